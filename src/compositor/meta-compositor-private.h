@@ -78,6 +78,9 @@ void         meta_compositor_damage_screen           (MetaCompositor  *composito
 
 void         meta_compositor_queue_redraw            (MetaCompositor  *compositor);
 
+void         meta_compositor_frames_presented        (MetaCompositor  *compositor,
+                                                      gint64           presentation_time);
+
 G_END_DECLS
 
 #endif
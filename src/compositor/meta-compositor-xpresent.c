@@ -111,6 +111,14 @@ meta_compositor_xpresent_process_event (MetaCompositor *compositor,
 
           if (generic_event_cookie->evtype == PresentCompleteNotify)
             {
+              XPresentCompleteNotifyEvent *complete_event;
+
+              complete_event = generic_event_cookie->data;
+
+              /* The server's clock is the monotonic one we use too */
+              meta_compositor_frames_presented (compositor,
+                                                complete_event->ust);
+
               meta_compositor_queue_redraw (compositor);
               self->present_pending = FALSE;
             }
@@ -133,6 +141,45 @@ meta_compositor_xpresent_ready_to_redraw (MetaCompositor *compositor)
   return !self->present_pending;
 }
 
+static guint fall_back_id = 0;
+
+static gboolean
+fall_back_idle_cb (gpointer user_data)
+{
+  MetaDisplay *display;
+
+  display = user_data;
+  fall_back_id = 0;
+
+  g_unsetenv ("META_COMPOSITOR");
+  meta_display_update_compositor (display);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+present_pixmap_result_cb (MetaDisplay *display,
+                          int          error_code,
+                          gpointer     user_data)
+{
+  char error_text[64];
+
+  if (error_code == Success)
+    return;
+
+  XGetErrorText (meta_display_get_xdisplay (display),
+                 error_code, error_text, 63);
+
+  g_warning ("XPresentPixmap failed with error %i (%s)",
+             error_code, error_text);
+
+  /* This may run from within a redraw, so don't replace the compositor
+   * from under it.
+   */
+  if (fall_back_id == 0)
+    fall_back_id = g_idle_add (fall_back_idle_cb, display);
+}
+
 static void
 meta_compositor_xpresent_redraw (MetaCompositor *compositor,
                                  XserverRegion   all_damage)
@@ -140,7 +187,6 @@ meta_compositor_xpresent_redraw (MetaCompositor *compositor,
   MetaCompositorXPresent *self;
   MetaDisplay *display;
   Display *xdisplay;
-  int result;
 
   self = META_COMPOSITOR_XPRESENT (compositor);
 
@@ -171,22 +217,10 @@ meta_compositor_xpresent_redraw (MetaCompositor *compositor,
                   NULL,
                   0);
 
-  result = meta_error_trap_pop_with_return (display);
-
-  if (result != Success)
-    {
-      char error_text[64];
-
-      XGetErrorText (xdisplay, result, error_text, 63);
-
-      g_warning ("XPresentPixmap failed with error %i (%s)",
-                 result, error_text);
-
-      g_unsetenv ("META_COMPOSITOR");
-      meta_display_update_compositor (display);
-
-      return;
-    }
+  /* Presenting happens every frame, so don't wait for the server here;
+   * a failure is reported once it has processed the request.
+   */
+  meta_error_trap_pop_async (display, present_pixmap_result_cb, NULL);
 
   self->root_current = !self->root_current;
   self->present_pending = TRUE;
@@ -53,8 +53,26 @@ typedef struct
 
   /* meta_compositor_queue_redraw */
   guint          redraw_id;
+
+  /* FrameInfo for clients that finished a frame, waiting for the next
+   * redraw, and for those drawn, waiting for it to be presented
+   */
+  GList         *frames_to_draw;
+  GList         *frames_drawn;
 } MetaCompositorPrivate;
 
+typedef struct
+{
+  MetaWindow *window;
+
+  /* The even value of the client's extended sync counter that ended
+   * the frame
+   */
+  guint64     counter_value;
+
+  gint64      drawn_time;
+} FrameInfo;
+
 enum
 {
   PROP_0,
@@ -164,6 +182,160 @@ find_surface_by_xwindow (MetaCompositor *compositor,
   return surface;
 }
 
+static void
+frame_message_result_cb (MetaDisplay *display,
+                         int          error_code,
+                         gpointer     user_data)
+{
+  /* The client may have destroyed its window in the meantime */
+}
+
+static void
+send_frame_message (MetaCompositor *compositor,
+                    FrameInfo      *frame,
+                    Atom            message_type,
+                    long            data2,
+                    long            data3,
+                    long            data4)
+{
+  MetaCompositorPrivate *priv;
+  XClientMessageEvent ev;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  ev.type = ClientMessage;
+  ev.window = meta_window_get_xwindow (frame->window);
+  ev.message_type = message_type;
+  ev.format = 32;
+  ev.data.l[0] = frame->counter_value & G_GUINT64_CONSTANT (0xffffffff);
+  ev.data.l[1] = frame->counter_value >> 32;
+  ev.data.l[2] = data2;
+  ev.data.l[3] = data3;
+  ev.data.l[4] = data4;
+
+  meta_error_trap_push (priv->display);
+
+  XSendEvent (priv->display->xdisplay, ev.window, False, 0, (XEvent *) &ev);
+
+  /* Sent every frame, so don't wait for the server here */
+  meta_error_trap_pop_async (priv->display, frame_message_result_cb, NULL);
+}
+
+/* Tells the client that the frame has been drawn, so that it can start
+ * on the next one. Times are in microseconds of the monotonic clock,
+ * which is what the X server uses too.
+ */
+static void
+send_frame_drawn (MetaCompositor *compositor,
+                  FrameInfo      *frame)
+{
+  MetaCompositorPrivate *priv;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  send_frame_message (compositor, frame,
+                      priv->display->atom__NET_WM_FRAME_DRAWN,
+                      frame->drawn_time & G_GINT64_CONSTANT (0xffffffff),
+                      frame->drawn_time >> 32,
+                      0);
+}
+
+/* Tells the client when the frame reached the screen, if we know, and
+ * how often the screen refreshes, so that it can pace its drawing
+ */
+static void
+send_frame_timings (MetaCompositor *compositor,
+                    FrameInfo      *frame,
+                    gint64          presentation_time)
+{
+  MetaCompositorPrivate *priv;
+  const MetaMonitorInfo *monitor;
+  gint64 presentation_offset;
+  long refresh_interval;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  /* 0 means unknown, so a frame presented as it was drawn gets 1 */
+  presentation_offset = 0;
+  if (presentation_time != 0)
+    {
+      presentation_offset = presentation_time - frame->drawn_time;
+
+      if (presentation_offset == 0)
+        presentation_offset = 1;
+      else if (presentation_offset != (gint32) presentation_offset)
+        presentation_offset = 0;
+    }
+
+  monitor = meta_screen_get_monitor_for_window (meta_window_get_screen (frame->window),
+                                                frame->window);
+  refresh_interval = (long) (G_USEC_PER_SEC / monitor->refresh_rate);
+
+  send_frame_message (compositor, frame,
+                      priv->display->atom__NET_WM_FRAME_TIMINGS,
+                      (gint32) presentation_offset,
+                      refresh_interval,
+                      0);
+}
+
+static GList *
+remove_window_frames (GList      *frames,
+                      MetaWindow *window)
+{
+  GList *l;
+
+  l = frames;
+  while (l != NULL)
+    {
+      GList *next = l->next;
+      FrameInfo *frame = l->data;
+
+      if (frame->window == window)
+        {
+          g_free (frame);
+          frames = g_list_delete_link (frames, l);
+        }
+
+      l = next;
+    }
+
+  return frames;
+}
+
+static void
+finish_frames (MetaCompositor *compositor)
+{
+  MetaCompositorPrivate *priv;
+  gint64 drawn_time;
+  GList *l;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  if (priv->frames_to_draw == NULL)
+    return;
+
+  drawn_time = g_get_monotonic_time ();
+
+  for (l = priv->frames_to_draw; l != NULL; l = l->next)
+    {
+      FrameInfo *frame = l->data;
+
+      frame->drawn_time = drawn_time;
+      send_frame_drawn (compositor, frame);
+    }
+
+  priv->frames_drawn = g_list_concat (priv->frames_drawn,
+                                      priv->frames_to_draw);
+  priv->frames_to_draw = NULL;
+
+  /* A compositor that waits for the server to present what it drew
+   * isn't ready to draw again until then, and tells us when it is;
+   * the others can't tell when a frame reaches the screen.
+   */
+  if (META_COMPOSITOR_GET_CLASS (compositor)->ready_to_redraw (compositor))
+    meta_compositor_frames_presented (compositor, 0);
+}
+
 static gboolean
 redraw_idle_cb (gpointer user_data)
 {
@@ -191,6 +363,8 @@ redraw_idle_cb (gpointer user_data)
       priv->all_damage = None;
     }
 
+  finish_frames (compositor);
+
   priv->redraw_id = 0;
 
   return G_SOURCE_REMOVE;
@@ -228,6 +402,10 @@ meta_compositor_dispose (GObject *object)
   g_clear_pointer (&priv->surfaces, g_hash_table_destroy);
   g_clear_pointer (&priv->stack, g_list_free);
 
+  /* Don't leave clients waiting for frames we won't draw */
+  finish_frames (compositor);
+  meta_compositor_frames_presented (compositor, 0);
+
   G_OBJECT_CLASS (meta_compositor_parent_class)->dispose (object);
 }
 
@@ -450,6 +628,9 @@ meta_compositor_remove_window (MetaCompositor *compositor,
 
   priv->stack = g_list_remove (priv->stack, surface);
   g_hash_table_remove (priv->surfaces, window);
+
+  priv->frames_to_draw = remove_window_frames (priv->frames_to_draw, window);
+  priv->frames_drawn = remove_window_frames (priv->frames_drawn, window);
 }
 
 void
@@ -539,6 +720,56 @@ meta_compositor_set_updates_frozen (MetaCompositor *compositor,
                                     MetaWindow     *window,
                                     gboolean        updates_frozen)
 {
+  MetaCompositorPrivate *priv;
+  MetaSurface *surface;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  surface = g_hash_table_lookup (priv->surfaces, window);
+  if (surface == NULL)
+    return;
+
+  meta_surface_set_frozen (surface, updates_frozen);
+}
+
+/**
+ * meta_compositor_queue_frame_drawn:
+ * @compositor: a #MetaCompositor
+ * @window: a #MetaWindow
+ * @counter_value: the even value the client set its extended sync
+ *   counter to
+ *
+ * Sends the window _NET_WM_FRAME_DRAWN and _NET_WM_FRAME_TIMINGS for the
+ * frame it has just finished, once the frame has been drawn to the
+ * screen; right away if we aren't compositing.
+ */
+void
+meta_compositor_queue_frame_drawn (MetaCompositor *compositor,
+                                   MetaWindow     *window,
+                                   guint64         counter_value)
+{
+  MetaCompositorPrivate *priv;
+  FrameInfo *frame;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  frame = g_new0 (FrameInfo, 1);
+  frame->window = window;
+  frame->counter_value = counter_value;
+
+  if (priv->composited &&
+      g_hash_table_lookup (priv->surfaces, window) != NULL)
+    {
+      priv->frames_to_draw = g_list_append (priv->frames_to_draw, frame);
+      meta_compositor_queue_redraw (compositor);
+      return;
+    }
+
+  /* Nothing of ours will show the frame, so it is as drawn as it gets */
+  frame->drawn_time = g_get_monotonic_time ();
+  send_frame_drawn (compositor, frame);
+  send_frame_timings (compositor, frame, 0);
+  g_free (frame);
 }
 
 void
@@ -977,6 +1208,30 @@ meta_compositor_damage_screen (MetaCompositor *compositor)
   XFixesDestroyRegion (xdisplay, screen_region);
 }
 
+/**
+ * meta_compositor_frames_presented:
+ * @compositor: a #MetaCompositor
+ * @presentation_time: when the last frame drawn reached the screen, in
+ *   microseconds of the monotonic clock, or 0 if unknown
+ *
+ * Sends _NET_WM_FRAME_TIMINGS for the frames drawn so far.
+ */
+void
+meta_compositor_frames_presented (MetaCompositor *compositor,
+                                  gint64          presentation_time)
+{
+  MetaCompositorPrivate *priv;
+  GList *l;
+
+  priv = meta_compositor_get_instance_private (compositor);
+
+  for (l = priv->frames_drawn; l != NULL; l = l->next)
+    send_frame_timings (compositor, l->data, presentation_time);
+
+  g_list_free_full (priv->frames_drawn, g_free);
+  priv->frames_drawn = NULL;
+}
+
 void
 meta_compositor_queue_redraw (MetaCompositor *compositor)
 {
@@ -39,6 +39,11 @@ typedef struct
   Damage           damage;
   gboolean         damage_received;
 
+  /* The client is in the middle of drawing, so its damage is left for
+   * when it is done
+   */
+  gboolean         frozen;
+
   Pixmap           pixmap;
 
   int              x;
@@ -374,6 +379,8 @@ meta_surface_constructed (GObject *object)
   meta_surface_sync_geometry (self);
   create_damage (self);
 
+  priv->frozen = meta_window_updates_are_frozen (priv->window);
+
   g_signal_connect_object (priv->window, "notify::decorated",
                            G_CALLBACK (notify_decorated_cb),
                            self, 0);
@@ -760,9 +767,30 @@ meta_surface_process_damage (MetaSurface        *self,
 
   priv->damage_received = TRUE;
 
+  if (priv->frozen)
+    return;
+
   meta_compositor_queue_redraw (priv->compositor);
 }
 
+void
+meta_surface_set_frozen (MetaSurface *self,
+                         gboolean     frozen)
+{
+  MetaSurfacePrivate *priv;
+
+  priv = meta_surface_get_instance_private (self);
+
+  if (priv->frozen == frozen)
+    return;
+
+  priv->frozen = frozen;
+
+  /* Show whatever the client drew while it was frozen */
+  if (!frozen && priv->damage_received)
+    meta_compositor_queue_redraw (priv->compositor);
+}
+
 void
 meta_surface_opacity_changed (MetaSurface *self)
 {
@@ -891,7 +919,7 @@ meta_surface_pre_paint (MetaSurface *self)
   damage = XFixesCreateRegion (priv->xdisplay, NULL, 0);
   has_damage = FALSE;
 
-  if (priv->damage_received)
+  if (priv->damage_received && !priv->frozen)
     {
       meta_error_trap_push (priv->display);
       XDamageSubtract (priv->xdisplay, priv->damage, None, damage);
@@ -60,6 +60,9 @@ void             meta_surface_hide                  (MetaSurface        *self);
 void             meta_surface_process_damage        (MetaSurface        *self,
                                                      XDamageNotifyEvent *event);
 
+void             meta_surface_set_frozen            (MetaSurface        *self,
+                                                     gboolean            frozen);
+
 void             meta_surface_opacity_changed       (MetaSurface        *self);
 
 void             meta_surface_opaque_region_changed (MetaSurface        *self);
@@ -73,23 +73,61 @@ struct _AgGetPropertyTask
   Bool have_reply;
 };
 
+struct _AgGetAttributesTask
+{
+  Display *display;
+  Window window;
+
+  /* GetWindowAttributes and GetGeometry, sent back to back */
+  unsigned long attributes_seq;
+  unsigned long geometry_seq;
+  int error;
+  int n_replies;
+
+  XWindowAttributes attrs;
+};
+
+typedef struct
+{
+  unsigned long request_seq;
+
+  /* Both NULL once the task has completed; only possible away from
+   * the head of the ring, when replies arrive out of order
+   */
+  AgGetPropertyTask *task;
+  AgGetAttributesTask *attrs_task;
+} AgPendingSlot;
+
 struct _AgPerDisplayData
 {
   ListNode node;
   _XAsyncHandler async;
 
   Display *display;
-  ListNode *pending_tasks;
-  ListNode *pending_tasks_tail;
+
+  /* Pending tasks in request order, in a ring buffer whose size is
+   * always a power of two; the oldest slot is never a hole
+   */
+  AgPendingSlot *pending;
+  int pending_size;
+  int pending_head;
+  int pending_count;
+
   ListNode *completed_tasks;
   ListNode *completed_tasks_tail;
   int n_tasks_pending;
   int n_tasks_completed;
 };
 
+#define PENDING_SLOT(dd, i) \
+  (&(dd)->pending[((dd)->pending_head + (i)) & ((dd)->pending_size - 1)])
+
 static ListNode *display_datas = NULL;
 static ListNode *display_datas_tail = NULL;
 
+static unsigned long n_replies_in_order = 0;
+static unsigned long n_replies_out_of_order = 0;
+
 static void
 append_to_list (ListNode **head,
                 ListNode **tail,
@@ -145,61 +183,231 @@ remove_from_list (ListNode **head,
   node->next = NULL;
 }
 
+static Bool
+append_to_pending (AgPerDisplayData    *dd,
+                   unsigned long        request_seq,
+                   AgGetPropertyTask   *task,
+                   AgGetAttributesTask *attrs_task)
+{
+  AgPendingSlot *slot;
+
+  if (dd->pending_count == dd->pending_size)
+    {
+      AgPendingSlot *new_pending;
+      int new_size;
+      int i;
+
+      new_size = dd->pending_size > 0 ? dd->pending_size * 2 : 16;
+      new_pending = Xmalloc (new_size * sizeof (AgPendingSlot));
+      if (new_pending == NULL)
+        return False;
+
+      /* Unwrap the ring while copying */
+      for (i = 0; i < dd->pending_count; i++)
+        new_pending[i] = *PENDING_SLOT (dd, i);
+
+      if (dd->pending)
+        XFree (dd->pending);
+
+      dd->pending = new_pending;
+      dd->pending_size = new_size;
+      dd->pending_head = 0;
+    }
+
+  slot = PENDING_SLOT (dd, dd->pending_count);
+  slot->request_seq = request_seq;
+  slot->task = task;
+  slot->attrs_task = attrs_task;
+
+  dd->pending_count += 1;
+  dd->n_tasks_pending += 1;
+
+  return True;
+}
+
+static Bool
+slot_is_hole (AgPendingSlot *slot)
+{
+  return slot->task == NULL && slot->attrs_task == NULL;
+}
+
 static void
-move_to_completed (AgPerDisplayData  *dd,
-                   AgGetPropertyTask *task)
+remove_from_pending (AgPerDisplayData *dd,
+                     int               index)
 {
-  remove_from_list (&dd->pending_tasks,
-                    &dd->pending_tasks_tail,
-                    &task->node);
+  AgPendingSlot *slot;
+
+  slot = PENDING_SLOT (dd, index);
+  slot->task = NULL;
+  slot->attrs_task = NULL;
+
+  /* Drop the head along with any holes left behind it */
+  while (dd->pending_count > 0 &&
+         slot_is_hole (PENDING_SLOT (dd, 0)))
+    {
+      dd->pending_head = (dd->pending_head + 1) & (dd->pending_size - 1);
+      dd->pending_count -= 1;
+    }
+
+  dd->n_tasks_pending -= 1;
+}
 
+static void
+move_to_completed (AgPerDisplayData  *dd,
+                   int                index)
+{
   append_to_list (&dd->completed_tasks,
                   &dd->completed_tasks_tail,
-                  &task->node);
+                  &PENDING_SLOT (dd, index)->task->node);
+
+  remove_from_pending (dd, index);
 
-  dd->n_tasks_pending -= 1;
   dd->n_tasks_completed += 1;
 }
 
-static AgGetPropertyTask*
+/* Returns the ring index of the pending task with this request
+ * sequence, or -1
+ */
+static int
 find_pending_by_request_sequence (AgPerDisplayData *dd,
                                   unsigned long     request_seq)
 {
-  ListNode *node;
+  int low, high;
 
-  /* if the sequence is after our last pending task, we
-   * aren't going to find a match
+  if (dd->pending_count == 0)
+    return -1;
+
+  /* Replies come in the order we sent the requests, so if the reply
+   * is for one of our tasks at all, it is nearly always the head.
    */
-  {
-    AgGetPropertyTask *task = (AgGetPropertyTask*) dd->pending_tasks_tail;
-    if (task != NULL)
-      {
-        if (task->request_seq < request_seq)
-          return NULL;
-        else if (task->request_seq == request_seq)
-          return task; /* why not check this */
-      }
-  }
-
-  /* Generally we should get replies in the order we sent
-   * requests, so we should usually be using the task
-   * at the head of the list, if we use any task at all.
-   * I'm not sure this is 100% guaranteed, if it is,
-   * it would be a big speedup.
+  if (PENDING_SLOT (dd, 0)->request_seq == request_seq)
+    {
+      n_replies_in_order += 1;
+      return 0;
+    }
+
+  /* Replies to other requests, older or newer than any of ours */
+  if (request_seq < PENDING_SLOT (dd, 0)->request_seq ||
+      request_seq > PENDING_SLOT (dd, dd->pending_count - 1)->request_seq)
+    return -1;
+
+  /* Otherwise fall back to a binary search; the ring is sorted by
+   * sequence, holes included, so this is at most log2 of the number of
+   * pending tasks.
    */
+  low = 1;
+  high = dd->pending_count - 1;
+  while (low <= high)
+    {
+      AgPendingSlot *slot;
+      int mid;
 
-  node = dd->pending_tasks;
-  while (node != NULL)
+      mid = low + (high - low) / 2;
+      slot = PENDING_SLOT (dd, mid);
+
+      if (slot->request_seq == request_seq)
+        {
+          if (slot_is_hole (slot))
+            return -1;
+
+          n_replies_out_of_order += 1;
+          return mid;
+        }
+      else if (slot->request_seq < request_seq)
+        low = mid + 1;
+      else
+        high = mid - 1;
+    }
+
+  return -1;
+}
+
+static Bool
+async_get_attributes_reply (Display             *dpy,
+                            AgGetAttributesTask *task,
+                            xReply              *rep,
+                            char                *buf,
+                            int                  len)
+{
+  XWindowAttributes *attrs;
+
+  task->n_replies += 1;
+
+  if (rep->generic.type == X_Error)
     {
-      AgGetPropertyTask *task = (AgGetPropertyTask*) node;
+      xError errbuf;
 
-      if (task->request_seq == request_seq)
-        return task;
+      /* Eaten for the same reason as GetProperty errors below */
+      if (task->error == Success)
+        task->error = rep->error.errorCode;
 
-      node = node->next;
+      _XGetAsyncReply (dpy, (char *)&errbuf, rep, buf, len,
+                       (SIZEOF (xError) - SIZEOF (xReply)) >> 2,
+                       False);
+
+      return True;
     }
 
-  return NULL;
+  attrs = &task->attrs;
+
+  /* Copied from XGetWindowAttributes() */
+  if (dpy->last_request_read == task->attributes_seq)
+    {
+      xGetWindowAttributesReply  replbuf;
+      xGetWindowAttributesReply *reply;
+
+      reply = (xGetWindowAttributesReply *)
+        _XGetAsyncReply (dpy, (char *)&replbuf, rep, buf, len,
+                         (SIZEOF (xGetWindowAttributesReply) - SIZEOF (xReply)) >> 2,
+                         True);
+
+      attrs->class = reply->class;
+      attrs->bit_gravity = reply->bitGravity;
+      attrs->win_gravity = reply->winGravity;
+      attrs->backing_store = reply->backingStore;
+      attrs->backing_planes = reply->backingBitPlanes;
+      attrs->backing_pixel = reply->backingPixel;
+      attrs->save_under = reply->saveUnder;
+      attrs->colormap = reply->colormap;
+      attrs->map_installed = reply->mapInstalled;
+      attrs->map_state = reply->mapState;
+      attrs->override_redirect = reply->override;
+      attrs->all_event_masks = reply->allEventMasks;
+      attrs->your_event_mask = reply->yourEventMask;
+      attrs->do_not_propagate_mask = reply->doNotPropagateMask;
+      attrs->visual = _XVIDtoVisual (dpy, reply->visualID);
+    }
+  else
+    {
+      xGetGeometryReply  replbuf;
+      xGetGeometryReply *reply;
+      int i;
+
+      reply = (xGetGeometryReply *)
+        _XGetAsyncReply (dpy, (char *)&replbuf, rep, buf, len,
+                         (SIZEOF (xGetGeometryReply) - SIZEOF (xReply)) >> 2,
+                         True);
+
+      attrs->x = cvtINT16toInt (reply->x);
+      attrs->y = cvtINT16toInt (reply->y);
+      attrs->width = reply->width;
+      attrs->height = reply->height;
+      attrs->border_width = reply->borderWidth;
+      attrs->depth = reply->depth;
+      attrs->root = reply->root;
+
+      attrs->screen = NULL;
+      for (i = 0; i < dpy->nscreens; i++)
+        {
+          if (dpy->screens[i].root == attrs->root)
+            {
+              attrs->screen = &dpy->screens[i];
+              break;
+            }
+        }
+    }
+
+  return True;
 }
 
 static Bool
@@ -214,6 +422,7 @@ async_get_property_handler (Display *dpy,
   AgGetPropertyTask *task;
   AgPerDisplayData *dd;
   int bytes_read;
+  int index;
 
   dd = (void*) data;
 
@@ -222,15 +431,27 @@ async_get_property_handler (Display *dpy,
           dpy->last_request_read, len);
 #endif
 
-  task = find_pending_by_request_sequence (dd, dpy->last_request_read);
+  index = find_pending_by_request_sequence (dd, dpy->last_request_read);
 
-  if (task == NULL)
+  if (index < 0)
     return False;
 
+  if (PENDING_SLOT (dd, index)->attrs_task != NULL)
+    {
+      AgGetAttributesTask *attrs_task;
+
+      attrs_task = PENDING_SLOT (dd, index)->attrs_task;
+      remove_from_pending (dd, index);
+
+      return async_get_attributes_reply (dpy, attrs_task, rep, buf, len);
+    }
+
+  task = PENDING_SLOT (dd, index)->task;
+
   assert (dpy->last_request_read == task->request_seq);
 
   task->have_reply = True;
-  move_to_completed (dd, task);
+  move_to_completed (dd, index);
 
   /* read bytes so far */
   bytes_read = SIZEOF (xReply);
@@ -503,12 +724,14 @@ get_display_data (Display *display,
 static void
 maybe_free_display_data (AgPerDisplayData *dd)
 {
-  if (dd->pending_tasks == NULL &&
+  if (dd->pending_count == 0 &&
       dd->completed_tasks == NULL)
     {
       DeqAsyncHandler (dd->display, &dd->async);
       remove_from_list (&display_datas, &display_datas_tail,
                         &dd->node);
+      if (dd->pending)
+        XFree (dd->pending);
       XFree (dd);
     }
 }
@@ -557,10 +780,12 @@ ag_task_create (Display *dpy,
   task->property = property;
   task->request_seq = dpy->request;
 
-  append_to_list (&dd->pending_tasks,
-                  &dd->pending_tasks_tail,
-                  &task->node);
-  dd->n_tasks_pending += 1;
+  if (!append_to_pending (dd, task->request_seq, task, NULL))
+    {
+      XFree (task);
+      UnlockDisplay (dpy);
+      return NULL;
+    }
 
   UnlockDisplay (dpy);
 
@@ -648,6 +873,92 @@ ag_task_get_display (AgGetPropertyTask *task)
   return task->dd->display;
 }
 
+AgGetAttributesTask*
+ag_attributes_task_create (Display *dpy,
+                           Window   window)
+{
+  AgGetAttributesTask *task;
+  xResourceReq *req;
+  AgPerDisplayData *dd;
+
+  LockDisplay (dpy);
+
+  dd = get_display_data (dpy, True);
+  if (dd == NULL)
+    {
+      UnlockDisplay (dpy);
+      return NULL;
+    }
+
+  task = Xcalloc (1, sizeof (AgGetAttributesTask));
+  if (task == NULL)
+    {
+      maybe_free_display_data (dd);
+      UnlockDisplay (dpy);
+      return NULL;
+    }
+
+  task->display = dpy;
+  task->window = window;
+
+  /* XGetWindowAttributes() needs both of these, and so do we */
+  GetResReq (GetWindowAttributes, window, req);
+  task->attributes_seq = dpy->request;
+
+  GetResReq (GetGeometry, window, req);
+  task->geometry_seq = dpy->request;
+
+  /* The requests are out already; if we can't track both of them,
+   * track neither, so the task is done and nothing points at it.
+   */
+  if (!append_to_pending (dd, task->attributes_seq, NULL, task))
+    {
+      task->error = BadAlloc;
+      task->n_replies = 2;
+    }
+  else if (!append_to_pending (dd, task->geometry_seq, NULL, task))
+    {
+      remove_from_pending (dd, dd->pending_count - 1);
+      task->error = BadAlloc;
+      task->n_replies = 2;
+    }
+
+  UnlockDisplay (dpy);
+
+  SyncHandle ();
+
+  return task;
+}
+
+Bool
+ag_attributes_task_have_reply (AgGetAttributesTask *task)
+{
+  return task->n_replies == 2;
+}
+
+Status
+ag_attributes_task_get_reply_and_free (AgGetAttributesTask *task,
+                                       XWindowAttributes   *attrs)
+{
+  AgPerDisplayData *dd;
+  Status s;
+
+  /* The pending slots point at the task until both replies are in */
+  assert (ag_attributes_task_have_reply (task));
+
+  s = task->error;
+  if (s == Success)
+    *attrs = task->attrs;
+
+  dd = get_display_data (task->display, False);
+  if (dd != NULL)
+    maybe_free_display_data (dd);
+
+  XFree (task);
+
+  return s;
+}
+
 AgGetPropertyTask*
 ag_get_next_completed_task (Display *display)
 {
@@ -667,6 +978,63 @@ ag_get_next_completed_task (Display *display)
   return (AgGetPropertyTask*) dd->completed_tasks;
 }
 
+void
+ag_fail_unanswered_tasks (Display *dpy)
+{
+  AgPerDisplayData *dd;
+
+  LockDisplay (dpy);
+
+  dd = get_display_data (dpy, False);
+  if (dd == NULL)
+    {
+      UnlockDisplay (dpy);
+      return;
+    }
+
+  /* Replies and errors come in request order, so anything at or before
+   * the last request the server answered that is still pending got an
+   * error the async handler never saw.
+   */
+  while (dd->pending_count > 0 &&
+         PENDING_SLOT (dd, 0)->request_seq <= dpy->last_request_read)
+    {
+      AgPendingSlot *slot;
+
+      slot = PENDING_SLOT (dd, 0);
+
+      if (slot->attrs_task != NULL)
+        {
+          AgGetAttributesTask *attrs_task;
+
+          /* The real error code is lost; callers only check for Success */
+          attrs_task = slot->attrs_task;
+          if (attrs_task->error == Success)
+            attrs_task->error = BadWindow;
+          attrs_task->n_replies += 1;
+
+          remove_from_pending (dd, 0);
+        }
+      else
+        {
+          slot->task->error = BadWindow;
+          slot->task->have_reply = True;
+
+          move_to_completed (dd, 0);
+        }
+    }
+
+  UnlockDisplay (dpy);
+}
+
+void
+ag_get_reply_stats (unsigned long *in_order,
+                    unsigned long *out_of_order)
+{
+  *in_order = n_replies_in_order;
+  *out_of_order = n_replies_out_of_order;
+}
+
 void*
 ag_Xmalloc (unsigned long bytes)
 {
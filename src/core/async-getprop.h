@@ -56,6 +56,33 @@ Display* ag_task_get_display  (AgGetPropertyTask *task);
 
 AgGetPropertyTask* ag_get_next_completed_task (Display *display);
 
+/* The equivalent of XGetWindowAttributes(), sharing the bookkeeping
+ * of the GetProperty tasks. These never show up in
+ * ag_get_next_completed_task(); the reply can only be taken, and the
+ * task freed, once ag_attributes_task_have_reply() is true.
+ */
+typedef struct _AgGetAttributesTask AgGetAttributesTask;
+
+AgGetAttributesTask* ag_attributes_task_create             (Display             *display,
+                                                            Window               window);
+Bool                 ag_attributes_task_have_reply         (AgGetAttributesTask *task);
+Status               ag_attributes_task_get_reply_and_free (AgGetAttributesTask *task,
+                                                            XWindowAttributes   *attrs);
+
+/* Completes, as failed, every task whose requests the server has
+ * already answered without the answer reaching us: when Xlib runs on
+ * XCB, errors go to the error handler rather than to async handlers.
+ * Call it after an XSync() or once a later reply has arrived, with the
+ * errors themselves trapped.
+ */
+void ag_fail_unanswered_tasks (Display *display);
+
+/* Number of replies that matched the oldest pending task, and the
+ * number that had to be looked up further back
+ */
+void ag_get_reply_stats (unsigned long *in_order,
+                         unsigned long *out_of_order);
+
 /* so other headers don't have to include internal Xlib goo */
 void*    ag_Xmalloc  (unsigned long bytes);
 void*    ag_Xmalloc0 (unsigned long bytes);
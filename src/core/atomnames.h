@@ -67,6 +67,7 @@ item(_GNOME_WM_STRUT_AREA)
 item(_METACITY_TIMESTAMP_PING)
 item(_METACITY_FOCUS_SET)
 item(_METACITY_SENTINEL)
+item(_METACITY_REPLY_SENTINEL)
 item(_METACITY_VERSION)
 item(WM_CLIENT_MACHINE)
 item(MANAGER)
@@ -171,6 +172,8 @@ item(_NET_WM_STATE_FOCUSED)
 item(_NET_WM_OPAQUE_REGION)
 item(_NET_RESTACK_WINDOW)
 item(_NET_WM_WINDOW_OPACITY)
+item(_NET_WM_FRAME_DRAWN)
+item(_NET_WM_FRAME_TIMINGS)
 
 /* eof atomnames.h */
 
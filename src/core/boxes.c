@@ -373,37 +373,102 @@ meta_rectangle_resize_with_gravity (const MetaRectangle *old_rect,
   rect->height = new_height;
 }
 
-/* Not so simple helper function for get_minimal_spanning_set_for_region() */
+/* The regions and strut lists we work on are kept in GArrays of
+ * MetaRectangles rather than in lists of separately allocated ones, so
+ * that splitting and merging rectangles doesn't have to allocate and free
+ * each of them; the results are only turned into lists at the end.
+ */
+static GArray*
+rect_array_new (void)
+{
+  return g_array_sized_new (FALSE, FALSE, sizeof (MetaRectangle), 16);
+}
+
 static GList*
-merge_spanning_rects_in_region (GList *region)
+rect_array_to_list (GArray *rects)
+{
+  GList *ret;
+  int i;
+
+  ret = NULL;
+  for (i = (int) rects->len - 1; i >= 0; i--)
+    ret = g_list_prepend (ret,
+                          g_memdup2 (&g_array_index (rects, MetaRectangle, i),
+                                     sizeof (MetaRectangle)));
+
+  return ret;
+}
+
+/* Reverses rects, so that a pass appending to it leaves it in the order
+ * prepending to a list used to.
+ */
+static void
+rect_array_reverse (GArray *rects)
+{
+  MetaRectangle *data = (MetaRectangle *) rects->data;
+  int i, j;
+
+  for (i = 0, j = (int) rects->len - 1; i < j; i++, j--)
+    {
+      MetaRectangle tmp = data[i];
+
+      data[i] = data[j];
+      data[j] = tmp;
+    }
+}
+
+/* Not so simple helper function for get_minimal_spanning_set_for_region() */
+static void
+merge_spanning_rects_in_region (GArray *region)
 {
   /* NOTE FOR ANY OPTIMIZATION PEOPLE OUT THERE: Please see the
    * documentation of get_minimal_spanning_set_for_region() for performance
    * considerations that also apply to this function.
    */
 
-  GList* compare;
-  compare = region;
+  MetaRectangle *rects;
+  int *next;
+  int *prev;
+  int n_rects;
+  int first;
+  int compare;
+  int i;
 
-  if (region == NULL)
+  if (region->len == 0)
     {
       g_warning ("Region to merge was empty!  Either you have a some "
                  "pathological STRUT list or there's a bug somewhere!");
 
-      return NULL;
+      return;
+    }
+
+  rects = (MetaRectangle *) region->data;
+  n_rects = region->len;
+
+  /* The rectangles still in the region, linked in their original order;
+   * -1 ends the list
+   */
+  next = g_new (int, n_rects);
+  prev = g_new (int, n_rects);
+  for (i = 0; i < n_rects; i++)
+    {
+      next[i] = i + 1 < n_rects ? i + 1 : -1;
+      prev[i] = i - 1;
     }
+  first = 0;
 
-  while (compare && compare->next)
+  compare = first;
+  while (compare >= 0 && next[compare] >= 0)
     {
-      MetaRectangle *a = compare->data;
-      GList *other = compare->next;
+      MetaRectangle *a = &rects[compare];
+      int other = next[compare];
 
       g_assert (a->width > 0 && a->height > 0);
 
-      while (other)
+      while (other >= 0)
         {
-          MetaRectangle *b = other->data;
-          GList *delete_me = NULL;
+          MetaRectangle *b = &rects[other];
+          int delete_me = -1;
 
           g_assert (b->width > 0 && b->height > 0);
 
@@ -458,30 +523,39 @@ merge_spanning_rects_in_region (GList *region)
                 }
             }
 
-          other = other->next;
+          other = next[other];
 
           /* Delete any rectangle in the list that is no longer wanted */
-          if (delete_me != NULL)
+          if (delete_me >= 0)
             {
               /* Deleting the rect we compare others to is a little tricker */
               if (compare == delete_me)
                 {
-                  compare = compare->next;
-                  other = compare->next;
-                  a = compare->data;
+                  compare = next[compare];
+                  other = next[compare];
+                  a = &rects[compare];
                 }
 
-              /* Okay, we can free it now */
-              g_free (delete_me->data);
-              region = g_list_delete_link (region, delete_me);
+              if (prev[delete_me] >= 0)
+                next[prev[delete_me]] = next[delete_me];
+              else
+                first = next[delete_me];
+              if (next[delete_me] >= 0)
+                prev[next[delete_me]] = prev[delete_me];
             }
-
         }
 
-      compare = compare->next;
+      compare = next[compare];
     }
 
-  return region;
+  /* Close up the gaps left by the deleted rectangles */
+  n_rects = 0;
+  for (i = first; i >= 0; i = next[i])
+    rects[n_rects++] = rects[i];
+  g_array_set_size (region, n_rects);
+
+  g_free (prev);
+  g_free (next);
 }
 
 /* Simple helper function for get_minimal_spanning_set_for_region()... */
@@ -524,8 +598,8 @@ meta_rectangle_get_minimal_spanning_set_for_region (
   /* NOTE FOR OPTIMIZERS: This function *might* be somewhat slow,
    * especially due to the call to merge_spanning_rects_in_region() (which
    * is O(n^2) where n is the size of the list generated in this function).
-   * This is made more onerous due to the fact that it involves a fair
-   * number of memory allocation and deallocation calls.  However, n is 1
+   * The rectangles are kept in arrays while we work on them, so at least
+   * that doesn't take an allocation per rectangle.  However, n is 1
    * for default installations of Gnome (because partial struts aren't used
    * by default and only partial struts increase the size of the spanning
    * set generated).  With one partial strut, n will be 2 or 3.  With 2
@@ -557,10 +631,10 @@ meta_rectangle_get_minimal_spanning_set_for_region (
    *     URL splitting.)
    */
 
+  GArray        *rects;
+  GArray        *split;
   GList         *ret;
-  GList         *tmp_list;
   const GSList  *strut_iter;
-  MetaRectangle *temp_rect;
 
   /* The algorithm is basically as follows:
    *   Initialize rectangle_set to basic_rect
@@ -573,16 +647,16 @@ meta_rectangle_get_minimal_spanning_set_for_region (
    *         splitting
    */
 
-  temp_rect = g_new (MetaRectangle, 1);
-  *temp_rect = *basic_rect;
-  ret = g_list_prepend (NULL, temp_rect);
+  rects = rect_array_new ();
+  split = rect_array_new ();
+  g_array_append_val (rects, *basic_rect);
 
-  strut_iter = all_struts;
   for (strut_iter = all_struts; strut_iter; strut_iter = strut_iter->next)
     {
-      GList *rect_iter;
       MetaStrut *strut = (MetaStrut *) strut_iter->data;
       MetaRectangle *strut_rect = &strut->rect;
+      GArray *tmp;
+      guint i;
 
       if (skip_middle_struts && strut->edge == META_EDGE_MONITOR)
         {
@@ -599,66 +673,70 @@ meta_rectangle_get_minimal_spanning_set_for_region (
             }
         }
 
-      tmp_list = ret;
-      ret = NULL;
-      rect_iter = tmp_list;
-      while (rect_iter)
+      g_array_set_size (split, 0);
+      for (i = 0; i < rects->len; i++)
         {
-          MetaRectangle *rect = (MetaRectangle*) rect_iter->data;
-          if (!meta_rectangle_overlap (rect, strut_rect))
-            ret = g_list_prepend (ret, rect);
-          else
+          MetaRectangle rect = g_array_index (rects, MetaRectangle, i);
+          MetaRectangle temp_rect;
+
+          if (!meta_rectangle_overlap (&rect, strut_rect))
             {
-              /* If there is area in rect left of strut */
-              if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
-                {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect right of strut */
-              if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
-                {
-                  int new_x;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  new_x = BOX_RIGHT (*strut_rect);
-                  temp_rect->width = BOX_RIGHT(*rect) - new_x;
-                  temp_rect->x = new_x;
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect above strut */
-              if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
-                {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect below strut */
-              if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
-                {
-                  int new_y;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  new_y = BOX_BOTTOM (*strut_rect);
-                  temp_rect->height = BOX_BOTTOM (*rect) - new_y;
-                  temp_rect->y = new_y;
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              g_free (rect);
+              g_array_append_val (split, rect);
+              continue;
+            }
+
+          /* If there is area in rect left of strut */
+          if (BOX_LEFT (rect) < BOX_LEFT (*strut_rect))
+            {
+              temp_rect = rect;
+              temp_rect.width = BOX_LEFT (*strut_rect) - BOX_LEFT (rect);
+              g_array_append_val (split, temp_rect);
+            }
+          /* If there is area in rect right of strut */
+          if (BOX_RIGHT (rect) > BOX_RIGHT (*strut_rect))
+            {
+              int new_x;
+              temp_rect = rect;
+              new_x = BOX_RIGHT (*strut_rect);
+              temp_rect.width = BOX_RIGHT (rect) - new_x;
+              temp_rect.x = new_x;
+              g_array_append_val (split, temp_rect);
+            }
+          /* If there is area in rect above strut */
+          if (BOX_TOP (rect) < BOX_TOP (*strut_rect))
+            {
+              temp_rect = rect;
+              temp_rect.height = BOX_TOP (*strut_rect) - BOX_TOP (rect);
+              g_array_append_val (split, temp_rect);
+            }
+          /* If there is area in rect below strut */
+          if (BOX_BOTTOM (rect) > BOX_BOTTOM (*strut_rect))
+            {
+              int new_y;
+              temp_rect = rect;
+              new_y = BOX_BOTTOM (*strut_rect);
+              temp_rect.height = BOX_BOTTOM (rect) - new_y;
+              temp_rect.y = new_y;
+              g_array_append_val (split, temp_rect);
             }
-          rect_iter = rect_iter->next;
         }
-      g_list_free (tmp_list);
+      rect_array_reverse (split);
+
+      tmp = rects;
+      rects = split;
+      split = tmp;
     }
 
   /* Sort by maximal area, just because I feel like it... */
-  ret = g_list_sort (ret, compare_rect_areas);
+  g_array_sort (rects, compare_rect_areas);
 
   /* Merge rectangles if possible so that the list really is minimal */
-  ret = merge_spanning_rects_in_region (ret);
+  merge_spanning_rects_in_region (rects);
+
+  ret = rect_array_to_list (rects);
+
+  g_array_free (split, TRUE);
+  g_array_free (rects, TRUE);
 
   return ret;
 }
@@ -1175,84 +1253,60 @@ meta_rectangle_edge_aligns (const MetaRectangle *rect, const MetaEdge *edge)
     }
 }
 
-static GList*
-get_rect_minus_overlap (const GList   *rect_in_list,
-                        MetaRectangle *overlap)
+/* Appends the parts of rect outside of overlap to pieces, in the reverse
+ * of the order they are found in.
+ */
+static void
+get_rect_minus_overlap (const MetaRectangle *rect,
+                        const MetaRectangle *overlap,
+                        GArray              *pieces)
 {
-  MetaRectangle *temp;
-  MetaRectangle *rect = rect_in_list->data;
-  GList *ret = NULL;
+  MetaRectangle temp[4];
+  int n_temp;
 
+  n_temp = 0;
   if (BOX_LEFT (*rect) < BOX_LEFT (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      *temp = *rect;
-      temp->width = BOX_LEFT (*overlap) - BOX_LEFT (*rect);
-      ret = g_list_prepend (ret, temp);
+      temp[n_temp] = *rect;
+      temp[n_temp].width = BOX_LEFT (*overlap) - BOX_LEFT (*rect);
+      n_temp++;
     }
   if (BOX_RIGHT (*rect) > BOX_RIGHT (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      *temp = *rect;
-      temp->x = BOX_RIGHT (*overlap);
-      temp->width = BOX_RIGHT (*rect) - BOX_RIGHT (*overlap);
-      ret = g_list_prepend (ret, temp);
+      temp[n_temp] = *rect;
+      temp[n_temp].x = BOX_RIGHT (*overlap);
+      temp[n_temp].width = BOX_RIGHT (*rect) - BOX_RIGHT (*overlap);
+      n_temp++;
     }
   if (BOX_TOP (*rect) < BOX_TOP (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      temp->x      = overlap->x;
-      temp->width  = overlap->width;
-      temp->y      = BOX_TOP (*rect);
-      temp->height = BOX_TOP (*overlap) - BOX_TOP (*rect);
-      ret = g_list_prepend (ret, temp);
+      temp[n_temp].x      = overlap->x;
+      temp[n_temp].width  = overlap->width;
+      temp[n_temp].y      = BOX_TOP (*rect);
+      temp[n_temp].height = BOX_TOP (*overlap) - BOX_TOP (*rect);
+      n_temp++;
     }
   if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      temp->x      = overlap->x;
-      temp->width  = overlap->width;
-      temp->y      = BOX_BOTTOM (*overlap);
-      temp->height = BOX_BOTTOM (*rect) - BOX_BOTTOM (*overlap);
-      ret = g_list_prepend (ret, temp);
+      temp[n_temp].x      = overlap->x;
+      temp[n_temp].width  = overlap->width;
+      temp[n_temp].y      = BOX_BOTTOM (*overlap);
+      temp[n_temp].height = BOX_BOTTOM (*rect) - BOX_BOTTOM (*overlap);
+      n_temp++;
     }
 
-  return ret;
+  while (n_temp > 0)
+    g_array_append_val (pieces, temp[--n_temp]);
 }
 
-static GList*
-replace_rect_with_list (GList *old_element,
-                        GList *new_list)
+/* Replaces the rectangle at index with pieces */
+static void
+replace_rect_with_pieces (GArray *rects,
+                          guint   index,
+                          GArray *pieces)
 {
-  GList *ret;
-  g_assert (old_element != NULL);
-
-  if (!new_list)
-    {
-      /* If there is no new list, just remove the old_element */
-      ret = g_list_remove_link (old_element, old_element);
-    }
-  else
-    {
-      /* Fix up the prev and next pointers everywhere */
-      ret = new_list;
-      if (old_element->prev)
-        {
-          old_element->prev->next = new_list;
-          new_list->prev = old_element->prev;
-        }
-      if (old_element->next)
-        {
-          GList *tmp = g_list_last (new_list);
-          old_element->next->prev = tmp;
-          tmp->next = old_element->next;
-        }
-    }
-
-  /* Free the old_element and return the appropriate "next" point */
-  g_free (old_element->data);
-  g_list_free_1 (old_element);
-  return ret;
+  g_array_remove_index (rects, index);
+  g_array_insert_vals (rects, index, pieces->data, pieces->len);
 }
 
 /* Make a copy of the strut list, make sure that copy only contains parts
@@ -1261,79 +1315,76 @@ replace_rect_with_list (GList *old_element,
  * that aren't disjoint in a way that the overlapping part is only included
  * once, so it's not really magic...).
  */
-static GList*
+static GArray*
 get_disjoint_strut_rect_list_in_region (const GSList        *old_struts,
                                         const MetaRectangle *region)
 {
-  GList *strut_rects;
-  GList *tmp;
+  GArray *strut_rects;
+  GArray *cur_leftover;
+  GArray *comp_leftover;
+  guint tmp;
 
   /* First, copy the list */
-  strut_rects = NULL;
+  strut_rects = rect_array_new ();
   while (old_struts)
     {
-      MetaRectangle *cur = &((MetaStrut*)old_struts->data)->rect;
-      MetaRectangle *copy = g_new (MetaRectangle, 1);
-      *copy = *cur;
-      if (meta_rectangle_intersect (copy, region, copy))
-        strut_rects = g_list_prepend (strut_rects, copy);
-      else
-        g_free (copy);
+      MetaRectangle copy = ((MetaStrut*)old_struts->data)->rect;
+
+      if (meta_rectangle_intersect (&copy, region, &copy))
+        g_array_append_val (strut_rects, copy);
 
       old_struts = old_struts->next;
     }
+  rect_array_reverse (strut_rects);
+
+  cur_leftover = rect_array_new ();
+  comp_leftover = rect_array_new ();
 
   /* Now, loop over the list and check for intersections, fixing things up
    * where they do intersect.
    */
-  tmp = strut_rects;
-  while (tmp)
+  for (tmp = 0; tmp < strut_rects->len; tmp++)
     {
-      GList *compare;
+      guint compare;
 
-      MetaRectangle *cur = tmp->data;
-
-      compare = tmp->next;
-      while (compare)
+      for (compare = tmp + 1; compare < strut_rects->len; compare++)
         {
-          MetaRectangle *comp = compare->data;
+          MetaRectangle cur = g_array_index (strut_rects, MetaRectangle, tmp);
+          MetaRectangle comp = g_array_index (strut_rects, MetaRectangle, compare);
           MetaRectangle overlap;
 
-          if (meta_rectangle_intersect (cur, comp, &overlap))
+          if (meta_rectangle_intersect (&cur, &comp, &overlap))
             {
               /* Get a list of rectangles for each strut that don't overlap
-               * the intersection region.
+               * the intersection region, and add the intersection region
+               * to the front of cur_leftover.
                */
-              GList *cur_leftover  = get_rect_minus_overlap (tmp,  &overlap);
-              GList *comp_leftover = get_rect_minus_overlap (compare, &overlap);
+              g_array_set_size (cur_leftover, 0);
+              g_array_append_val (cur_leftover, overlap);
+              get_rect_minus_overlap (&cur, &overlap, cur_leftover);
 
-              /* Add the intersection region to cur_leftover */
-              MetaRectangle *overlap_allocated = g_new (MetaRectangle, 1);
-              *overlap_allocated = overlap;
-              cur_leftover = g_list_prepend (cur_leftover, overlap_allocated);
+              g_array_set_size (comp_leftover, 0);
+              get_rect_minus_overlap (&comp, &overlap, comp_leftover);
 
-              /* Fix up tmp, compare, and cur -- maybe struts too */
-              if (strut_rects == tmp)
-                {
-                  strut_rects = replace_rect_with_list (tmp, cur_leftover);
-                  tmp = strut_rects;
-                }
-              else
-                tmp   = replace_rect_with_list (tmp,     cur_leftover);
-              compare = replace_rect_with_list (compare, comp_leftover);
+              /* Fix up tmp and compare; compare is after tmp, so replace
+               * it first
+               */
+              replace_rect_with_pieces (strut_rects, compare, comp_leftover);
+              replace_rect_with_pieces (strut_rects, tmp, cur_leftover);
+              compare += cur_leftover->len - 1;
 
-              if (compare == NULL)
+              /* Carry on after the first piece of comp, or after the rect
+               * that followed it if nothing was left of it
+               */
+              if (comp_leftover->len == 0 && compare >= strut_rects->len)
                 break;
-
-              cur = tmp->data;
             }
-
-          compare = compare->next;
         }
-
-      tmp = tmp->next;
     }
 
+  g_array_free (comp_leftover, TRUE);
+  g_array_free (cur_leftover, TRUE);
+
   return strut_rects;
 }
 
@@ -1549,15 +1600,16 @@ add_edges (GList               *cur_edges,
   return cur_edges;
 }
 
-/* Remove any part of old_edge that intersects remove and add any resulting
- * edges to cur_list.  Return cur_list when finished.
+/* Puts the parts of old_edge that remain after removing any part that
+ * intersects remove into pieces, and returns how many there are.
  */
-static GList*
-split_edge (GList *cur_list,
-            const MetaEdge *old_edge,
-            const MetaEdge *remove)
+static int
+get_edge_minus_overlap (const MetaEdge *old_edge,
+                        const MetaEdge *remove,
+                        MetaEdge        pieces[2])
 {
-  MetaEdge *temp_edge;
+  int n_pieces = 0;
+
   switch (old_edge->side_type)
     {
     case META_SIDE_LEFT:
@@ -1565,20 +1617,18 @@ split_edge (GList *cur_list,
       g_assert (meta_rectangle_vert_overlap (&old_edge->rect, &remove->rect));
       if (BOX_TOP (old_edge->rect)  < BOX_TOP (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.height = BOX_TOP (remove->rect)
-                                 - BOX_TOP (old_edge->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          pieces[n_pieces] = *old_edge;
+          pieces[n_pieces].rect.height = BOX_TOP (remove->rect)
+                                       - BOX_TOP (old_edge->rect);
+          n_pieces++;
         }
       if (BOX_BOTTOM (old_edge->rect) > BOX_BOTTOM (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.y      = BOX_BOTTOM (remove->rect);
-          temp_edge->rect.height = BOX_BOTTOM (old_edge->rect)
-                                 - BOX_BOTTOM (remove->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          pieces[n_pieces] = *old_edge;
+          pieces[n_pieces].rect.y      = BOX_BOTTOM (remove->rect);
+          pieces[n_pieces].rect.height = BOX_BOTTOM (old_edge->rect)
+                                       - BOX_BOTTOM (remove->rect);
+          n_pieces++;
         }
       break;
     case META_SIDE_TOP:
@@ -1586,26 +1636,44 @@ split_edge (GList *cur_list,
       g_assert (meta_rectangle_horiz_overlap (&old_edge->rect, &remove->rect));
       if (BOX_LEFT (old_edge->rect)  < BOX_LEFT (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.width = BOX_LEFT (remove->rect)
-                                - BOX_LEFT (old_edge->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          pieces[n_pieces] = *old_edge;
+          pieces[n_pieces].rect.width = BOX_LEFT (remove->rect)
+                                      - BOX_LEFT (old_edge->rect);
+          n_pieces++;
         }
       if (BOX_RIGHT (old_edge->rect) > BOX_RIGHT (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.x     = BOX_RIGHT (remove->rect);
-          temp_edge->rect.width = BOX_RIGHT (old_edge->rect)
-                                - BOX_RIGHT (remove->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          pieces[n_pieces] = *old_edge;
+          pieces[n_pieces].rect.x     = BOX_RIGHT (remove->rect);
+          pieces[n_pieces].rect.width = BOX_RIGHT (old_edge->rect)
+                                      - BOX_RIGHT (remove->rect);
+          n_pieces++;
         }
       break;
     default:
       g_assert_not_reached ();
     }
 
+  return n_pieces;
+}
+
+/* Remove any part of old_edge that intersects remove and add any resulting
+ * edges to cur_list.  Return cur_list when finished.
+ */
+static GList*
+split_edge (GList *cur_list,
+            const MetaEdge *old_edge,
+            const MetaEdge *remove)
+{
+  MetaEdge pieces[2];
+  int n_pieces;
+  int i;
+
+  n_pieces = get_edge_minus_overlap (old_edge, remove, pieces);
+  for (i = 0; i < n_pieces; i++)
+    cur_list = g_list_prepend (cur_list,
+                               g_memdup2 (&pieces[i], sizeof (MetaEdge)));
+
   return cur_list;
 }
 
@@ -1658,7 +1726,8 @@ fix_up_edges (MetaRectangle *rect,         MetaEdge *edge,
 }
 
 /* This function removes intersections of edges with the rectangles from the
- * list of edges.
+ * list of edges.  Like the regions above, the edges are split in GArrays of
+ * MetaEdges and only turned back into a list at the end.
  */
 GList*
 meta_rectangle_remove_intersections_with_boxes_from_edges (
@@ -1667,19 +1736,39 @@ meta_rectangle_remove_intersections_with_boxes_from_edges (
 {
   const GSList *rect_iter;
   const int opposing = 1;
+  GArray *cur;
+  GArray *kept;
+  GArray *splits;
+  GList *edge_iter;
+  GList *ret;
+  int i;
+
+  if (rectangles == NULL)
+    return edges;
+
+  cur = g_array_new (FALSE, FALSE, sizeof (MetaEdge));
+  kept = g_array_new (FALSE, FALSE, sizeof (MetaEdge));
+  splits = g_array_new (FALSE, FALSE, sizeof (MetaEdge));
+
+  for (edge_iter = edges; edge_iter; edge_iter = edge_iter->next)
+    g_array_append_vals (cur, edge_iter->data, 1);
+  g_list_free_full (edges, g_free);
 
   /* Now remove all intersections of rectangles with the edge list */
   rect_iter = rectangles;
   while (rect_iter)
     {
       MetaRectangle *rect = rect_iter->data;
-      GList *edge_iter = edges;
-      while (edge_iter)
+      guint j;
+
+      g_array_set_size (kept, 0);
+      g_array_set_size (splits, 0);
+
+      for (j = 0; j < cur->len; j++)
         {
-          MetaEdge *edge = edge_iter->data;
+          MetaEdge *edge = &g_array_index (cur, MetaEdge, j);
           MetaEdge overlap;
           int      handle;
-          gboolean edge_iter_advanced = FALSE;
 
           /* If this edge overlaps with this rect... */
           if (rectangle_and_edge_intersection (rect, edge, &overlap, &handle))
@@ -1699,28 +1788,43 @@ meta_rectangle_remove_intersections_with_boxes_from_edges (
                */
               if (handle != opposing)
                 {
-                  /* Keep track of this edge so we can delete it below */
-                  GList *delete_me = edge_iter;
-                  edge_iter = edge_iter->next;
-                  edge_iter_advanced = TRUE;
-
-                  /* Split the edge and add the result to beginning of edges */
-                  edges = split_edge (edges, edge, &overlap);
-
-                  /* Now free the edge... */
-                  g_free (edge);
-                  edges = g_list_delete_link (edges, delete_me);
+                  MetaEdge pieces[2];
+                  int n_pieces;
+
+                  /* Split the edge; the pieces go in front of the edges
+                   * that are kept, as they used to be prepended to them
+                   */
+                  n_pieces = get_edge_minus_overlap (edge, &overlap, pieces);
+                  g_array_append_vals (splits, pieces, n_pieces);
+                  continue;
                 }
             }
 
-          if (!edge_iter_advanced)
-            edge_iter = edge_iter->next;
+          g_array_append_vals (kept, edge, 1);
         }
 
+      /* cur becomes the splits, last split first, followed by the kept
+       * edges
+       */
+      g_array_set_size (cur, 0);
+      for (i = (int) splits->len - 1; i >= 0; i--)
+        g_array_append_vals (cur, &g_array_index (splits, MetaEdge, i), 1);
+      g_array_append_vals (cur, kept->data, kept->len);
+
       rect_iter = rect_iter->next;
     }
 
-  return edges;
+  ret = NULL;
+  for (i = (int) cur->len - 1; i >= 0; i--)
+    ret = g_list_prepend (ret,
+                          g_memdup2 (&g_array_index (cur, MetaEdge, i),
+                                     sizeof (MetaEdge)));
+
+  g_array_free (cur, TRUE);
+  g_array_free (kept, TRUE);
+  g_array_free (splits, TRUE);
+
+  return ret;
 }
 
 /* This function is trying to find all the edges of an onscreen region. */
@@ -1729,9 +1833,9 @@ meta_rectangle_find_onscreen_edges (const MetaRectangle *basic_rect,
                                     const GSList        *all_struts)
 {
   GList        *ret;
-  GList        *fixed_strut_rects;
+  GArray       *fixed_strut_rects;
   GList        *edge_iter;
-  const GList  *strut_rect_iter;
+  guint         i;
 
   /* The algorithm is basically as follows:
    *   Make sure the struts are disjoint
@@ -1755,10 +1859,10 @@ meta_rectangle_find_onscreen_edges (const MetaRectangle *basic_rect,
   /* Start off the list with the edges of basic_rect */
   ret = add_edges (NULL, basic_rect, TRUE);
 
-  strut_rect_iter = fixed_strut_rects;
-  while (strut_rect_iter)
+  for (i = 0; i < fixed_strut_rects->len; i++)
     {
-      MetaRectangle *strut_rect = (MetaRectangle*) strut_rect_iter->data;
+      MetaRectangle *strut_rect = &g_array_index (fixed_strut_rects,
+                                                  MetaRectangle, i);
 
       /* Get the new possible edges we may need to add from the strut */
       GList *new_strut_edges = add_edges (NULL, strut_rect, FALSE);
@@ -1794,14 +1898,13 @@ meta_rectangle_find_onscreen_edges (const MetaRectangle *basic_rect,
         }
 
       ret = g_list_concat (new_strut_edges, ret);
-      strut_rect_iter = strut_rect_iter->next;
     }
 
   /* Sort the list */
   ret = g_list_sort (ret, meta_rectangle_edge_cmp);
 
   /* Free the fixed struts list */
-  g_list_free_full (fixed_strut_rects, g_free);
+  g_array_free (fixed_strut_rects, TRUE);
 
   return ret;
 }
@@ -29,6 +29,7 @@
 
 #include <libmetacity/meta-frame-borders.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #if 0
@@ -365,6 +366,163 @@ validate_fullscreen_monitors (MetaWindow *window)
   return TRUE;
 }
 
+/* The union of the monitors a fullscreen window spans, if it has been
+ * told which ones to span
+ */
+static gboolean
+get_fullscreen_rect (MetaWindow    *window,
+                     MetaRectangle *rect)
+{
+  int i;
+
+  if (!window->fullscreen || !validate_fullscreen_monitors (window))
+    return FALSE;
+
+  *rect = window->screen->monitor_infos[window->fullscreen_monitors[0]].rect;
+
+  for (i = 1; i <= 3; i++)
+    {
+      long monitor = window->fullscreen_monitors[i];
+
+      meta_rectangle_union (rect,
+                            &window->screen->monitor_infos[monitor].rect,
+                            rect);
+    }
+
+  return TRUE;
+}
+
+typedef struct
+{
+  MetaRectangle  work_area;
+
+  /* Belongs to the active workspace */
+  GList         *region;
+} MonitorContext;
+
+/* What constraining the window being moved or resized needs to know
+ * about the monitors and workspaces; none of it changes during the grab
+ * unless struts, monitors or workspaces do, and the display drops it
+ * when they do.
+ */
+struct MetaConstraintContext
+{
+  MetaWindow     *window;
+
+  /* What the context was computed for; it is computed again if the
+   * window moves to another workspace or is made fullscreen meanwhile.
+   */
+  MetaWorkspace  *active_workspace;
+  MetaWorkspace  *workspace;
+  gboolean        on_all_workspaces;
+  gboolean        fullscreen;
+  long            fullscreen_monitors[4];
+
+  /* Belongs to the active workspace */
+  GList          *usable_screen_region;
+
+  MonitorContext *monitors;
+  int             n_monitors;
+
+  gboolean        has_fullscreen_rect;
+  MetaRectangle   fullscreen_rect;
+};
+
+static gboolean
+constraint_context_is_current (MetaConstraintContext *context,
+                               MetaWindow            *window)
+{
+  return context->window == window &&
+         context->n_monitors == window->screen->n_monitor_infos &&
+         context->active_workspace == window->screen->active_workspace &&
+         context->workspace == window->workspace &&
+         context->on_all_workspaces == window->on_all_workspaces &&
+         context->fullscreen == window->fullscreen &&
+         memcmp (context->fullscreen_monitors, window->fullscreen_monitors,
+                 sizeof (context->fullscreen_monitors)) == 0;
+}
+
+void
+meta_display_compute_constraint_context (MetaDisplay *display)
+{
+  MetaConstraintContext *context;
+  MetaWindow *window;
+  MetaWorkspace *workspace;
+  int i;
+
+  window = display->grab_window;
+  g_assert (window != NULL);
+
+  if (display->grab_constraint_context != NULL)
+    {
+      if (constraint_context_is_current (display->grab_constraint_context,
+                                         window))
+        return;
+
+      meta_display_cleanup_constraint_context (display);
+    }
+
+  context = g_new0 (MetaConstraintContext, 1);
+  context->window = window;
+  context->active_workspace = window->screen->active_workspace;
+  context->workspace = window->workspace;
+  context->on_all_workspaces = window->on_all_workspaces;
+  context->fullscreen = window->fullscreen;
+  memcpy (context->fullscreen_monitors, window->fullscreen_monitors,
+          sizeof (context->fullscreen_monitors));
+
+  workspace = window->screen->active_workspace;
+  context->usable_screen_region =
+    meta_workspace_get_onscreen_region (workspace);
+
+  context->n_monitors = window->screen->n_monitor_infos;
+  context->monitors = g_new (MonitorContext, context->n_monitors);
+
+  for (i = 0; i < context->n_monitors; i++)
+    {
+      MonitorContext *monitor = &context->monitors[i];
+
+      meta_window_get_work_area_for_monitor (window, i, &monitor->work_area);
+      monitor->region = meta_workspace_get_onmonitor_region (workspace, i);
+    }
+
+  context->has_fullscreen_rect =
+    get_fullscreen_rect (window, &context->fullscreen_rect);
+
+  display->grab_constraint_context = context;
+}
+
+void
+meta_display_cleanup_constraint_context (MetaDisplay *display)
+{
+  MetaConstraintContext *context = display->grab_constraint_context;
+
+  if (context == NULL) /* Not currently cached */
+    return;
+
+  g_free (context->monitors);
+  g_free (context);
+  display->grab_constraint_context = NULL;
+}
+
+/* The context for window if it is being moved or resized by a grab,
+ * computing it again if it had to be dropped
+ */
+static MetaConstraintContext *
+get_constraint_context (MetaWindow *window)
+{
+  MetaDisplay *display = window->display;
+
+  if (display->grab_window != window ||
+      !(meta_grab_op_is_moving (display->grab_op) ||
+        meta_grab_op_is_resizing (display->grab_op)))
+    return NULL;
+
+  meta_display_compute_constraint_context (display);
+
+  return display->grab_constraint_context;
+}
+
 static void
 setup_constraint_info (ConstraintInfo      *info,
                        MetaWindow          *window,
@@ -375,6 +533,7 @@ setup_constraint_info (ConstraintInfo      *info,
                        MetaRectangle       *new)
 {
   const MetaMonitorInfo *monitor_info;
+  MetaConstraintContext *context;
   MetaWorkspace *cur_workspace;
 
   info->orig    = *orig;
@@ -436,38 +595,39 @@ setup_constraint_info (ConstraintInfo      *info,
 
   monitor_info =
     meta_screen_get_monitor_for_rect (window->screen, &info->current);
-  meta_window_get_work_area_for_monitor (window,
-                                         monitor_info->number,
-                                         &info->work_area_monitor);
 
-  if (!window->fullscreen || !validate_fullscreen_monitors (window))
+  context = get_constraint_context (window);
+  if (context != NULL)
     {
-      info->entire_monitor = monitor_info->rect;
+      const MonitorContext *monitor;
+
+      monitor = &context->monitors[monitor_info->number];
+      info->work_area_monitor = monitor->work_area;
+      info->usable_screen_region = context->usable_screen_region;
+      info->usable_monitor_region = monitor->region;
+
+      if (context->has_fullscreen_rect)
+        info->entire_monitor = context->fullscreen_rect;
+      else
+        info->entire_monitor = monitor_info->rect;
     }
   else
     {
-      int i = 0;
-      long monitor;
+      meta_window_get_work_area_for_monitor (window,
+                                             monitor_info->number,
+                                             &info->work_area_monitor);
 
-      monitor = window->fullscreen_monitors[i];
-      info->entire_monitor = window->screen->monitor_infos[monitor].rect;
+      if (!get_fullscreen_rect (window, &info->entire_monitor))
+        info->entire_monitor = monitor_info->rect;
 
-      for (i = 1; i <= 3; i++)
-        {
-          monitor = window->fullscreen_monitors[i];
-          meta_rectangle_union (&info->entire_monitor,
-                                &window->screen->monitor_infos[monitor].rect,
-                                &info->entire_monitor);
-        }
+      cur_workspace = window->screen->active_workspace;
+      info->usable_screen_region =
+        meta_workspace_get_onscreen_region (cur_workspace);
+      info->usable_monitor_region =
+        meta_workspace_get_onmonitor_region (cur_workspace,
+                                             monitor_info->number);
     }
 
-  cur_workspace = window->screen->active_workspace;
-  info->usable_screen_region =
-    meta_workspace_get_onscreen_region (cur_workspace);
-  info->usable_monitor_region =
-    meta_workspace_get_onmonitor_region (cur_workspace,
-                                         monitor_info->number);
-
   /* Log all this information for debugging */
   meta_topic (META_DEBUG_GEOMETRY,
               "Setting up constraint info:\n"
@@ -34,6 +34,9 @@
 #include "common.h"
 #include "boxes.h"
 #include "display.h"
+#include "icon-store.h"
+#include "keybinding-index.h"
+#include "edge-cache.h"
 
 #include <libsn/sn.h>
 
@@ -48,6 +51,7 @@ typedef struct _MetaGroupPropHooks  MetaGroupPropHooks;
 typedef struct _MetaWindowPropHooks MetaWindowPropHooks;
 
 typedef struct MetaEdgeResistanceData MetaEdgeResistanceData;
+typedef struct MetaConstraintContext MetaConstraintContext;
 
 typedef void (* MetaWindowPingFunc) (MetaDisplay *display,
 				     Window       xwindow,
@@ -134,12 +138,27 @@ struct _MetaDisplay
   guint focused_by_us : 1;
 
   /*< private-ish >*/
-  guint error_trap_synced_at_last_pop : 1;
   MetaScreen *screen;
   GHashTable *window_ids;
-  int error_traps;
-  int (* error_trap_handler) (Display     *display,
-                              XErrorEvent *error);
+
+  /* Error trap state, see errors.c; error_traps holds the pushed traps,
+   * innermost first, and pending_error_traps the popped ones the server
+   * hasn't caught up with yet, oldest first.
+   */
+  GSList *error_traps;
+  GQueue *pending_error_traps;
+  gpointer error_trap_observer;
+
+  /* Property requests whose hooks run once the replies are in, see
+   * meta_prop_get_values_async()
+   */
+  GQueue *pending_prop_requests;
+
+  guint reply_sentinel_id;
+
+  /* Scaled window icons, shared between windows showing the same one */
+  MetaIconStore *icon_store;
+
   int server_grab_count;
 
   /* serials of leave/unmap events that may
@@ -189,6 +208,8 @@ struct _MetaDisplay
   guint32     grab_motion_notify_time;
   GList*      grab_old_window_stacking;
   MetaEdgeResistanceData *grab_edge_resistance_data;
+  MetaEdgeCache *window_edge_cache;
+  MetaConstraintContext *grab_constraint_context;
   unsigned int grab_last_user_action_was_snap;
 
   /* we use property updates as sentinels for certain window focus events
@@ -205,6 +226,12 @@ struct _MetaDisplay
   /* Keybindings stuff */
   MetaKeyBinding *key_bindings;
   int             n_key_bindings;
+  MetaKeyBindingIndex *key_binding_index;
+  /* The passive key grabs we keep on the root window and on every client
+   * window, see update_key_grabs()
+   */
+  GHashTable     *root_key_grabs;
+  GHashTable     *window_key_grabs;
   int             min_keycode;
   int             max_keycode;
   KeySym *keymap;
@@ -328,6 +355,8 @@ void        meta_display_register_sync_alarm   (MetaDisplay *display,
 void        meta_display_unregister_sync_alarm (MetaDisplay *display,
                                                 XSyncAlarm   alarm);
 
+void        meta_display_queue_reply_sentinel (MetaDisplay *display);
+
 /* Return whether the xwindow is a no focus window for any of the screens */
 gboolean    meta_display_xwindow_is_a_no_focus_window (MetaDisplay *display,
                                                        Window xwindow);
@@ -375,8 +404,13 @@ void meta_display_grab_focus_window_button   (MetaDisplay *display,
 void meta_display_ungrab_focus_window_button (MetaDisplay *display,
                                               MetaWindow  *window);
 
-/* Next function is defined in edge-resistance.c */
+/* Next functions are defined in edge-resistance.c */
 void meta_display_cleanup_edges              (MetaDisplay *display);
+void meta_display_free_window_edge_cache     (MetaDisplay *display);
+
+/* Next functions are defined in constraints.c */
+void meta_display_compute_constraint_context (MetaDisplay *display);
+void meta_display_cleanup_constraint_context (MetaDisplay *display);
 
 /* make a request to ensure the event serial has changed */
 void     meta_display_increment_event_serial (MetaDisplay *display);
@@ -39,12 +39,14 @@
 #include "group-props.h"
 #include "frame-private.h"
 #include "errors.h"
+#include "iconcache.h"
 #include "keybindings.h"
 #include "prefs.h"
 #include "resizepopup.h"
 #include "xprops.h"
 #include "workspace.h"
 #include "bell.h"
+#include "round-trips.h"
 #include "effects.h"
 #include "meta-compositor.h"
 #include <libmetacity/meta-frame-borders.h>
@@ -433,9 +435,10 @@ meta_display_open (void)
    */
   the_display->name = g_strdup (XDisplayName (NULL));
   the_display->xdisplay = xdisplay;
-  the_display->error_trap_synced_at_last_pop = TRUE;
-  the_display->error_traps = 0;
-  the_display->error_trap_handler = NULL;
+  meta_error_trap_init (the_display);
+  the_display->pending_prop_requests = g_queue_new ();
+  the_display->reply_sentinel_id = 0;
+  the_display->icon_store = meta_icon_store_new ();
   the_display->server_grab_count = 0;
   the_display->display_opening = TRUE;
 
@@ -528,6 +531,8 @@ meta_display_open (void)
   the_display->grab_tile_monitor_number = -1;
 
   the_display->grab_edge_resistance_data = NULL;
+  the_display->window_edge_cache = NULL;
+  the_display->grab_constraint_context = NULL;
 
   {
     int major, minor;
@@ -829,72 +834,27 @@ meta_display_open (void)
   return TRUE;
 }
 
-static gint
-ptrcmp (gconstpointer a, gconstpointer b)
-{
-  if (a < b)
-    return -1;
-  else if (a > b)
-    return 1;
-  else
-    return 0;
-}
-
 GSList*
 meta_display_list_windows (MetaDisplay          *display,
                            MetaListWindowsFlags  flags)
 {
   GSList *winlist;
-  GSList *tmp;
-  GSList *prev;
-  GHashTableIter iter;
-  gpointer key, value;
+  GList *tmp;
+
+  if (display->screen == NULL)
+    return NULL;
 
   winlist = NULL;
-  g_hash_table_iter_init (&iter, display->window_ids);
-  while (g_hash_table_iter_next (&iter, &key, &value))
+  tmp = display->screen->windows;
+  while (tmp != NULL)
     {
-      MetaWindow *window = value;
+      MetaWindow *window = tmp->data;
 
       if (!window->override_redirect ||
          (flags & META_LIST_INCLUDE_OVERRIDE_REDIRECT) != 0)
         winlist = g_slist_prepend (winlist, window);
-    }
-
-  /* Uniquify the list, since both frame windows and plain
-   * windows are in the hash
-   */
-  winlist = g_slist_sort (winlist, ptrcmp);
-
-  prev = NULL;
-  tmp = winlist;
-  while (tmp != NULL)
-    {
-      GSList *next;
-
-      next = tmp->next;
-
-      if (next &&
-          next->data == tmp->data)
-        {
-          /* Delete tmp from list */
 
-          if (prev)
-            prev->next = next;
-
-          if (tmp == winlist)
-            winlist = next;
-
-          g_slist_free_1 (tmp);
-
-          /* leave prev unchanged */
-        }
-      else
-        {
-          prev = tmp;
-        }
-
-      tmp = next;
+      tmp = tmp->next;
     }
 
   return winlist;
@@ -933,11 +893,14 @@ meta_display_close (MetaDisplay *display,
       return;
     }
 
-  if (display->error_traps > 0)
+  if (display->error_traps != NULL)
     g_error ("Display closed with error traps pending");
 
   display->closing += 1;
 
+  meta_round_trip_dump_stats ();
+  meta_round_trip_free_stats ();
+
   meta_prefs_remove_listener (prefs_changed_callback, display);
 
   meta_display_remove_autoraise_callback (display);
@@ -945,6 +908,19 @@ meta_display_close (MetaDisplay *display,
   if (display->grab_old_window_stacking)
     g_list_free (display->grab_old_window_stacking);
 
+  if (display->reply_sentinel_id != 0)
+    {
+      g_source_remove (display->reply_sentinel_id);
+      display->reply_sentinel_id = 0;
+    }
+
+  /* Run the hooks for property changes we haven't seen the end of,
+   * while the windows are still around
+   */
+  meta_prop_flush_pending (display);
+  g_queue_free (display->pending_prop_requests);
+  display->pending_prop_requests = NULL;
+
   /* Stop caring about events */
   meta_ui_remove_event_func (display->xdisplay,
                              event_callback,
@@ -952,6 +928,8 @@ meta_display_close (MetaDisplay *display,
 
   meta_display_unmanage_windows (display, timestamp);
 
+  meta_display_free_window_edge_cache (display);
+
   g_clear_object (&display->compositor);
 
   if (display->screen != NULL)
@@ -983,6 +961,11 @@ meta_display_close (MetaDisplay *display,
 
   meta_display_shutdown_keys (display);
 
+  meta_icon_cache_shutdown_workers ();
+  meta_icon_store_free (display->icon_store);
+
+  meta_error_trap_shutdown (display);
+
   g_free (display);
   the_display = NULL;
 
@@ -1307,6 +1290,60 @@ find_timestamp_predicate (Display  *xdisplay,
           ev->xproperty.atom == display->atom__METACITY_TIMESTAMP_PING);
 }
 
+static void
+process_pending_replies (MetaDisplay *display)
+{
+  meta_error_trap_process_pending (display);
+  meta_prop_process_pending (display);
+}
+
+static gboolean
+reply_sentinel_idle_cb (gpointer user_data)
+{
+  MetaDisplay *display;
+
+  display = user_data;
+  display->reply_sentinel_id = 0;
+
+  process_pending_replies (display);
+
+  if (g_queue_is_empty (display->pending_error_traps) &&
+      g_queue_is_empty (display->pending_prop_requests))
+    return G_SOURCE_REMOVE;
+
+  if (display->timestamp_pinging_window != None)
+    {
+      XChangeProperty (display->xdisplay, display->timestamp_pinging_window,
+                       display->atom__METACITY_REPLY_SENTINEL,
+                       XA_STRING, 8, PropModeAppend, NULL, 0);
+    }
+  else
+    {
+      XSync (display->xdisplay, False);
+      process_pending_replies (display);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * Makes sure the event loop gets to run once the server has answered
+ * every request made so far, so that replies and errors that are read
+ * without an accompanying event don't go unnoticed. Rather than waiting
+ * for the server, we have it send us a PropertyNotify after those
+ * requests; requests made in the same main loop iteration share one.
+ */
+void
+meta_display_queue_reply_sentinel (MetaDisplay *display)
+{
+  /* Whatever is still pending is flushed synchronously on close */
+  if (display->closing)
+    return;
+
+  if (display->reply_sentinel_id == 0)
+    display->reply_sentinel_id = g_idle_add (reply_sentinel_idle_cb, display);
+}
+
 /* Get a timestamp, even if it means a roundtrip */
 guint32
 meta_display_get_current_time_roundtrip (MetaDisplay *display)
@@ -1317,7 +1354,9 @@ meta_display_get_current_time_roundtrip (MetaDisplay *display)
   if (timestamp == CurrentTime)
     {
       XEvent property_event;
+      gint64 start_time;
 
+      start_time = meta_round_trip_begin ();
       XChangeProperty (display->xdisplay, display->timestamp_pinging_window,
                        display->atom__METACITY_TIMESTAMP_PING,
                        XA_STRING, 8, PropModeAppend, NULL, 0);
@@ -1325,6 +1364,7 @@ meta_display_get_current_time_roundtrip (MetaDisplay *display)
                 &property_event,
                 find_timestamp_predicate,
                 (XPointer) display);
+      meta_round_trip_end (G_STRFUNC, start_time);
       timestamp = property_event.xproperty.time;
     }
 
@@ -1710,24 +1750,22 @@ handle_window_focus_event (MetaDisplay *display,
 
 static gboolean
 dock_has_overlaps (MetaWindow *dock,
-                   GList      *windows)
+                   GPtrArray  *windows)
 {
   MetaRectangle dock_rect;
-  GList *tmp;
+  guint i;
 
   if (dock->type != META_WINDOW_DOCK)
     return FALSE;
 
   meta_window_get_input_rect (dock, &dock_rect);
 
-  tmp = windows;
-  while (tmp != NULL)
+  for (i = 0; i < windows->len; i++)
     {
       MetaWindow *other;
       MetaRectangle other_rect;
 
-      other = tmp->data;
-      tmp = tmp->next;
+      other = g_ptr_array_index (windows, i);
 
       if (dock == other)
         continue;
@@ -1791,6 +1829,18 @@ event_callback (XEvent   *event,
   if (dump_events)
     meta_spew_event (display, event);
 
+  /* Every event moves the last processed request forward */
+  process_pending_replies (display);
+
+  /* Client requests may depend on properties set just before them,
+   * e.g. WM_NORMAL_HINTS followed by a ConfigureRequest, so make sure
+   * those have been dealt with first
+   */
+  if (event->type == ConfigureRequest ||
+      event->type == MapRequest ||
+      event->type == ClientMessage)
+    meta_prop_flush_pending (display);
+
   sn_display_process_event (display->sn_display, event);
 
   filter_out_event = FALSE;
@@ -2381,8 +2431,10 @@ event_callback (XEvent   *event,
        */
       if (window == NULL && event->xmap.event == screen->xroot)
         {
+          meta_round_trip_push_op (META_ROUND_TRIP_OP_MAP);
           window = meta_window_new (display, event->xmap.window, FALSE,
                                     META_EFFECT_TYPE_CREATE);
+          meta_round_trip_pop_op ();
         }
       else if (window && window->restore_focus_on_map)
         {
@@ -2393,8 +2445,10 @@ event_callback (XEvent   *event,
     case MapRequest:
       if (window == NULL)
         {
+          meta_round_trip_push_op (META_ROUND_TRIP_OP_MAP);
           window = meta_window_new (display, event->xmaprequest.window, FALSE,
                                     META_EFFECT_TYPE_CREATE);
+          meta_round_trip_pop_op ();
         }
       /* if frame was receiver it's some malicious send event or something */
       else if (!frame_was_receiver && window)
@@ -2656,6 +2710,7 @@ event_callback (XEvent   *event,
                        display->atom__METACITY_TOGGLE_VERBOSE)
                 {
                   meta_verbose ("Received toggle verbose message\n");
+                  meta_round_trip_dump_stats ();
                   meta_toggle_debug ();
                 }
               else if (event->xclient.message_type ==
@@ -3631,6 +3686,8 @@ meta_display_begin_grab_op (MetaDisplay *display,
       return FALSE;
     }
 
+  meta_round_trip_push_op (META_ROUND_TRIP_OP_GRAB);
+
   if (window &&
       (meta_grab_op_is_moving (op) || meta_grab_op_is_resizing (op)))
     {
@@ -3675,6 +3732,7 @@ meta_display_begin_grab_op (MetaDisplay *display,
     {
       meta_topic (META_DEBUG_WINDOW_OPS,
                   "XGrabPointer() failed\n");
+      meta_round_trip_pop_op ();
       return FALSE;
     }
 
@@ -3695,6 +3753,7 @@ meta_display_begin_grab_op (MetaDisplay *display,
                       "grabbing all keys failed, ungrabbing pointer\n");
           XUngrabPointer (display->xdisplay, timestamp);
           display->grab_have_pointer = FALSE;
+          meta_round_trip_pop_op ();
           return FALSE;
         }
     }
@@ -3744,6 +3803,13 @@ meta_display_begin_grab_op (MetaDisplay *display,
 
           window->sync_request_time = 0;
         }
+
+      /* Work out what the constraints need once, rather than on
+       * every motion
+       */
+      if (meta_grab_op_is_moving (display->grab_op) ||
+          meta_grab_op_is_resizing (display->grab_op))
+        meta_display_compute_constraint_context (display);
     }
 
   meta_topic (META_DEBUG_WINDOW_OPS,
@@ -3838,6 +3904,8 @@ meta_display_begin_grab_op (MetaDisplay *display,
       meta_window_refresh_resize_popup (display->grab_window);
     }
 
+  meta_round_trip_pop_op ();
+
   return TRUE;
 }
 
@@ -3852,7 +3920,14 @@ meta_display_end_grab_op (MetaDisplay *display,
     return;
 
   if (display->grab_window != NULL)
-    display->grab_window->shaken_loose = FALSE;
+    {
+      display->grab_window->shaken_loose = FALSE;
+
+      /* A resize may end before the client answers its last sync
+       * request, e.g. from the keyboard
+       */
+      meta_window_set_updates_frozen_for_resize (display->grab_window, FALSE);
+    }
 
   /*if(display->grab_window != NULL && display->grab_window->tile_mode == META_TILE_MAXIMIZED)
     {
@@ -3893,6 +3968,7 @@ meta_display_end_grab_op (MetaDisplay *display,
       meta_topic (META_DEBUG_WINDOW_OPS,
                   "Clearing out the edges for resistance/snapping");
       meta_display_cleanup_edges (display);
+      meta_display_cleanup_constraint_context (display);
     }
 
   if (display->grab_old_window_stacking != NULL)
@@ -0,0 +1,490 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity window edge cache */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "edge-cache.h"
+#include "stack-order.h"
+
+typedef struct
+{
+  gconstpointer  id;
+  MetaRectangle  rect;
+  gboolean       is_dock;
+
+  /* The edges of the window, less the parts covered by the windows above
+   * it; docks have none.
+   */
+  GList         *edges;
+} CachedWindow;
+
+struct _MetaEdgeCache
+{
+  MetaRectangle  screen_rect;
+
+  /* CachedWindow, bottom to top */
+  GArray        *windows;
+
+  /* The edges of all the windows, sorted */
+  GArray        *vertical_edges;
+  GArray        *horizontal_edges;
+};
+
+MetaEdgeCache *
+meta_edge_cache_new (void)
+{
+  MetaEdgeCache *cache;
+
+  cache = g_new0 (MetaEdgeCache, 1);
+  cache->windows = g_array_new (FALSE, FALSE, sizeof (CachedWindow));
+  cache->vertical_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+  cache->horizontal_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+
+  return cache;
+}
+
+static void
+free_window_edges (GArray *windows)
+{
+  guint i;
+
+  for (i = 0; i < windows->len; i++)
+    g_list_free_full (g_array_index (windows, CachedWindow, i).edges, g_free);
+}
+
+void
+meta_edge_cache_free (MetaEdgeCache *cache)
+{
+  free_window_edges (cache->windows);
+  g_array_free (cache->windows, TRUE);
+  g_array_free (cache->vertical_edges, TRUE);
+  g_array_free (cache->horizontal_edges, TRUE);
+  g_free (cache);
+}
+
+const GArray *
+meta_edge_cache_get_vertical_edges (MetaEdgeCache *cache)
+{
+  return cache->vertical_edges;
+}
+
+const GArray *
+meta_edge_cache_get_horizontal_edges (MetaEdgeCache *cache)
+{
+  return cache->horizontal_edges;
+}
+
+gint
+meta_edge_cache_compare_edges (gconstpointer a,
+                               gconstpointer b)
+{
+  const MetaEdge *a_edge = *(const MetaEdge * const *) a;
+  const MetaEdge *b_edge = *(const MetaEdge * const *) b;
+  int result;
+
+  result = meta_rectangle_edge_cmp_ignore_type (a_edge, b_edge);
+  if (result != 0)
+    return result;
+
+  /* Window edges first, then monitor and screen edges, as when they
+   * used to be sorted together in that order
+   */
+  if (a_edge->edge_type != b_edge->edge_type)
+    return a_edge->edge_type - b_edge->edge_type;
+
+  if (a_edge->side_type != b_edge->side_type)
+    return a_edge->side_type - b_edge->side_type;
+
+  /* One of these is 0 */
+  return (a_edge->rect.width + a_edge->rect.height) -
+         (b_edge->rect.width + b_edge->rect.height);
+}
+
+static gboolean
+edge_is_vertical (const MetaEdge *edge)
+{
+  return edge->side_type == META_SIDE_LEFT ||
+         edge->side_type == META_SIDE_RIGHT;
+}
+
+/* Gets the edges of a window at cur_rect, less the parts covered by the
+ * windows at obscuring_rects
+ */
+static GList*
+get_window_edges (const MetaRectangle *cur_rect,
+                  const MetaRectangle *screen_rect,
+                  const GSList        *obscuring_rects)
+{
+  GList *new_edges;
+  MetaEdge *new_edge;
+  MetaRectangle reduced;
+
+  /* We don't care about snapping to any portion of the window that
+   * is offscreen (we also don't care about parts of edges covered
+   * by other windows or DOCKS, but that's handled below).  Nothing is
+   * left of a window that is entirely offscreen.
+   */
+  if (!meta_rectangle_intersect (cur_rect, screen_rect, &reduced))
+    return NULL;
+
+  new_edges = NULL;
+
+  /* Left side of this window is resistance for the right edge of
+   * the window being moved.
+   */
+  new_edge = g_new (MetaEdge, 1);
+  new_edge->rect = reduced;
+  new_edge->rect.width = 0;
+  new_edge->side_type = META_SIDE_RIGHT;
+  new_edge->edge_type = META_EDGE_WINDOW;
+  new_edges = g_list_prepend (new_edges, new_edge);
+
+  /* Right side of this window is resistance for the left edge of
+   * the window being moved.
+   */
+  new_edge = g_new (MetaEdge, 1);
+  new_edge->rect = reduced;
+  new_edge->rect.x += new_edge->rect.width;
+  new_edge->rect.width = 0;
+  new_edge->side_type = META_SIDE_LEFT;
+  new_edge->edge_type = META_EDGE_WINDOW;
+  new_edges = g_list_prepend (new_edges, new_edge);
+
+  /* Top side of this window is resistance for the bottom edge of
+   * the window being moved.
+   */
+  new_edge = g_new (MetaEdge, 1);
+  new_edge->rect = reduced;
+  new_edge->rect.height = 0;
+  new_edge->side_type = META_SIDE_BOTTOM;
+  new_edge->edge_type = META_EDGE_WINDOW;
+  new_edges = g_list_prepend (new_edges, new_edge);
+
+  /* Top side of this window is resistance for the bottom edge of
+   * the window being moved.
+   */
+  new_edge = g_new (MetaEdge, 1);
+  new_edge->rect = reduced;
+  new_edge->rect.y += new_edge->rect.height;
+  new_edge->rect.height = 0;
+  new_edge->side_type = META_SIDE_TOP;
+  new_edge->edge_type = META_EDGE_WINDOW;
+  new_edges = g_list_prepend (new_edges, new_edge);
+
+  /* Remove edge portions overlapped by the windows above */
+  return meta_rectangle_remove_intersections_with_boxes_from_edges (
+           new_edges,
+           obscuring_rects);
+}
+
+/* Whether anything in damage overlaps or touches rect; a window just
+ * next to an edge can still split it.
+ */
+static gboolean
+rect_is_damaged (const MetaRectangle *rect,
+                 const GArray        *damage)
+{
+  MetaRectangle grown;
+  guint i;
+
+  grown = meta_rect (rect->x - 1, rect->y - 1,
+                     rect->width + 2, rect->height + 2);
+
+  for (i = 0; i < damage->len; i++)
+    {
+      if (meta_rectangle_overlap (&grown,
+                                  &g_array_index (damage, MetaRectangle, i)))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Returns sorted without the edges in dropped and with those in added,
+ * keeping it sorted; only added needs sorting.
+ */
+static GArray*
+update_sorted_edges (GArray     *sorted,
+                     GHashTable *dropped,
+                     GArray     *added)
+{
+  GArray *result;
+  guint i, j;
+
+  if (g_hash_table_size (dropped) == 0 && added->len == 0)
+    return sorted;
+
+  g_array_sort (added, meta_edge_cache_compare_edges);
+
+  result = g_array_sized_new (FALSE, FALSE, sizeof (MetaEdge*),
+                              sorted->len + added->len);
+
+  i = j = 0;
+  while (i < sorted->len || j < added->len)
+    {
+      MetaEdge *edge;
+
+      if (i < sorted->len &&
+          g_hash_table_contains (dropped,
+                                 g_array_index (sorted, MetaEdge*, i)))
+        {
+          i++;
+          continue;
+        }
+
+      if (j == added->len ||
+          (i < sorted->len &&
+           meta_edge_cache_compare_edges (&g_array_index (sorted, MetaEdge*, i),
+                                          &g_array_index (added, MetaEdge*, j)) <= 0))
+        edge = g_array_index (sorted, MetaEdge*, i++);
+      else
+        edge = g_array_index (added, MetaEdge*, j++);
+
+      g_array_append_val (result, edge);
+    }
+
+  g_array_free (sorted, TRUE);
+
+  return result;
+}
+
+int
+meta_edge_cache_update (MetaEdgeCache             *cache,
+                        const MetaRectangle       *screen_rect,
+                        const MetaEdgeCacheWindow *new_windows,
+                        int                        n_windows)
+{
+  GArray *windows;
+  GArray *old_windows;
+  GHashTable *old_positions;
+  /* For each window, where it was in old_windows or -1, and whether its
+   * edges can be kept from there
+   */
+  int *old_position;
+  gboolean *unchanged;
+  /* The old positions of the windows that were there before, in their
+   * new stacking order, and whether they kept their place in it
+   */
+  int *order;
+  gboolean *kept;
+  int n_kept_windows;
+  /* The old and new positions of anything that changed */
+  GArray *damage;
+  GSList *obscuring_rects;
+  GSList *rem_rects;
+  GHashTable *dropped;
+  GArray *added_vertical;
+  GArray *added_horizontal;
+  int n_reused;
+  int i;
+
+  /* The edges are clipped to the screen, so nothing can be kept when
+   * it changes
+   */
+  if (!meta_rectangle_equal (&cache->screen_rect, screen_rect))
+    {
+      free_window_edges (cache->windows);
+      g_array_set_size (cache->windows, 0);
+      g_array_set_size (cache->vertical_edges, 0);
+      g_array_set_size (cache->horizontal_edges, 0);
+      cache->screen_rect = *screen_rect;
+    }
+
+  windows = g_array_sized_new (FALSE, FALSE, sizeof (CachedWindow), n_windows);
+  for (i = 0; i < n_windows; i++)
+    {
+      CachedWindow new_window;
+
+      new_window.id = new_windows[i].id;
+      new_window.rect = new_windows[i].rect;
+      new_window.is_dock = new_windows[i].is_dock;
+      new_window.edges = NULL;
+      g_array_append_val (windows, new_window);
+    }
+
+  /*
+   * 1st: Find the windows from the last time, and which of them are still
+   * in the same order relative to each other
+   */
+  old_windows = cache->windows;
+  old_positions = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < (int) old_windows->len; i++)
+    g_hash_table_insert (old_positions,
+                         (gpointer) g_array_index (old_windows, CachedWindow, i).id,
+                         GINT_TO_POINTER (i + 1));
+
+  old_position = g_new (int, n_windows + 1);
+  unchanged = g_new (gboolean, n_windows + 1);
+  order = g_new (int, n_windows + 1);
+  kept = g_new (gboolean, n_windows + 1);
+
+  n_kept_windows = 0;
+  for (i = 0; i < n_windows; i++)
+    {
+      CachedWindow *new_window = &g_array_index (windows, CachedWindow, i);
+
+      old_position[i] =
+        GPOINTER_TO_INT (g_hash_table_lookup (old_positions,
+                                              new_window->id)) - 1;
+      if (old_position[i] >= 0)
+        order[n_kept_windows++] = old_position[i];
+    }
+  g_hash_table_destroy (old_positions);
+
+  meta_stack_order_find_kept (order, n_kept_windows, kept);
+
+  /*
+   * 2nd: Collect where anything appeared, disappeared, moved or was
+   * restacked; the edges of any window touching those places, or that
+   * changed itself, need to be found again.
+   */
+  damage = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  n_kept_windows = 0;
+  for (i = 0; i < n_windows; i++)
+    {
+      CachedWindow *new_window = &g_array_index (windows, CachedWindow, i);
+      CachedWindow *old_window;
+
+      unchanged[i] = FALSE;
+
+      if (old_position[i] < 0)
+        {
+          g_array_append_val (damage, new_window->rect);
+          continue;
+        }
+
+      old_window = &g_array_index (old_windows, CachedWindow, old_position[i]);
+      /* Found in this pass, so that only the vanished windows are left */
+      old_window->id = NULL;
+
+      if (kept[n_kept_windows++] &&
+          old_window->is_dock == new_window->is_dock &&
+          meta_rectangle_equal (&old_window->rect, &new_window->rect))
+        {
+          unchanged[i] = TRUE;
+          continue;
+        }
+
+      g_array_append_val (damage, old_window->rect);
+      g_array_append_val (damage, new_window->rect);
+    }
+
+  for (i = 0; i < (int) old_windows->len; i++)
+    {
+      CachedWindow *old_window = &g_array_index (old_windows, CachedWindow, i);
+
+      if (old_window->id != NULL)
+        g_array_append_val (damage, old_window->rect);
+    }
+
+  /*
+   * 3rd: Keep the edges of the windows nothing has happened to, and find
+   * those of the others, removing the parts covered by the windows
+   * above them.
+   */
+  obscuring_rects = NULL;
+  for (i = n_windows; i > 0; i--)
+    obscuring_rects =
+      g_slist_prepend (obscuring_rects,
+                       &g_array_index (windows, CachedWindow, i - 1).rect);
+
+  added_vertical = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+  added_horizontal = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+
+  n_reused = 0;
+  rem_rects = obscuring_rects;
+  for (i = 0; i < n_windows; i++)
+    {
+      CachedWindow *new_window = &g_array_index (windows, CachedWindow, i);
+      GList *edge_iter;
+
+      /* Update the remaining windows to only those above this one */
+      rem_rects = rem_rects->next;
+
+      if (new_window->is_dock)
+        continue;
+
+      if (unchanged[i] && !rect_is_damaged (&new_window->rect, damage))
+        {
+          CachedWindow *old_window;
+
+          old_window = &g_array_index (old_windows, CachedWindow,
+                                       old_position[i]);
+          new_window->edges = old_window->edges;
+          old_window->edges = NULL;
+          n_reused++;
+          continue;
+        }
+
+      new_window->edges = get_window_edges (&new_window->rect,
+                                            screen_rect,
+                                            rem_rects);
+
+      for (edge_iter = new_window->edges;
+           edge_iter != NULL;
+           edge_iter = edge_iter->next)
+        {
+          MetaEdge *edge = edge_iter->data;
+
+          if (edge_is_vertical (edge))
+            g_array_append_val (added_vertical, edge);
+          else
+            g_array_append_val (added_horizontal, edge);
+        }
+    }
+
+  /*
+   * 4th: Take the edges that weren't kept out of the sorted arrays, and
+   * put the new ones in
+   */
+  dropped = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < (int) old_windows->len; i++)
+    {
+      GList *edge_iter;
+
+      for (edge_iter = g_array_index (old_windows, CachedWindow, i).edges;
+           edge_iter != NULL;
+           edge_iter = edge_iter->next)
+        g_hash_table_add (dropped, edge_iter->data);
+    }
+
+  cache->vertical_edges = update_sorted_edges (cache->vertical_edges,
+                                               dropped, added_vertical);
+  cache->horizontal_edges = update_sorted_edges (cache->horizontal_edges,
+                                                 dropped, added_horizontal);
+
+  /*
+   * 5th: Free the extra memory not needed, and keep the window edges for
+   * next time
+   */
+  g_hash_table_destroy (dropped);
+  g_array_free (added_vertical, TRUE);
+  g_array_free (added_horizontal, TRUE);
+  g_slist_free (obscuring_rects);
+  g_array_free (damage, TRUE);
+  g_free (kept);
+  g_free (order);
+  g_free (unchanged);
+  g_free (old_position);
+
+  free_window_edges (old_windows);
+  g_array_free (old_windows, TRUE);
+  cache->windows = windows;
+
+  return n_reused;
+}
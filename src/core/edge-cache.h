@@ -0,0 +1,70 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file edge-cache.h  Window edges kept from one grab to the next
+ *
+ * Edge resistance needs the edges of all the windows, less the parts
+ * covered by the windows above them, sorted by position. The edges of
+ * a window only depend on its own rectangle and on the windows above
+ * it, so between two grabs only the windows near the ones that changed
+ * need their edges found again, and only those edges need to be taken
+ * out of and put back into the sorted arrays.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_EDGE_CACHE_H
+#define META_EDGE_CACHE_H
+
+#include "boxes.h"
+
+typedef struct _MetaEdgeCache MetaEdgeCache;
+
+typedef struct
+{
+  /* Only compared, never looked at; it may be gone by the next update */
+  gconstpointer  id;
+  MetaRectangle  rect;
+
+  /* Docks have no edges here, but still cover the windows below them */
+  gboolean       is_dock;
+} MetaEdgeCacheWindow;
+
+MetaEdgeCache *meta_edge_cache_new                  (void);
+void           meta_edge_cache_free                 (MetaEdgeCache             *cache);
+
+/* Brings the edges up to date with windows, from bottom to top, and
+ * returns the number of windows whose edges were kept.
+ */
+int            meta_edge_cache_update               (MetaEdgeCache             *cache,
+                                                     const MetaRectangle       *screen_rect,
+                                                     const MetaEdgeCacheWindow *windows,
+                                                     int                        n_windows);
+
+/* Arrays of MetaEdge*, sorted with meta_edge_cache_compare_edges(); they
+ * and the edges belong to the cache and only last until the next update.
+ */
+const GArray  *meta_edge_cache_get_vertical_edges   (MetaEdgeCache             *cache);
+const GArray  *meta_edge_cache_get_horizontal_edges (MetaEdgeCache             *cache);
+
+/* Orders MetaEdge* array elements by position like
+ * meta_rectangle_edge_cmp_ignore_type(), with ties broken by type so
+ * that the order doesn't depend on how the edges were added.
+ */
+gint           meta_edge_cache_compare_edges        (gconstpointer              a,
+                                                     gconstpointer              b);
+
+#endif
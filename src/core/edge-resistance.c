@@ -38,6 +38,9 @@
 
 struct MetaEdgeResistanceData
 {
+  /* left_edges and right_edges are the same array, holding the edges of
+   * both sides; so are top_edges and bottom_edges.
+   */
   GArray *left_edges;
   GArray *right_edges;
   GArray *top_edges;
@@ -574,66 +577,16 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
 void
 meta_display_cleanup_edges (MetaDisplay *display)
 {
-  guint i,j;
   MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
-  GHashTable *edges_to_be_freed;
 
   if (edge_data == NULL) /* Not currently cached */
     return;
 
-  /* We first need to clean out any window edges */
-  edges_to_be_freed = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                             g_free, NULL);
-  for (i = 0; i < 4; i++)
-    {
-      GArray *tmp = NULL;
-      MetaSide side;
-      switch (i)
-        {
-        case 0:
-          tmp = edge_data->left_edges;
-          side = META_SIDE_LEFT;
-          break;
-        case 1:
-          tmp = edge_data->right_edges;
-          side = META_SIDE_RIGHT;
-          break;
-        case 2:
-          tmp = edge_data->top_edges;
-          side = META_SIDE_TOP;
-          break;
-        case 3:
-          tmp = edge_data->bottom_edges;
-          side = META_SIDE_BOTTOM;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
-
-      for (j = 0; j < tmp->len; j++)
-        {
-          MetaEdge *edge = g_array_index (tmp, MetaEdge*, j);
-          if (edge->edge_type == META_EDGE_WINDOW &&
-              edge->side_type == side)
-            {
-              /* The same edge will appear in two arrays, and we can't free
-               * it yet we still need to compare edge->side_type for the other
-               * array that it is in.  So store it in a hash table for later
-               * freeing.  Could also do this in a simple linked list.
-               */
-              g_hash_table_insert (edges_to_be_freed, edge, edge);
-            }
-        }
-    }
-
-  /* Now free all the window edges (the key destroy function is g_free) */
-  g_hash_table_destroy (edges_to_be_freed);
-
-  /* Now free the arrays and data */
+  /* The window edges belong to display->window_edge_cache, and the
+   * others to the workspace, so only the arrays are ours to free
+   */
   g_array_free (edge_data->left_edges, TRUE);
-  g_array_free (edge_data->right_edges, TRUE);
   g_array_free (edge_data->top_edges, TRUE);
-  g_array_free (edge_data->bottom_edges, TRUE);
   edge_data->left_edges = NULL;
   edge_data->right_edges = NULL;
   edge_data->top_edges = NULL;
@@ -643,65 +596,126 @@ meta_display_cleanup_edges (MetaDisplay *display)
   display->grab_edge_resistance_data = NULL;
 }
 
-static int
-stupid_sort_requiring_extra_pointer_dereference (gconstpointer a,
-                                                 gconstpointer b)
+void
+meta_display_free_window_edge_cache (MetaDisplay *display)
 {
-  const MetaEdge * const *a_edge = a;
-  const MetaEdge * const *b_edge = b;
-  return meta_rectangle_edge_cmp_ignore_type (*a_edge, *b_edge);
+  if (display->window_edge_cache == NULL)
+    return;
+
+  meta_display_cleanup_edges (display);
+
+  meta_edge_cache_free (display->window_edge_cache);
+  display->window_edge_cache = NULL;
+}
+
+/* Returns an array of the edges in both window_edges and other_edges,
+ * which are sorted already
+ */
+static GArray*
+merge_edges (const GArray *window_edges,
+             const GArray *other_edges)
+{
+  GArray *result;
+  guint i, j;
+
+  result = g_array_sized_new (FALSE,
+                              FALSE,
+                              sizeof(MetaEdge*),
+                              window_edges->len + other_edges->len);
+
+  i = j = 0;
+  while (i < window_edges->len || j < other_edges->len)
+    {
+      MetaEdge *edge;
+
+      if (j == other_edges->len ||
+          (i < window_edges->len &&
+           meta_edge_cache_compare_edges (&g_array_index (window_edges, MetaEdge*, i),
+                                          &g_array_index (other_edges, MetaEdge*, j)) <= 0))
+        edge = g_array_index (window_edges, MetaEdge*, i++);
+      else
+        edge = g_array_index (other_edges, MetaEdge*, j++);
+
+      g_array_append_val (result, edge);
+    }
+
+  return result;
 }
 
 static void
-cache_edges (MetaDisplay *display,
-             GList       *window_edges,
-             GList       *monitor_edges,
-             GList       *screen_edges)
+cache_edges (MetaDisplay   *display,
+             MetaEdgeCache *window_edge_cache,
+             GList         *monitor_edges,
+             GList         *screen_edges)
 {
   MetaEdgeResistanceData *edge_data;
+  const GArray *window_vertical;
+  const GArray *window_horizontal;
+  GArray *other_vertical;
+  GArray *other_horizontal;
   GList *tmp;
-  int num_left, num_right, num_top, num_bottom;
   int i;
 
+  window_vertical = meta_edge_cache_get_vertical_edges (window_edge_cache);
+  window_horizontal = meta_edge_cache_get_horizontal_edges (window_edge_cache);
+
   /*
    * 0th: Print debugging information to the log about the edges
    */
   if (meta_check_debug_flags (META_DEBUG_EDGE_RESISTANCE))
     {
-      int max_edges = MAX (MAX( g_list_length (window_edges),
-                                g_list_length (monitor_edges)),
-                           g_list_length (screen_edges));
-      char big_buffer[(EDGE_LENGTH+2)*max_edges];
-
-      meta_rectangle_edge_list_to_string (window_edges, ", ", big_buffer);
-      meta_topic (META_DEBUG_EDGE_RESISTANCE,
-                  "Window edges for resistance  : %s\n", big_buffer);
-
-      meta_rectangle_edge_list_to_string (monitor_edges, ", ", big_buffer);
-      meta_topic (META_DEBUG_EDGE_RESISTANCE,
-                  "Monitor edges for resistance: %s\n", big_buffer);
-
-      meta_rectangle_edge_list_to_string (screen_edges, ", ", big_buffer);
-      meta_topic (META_DEBUG_EDGE_RESISTANCE,
-                  "Screen edges for resistance  : %s\n", big_buffer);
+      GList *window_edges = NULL;
+      int max_edges;
+      guint j;
+
+      for (j = window_horizontal->len; j > 0; j--)
+        window_edges = g_list_prepend (window_edges,
+                                       g_array_index (window_horizontal,
+                                                      MetaEdge*, j - 1));
+      for (j = window_vertical->len; j > 0; j--)
+        window_edges = g_list_prepend (window_edges,
+                                       g_array_index (window_vertical,
+                                                      MetaEdge*, j - 1));
+
+      max_edges = MAX (MAX( g_list_length (window_edges),
+                            g_list_length (monitor_edges)),
+                       g_list_length (screen_edges));
+
+      {
+        char big_buffer[(EDGE_LENGTH+2)*max_edges];
+
+        meta_rectangle_edge_list_to_string (window_edges, ", ", big_buffer);
+        meta_topic (META_DEBUG_EDGE_RESISTANCE,
+                    "Window edges for resistance  : %s\n", big_buffer);
+
+        meta_rectangle_edge_list_to_string (monitor_edges, ", ", big_buffer);
+        meta_topic (META_DEBUG_EDGE_RESISTANCE,
+                    "Monitor edges for resistance: %s\n", big_buffer);
+
+        meta_rectangle_edge_list_to_string (screen_edges, ", ", big_buffer);
+        meta_topic (META_DEBUG_EDGE_RESISTANCE,
+                    "Screen edges for resistance  : %s\n", big_buffer);
+      }
+
+      g_list_free (window_edges);
     }
 
   /*
-   * 1st: Get the total number of each kind of edge
+   * 1st: Split the monitor and screen edges by direction and sort them;
+   * the window edges are kept sorted by the cache already
    */
-  num_left = num_right = num_top = num_bottom = 0;
-  for (i = 0; i < 3; i++)
+  other_vertical = g_array_new (FALSE, FALSE, sizeof(MetaEdge*));
+  other_horizontal = g_array_new (FALSE, FALSE, sizeof(MetaEdge*));
+
+  for (i = 0; i < 2; i++)
     {
       tmp = NULL;
       switch (i)
         {
         case 0:
-          tmp = window_edges;
-          break;
-        case 1:
           tmp = monitor_edges;
           break;
-        case 2:
+        case 1:
           tmp = screen_edges;
           break;
         default:
@@ -714,16 +728,12 @@ cache_edges (MetaDisplay *display,
           switch (edge->side_type)
             {
             case META_SIDE_LEFT:
-              num_left++;
-              break;
             case META_SIDE_RIGHT:
-              num_right++;
+              g_array_append_val (other_vertical, edge);
               break;
             case META_SIDE_TOP:
-              num_top++;
-              break;
             case META_SIDE_BOTTOM:
-              num_bottom++;
+              g_array_append_val (other_horizontal, edge);
               break;
             default:
               g_assert_not_reached ();
@@ -732,267 +742,94 @@ cache_edges (MetaDisplay *display,
         }
     }
 
+  g_array_sort (other_vertical, meta_edge_cache_compare_edges);
+  g_array_sort (other_horizontal, meta_edge_cache_compare_edges);
+
   /*
-   * 2nd: Allocate the edges
+   * 2nd: Merge them with the window edges; the same edges are searched
+   * for either side, so each array is used for both
    */
   g_assert (display->grab_edge_resistance_data == NULL);
   display->grab_edge_resistance_data = g_new0 (MetaEdgeResistanceData, 1);
   edge_data = display->grab_edge_resistance_data;
-  edge_data->left_edges   = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->right_edges  = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->top_edges    = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
-  edge_data->bottom_edges = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
-
-  /*
-   * 3rd: Add the edges to the arrays
-   */
-  for (i = 0; i < 3; i++)
-    {
-      tmp = NULL;
-      switch (i)
-        {
-        case 0:
-          tmp = window_edges;
-          break;
-        case 1:
-          tmp = monitor_edges;
-          break;
-        case 2:
-          tmp = screen_edges;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
+  edge_data->left_edges   = merge_edges (window_vertical, other_vertical);
+  edge_data->right_edges  = edge_data->left_edges;
+  edge_data->top_edges    = merge_edges (window_horizontal, other_horizontal);
+  edge_data->bottom_edges = edge_data->top_edges;
 
-      while (tmp)
-        {
-          MetaEdge *edge = tmp->data;
-          switch (edge->side_type)
-            {
-            case META_SIDE_LEFT:
-            case META_SIDE_RIGHT:
-              g_array_append_val (edge_data->left_edges, edge);
-              g_array_append_val (edge_data->right_edges, edge);
-              break;
-            case META_SIDE_TOP:
-            case META_SIDE_BOTTOM:
-              g_array_append_val (edge_data->top_edges, edge);
-              g_array_append_val (edge_data->bottom_edges, edge);
-              break;
-            default:
-              g_assert_not_reached ();
-            }
-          tmp = tmp->next;
-        }
-    }
-
-  /*
-   * 4th: Sort the arrays (FIXME: This is kinda dumb since the arrays were
-   * individually sorted earlier and we could have done this faster and
-   * avoided this sort by sticking them into the array with some simple
-   * merging of the lists).
-   */
-  g_array_sort (display->grab_edge_resistance_data->left_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->right_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->top_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->bottom_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
+  g_array_free (other_vertical, TRUE);
+  g_array_free (other_horizontal, TRUE);
 }
 
 static void
 compute_resistance_and_snapping_edges (MetaDisplay *display)
 {
+  MetaScreen *screen;
   GList *stacked_windows;
   GList *cur_window_iter;
-  GList *edges;
-  /* Lists of window positions (rects) and their relative stacking positions */
-  int stack_position;
-  GSList *obscuring_windows, *window_stacking;
-  /* The portions of the above lists that still remain at the stacking position
-   * in the layer that we are working on
-   */
-  GSList *rem_windows, *rem_win_stacking;
+  GArray *windows;
+  int n_reused;
 
   g_assert (display->grab_window != NULL);
   meta_topic (META_DEBUG_WINDOW_OPS,
               "Computing edges to resist-movement or snap-to for %s.\n",
               display->grab_window->desc);
 
+  screen = display->grab_screen;
+
   /*
    * 1st: Get the list of relevant windows, from bottom to top
    */
   stacked_windows =
-    meta_stack_list_windows (display->grab_screen->stack,
-                             display->grab_screen->active_workspace);
+    meta_stack_list_windows (screen->stack, screen->active_workspace);
 
-  /*
-   * 2nd: we need to separate that stacked list into a list of windows that
-   * can obscure other edges.  To make sure we only have windows obscuring
-   * those below it instead of going both ways, we also need to keep a
-   * counter list.  Messy, I know.
-   */
-  obscuring_windows = window_stacking = NULL;
-  cur_window_iter = stacked_windows;
-  stack_position = 0;
-  while (cur_window_iter != NULL)
+  windows = g_array_new (FALSE, FALSE, sizeof (MetaEdgeCacheWindow));
+  for (cur_window_iter = stacked_windows;
+       cur_window_iter != NULL;
+       cur_window_iter = cur_window_iter->next)
     {
       MetaWindow *cur_window = cur_window_iter->data;
-      if (WINDOW_EDGES_RELEVANT (cur_window, display))
-        {
-          MetaRectangle *new_rect;
-          new_rect = g_new (MetaRectangle, 1);
-          meta_window_get_outer_rect (cur_window, new_rect);
-          obscuring_windows = g_slist_prepend (obscuring_windows, new_rect);
-          window_stacking =
-            g_slist_prepend (window_stacking, GINT_TO_POINTER (stack_position));
-        }
+      MetaEdgeCacheWindow new_window;
 
-      stack_position++;
-      cur_window_iter = cur_window_iter->next;
-    }
-  /* Put 'em in bottom to top order */
-  rem_windows = obscuring_windows = g_slist_reverse (obscuring_windows);
-  rem_win_stacking = window_stacking = g_slist_reverse (window_stacking);
+      if (!(WINDOW_EDGES_RELEVANT (cur_window, display)))
+        continue;
 
-  /*
-   * 3rd: loop over the windows again, this time getting the edges from
-   * them and removing intersections with the relevant obscuring_windows &
-   * obscuring_docks.
-   */
-  edges = NULL;
-  stack_position = 0;
-  cur_window_iter = stacked_windows;
-  while (cur_window_iter != NULL)
-    {
-      MetaRectangle  cur_rect;
-      MetaWindow    *cur_window = cur_window_iter->data;
-      meta_window_get_outer_rect (cur_window, &cur_rect);
-
-      /* Check if we want to use this window's edges for edge
-       * resistance (note that dock edges are considered screen edges
-       * which are handled separately
+      new_window.id = cur_window;
+      meta_window_get_outer_rect (cur_window, &new_window.rect);
+      /* Dock edges are considered screen edges, which are handled
+       * separately, but docks still obscure the windows below them
        */
-      if (WINDOW_EDGES_RELEVANT (cur_window, display) &&
-          cur_window->type != META_WINDOW_DOCK)
-        {
-          GList *new_edges;
-          MetaEdge *new_edge;
-          MetaRectangle reduced;
-
-          /* We don't care about snapping to any portion of the window that
-           * is offscreen (we also don't care about parts of edges covered
-           * by other windows or DOCKS, but that's handled below).
-           */
-          meta_rectangle_intersect (&cur_rect,
-                                    &display->grab_screen->rect,
-                                    &reduced);
-
-          new_edges = NULL;
-
-          /* Left side of this window is resistance for the right edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.width = 0;
-          new_edge->side_type = META_SIDE_RIGHT;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Right side of this window is resistance for the left edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.x += new_edge->rect.width;
-          new_edge->rect.width = 0;
-          new_edge->side_type = META_SIDE_LEFT;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Top side of this window is resistance for the bottom edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.height = 0;
-          new_edge->side_type = META_SIDE_BOTTOM;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Top side of this window is resistance for the bottom edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.y += new_edge->rect.height;
-          new_edge->rect.height = 0;
-          new_edge->side_type = META_SIDE_TOP;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Update the remaining windows to only those at a higher
-           * stacking position than this one.
-           */
-          while (rem_win_stacking &&
-                 stack_position >= GPOINTER_TO_INT (rem_win_stacking->data))
-            {
-              rem_windows      = rem_windows->next;
-              rem_win_stacking = rem_win_stacking->next;
-            }
-
-          /* Remove edge portions overlapped by rem_windows and rem_docks */
-          new_edges =
-            meta_rectangle_remove_intersections_with_boxes_from_edges (
-              new_edges,
-              rem_windows);
-
-          /* Save the new edges */
-          edges = g_list_concat (new_edges, edges);
-        }
-
-      stack_position++;
-      cur_window_iter = cur_window_iter->next;
+      new_window.is_dock = cur_window->type == META_WINDOW_DOCK;
+      g_array_append_val (windows, new_window);
     }
+  g_list_free (stacked_windows);
 
   /*
-   * 4th: Free the extra memory not needed and sort the list
+   * 2nd: Bring the window edges of the last grab up to date; only the
+   * windows near the ones that changed get new edges
    */
-  g_list_free (stacked_windows);
-  /* Free the memory used by the obscuring windows/docks lists */
-  g_slist_free (window_stacking);
-  g_slist_free_full (obscuring_windows, g_free);
+  if (display->window_edge_cache == NULL)
+    display->window_edge_cache = meta_edge_cache_new ();
 
-  /* Sort the list.  FIXME: Should I bother with this sorting?  I just
-   * sort again later in cache_edges() anyway...
-   */
-  edges = g_list_sort (edges, meta_rectangle_edge_cmp);
+  n_reused = meta_edge_cache_update (display->window_edge_cache,
+                                     &screen->rect,
+                                     (MetaEdgeCacheWindow *) windows->data,
+                                     windows->len);
+
+  meta_topic (META_DEBUG_EDGE_RESISTANCE,
+              "Kept the edges of %d of %u windows from the last grab\n",
+              n_reused, windows->len);
+
+  g_array_free (windows, TRUE);
 
   /*
-   * 5th: Cache the combination of these edges with the onscreen and
-   * monitor edges in an array for quick access. Free the edges since
-   * they've been cached elsewhere.
+   * 3rd: Cache the combination of these edges with the onscreen and
+   * monitor edges in an array for quick access.
    */
   cache_edges (display,
-               edges,
-               display->grab_screen->active_workspace->monitor_edges,
-               display->grab_screen->active_workspace->screen_edges);
-  g_list_free (edges);
+               display->window_edge_cache,
+               screen->active_workspace->monitor_edges,
+               screen->active_workspace->screen_edges);
 }
 
 /* Note that old_[xy] and new_[xy] are with respect to inner positions of
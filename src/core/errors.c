@@ -18,48 +18,359 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+ * Every trap is mirrored by a GDK error trap, which is what keeps the
+ * errors caused inside it from reaching the default error handler; GDK
+ * already keeps popped traps around until the server has caught up, so
+ * popping without a result never blocks.
+ *
+ * On top of that we record the request sequence range of each trap
+ * ourselves and watch errors go by with an Xlib error hook, set with
+ * XESetError() on an extension of our own, matching each one to the
+ * innermost trap containing its serial.  Async handlers, as used by
+ * async-getprop.c for replies, won't do here: with XCB underneath
+ * Xlib they never see errors.  The hook gives us the error code
+ * without an XSync whenever the server has already answered, and lets
+ * callers that can act on the result later use
+ * meta_error_trap_pop_async(), whose callback runs from the event loop
+ * once every trapped request has been processed (see
+ * meta_display_queue_reply_sentinel()).
+ */
+
 #include "config.h"
 
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
+#include <X11/Xlibint.h>
 
+#include "display-private.h"
 #include "errors.h"
+#include "round-trips.h"
 
-void
-meta_error_trap_push (MetaDisplay *display)
+typedef struct
+{
+  gulong            start_sequence;
+
+  /* First request not covered by the trap, 0 while still pushed */
+  gulong            end_sequence;
+
+  int               error_code;
+
+  MetaErrorTrapFunc func;
+  gpointer          user_data;
+} MetaErrorTrap;
+
+static GdkDisplay *
+get_gdk_display (MetaDisplay *display)
 {
-  Display *xdisplay;
   GdkDisplay *gdk_display;
 
-  xdisplay = meta_display_get_xdisplay (display);
-  gdk_display = gdk_x11_lookup_xdisplay (xdisplay);
+  gdk_display = gdk_x11_lookup_xdisplay (display->xdisplay);
   g_assert (gdk_display != NULL);
 
-  gdk_x11_display_error_trap_push (gdk_display);
+  return gdk_display;
+}
+
+static gboolean
+trap_contains (MetaErrorTrap *trap,
+               gulong         serial)
+{
+  if (serial < trap->start_sequence)
+    return FALSE;
+
+  return trap->end_sequence == 0 || serial < trap->end_sequence;
+}
+
+static gboolean
+trap_is_complete (MetaErrorTrap *trap,
+                  gulong         processed)
+{
+  return trap->end_sequence <= processed + 1;
+}
+
+static MetaErrorTrap *
+find_trap (MetaDisplay *display,
+           gulong       serial)
+{
+  GList *l;
+  GSList *sl;
+
+  /* Popped traps can only be nested inside pushed ones, never the other
+   * way round, and among popped traps the inner one is popped first; so
+   * the first match in this order is the innermost trap.
+   */
+  for (l = display->pending_error_traps->head; l != NULL; l = l->next)
+    {
+      if (trap_contains (l->data, serial))
+        return l->data;
+    }
+
+  for (sl = display->error_traps; sl != NULL; sl = sl->next)
+    {
+      if (trap_contains (sl->data, serial))
+        return sl->data;
+    }
+
+  return NULL;
+}
+
+/* The displays whose errors we watch; XESetError() hooks get no data */
+static GSList *observed_displays = NULL;
+
+static MetaDisplay *
+find_observed_display (Display *xdisplay)
+{
+  GSList *l;
+
+  for (l = observed_displays; l != NULL; l = l->next)
+    {
+      MetaDisplay *display = l->data;
+
+      if (display->xdisplay == xdisplay)
+        return display;
+    }
+
+  return NULL;
+}
+
+/* The error only carries the low 16 bits of its serial; it is for one
+ * of the last 65536 requests made.
+ */
+static gulong
+get_error_serial (Display *dpy,
+                  xError  *error)
+{
+  gulong last_request;
+  gulong serial;
+
+  last_request = dpy->request;
+  serial = (last_request & ~((gulong) 0xffff)) | error->sequenceNumber;
+
+  if (serial > last_request)
+    serial -= 0x10000;
+
+  return serial;
+}
+
+/* Called by _XError(), and by _XReply() for errors in place of a reply,
+ * with the display locked, so it must not call back into Xlib.  It may
+ * be called twice for the same error.
+ */
+static int
+error_observer (Display   *dpy,
+                xError    *error,
+                XExtCodes *codes,
+                int       *ret_code)
+{
+  MetaDisplay *display;
+  MetaErrorTrap *trap;
+
+  display = find_observed_display (dpy);
+  if (display == NULL)
+    return False;
+
+  trap = find_trap (display, get_error_serial (dpy, error));
+
+  /* Like GDK, only the first error inside a trap is reported */
+  if (trap != NULL && trap->error_code == Success)
+    trap->error_code = error->errorCode;
+
+  /* Never handle it; the GDK trap takes care of ignoring it */
+  return False;
+}
+
+void
+meta_error_trap_init (MetaDisplay *display)
+{
+  XExtCodes *codes;
+
+  display->error_traps = NULL;
+  display->pending_error_traps = g_queue_new ();
+
+  observed_displays = g_slist_prepend (observed_displays, display);
+
+  /* Xlib frees the codes when the display is closed */
+  codes = XAddExtension (display->xdisplay);
+  XESetError (display->xdisplay, codes->extension, error_observer);
+
+  display->error_trap_observer = codes;
+}
+
+void
+meta_error_trap_shutdown (MetaDisplay *display)
+{
+  XExtCodes *codes;
+
+  /* Give pending callbacks their answer before we go away */
+  if (!g_queue_is_empty (display->pending_error_traps))
+    {
+      XSync (display->xdisplay, False);
+      meta_error_trap_process_pending (display);
+    }
+
+  g_queue_free_full (display->pending_error_traps, g_free);
+  display->pending_error_traps = NULL;
+
+  codes = display->error_trap_observer;
+  XESetError (display->xdisplay, codes->extension, NULL);
+  display->error_trap_observer = NULL;
+
+  observed_displays = g_slist_remove (observed_displays, display);
+}
+
+void
+meta_error_trap_push (MetaDisplay *display)
+{
+  MetaErrorTrap *trap;
+
+  gdk_x11_display_error_trap_push (get_gdk_display (display));
+
+  trap = g_new0 (MetaErrorTrap, 1);
+  trap->start_sequence = XNextRequest (display->xdisplay);
+  trap->error_code = Success;
+
+  display->error_traps = g_slist_prepend (display->error_traps, trap);
+}
+
+static MetaErrorTrap *
+pop_trap (MetaDisplay *display)
+{
+  MetaErrorTrap *trap;
+
+  g_return_val_if_fail (display->error_traps != NULL, NULL);
+
+  trap = display->error_traps->data;
+  display->error_traps = g_slist_delete_link (display->error_traps,
+                                              display->error_traps);
+
+  trap->end_sequence = XNextRequest (display->xdisplay);
+
+  /* Never blocks; GDK keeps ignoring errors in the range until the
+   * server has processed it.
+   */
+  gdk_x11_display_error_trap_pop_ignored (get_gdk_display (display));
+
+  return trap;
+}
+
+/* Drops the trap once no more errors can arrive for it; until then it is
+ * kept around so that late errors are attributed to it rather than to
+ * an enclosing trap.
+ */
+static void
+finish_trap (MetaDisplay   *display,
+             MetaErrorTrap *trap)
+{
+  if (trap_is_complete (trap, LastKnownRequestProcessed (display->xdisplay)))
+    g_free (trap);
+  else
+    g_queue_push_tail (display->pending_error_traps, trap);
 }
 
 void
 meta_error_trap_pop (MetaDisplay *display)
 {
-  Display *xdisplay;
-  GdkDisplay *gdk_display;
+  MetaErrorTrap *trap;
 
-  xdisplay = meta_display_get_xdisplay (display);
-  gdk_display = gdk_x11_lookup_xdisplay (xdisplay);
-  g_assert (gdk_display != NULL);
+  trap = pop_trap (display);
+  if (trap == NULL)
+    return;
 
-  gdk_x11_display_error_trap_pop_ignored (gdk_display);
+  finish_trap (display, trap);
 }
 
 int
-meta_error_trap_pop_with_return (MetaDisplay *display)
+meta_error_trap_pop_with_return_full (MetaDisplay *display,
+                                      const char  *site)
 {
-  Display *xdisplay;
-  GdkDisplay *gdk_display;
+  MetaErrorTrap *trap;
+  int result;
 
-  xdisplay = meta_display_get_xdisplay (display);
-  gdk_display = gdk_x11_lookup_xdisplay (xdisplay);
-  g_assert (gdk_display != NULL);
+  trap = pop_trap (display);
+  if (trap == NULL)
+    return Success;
+
+  /* We only have to wait for the server if it hasn't told us about an
+   * error yet and still has some of the trapped requests to process.
+   */
+  if (trap->error_code == Success &&
+      !trap_is_complete (trap, LastKnownRequestProcessed (display->xdisplay)))
+    {
+      gint64 start_time;
+
+      start_time = meta_round_trip_begin ();
+      XSync (display->xdisplay, False);
+      meta_round_trip_end (site, start_time);
+    }
+
+  result = trap->error_code;
+
+  finish_trap (display, trap);
+
+  return result;
+}
+
+/**
+ * Pops a trap without waiting for the server.  Once all requests made
+ * under the trap have been processed, func is called with the result
+ * from the event loop.  If the result is already known, func is called
+ * before this function returns.
+ */
+void
+meta_error_trap_pop_async (MetaDisplay       *display,
+                           MetaErrorTrapFunc  func,
+                           gpointer           user_data)
+{
+  MetaErrorTrap *trap;
+
+  trap = pop_trap (display);
+  if (trap == NULL)
+    return;
+
+  if (trap->error_code != Success ||
+      trap_is_complete (trap, LastKnownRequestProcessed (display->xdisplay)))
+    {
+      func (display, trap->error_code, user_data);
+      finish_trap (display, trap);
+
+      return;
+    }
+
+  trap->func = func;
+  trap->user_data = user_data;
+
+  g_queue_push_tail (display->pending_error_traps, trap);
+
+  meta_display_queue_reply_sentinel (display);
+}
+
+/**
+ * Retires the popped traps that the server has caught up with, running
+ * their callbacks.  Called for every event we get, since each one moves
+ * the last processed request forward.
+ */
+void
+meta_error_trap_process_pending (MetaDisplay *display)
+{
+  gulong processed;
+
+  processed = LastKnownRequestProcessed (display->xdisplay);
+
+  /* The queue is sorted by end sequence, since that is taken at pop */
+  while (!g_queue_is_empty (display->pending_error_traps))
+    {
+      MetaErrorTrap *trap;
+
+      trap = g_queue_peek_head (display->pending_error_traps);
+
+      if (!trap_is_complete (trap, processed))
+        break;
+
+      g_queue_pop_head (display->pending_error_traps);
+
+      if (trap->func != NULL)
+        trap->func (display, trap->error_code, trap->user_data);
 
-  return gdk_x11_display_error_trap_pop (gdk_display);
+      g_free (trap);
+    }
 }
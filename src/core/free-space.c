@@ -0,0 +1,307 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity free space tracking for window placement */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "free-space.h"
+
+struct _MetaFreeSpace
+{
+  MetaRectangle  area;
+
+  /* MetaRectangle; the maximal free rectangles, none of them inside
+   * another
+   */
+  GArray        *free_rects;
+
+  /* MetaRectangle; the windows, cut down to the area */
+  GArray        *windows;
+
+  /* MetaRectangle; scratch space for splitting free rectangles */
+  GArray        *pieces;
+};
+
+MetaFreeSpace *
+meta_free_space_new (const MetaRectangle *area)
+{
+  MetaFreeSpace *space;
+
+  space = g_new0 (MetaFreeSpace, 1);
+  space->area = *area;
+  space->free_rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  space->windows = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  space->pieces = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+
+  if (area->width > 0 && area->height > 0)
+    g_array_append_val (space->free_rects, *area);
+
+  return space;
+}
+
+void
+meta_free_space_free (MetaFreeSpace *space)
+{
+  g_array_free (space->free_rects, TRUE);
+  g_array_free (space->windows, TRUE);
+  g_array_free (space->pieces, TRUE);
+  g_free (space);
+}
+
+/* Appends the maximal rectangles of free_rect that are outside of window */
+static void
+split_free_rect (const MetaRectangle *free_rect,
+                 const MetaRectangle *window,
+                 GArray              *pieces)
+{
+  MetaRectangle piece;
+
+  if (BOX_LEFT (*window) > BOX_LEFT (*free_rect))
+    {
+      piece = *free_rect;
+      piece.width = BOX_LEFT (*window) - BOX_LEFT (*free_rect);
+      g_array_append_val (pieces, piece);
+    }
+  if (BOX_RIGHT (*window) < BOX_RIGHT (*free_rect))
+    {
+      piece = *free_rect;
+      piece.x = BOX_RIGHT (*window);
+      piece.width = BOX_RIGHT (*free_rect) - BOX_RIGHT (*window);
+      g_array_append_val (pieces, piece);
+    }
+  if (BOX_TOP (*window) > BOX_TOP (*free_rect))
+    {
+      piece = *free_rect;
+      piece.height = BOX_TOP (*window) - BOX_TOP (*free_rect);
+      g_array_append_val (pieces, piece);
+    }
+  if (BOX_BOTTOM (*window) < BOX_BOTTOM (*free_rect))
+    {
+      piece = *free_rect;
+      piece.y = BOX_BOTTOM (*window);
+      piece.height = BOX_BOTTOM (*free_rect) - BOX_BOTTOM (*window);
+      g_array_append_val (pieces, piece);
+    }
+}
+
+void
+meta_free_space_add_window (MetaFreeSpace       *space,
+                            const MetaRectangle *window)
+{
+  MetaRectangle clipped;
+  GArray *pieces;
+  guint i, j;
+
+  if (!meta_rectangle_intersect (window, &space->area, &clipped))
+    return;
+
+  g_array_append_val (space->windows, clipped);
+
+  /* Replace the free rectangles the window overlaps by what is left of
+   * them around it
+   */
+  pieces = space->pieces;
+  g_array_set_size (pieces, 0);
+
+  i = 0;
+  while (i < space->free_rects->len)
+    {
+      MetaRectangle *free_rect;
+
+      free_rect = &g_array_index (space->free_rects, MetaRectangle, i);
+
+      if (meta_rectangle_overlap (free_rect, &clipped))
+        {
+          split_free_rect (free_rect, &clipped, pieces);
+          g_array_remove_index_fast (space->free_rects, i);
+        }
+      else
+        i++;
+    }
+
+  /* The rectangles that were left alone are still maximal, and none of
+   * them can be inside a piece, since each piece is inside a rectangle
+   * that was maximal too. So only the pieces can be redundant.
+   */
+  for (i = 0; i < pieces->len; i++)
+    {
+      MetaRectangle *piece = &g_array_index (pieces, MetaRectangle, i);
+      gboolean redundant;
+
+      redundant = FALSE;
+
+      for (j = 0; j < space->free_rects->len && !redundant; j++)
+        redundant =
+          meta_rectangle_contains_rect (&g_array_index (space->free_rects,
+                                                        MetaRectangle, j),
+                                        piece);
+
+      /* Of two equal pieces, keep the first */
+      for (j = 0; j < pieces->len && !redundant; j++)
+        {
+          MetaRectangle *other = &g_array_index (pieces, MetaRectangle, j);
+
+          if (j == i || !meta_rectangle_contains_rect (other, piece))
+            continue;
+
+          redundant = j < i || !meta_rectangle_equal (other, piece);
+        }
+
+      if (!redundant)
+        g_array_append_val (space->free_rects, *piece);
+    }
+}
+
+const MetaRectangle *
+meta_free_space_get_rects (MetaFreeSpace *space,
+                           int           *n_rects)
+{
+  *n_rects = space->free_rects->len;
+
+  return (const MetaRectangle *) space->free_rects->data;
+}
+
+/* Stops counting once the total is over limit, if limit isn't -1 */
+static int
+get_overlap_area (MetaFreeSpace       *space,
+                  const MetaRectangle *rect,
+                  int                  limit)
+{
+  int total;
+  guint i;
+
+  total = 0;
+  for (i = 0; i < space->windows->len; i++)
+    {
+      MetaRectangle overlap;
+
+      if (meta_rectangle_intersect (rect,
+                                    &g_array_index (space->windows,
+                                                    MetaRectangle, i),
+                                    &overlap))
+        {
+          total += meta_rectangle_area (&overlap);
+
+          if (limit >= 0 && total > limit)
+            break;
+        }
+    }
+
+  return total;
+}
+
+static gboolean
+is_better_position (const MetaRectangle *rect,
+                    int                  overlap,
+                    const MetaRectangle *best,
+                    int                  best_overlap)
+{
+  if (best_overlap < 0)
+    return TRUE;
+
+  if (overlap != best_overlap)
+    return overlap < best_overlap;
+
+  if (rect->y != best->y)
+    return rect->y < best->y;
+
+  return rect->x < best->x;
+}
+
+int
+meta_free_space_find_position (MetaFreeSpace *space,
+                               int            width,
+                               int            height,
+                               int           *x,
+                               int           *y)
+{
+  MetaRectangle best;
+  int best_overlap;
+  guint i;
+  int corner;
+
+  if (width > space->area.width || height > space->area.height)
+    return -1;
+
+  best = meta_rect (space->area.x, space->area.y, width, height);
+  best_overlap = -1;
+
+  /* If it fits into a free rectangle, it overlaps nothing there */
+  for (i = 0; i < space->free_rects->len; i++)
+    {
+      const MetaRectangle *free_rect;
+      MetaRectangle rect;
+
+      free_rect = &g_array_index (space->free_rects, MetaRectangle, i);
+      if (free_rect->width < width || free_rect->height < height)
+        continue;
+
+      rect = meta_rect (free_rect->x, free_rect->y, width, height);
+      if (is_better_position (&rect, 0, &best, best_overlap))
+        {
+          best = rect;
+          best_overlap = 0;
+        }
+    }
+
+  if (best_overlap == 0)
+    {
+      *x = best.x;
+      *y = best.y;
+      return 0;
+    }
+
+  /* Otherwise, try it in each corner of each free rectangle, pushed
+   * back into the area where it sticks out, and take the place where it
+   * covers the least of the windows
+   */
+  best_overlap = get_overlap_area (space, &best, -1);
+
+  for (i = 0; i < space->free_rects->len; i++)
+    {
+      const MetaRectangle *free_rect;
+
+      free_rect = &g_array_index (space->free_rects, MetaRectangle, i);
+
+      for (corner = 0; corner < 4; corner++)
+        {
+          MetaRectangle rect;
+          int overlap;
+
+          rect.x = corner & 1 ? BOX_RIGHT (*free_rect) - width : free_rect->x;
+          rect.y = corner & 2 ? BOX_BOTTOM (*free_rect) - height : free_rect->y;
+          rect.width = width;
+          rect.height = height;
+
+          rect.x = CLAMP (rect.x, space->area.x, BOX_RIGHT (space->area) - width);
+          rect.y = CLAMP (rect.y, space->area.y, BOX_BOTTOM (space->area) - height);
+
+          /* Anything over the best so far loses anyway */
+          overlap = get_overlap_area (space, &rect, best_overlap);
+          if (is_better_position (&rect, overlap, &best, best_overlap))
+            {
+              best = rect;
+              best_overlap = overlap;
+            }
+        }
+    }
+
+  *x = best.x;
+  *y = best.y;
+
+  return best_overlap;
+}
@@ -0,0 +1,58 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file free-space.h  Keeping track of the free parts of a work area
+ *
+ * The free space left by the windows in a work area is kept as its
+ * maximal free rectangles: every free rectangle that can't be made any
+ * bigger without running into a window or out of the area. Such
+ * rectangles overlap each other, but a window fits into the free space
+ * if and only if it fits into one of them, so finding a place for it
+ * only needs a look at each. A window being added only splits the free
+ * rectangles it covers.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_FREE_SPACE_H
+#define META_FREE_SPACE_H
+
+#include "boxes.h"
+
+typedef struct _MetaFreeSpace MetaFreeSpace;
+
+MetaFreeSpace       *meta_free_space_new           (const MetaRectangle *area);
+void                 meta_free_space_free          (MetaFreeSpace       *space);
+
+/* Takes the part of window inside the area out of the free space */
+void                 meta_free_space_add_window    (MetaFreeSpace       *space,
+                                                    const MetaRectangle *window);
+
+const MetaRectangle *meta_free_space_get_rects     (MetaFreeSpace       *space,
+                                                    int                 *n_rects);
+
+/* Finds a position for a width x height rectangle within the area where
+ * it overlaps the windows as little as possible, preferring positions
+ * near the top and then the left. Returns the total area it overlaps,
+ * or -1 if it doesn't fit into the area at all.
+ */
+int                  meta_free_space_find_position (MetaFreeSpace       *space,
+                                                    int                  width,
+                                                    int                  height,
+                                                    int                 *x,
+                                                    int                 *y);
+
+#endif
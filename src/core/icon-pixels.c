@@ -0,0 +1,639 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity icon pixel conversion and scaling */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "icon-pixels.h"
+
+#include <string.h>
+
+/* Only compile-time detection: SSE2 is part of the x86-64 baseline and
+ * NEON of AArch64, which covers nearly every build; other targets get
+ * the plain C loops. The NEON paths reinterpret RGBA bytes as native
+ * words, so they are limited to little-endian.
+ */
+#if defined (__SSE2__)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Filter weights are fixed point with this many fractional bits; the
+ * weights for one destination pixel always add up to exactly WEIGHT_ONE.
+ */
+#define WEIGHT_SHIFT 14
+#define WEIGHT_ONE (1 << WEIGHT_SHIFT)
+
+/* The horizontal pass keeps this many extra bits of precision in its
+ * 16-bit output, which the vertical pass drops again.
+ */
+#define INTER_SHIFT (WEIGHT_SHIFT - 6)
+#define FINAL_SHIFT (WEIGHT_SHIFT + 6)
+
+static inline guchar
+mul_un8 (guint x,
+         guint a)
+{
+  guint t;
+
+  /* x * a / 255, correctly rounded */
+  t = x * a + 128;
+
+  return (t + (t >> 8)) >> 8;
+}
+
+static inline void
+swizzle_pixel (guint32  argb,
+               guchar  *rgba)
+{
+  rgba[0] = (argb >> 16) & 0xff;
+  rgba[1] = (argb >> 8) & 0xff;
+  rgba[2] = argb & 0xff;
+  rgba[3] = argb >> 24;
+}
+
+/**
+ * Converts _NET_WM_ICON pixels, one 0xAARRGGBB value in the low 32 bits
+ * of each long, to RGBA bytes.
+ */
+void
+meta_icon_pixels_from_argb (const gulong *argb,
+                            guchar       *rgba,
+                            gsize         n_pixels)
+{
+  gsize i;
+
+  i = 0;
+
+#if defined (USE_SSE2)
+  {
+    const __m128i ag_mask = _mm_set1_epi32 (0xff00ff00);
+    const __m128i low_mask = _mm_set1_epi32 (0x000000ff);
+
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        __m128i v;
+        __m128i rb;
+
+#if GLIB_SIZEOF_LONG == 8
+        __m128i a;
+        __m128i b;
+
+        /* Gather the low halves of four longs into one vector */
+        a = _mm_loadu_si128 ((const __m128i *) (argb + i));
+        b = _mm_loadu_si128 ((const __m128i *) (argb + i + 2));
+        a = _mm_shuffle_epi32 (a, _MM_SHUFFLE (3, 1, 2, 0));
+        b = _mm_shuffle_epi32 (b, _MM_SHUFFLE (3, 1, 2, 0));
+        v = _mm_unpacklo_epi64 (a, b);
+#else
+        v = _mm_loadu_si128 ((const __m128i *) (argb + i));
+#endif
+
+        /* Swap the R and B bytes, leaving A and G in place */
+        rb = _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 (v, 16), low_mask),
+                           _mm_slli_epi32 (_mm_and_si128 (v, low_mask), 16));
+        v = _mm_or_si128 (_mm_and_si128 (v, ag_mask), rb);
+
+        _mm_storeu_si128 ((__m128i *) (rgba + i * 4), v);
+      }
+  }
+#elif defined (USE_NEON)
+  {
+    const uint32x4_t ag_mask = vdupq_n_u32 (0xff00ff00);
+    const uint32x4_t low_mask = vdupq_n_u32 (0x000000ff);
+
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        uint32x4_t v;
+        uint32x4_t rb;
+
+#if GLIB_SIZEOF_LONG == 8
+        v = vcombine_u32 (vmovn_u64 (vld1q_u64 ((const uint64_t *) (argb + i))),
+                          vmovn_u64 (vld1q_u64 ((const uint64_t *) (argb + i + 2))));
+#else
+        v = vld1q_u32 ((const uint32_t *) (argb + i));
+#endif
+
+        rb = vorrq_u32 (vandq_u32 (vshrq_n_u32 (v, 16), low_mask),
+                        vshlq_n_u32 (vandq_u32 (v, low_mask), 16));
+        v = vorrq_u32 (vandq_u32 (v, ag_mask), rb);
+
+        vst1q_u8 (rgba + i * 4, vreinterpretq_u8_u32 (v));
+      }
+  }
+#endif
+
+  for (; i < n_pixels; i++)
+    swizzle_pixel (argb[i], rgba + i * 4);
+}
+
+/**
+ * Multiplies the color channels of RGBA pixels by their alpha.
+ */
+void
+meta_icon_pixels_premultiply (guchar *rgba,
+                              gsize   n_pixels)
+{
+  gsize i;
+
+  i = 0;
+
+#if defined (USE_SSE2)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i half = _mm_set1_epi16 (128);
+    const __m128i alpha_mask = _mm_set1_epi32 (0xff000000);
+
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        __m128i v;
+        __m128i lo;
+        __m128i hi;
+        __m128i alpha_lo;
+        __m128i alpha_hi;
+
+        v = _mm_loadu_si128 ((const __m128i *) (rgba + i * 4));
+
+        lo = _mm_unpacklo_epi8 (v, zero);
+        hi = _mm_unpackhi_epi8 (v, zero);
+
+        alpha_lo = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (lo, _MM_SHUFFLE (3, 3, 3, 3)),
+                                        _MM_SHUFFLE (3, 3, 3, 3));
+        alpha_hi = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (hi, _MM_SHUFFLE (3, 3, 3, 3)),
+                                        _MM_SHUFFLE (3, 3, 3, 3));
+
+        /* Same rounding as mul_un8() */
+        lo = _mm_add_epi16 (_mm_mullo_epi16 (lo, alpha_lo), half);
+        hi = _mm_add_epi16 (_mm_mullo_epi16 (hi, alpha_hi), half);
+        lo = _mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8);
+        hi = _mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8);
+
+        /* Put the original alpha back */
+        v = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, _mm_packus_epi16 (lo, hi)),
+                          _mm_and_si128 (alpha_mask, v));
+
+        _mm_storeu_si128 ((__m128i *) (rgba + i * 4), v);
+      }
+  }
+#elif defined (USE_NEON)
+  for (; i + 8 <= n_pixels; i += 8)
+    {
+      uint8x8x4_t v;
+      int c;
+
+      v = vld4_u8 (rgba + i * 4);
+
+      for (c = 0; c < 3; c++)
+        {
+          uint16x8_t t;
+
+          t = vaddq_u16 (vmull_u8 (v.val[c], v.val[3]), vdupq_n_u16 (128));
+          v.val[c] = vshrn_n_u16 (vaddq_u16 (t, vshrq_n_u16 (t, 8)), 8);
+        }
+
+      vst4_u8 (rgba + i * 4, v);
+    }
+#endif
+
+  for (; i < n_pixels; i++)
+    {
+      guchar *p = rgba + i * 4;
+
+      p[0] = mul_un8 (p[0], p[3]);
+      p[1] = mul_un8 (p[1], p[3]);
+      p[2] = mul_un8 (p[2], p[3]);
+    }
+}
+
+/**
+ * Undoes meta_icon_pixels_premultiply(). Only ever run on icons that
+ * have already been scaled down, so it is left to the compiler.
+ */
+void
+meta_icon_pixels_unpremultiply (guchar *rgba,
+                                gsize   n_pixels)
+{
+  gsize i;
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      guchar *p = rgba + i * 4;
+      guint a;
+      int c;
+
+      a = p[3];
+      if (a == 0xff || a == 0)
+        continue;
+
+      for (c = 0; c < 3; c++)
+        p[c] = MIN (0xff, (p[c] * 0xff + a / 2) / a);
+    }
+}
+
+/**
+ * Replaces the alpha channel of dest with that of src.
+ */
+void
+meta_icon_pixels_copy_alpha (const guchar *src,
+                             guchar       *dest,
+                             gsize         n_pixels)
+{
+  gsize i;
+
+  i = 0;
+
+#if defined (USE_SSE2)
+  {
+    const __m128i alpha_mask = _mm_set1_epi32 (0xff000000);
+
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        __m128i s;
+        __m128i d;
+
+        s = _mm_loadu_si128 ((const __m128i *) (src + i * 4));
+        d = _mm_loadu_si128 ((const __m128i *) (dest + i * 4));
+
+        d = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, d),
+                          _mm_and_si128 (alpha_mask, s));
+
+        _mm_storeu_si128 ((__m128i *) (dest + i * 4), d);
+      }
+  }
+#elif defined (USE_NEON)
+  for (; i + 8 <= n_pixels; i += 8)
+    {
+      uint8x8x4_t s;
+      uint8x8x4_t d;
+
+      s = vld4_u8 (src + i * 4);
+      d = vld4_u8 (dest + i * 4);
+
+      d.val[3] = s.val[3];
+
+      vst4_u8 (dest + i * 4, d);
+    }
+#endif
+
+  for (; i < n_pixels; i++)
+    dest[i * 4 + 3] = src[i * 4 + 3];
+}
+
+/**
+ * Turns a depth 1 pixmap that has been read back as transparent/opaque
+ * into opaque white background/black foreground.
+ */
+void
+meta_icon_pixels_bitmap_to_mono (guchar *rgba,
+                                 gsize   n_pixels)
+{
+  gsize i;
+
+  i = 0;
+
+#if defined (USE_SSE2)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i alpha_mask = _mm_set1_epi32 (0xff000000);
+
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        __m128i v;
+        __m128i transparent;
+
+        v = _mm_loadu_si128 ((const __m128i *) (rgba + i * 4));
+
+        transparent = _mm_cmpeq_epi32 (_mm_and_si128 (v, alpha_mask), zero);
+        v = _mm_or_si128 (transparent, alpha_mask);
+
+        _mm_storeu_si128 ((__m128i *) (rgba + i * 4), v);
+      }
+  }
+#elif defined (USE_NEON)
+  for (; i + 8 <= n_pixels; i += 8)
+    {
+      uint8x8x4_t v;
+      uint8x8_t transparent;
+
+      v = vld4_u8 (rgba + i * 4);
+
+      transparent = vceq_u8 (v.val[3], vdup_n_u8 (0));
+      v.val[0] = v.val[1] = v.val[2] = transparent;
+      v.val[3] = vdup_n_u8 (0xff);
+
+      vst4_u8 (rgba + i * 4, v);
+    }
+#endif
+
+  for (; i < n_pixels; i++)
+    {
+      guchar *p = rgba + i * 4;
+
+      if (p[3] == 0)
+        p[0] = p[1] = p[2] = 0xff; /* white background */
+      else
+        p[0] = p[1] = p[2] = 0x00; /* black foreground */
+
+      p[3] = 0xff;
+    }
+}
+
+/* Box filter taps along one axis: destination pixel i averages the
+ * count[i] source pixels starting at first[i], weighted by how much of
+ * each one it covers.
+ */
+typedef struct
+{
+  int     max_taps;
+  int    *first;
+  int    *count;
+  gint32 *weights;
+} FilterTaps;
+
+static void
+filter_taps_init (FilterTaps *taps,
+                  int         src_size,
+                  int         dest_size)
+{
+  int i;
+
+  taps->max_taps = (src_size + dest_size - 1) / dest_size + 1;
+  taps->first = g_new (int, dest_size);
+  taps->count = g_new (int, dest_size);
+  taps->weights = g_new0 (gint32, dest_size * taps->max_taps);
+
+  for (i = 0; i < dest_size; i++)
+    {
+      gint64 lo;
+      gint64 hi;
+      gint32 *weights;
+      int total;
+      int largest;
+      int k;
+
+      /* In units of 1/dest_size of a source pixel, destination pixel i
+       * covers [lo, hi) and source pixel j covers [j, j + 1) * dest_size.
+       */
+      lo = (gint64) i * src_size;
+      hi = lo + src_size;
+
+      taps->first[i] = lo / dest_size;
+      taps->count[i] = (hi - 1) / dest_size - taps->first[i] + 1;
+
+      weights = taps->weights + i * taps->max_taps;
+      total = 0;
+      largest = 0;
+
+      for (k = 0; k < taps->count[i]; k++)
+        {
+          gint64 pixel_lo;
+          gint64 overlap;
+
+          pixel_lo = (gint64) (taps->first[i] + k) * dest_size;
+          overlap = MIN (hi, pixel_lo + dest_size) - MAX (lo, pixel_lo);
+
+          weights[k] = (overlap * WEIGHT_ONE + src_size / 2) / src_size;
+          total += weights[k];
+
+          if (weights[k] > weights[largest])
+            largest = k;
+        }
+
+      /* Rounding must not change the brightness */
+      weights[largest] += WEIGHT_ONE - total;
+    }
+}
+
+static void
+filter_taps_free (FilterTaps *taps)
+{
+  g_free (taps->first);
+  g_free (taps->count);
+  g_free (taps->weights);
+}
+
+static void
+downscale_row (const guchar *src,
+               guint16      *inter,
+               FilterTaps   *taps,
+               int           dest_width)
+{
+  int x;
+
+  for (x = 0; x < dest_width; x++)
+    {
+      const guchar *p = src + taps->first[x] * 4;
+      const gint32 *weights = taps->weights + x * taps->max_taps;
+      int count = taps->count[x];
+      int k;
+
+#if defined (USE_SSE2)
+      __m128i zero = _mm_setzero_si128 ();
+      __m128i acc = zero;
+
+      for (k = 0; k < count; k++)
+        {
+          __m128i pixel;
+          guint32 word;
+
+          memcpy (&word, p + k * 4, 4);
+
+          /* Spread the channels over 32-bit lanes, with the weight in
+           * the low and zero in the high half of each lane's pair, so
+           * madd yields channel * weight.
+           */
+          pixel = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (word), zero);
+          pixel = _mm_unpacklo_epi16 (pixel, zero);
+          acc = _mm_add_epi32 (acc, _mm_madd_epi16 (pixel, _mm_set1_epi32 (weights[k])));
+        }
+
+      acc = _mm_srli_epi32 (_mm_add_epi32 (acc, _mm_set1_epi32 (1 << (INTER_SHIFT - 1))),
+                            INTER_SHIFT);
+      _mm_storel_epi64 ((__m128i *) (inter + x * 4), _mm_packs_epi32 (acc, acc));
+#elif defined (USE_NEON)
+      uint32x4_t acc = vdupq_n_u32 (0);
+
+      for (k = 0; k < count; k++)
+        {
+          uint32_t word;
+          uint16x4_t pixel;
+
+          memcpy (&word, p + k * 4, 4);
+
+          pixel = vget_low_u16 (vmovl_u8 (vreinterpret_u8_u32 (vdup_n_u32 (word))));
+          acc = vmlal_n_u16 (acc, pixel, weights[k]);
+        }
+
+      vst1_u16 (inter + x * 4, vrshrn_n_u32 (acc, INTER_SHIFT));
+#else
+      int c;
+
+      for (c = 0; c < 4; c++)
+        {
+          guint32 acc = 0;
+
+          for (k = 0; k < count; k++)
+            acc += p[k * 4 + c] * weights[k];
+
+          inter[x * 4 + c] = (acc + (1 << (INTER_SHIFT - 1))) >> INTER_SHIFT;
+        }
+#endif
+    }
+}
+
+static void
+downscale_column (guint16     **inter_rows,
+                  const gint32 *weights,
+                  int           count,
+                  guchar       *dest,
+                  int           n_values)
+{
+  int i;
+  int k;
+
+  i = 0;
+
+#if defined (USE_SSE2)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i round = _mm_set1_epi32 (1 << (FINAL_SHIFT - 1));
+
+    for (; i + 8 <= n_values; i += 8)
+      {
+        __m128i acc_lo = _mm_setzero_si128 ();
+        __m128i acc_hi = _mm_setzero_si128 ();
+        __m128i v;
+
+        for (k = 0; k < count; k++)
+          {
+            __m128i w = _mm_set1_epi32 (weights[k]);
+
+            v = _mm_loadu_si128 ((const __m128i *) (inter_rows[k] + i));
+
+            acc_lo = _mm_add_epi32 (acc_lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (v, zero), w));
+            acc_hi = _mm_add_epi32 (acc_hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (v, zero), w));
+          }
+
+        acc_lo = _mm_srli_epi32 (_mm_add_epi32 (acc_lo, round), FINAL_SHIFT);
+        acc_hi = _mm_srli_epi32 (_mm_add_epi32 (acc_hi, round), FINAL_SHIFT);
+
+        v = _mm_packs_epi32 (acc_lo, acc_hi);
+        _mm_storel_epi64 ((__m128i *) (dest + i), _mm_packus_epi16 (v, v));
+      }
+  }
+#elif defined (USE_NEON)
+  {
+    const uint32x4_t round = vdupq_n_u32 (1 << (FINAL_SHIFT - 1));
+
+    for (; i + 8 <= n_values; i += 8)
+      {
+        uint32x4_t acc_lo = vdupq_n_u32 (0);
+        uint32x4_t acc_hi = vdupq_n_u32 (0);
+        uint16x8_t v;
+
+        for (k = 0; k < count; k++)
+          {
+            v = vld1q_u16 (inter_rows[k] + i);
+
+            acc_lo = vmlal_n_u16 (acc_lo, vget_low_u16 (v), weights[k]);
+            acc_hi = vmlal_n_u16 (acc_hi, vget_high_u16 (v), weights[k]);
+          }
+
+        acc_lo = vshrq_n_u32 (vaddq_u32 (acc_lo, round), FINAL_SHIFT);
+        acc_hi = vshrq_n_u32 (vaddq_u32 (acc_hi, round), FINAL_SHIFT);
+
+        v = vcombine_u16 (vmovn_u32 (acc_lo), vmovn_u32 (acc_hi));
+        vst1_u8 (dest + i, vmovn_u16 (v));
+      }
+  }
+#endif
+
+  for (; i < n_values; i++)
+    {
+      guint32 acc = 0;
+
+      for (k = 0; k < count; k++)
+        acc += inter_rows[k][i] * weights[k];
+
+      dest[i] = (acc + (1 << (FINAL_SHIFT - 1))) >> FINAL_SHIFT;
+    }
+}
+
+/**
+ * Shrinks premultiplied RGBA pixels with an area-averaging box filter.
+ * The filter is separable: each source row is first reduced to the
+ * destination width, then columns of those rows are reduced to the
+ * destination height.
+ *
+ * The destination must not be larger than the source along either axis;
+ * enlarging is better left to a bilinear filter.
+ */
+void
+meta_icon_pixels_downscale (const guchar *src,
+                            int           src_width,
+                            int           src_height,
+                            int           src_stride,
+                            guchar       *dest,
+                            int           dest_width,
+                            int           dest_height,
+                            int           dest_stride)
+{
+  FilterTaps horizontal;
+  FilterTaps vertical;
+  guint16 *inter;
+  guint16 **inter_rows;
+  int inter_stride;
+  int y;
+
+  g_return_if_fail (dest_width > 0 && dest_width <= src_width);
+  g_return_if_fail (dest_height > 0 && dest_height <= src_height);
+
+  filter_taps_init (&horizontal, src_width, dest_width);
+  filter_taps_init (&vertical, src_height, dest_height);
+
+  inter_stride = dest_width * 4;
+  inter = g_new (guint16, inter_stride * src_height);
+
+  for (y = 0; y < src_height; y++)
+    downscale_row (src + y * src_stride, inter + y * inter_stride,
+                   &horizontal, dest_width);
+
+  inter_rows = g_new (guint16 *, vertical.max_taps);
+
+  for (y = 0; y < dest_height; y++)
+    {
+      int k;
+
+      for (k = 0; k < vertical.count[y]; k++)
+        inter_rows[k] = inter + (vertical.first[y] + k) * inter_stride;
+
+      downscale_column (inter_rows,
+                        vertical.weights + y * vertical.max_taps,
+                        vertical.count[y],
+                        dest + y * dest_stride,
+                        inter_stride);
+    }
+
+  g_free (inter_rows);
+  g_free (inter);
+
+  filter_taps_free (&horizontal);
+  filter_taps_free (&vertical);
+}
@@ -0,0 +1,61 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file icon-pixels.h  Pixel conversion and scaling for window icons
+ *
+ * Icons arrive as _NET_WM_ICON data (one unpremultiplied ARGB pixel in
+ * each long) or as legacy pixmap/mask pairs, and have to end up as
+ * RGBA GdkPixbufs at the frame and tab-list sizes. The loops doing that
+ * run every time a busy application changes its icon, so the hot ones
+ * use SSE2 or NEON when the target guarantees them (x86-64 and AArch64
+ * always do) and fall back to portable C elsewhere; every path computes
+ * exactly the same result.
+ *
+ * All RGBA buffers are GdkPixbuf byte order: R, G, B, A.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_ICON_PIXELS_H
+#define META_ICON_PIXELS_H
+
+#include <glib.h>
+
+void meta_icon_pixels_from_argb      (const gulong *argb,
+                                      guchar       *rgba,
+                                      gsize         n_pixels);
+
+void meta_icon_pixels_premultiply    (guchar       *rgba,
+                                      gsize         n_pixels);
+void meta_icon_pixels_unpremultiply  (guchar       *rgba,
+                                      gsize         n_pixels);
+
+void meta_icon_pixels_copy_alpha     (const guchar *src,
+                                      guchar       *dest,
+                                      gsize         n_pixels);
+void meta_icon_pixels_bitmap_to_mono (guchar       *rgba,
+                                      gsize         n_pixels);
+
+void meta_icon_pixels_downscale      (const guchar *src,
+                                      int           src_width,
+                                      int           src_height,
+                                      int           src_stride,
+                                      guchar       *dest,
+                                      int           dest_width,
+                                      int           dest_height,
+                                      int           dest_stride);
+
+#endif
@@ -0,0 +1,320 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity display-wide icon store */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "icon-store.h"
+#include "util.h"
+
+#include <string.h>
+
+typedef struct
+{
+  guint64 hash;
+  int     width;
+  int     height;
+  int     size;
+} IconKey;
+
+typedef struct
+{
+  IconKey  key;
+
+  /* Windows hold the references; the entry goes stale once they are
+   * all gone, and is dropped at the next purge.
+   */
+  GWeakRef pixbuf;
+} IconEntry;
+
+struct _MetaIconStore
+{
+  /* Icons are scaled on worker threads, see iconcache.c */
+  GMutex      lock;
+
+  /* IconKey -> IconEntry */
+  GHashTable *entries;
+  guint       purge_threshold;
+
+  guint       n_lookups;
+  guint       n_shared;
+  guint64     bytes_saved;
+};
+
+#define MIN_PURGE_THRESHOLD 64
+
+/* A 64-bit multiply-rotate hash over the pixels; collisions would show
+ * one application's icon on another's windows, so 32 bits won't do.
+ */
+static guint64
+hash_pixels (const guchar *pixdata,
+             gsize         len)
+{
+  const guint64 k1 = G_GUINT64_CONSTANT (0x9e3779b97f4a7c15);
+  const guint64 k2 = G_GUINT64_CONSTANT (0xc2b2ae3d27d4eb4f);
+  guint64 hash;
+  gsize i;
+
+  hash = len * k1;
+
+  for (i = 0; i + 8 <= len; i += 8)
+    {
+      guint64 word;
+
+      memcpy (&word, pixdata + i, 8);
+
+      word *= k2;
+      word = (word << 31) | (word >> 33);
+      hash ^= word * k1;
+      hash = ((hash << 27) | (hash >> 37)) * 5 + 0x52dce729;
+    }
+
+  for (; i < len; i++)
+    hash = (hash ^ pixdata[i]) * k1;
+
+  /* Final avalanche, so that the low bits used by the hash table depend
+   * on all of the input
+   */
+  hash ^= hash >> 33;
+  hash *= k2;
+  hash ^= hash >> 29;
+
+  return hash;
+}
+
+static guint
+icon_key_hash (gconstpointer v)
+{
+  const IconKey *key = v;
+
+  return (guint) key->hash;
+}
+
+static gboolean
+icon_key_equal (gconstpointer a,
+                gconstpointer b)
+{
+  const IconKey *key_a = a;
+  const IconKey *key_b = b;
+
+  return key_a->hash == key_b->hash &&
+         key_a->width == key_b->width &&
+         key_a->height == key_b->height &&
+         key_a->size == key_b->size;
+}
+
+static gsize
+pixbuf_bytes (GdkPixbuf *pixbuf)
+{
+  return (gsize) gdk_pixbuf_get_rowstride (pixbuf) *
+         gdk_pixbuf_get_height (pixbuf);
+}
+
+static void
+icon_entry_free (gpointer data)
+{
+  IconEntry *entry = data;
+
+  g_weak_ref_clear (&entry->pixbuf);
+  g_free (entry);
+}
+
+static gboolean
+icon_entry_is_stale (gpointer key,
+                     gpointer value,
+                     gpointer user_data)
+{
+  IconEntry *entry = value;
+  GdkPixbuf *pixbuf;
+
+  pixbuf = g_weak_ref_get (&entry->pixbuf);
+  if (pixbuf == NULL)
+    return TRUE;
+
+  g_object_unref (pixbuf);
+
+  return FALSE;
+}
+
+/* Called with the lock held. Purging only when the table has doubled
+ * since the last time keeps the cost per insertion constant.
+ */
+static void
+maybe_purge (MetaIconStore *store)
+{
+  if (g_hash_table_size (store->entries) < store->purge_threshold)
+    return;
+
+  g_hash_table_foreach_remove (store->entries, icon_entry_is_stale, NULL);
+
+  store->purge_threshold = MAX (MIN_PURGE_THRESHOLD,
+                                g_hash_table_size (store->entries) * 2);
+}
+
+MetaIconStore *
+meta_icon_store_new (void)
+{
+  MetaIconStore *store;
+
+  store = g_new0 (MetaIconStore, 1);
+  g_mutex_init (&store->lock);
+  store->entries = g_hash_table_new_full (icon_key_hash, icon_key_equal,
+                                          NULL, icon_entry_free);
+  store->purge_threshold = MIN_PURGE_THRESHOLD;
+
+  return store;
+}
+
+/**
+ * Must not be called while icons may still be scaled on other threads.
+ */
+void
+meta_icon_store_free (MetaIconStore *store)
+{
+  meta_icon_store_dump_stats (store);
+
+  /* Windows may still hold icons; they simply stop being shared */
+  g_hash_table_destroy (store->entries);
+  g_mutex_clear (&store->lock);
+  g_free (store);
+}
+
+/**
+ * Returns a reference to the icon for width x height RGBA pixels scaled
+ * to size, calling scale_func only if no window is already using an
+ * identical icon. Takes ownership of pixdata either way.
+ */
+GdkPixbuf *
+meta_icon_store_scale (MetaIconStore     *store,
+                       guchar            *pixdata,
+                       int                width,
+                       int                height,
+                       int                size,
+                       MetaIconScaleFunc  scale_func)
+{
+  IconKey key;
+  IconEntry *entry;
+  GdkPixbuf *pixbuf;
+  GdkPixbuf *shared;
+
+  key.hash = hash_pixels (pixdata, (gsize) width * height * 4);
+  key.width = width;
+  key.height = height;
+  key.size = size;
+
+  g_mutex_lock (&store->lock);
+
+  store->n_lookups += 1;
+
+  entry = g_hash_table_lookup (store->entries, &key);
+  shared = entry != NULL ? g_weak_ref_get (&entry->pixbuf) : NULL;
+
+  if (shared != NULL)
+    {
+      store->n_shared += 1;
+      store->bytes_saved += pixbuf_bytes (shared);
+    }
+
+  g_mutex_unlock (&store->lock);
+
+  if (shared != NULL)
+    {
+      g_free (pixdata);
+
+      return shared;
+    }
+
+  /* Scale without holding the lock; if another thread gets the same
+   * icon done first, we use theirs instead.
+   */
+  pixbuf = (* scale_func) (pixdata, width, height, size);
+  if (pixbuf == NULL)
+    return NULL;
+
+  g_mutex_lock (&store->lock);
+
+  entry = g_hash_table_lookup (store->entries, &key);
+  shared = entry != NULL ? g_weak_ref_get (&entry->pixbuf) : NULL;
+
+  if (shared != NULL)
+    {
+      store->n_shared += 1;
+    }
+  else if (entry != NULL)
+    {
+      g_weak_ref_set (&entry->pixbuf, pixbuf);
+    }
+  else
+    {
+      maybe_purge (store);
+
+      entry = g_new0 (IconEntry, 1);
+      entry->key = key;
+      g_weak_ref_init (&entry->pixbuf, pixbuf);
+
+      g_hash_table_insert (store->entries, &entry->key, entry);
+    }
+
+  g_mutex_unlock (&store->lock);
+
+  if (shared != NULL)
+    {
+      g_object_unref (pixbuf);
+
+      return shared;
+    }
+
+  return pixbuf;
+}
+
+void
+meta_icon_store_dump_stats (MetaIconStore *store)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint n_icons;
+  guint64 live_bytes;
+
+  n_icons = 0;
+  live_bytes = 0;
+
+  g_mutex_lock (&store->lock);
+
+  g_hash_table_iter_init (&iter, store->entries);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      IconEntry *entry = value;
+      GdkPixbuf *pixbuf;
+
+      pixbuf = g_weak_ref_get (&entry->pixbuf);
+      if (pixbuf == NULL)
+        continue;
+
+      n_icons += 1;
+      live_bytes += pixbuf_bytes (pixbuf);
+
+      g_object_unref (pixbuf);
+    }
+
+  meta_verbose ("Icon store: %u distinct icons using %" G_GUINT64_FORMAT
+                " bytes; %u of %u icons were shared, saving %" G_GUINT64_FORMAT
+                " bytes in total\n",
+                n_icons, live_bytes,
+                store->n_shared, store->n_lookups, store->bytes_saved);
+
+  g_mutex_unlock (&store->lock);
+}
@@ -0,0 +1,56 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file icon-store.h  Display-wide store of scaled window icons
+ *
+ * Windows of one application usually all set the same _NET_WM_ICON, so
+ * rather than every window scaling its own copy, scaled icons are looked
+ * up by the contents of the source image and the size they were scaled
+ * to. Windows hold ordinary references to the pixbufs; the store only
+ * keeps weak ones, so an icon goes away with the last window using it.
+ * The store may be used from any thread.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_ICON_STORE_H
+#define META_ICON_STORE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+typedef struct _MetaIconStore MetaIconStore;
+
+/* Scales width x height RGBA pixels to a size x size icon, taking
+ * ownership of pixdata
+ */
+typedef GdkPixbuf * (* MetaIconScaleFunc) (guchar *pixdata,
+                                           int     width,
+                                           int     height,
+                                           int     size);
+
+MetaIconStore *meta_icon_store_new        (void);
+void           meta_icon_store_free       (MetaIconStore     *store);
+
+GdkPixbuf     *meta_icon_store_scale      (MetaIconStore     *store,
+                                           guchar            *pixdata,
+                                           int                width,
+                                           int                height,
+                                           int                size,
+                                           MetaIconScaleFunc  scale_func);
+
+void           meta_icon_store_dump_stats (MetaIconStore     *store);
+
+#endif
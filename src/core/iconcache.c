@@ -21,10 +21,14 @@
 
 #include <config.h>
 #include "iconcache.h"
+#include "icon-pixels.h"
+#include "icon-store.h"
 #include "ui.h"
 #include "errors.h"
+#include "xprops.h"
 
 #include <X11/Xatom.h>
+#include <string.h>
 
 #include "window-private.h"
 
@@ -44,6 +48,46 @@ get_fallback_icons (MetaScreen  *screen,
   *mini_iconp = meta_ui_get_default_mini_icon (screen->ui, ideal_mini_size);
 }
 
+/* Whether a w x h icon is a better match for ideal_size than the best
+ * one found so far, if any
+ */
+static gboolean
+size_is_better (gboolean have_best,
+                int      best_w,
+                int      best_h,
+                int      w,
+                int      h,
+                int      ideal_size)
+{
+  int best_size;
+  int this_size;
+
+  if (!have_best)
+    return TRUE;
+
+  /* work with averages */
+  best_size = (best_w + best_h) / 2;
+  this_size = (w + h) / 2;
+
+  /* larger than desired is always better than smaller */
+  if (best_size < ideal_size &&
+      this_size >= ideal_size)
+    return TRUE;
+  /* if we have too small, pick anything bigger */
+  else if (best_size < ideal_size &&
+           this_size > best_size)
+    return TRUE;
+  /* if we have too large, pick anything smaller
+   * but still >= the ideal
+   */
+  else if (best_size > ideal_size &&
+           this_size >= ideal_size &&
+           this_size < best_size)
+    return TRUE;
+
+  return FALSE;
+}
+
 static gboolean
 find_best_size (gulong  *data,
                 gulong   nitems,
@@ -67,9 +111,6 @@ find_best_size (gulong  *data,
   while (nitems > 0)
     {
       int w, h;
-      gboolean replace;
-
-      replace = FALSE;
 
       if (nitems < 3)
         return FALSE; /* no space for w, h */
@@ -80,34 +121,8 @@ find_best_size (gulong  *data,
       if (nitems < ((gulong)(w * h) + 2))
         break; /* not enough data */
 
-      if (best_start == NULL)
-        {
-          replace = TRUE;
-        }
-      else
-        {
-          /* work with averages */
-          int best_size = (best_w + best_h) / 2;
-          int this_size = (w + h) / 2;
-
-          /* larger than desired is always better than smaller */
-          if (best_size < ideal_size &&
-              this_size >= ideal_size)
-            replace = TRUE;
-          /* if we have too small, pick anything bigger */
-          else if (best_size < ideal_size &&
-                   this_size > best_size)
-            replace = TRUE;
-          /* if we have too large, pick anything smaller
-           * but still >= the ideal
-           */
-          else if (best_size > ideal_size &&
-                   this_size >= ideal_size &&
-                   this_size < best_size)
-            replace = TRUE;
-        }
-
-      if (replace)
+      if (size_is_better (best_start != NULL, best_w, best_h,
+                          w, h, ideal_size))
         {
           best_start = data + 2;
           best_w = w;
@@ -132,33 +147,9 @@ find_best_size (gulong  *data,
 static void
 argbdata_to_pixdata (gulong *argb_data, int len, guchar **pixdata)
 {
-  guchar *p;
-  int i;
-
   *pixdata = g_new (guchar, len * 4);
-  p = *pixdata;
 
-  /* One could speed this up a lot. */
-  i = 0;
-  while (i < len)
-    {
-      guint argb;
-      guint rgba;
-
-      argb = argb_data[i];
-      rgba = (argb << 8) | (argb >> 24);
-
-      *p = rgba >> 24;
-      ++p;
-      *p = (rgba >> 16) & 0xff;
-      ++p;
-      *p = (rgba >> 8) & 0xff;
-      ++p;
-      *p = rgba & 0xff;
-      ++p;
-
-      ++i;
-    }
+  meta_icon_pixels_from_argb (argb_data, *pixdata, len);
 }
 
 static gboolean
@@ -286,7 +277,7 @@ static void
 apply_foreground_background (GdkPixbuf *pixbuf)
 {
   int w, h;
-  int i, j;
+  int i;
   guchar *pixels;
   int stride;
 
@@ -295,25 +286,8 @@ apply_foreground_background (GdkPixbuf *pixbuf)
   pixels = gdk_pixbuf_get_pixels (pixbuf);
   stride = gdk_pixbuf_get_rowstride (pixbuf);
 
-  i = 0;
-  while (i < h)
-    {
-      j = 0;
-      while (j < w)
-        {
-          guchar *p = pixels + i * stride + j * 4;
-          if (p[3] == 0)
-            p[0] = p[1] = p[2] =  0xff; /* white background */
-          else
-            p[0] = p[1] = p[2] = 0x00; /* black foreground */
-
-          p[3] = 0xff;
-
-          ++j;
-        }
-
-      ++i;
-    }
+  for (i = 0; i < h; i++)
+    meta_icon_pixels_bitmap_to_mono (pixels + i * stride, w);
 }
 
 static GdkPixbuf*
@@ -321,7 +295,7 @@ apply_mask (GdkPixbuf *pixbuf,
             GdkPixbuf *mask)
 {
   int w, h;
-  int i, j;
+  int i;
   GdkPixbuf *with_alpha;
   guchar *src;
   guchar *dest;
@@ -339,24 +313,81 @@ apply_mask (GdkPixbuf *pixbuf,
   dest_stride = gdk_pixbuf_get_rowstride (with_alpha);
   src_stride = gdk_pixbuf_get_rowstride (mask);
 
-  i = 0;
-  while (i < h)
-    {
-      j = 0;
-      while (j < w)
-        {
-          guchar *s = src + i * src_stride + j * 4;
-          guchar *d = dest + i * dest_stride + j * 4;
+  for (i = 0; i < h; i++)
+    meta_icon_pixels_copy_alpha (src + i * src_stride,
+                                 dest + i * dest_stride,
+                                 w);
 
-          d[3] = s[3];
+  return with_alpha;
+}
 
-          ++j;
-        }
+/* Shrinks premultiplied pixels into the middle of a size x size icon,
+ * leaving the rest of it transparent.
+ */
+static GdkPixbuf*
+downscale_premultiplied (const guchar *pixels,
+                         int           w,
+                         int           h,
+                         int           stride,
+                         int           scaled_w,
+                         int           scaled_h,
+                         int           size)
+{
+  guchar *dest;
+  int offset;
+
+  dest = g_malloc0 (size * size * 4);
+  offset = ((size - scaled_h) / 2 * size + (size - scaled_w) / 2) * 4;
+
+  meta_icon_pixels_downscale (pixels, w, h, stride,
+                              dest + offset, scaled_w, scaled_h, size * 4);
+  meta_icon_pixels_unpremultiply (dest, size * size);
+
+  return gdk_pixbuf_new_from_data (dest,
+                                   GDK_COLORSPACE_RGB,
+                                   TRUE,
+                                   8,
+                                   size, size, size * 4,
+                                   free_pixels,
+                                   NULL);
+}
 
-      ++i;
-    }
+static GdkPixbuf*
+scale_pixbuf (GdkPixbuf *src,
+              int        size)
+{
+  int w, h;
+  int stride;
+  const guchar *pixels;
+  guchar *premultiplied;
+  GdkPixbuf *dest;
+  int i;
 
-  return with_alpha;
+  w = gdk_pixbuf_get_width (src);
+  h = gdk_pixbuf_get_height (src);
+
+  /* Our box filter only shrinks and needs an alpha channel to work in */
+  if (w < size || h < size ||
+      !gdk_pixbuf_get_has_alpha (src) ||
+      gdk_pixbuf_get_n_channels (src) != 4)
+    return gdk_pixbuf_scale_simple (src, size, size, GDK_INTERP_BILINEAR);
+
+  pixels = gdk_pixbuf_get_pixels (src);
+  stride = gdk_pixbuf_get_rowstride (src);
+
+  /* src is scaled to both sizes, so premultiply a copy */
+  premultiplied = g_new (guchar, w * h * 4);
+
+  for (i = 0; i < h; i++)
+    memcpy (premultiplied + i * w * 4, pixels + i * stride, w * 4);
+
+  meta_icon_pixels_premultiply (premultiplied, w * h);
+
+  dest = downscale_premultiplied (premultiplied, w, h, w * 4, size, size, size);
+
+  g_free (premultiplied);
+
+  return dest;
 }
 
 static gboolean
@@ -414,16 +445,8 @@ try_pixmap_and_mask (MetaDisplay  *display,
 
   if (unscaled)
     {
-      *iconp =
-        gdk_pixbuf_scale_simple (unscaled,
-                                 ideal_size,
-                                 ideal_size,
-                                 GDK_INTERP_BILINEAR);
-      *mini_iconp =
-        gdk_pixbuf_scale_simple (unscaled,
-                                 ideal_mini_size,
-                                 ideal_mini_size,
-                                 GDK_INTERP_BILINEAR);
+      *iconp = scale_pixbuf (unscaled, ideal_size);
+      *mini_iconp = scale_pixbuf (unscaled, ideal_mini_size);
 
       g_object_unref (G_OBJECT (unscaled));
 
@@ -452,6 +475,7 @@ meta_icon_cache_init (MetaIconCache *icon_cache)
   icon_cache->mask = None;
   icon_cache->wm_hints_dirty = TRUE;
   icon_cache->net_wm_icon_dirty = TRUE;
+  icon_cache->net_wm_icon_serial = 0;
 }
 
 void
@@ -487,7 +511,12 @@ meta_icon_cache_property_changed (MetaIconCache *icon_cache,
   display = window->display;
 
   if (atom == display->atom__NET_WM_ICON)
-    icon_cache->net_wm_icon_dirty = TRUE;
+    {
+      icon_cache->net_wm_icon_dirty = TRUE;
+
+      /* Makes fetches of the old value stale */
+      icon_cache->net_wm_icon_serial += 1;
+    }
   else if (atom == XA_WM_HINTS)
     {
       /* We won't update if pixmap is unchanged;
@@ -518,6 +547,30 @@ scaled_from_pixdata (guchar *pixdata,
 {
   GdkPixbuf *src;
   GdkPixbuf *dest;
+  int size;
+
+  size = MAX (w, h);
+
+  /* Shrinking, by far the common case, goes through our own filter,
+   * which also takes care of centering non-square icons.
+   */
+  if (size > new_size)
+    {
+      int scaled_w;
+      int scaled_h;
+
+      scaled_w = MAX (1, (w * new_size + size / 2) / size);
+      scaled_h = MAX (1, (h * new_size + size / 2) / size);
+
+      meta_icon_pixels_premultiply (pixdata, w * h);
+
+      dest = downscale_premultiplied (pixdata, w, h, w * 4,
+                                      scaled_w, scaled_h, new_size);
+
+      g_free (pixdata);
+
+      return dest;
+    }
 
   src = gdk_pixbuf_new_from_data (pixdata,
                                   GDK_COLORSPACE_RGB,
@@ -533,9 +586,6 @@ scaled_from_pixdata (guchar *pixdata,
   if (w != h)
     {
       GdkPixbuf *tmp;
-      int size;
-
-      size = MAX (w, h);
 
       tmp = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
 
@@ -622,15 +672,19 @@ meta_read_icons (MetaScreen     *screen,
                          &mini_h,
                          &mini_pixdata))
         {
-          *iconp = scaled_from_pixdata (pixdata,
-                                        w,
-                                        h,
-                                        ideal_size);
-
-          *mini_iconp = scaled_from_pixdata (mini_pixdata,
-                                             mini_w,
-                                             mini_h,
-                                             ideal_mini_size);
+          *iconp = meta_icon_store_scale (screen->display->icon_store,
+                                          pixdata,
+                                          w,
+                                          h,
+                                          ideal_size,
+                                          scaled_from_pixdata);
+
+          *mini_iconp = meta_icon_store_scale (screen->display->icon_store,
+                                               mini_pixdata,
+                                               mini_w,
+                                               mini_h,
+                                               ideal_mini_size,
+                                               scaled_from_pixdata);
 
           if (*iconp && *mini_iconp)
             {
@@ -687,3 +741,440 @@ meta_read_icons (MetaScreen     *screen,
   /* found nothing new */
   return FALSE;
 }
+
+/*
+ * Size-selective _NET_WM_ICON fetching
+ *
+ * The property is a list of (width, height, pixels) entries and can get
+ * to megabytes with large icon sizes, of which we need at most two. So
+ * instead of reading all of it, we walk the size headers two longs at a
+ * time, pick the sizes we want, and read only their pixels. Everything
+ * is asynchronous; the steps are chained from the event loop.
+ *
+ * The X reads have to stay on the main thread, but converting and
+ * scaling the pixels is handed to a few worker threads, so that a burst
+ * of windows with large icons doesn't hold up event processing. The
+ * results are delivered back on the main thread.
+ */
+
+/* Scaling a handful of icons at once is all we ever need */
+#define MAX_ICON_WORKERS 4
+
+typedef struct
+{
+  gulong offset; /* of the pixels, in longs */
+  int    width;
+  int    height;
+} IconSize;
+
+typedef struct
+{
+  MetaWindow        *window;
+  guint              serial;
+  int                ideal_size;
+  int                ideal_mini_size;
+  MetaIconFetchFunc  func;
+
+  /* In longs; total is only known after the first reply */
+  gulong             total;
+  gulong             next_header;
+  GArray            *sizes;
+
+  IconSize           best;
+  IconSize           best_mini;
+  int                n_received;
+
+  /* The selected pixels as read, freed with XFree(); the same buffer if
+   * both sizes are the same
+   */
+  gulong            *argb;
+  gulong            *mini_argb;
+
+  /* Filled in by the worker thread */
+  MetaIconStore     *store;
+  GdkPixbuf         *icon;
+  GdkPixbuf         *mini_icon;
+} IconFetch;
+
+static void request_next_header (IconFetch *fetch);
+
+static gboolean
+icon_fetch_is_current (IconFetch *fetch)
+{
+  MetaWindow *window;
+
+  window = fetch->window;
+
+  /* If the property changed meanwhile, there's another fetch coming */
+  return !window->unmanaging &&
+         fetch->serial == window->icon_cache.net_wm_icon_serial;
+}
+
+static void
+icon_fetch_free (IconFetch *fetch)
+{
+  if (fetch->mini_argb != fetch->argb)
+    g_clear_pointer (&fetch->mini_argb, XFree);
+  g_clear_pointer (&fetch->argb, XFree);
+
+  g_clear_object (&fetch->icon);
+  g_clear_object (&fetch->mini_icon);
+
+  g_array_free (fetch->sizes, TRUE);
+  g_object_unref (fetch->window);
+  g_free (fetch);
+}
+
+/* Back on the main thread, with the icons scaled if all went well */
+static void
+icon_fetch_complete (IconFetch *fetch)
+{
+  if (icon_fetch_is_current (fetch))
+    {
+      MetaIconCache *icon_cache;
+
+      icon_cache = &fetch->window->icon_cache;
+
+      /* If the property no longer gives an icon, the one we have is
+       * stale; make sure meta_read_icons() will replace it.
+       */
+      if (fetch->icon != NULL)
+        icon_cache->origin = USING_NET_WM_ICON;
+      else if (icon_cache->origin == USING_NET_WM_ICON)
+        icon_cache->origin = USING_NO_ICON;
+
+      (* fetch->func) (fetch->window,
+                       g_steal_pointer (&fetch->icon),
+                       g_steal_pointer (&fetch->mini_icon));
+    }
+
+  icon_fetch_free (fetch);
+}
+
+static gboolean
+icon_fetch_scaled_cb (gpointer data)
+{
+  icon_fetch_complete (data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Runs on a worker thread, so must not touch the window */
+static void
+scale_icons_thread (gpointer data,
+                    gpointer user_data)
+{
+  IconFetch *fetch;
+  guchar *pixdata;
+  guchar *mini_pixdata;
+
+  fetch = data;
+
+  argbdata_to_pixdata (fetch->argb,
+                       fetch->best.width * fetch->best.height,
+                       &pixdata);
+  argbdata_to_pixdata (fetch->mini_argb,
+                       fetch->best_mini.width * fetch->best_mini.height,
+                       &mini_pixdata);
+
+  fetch->icon = meta_icon_store_scale (fetch->store,
+                                       pixdata,
+                                       fetch->best.width,
+                                       fetch->best.height,
+                                       fetch->ideal_size,
+                                       scaled_from_pixdata);
+
+  fetch->mini_icon = meta_icon_store_scale (fetch->store,
+                                            mini_pixdata,
+                                            fetch->best_mini.width,
+                                            fetch->best_mini.height,
+                                            fetch->ideal_mini_size,
+                                            scaled_from_pixdata);
+
+  if (fetch->icon == NULL || fetch->mini_icon == NULL)
+    {
+      g_clear_object (&fetch->icon);
+      g_clear_object (&fetch->mini_icon);
+    }
+
+  g_idle_add_full (META_PRIORITY_BEFORE_REDRAW,
+                   icon_fetch_scaled_cb, fetch, NULL);
+}
+
+static GThreadPool *icon_workers = NULL;
+
+static void
+icon_fetch_finish (IconFetch *fetch,
+                   gboolean   success)
+{
+  if (!success || !icon_fetch_is_current (fetch))
+    {
+      icon_fetch_complete (fetch);
+      return;
+    }
+
+  if (icon_workers == NULL)
+    {
+      int n_workers;
+
+      n_workers = CLAMP ((int) g_get_num_processors () - 1,
+                         1, MAX_ICON_WORKERS);
+
+      /* Can't fail for a non-exclusive pool */
+      icon_workers = g_thread_pool_new (scale_icons_thread, NULL,
+                                        n_workers, FALSE, NULL);
+    }
+
+  fetch->store = fetch->window->display->icon_store;
+
+  g_thread_pool_push (icon_workers, fetch, NULL);
+}
+
+/**
+ * Waits for icons still being scaled on worker threads, and stops the
+ * workers. Their results are dropped if the main loop doesn't get to
+ * run again.
+ */
+void
+meta_icon_cache_shutdown_workers (void)
+{
+  if (icon_workers == NULL)
+    return;
+
+  g_thread_pool_free (icon_workers, FALSE, TRUE);
+  icon_workers = NULL;
+}
+
+static void
+pixels_cb (MetaDisplay   *display,
+           int            result,
+           Atom           type,
+           int            format,
+           unsigned long  n_items,
+           unsigned long  bytes_after,
+           unsigned char *data,
+           gpointer       user_data)
+{
+  IconFetch *fetch;
+  IconSize *size;
+  gboolean same_size;
+
+  fetch = user_data;
+
+  same_size = fetch->best.offset == fetch->best_mini.offset;
+  size = fetch->n_received == 0 ? &fetch->best : &fetch->best_mini;
+  fetch->n_received += 1;
+
+  if (result == Success && type == XA_CARDINAL && format == 32 &&
+      n_items == (gulong) size->width * size->height)
+    {
+      /* Converted along with the scaling, off the main thread */
+      if (size == &fetch->best)
+        {
+          fetch->argb = (gulong *) data;
+          if (same_size)
+            fetch->mini_argb = fetch->argb;
+        }
+      else
+        {
+          fetch->mini_argb = (gulong *) data;
+        }
+
+      data = NULL;
+    }
+
+  if (data)
+    XFree (data);
+
+  /* Only finish after the last request we made */
+  if (same_size || fetch->n_received == 2)
+    icon_fetch_finish (fetch,
+                       fetch->argb != NULL && fetch->mini_argb != NULL);
+}
+
+static gboolean
+pick_size (IconFetch *fetch,
+           int        ideal_size,
+           IconSize  *best)
+{
+  gboolean have_best;
+  guint i;
+
+  have_best = FALSE;
+  for (i = 0; i < fetch->sizes->len; i++)
+    {
+      IconSize *size;
+
+      size = &g_array_index (fetch->sizes, IconSize, i);
+
+      if (size_is_better (have_best, best->width, best->height,
+                          size->width, size->height, ideal_size))
+        {
+          *best = *size;
+          have_best = TRUE;
+        }
+    }
+
+  return have_best;
+}
+
+static void
+request_pixels (IconFetch *fetch)
+{
+  MetaDisplay *display;
+
+  display = fetch->window->display;
+
+  if (!pick_size (fetch, fetch->ideal_size, &fetch->best) ||
+      !pick_size (fetch, fetch->ideal_mini_size, &fetch->best_mini))
+    {
+      icon_fetch_finish (fetch, FALSE);
+      return;
+    }
+
+  meta_verbose ("Reading %dx%d and %dx%d out of %d sizes of _NET_WM_ICON on %s\n",
+                fetch->best.width, fetch->best.height,
+                fetch->best_mini.width, fetch->best_mini.height,
+                fetch->sizes->len, fetch->window->desc);
+
+  meta_prop_get_range_async (display, fetch->window->xwindow,
+                             display->atom__NET_WM_ICON, XA_CARDINAL,
+                             fetch->best.offset,
+                             fetch->best.width * fetch->best.height,
+                             pixels_cb, fetch);
+
+  if (fetch->best_mini.offset != fetch->best.offset)
+    meta_prop_get_range_async (display, fetch->window->xwindow,
+                               display->atom__NET_WM_ICON, XA_CARDINAL,
+                               fetch->best_mini.offset,
+                               fetch->best_mini.width * fetch->best_mini.height,
+                               pixels_cb, fetch);
+}
+
+static void
+header_cb (MetaDisplay   *display,
+           int            result,
+           Atom           type,
+           int            format,
+           unsigned long  n_items,
+           unsigned long  bytes_after,
+           unsigned char *data,
+           gpointer       user_data)
+{
+  IconFetch *fetch;
+  gulong *longs;
+  gulong w, h;
+  IconSize size;
+
+  fetch = user_data;
+
+  if (result != Success || type != XA_CARDINAL || format != 32 ||
+      n_items != 2)
+    {
+      if (data)
+        XFree (data);
+
+      icon_fetch_finish (fetch, FALSE);
+      return;
+    }
+
+  if (fetch->next_header == 0)
+    fetch->total = n_items + bytes_after / 4;
+
+  longs = (gulong *) data;
+  w = longs[0];
+  h = longs[1];
+
+  XFree (data);
+
+  /* Same rules as find_best_size(): stop at the first entry that
+   * claims more data than there is
+   */
+  if (w > G_MAXUINT16 || h > G_MAXUINT16 ||
+      fetch->total - fetch->next_header < w * h + 2)
+    {
+      request_pixels (fetch);
+      return;
+    }
+
+  size.offset = fetch->next_header + 2;
+  size.width = w;
+  size.height = h;
+  g_array_append_val (fetch->sizes, size);
+
+  fetch->next_header += w * h + 2;
+
+  request_next_header (fetch);
+}
+
+static void
+request_next_header (IconFetch *fetch)
+{
+  MetaDisplay *display;
+
+  display = fetch->window->display;
+
+  if (fetch->sizes->len > 0)
+    {
+      gulong remaining;
+
+      remaining = fetch->total - fetch->next_header;
+
+      if (remaining == 0)
+        {
+          request_pixels (fetch);
+          return;
+        }
+
+      /* no space for w, h */
+      if (remaining < 3)
+        {
+          icon_fetch_finish (fetch, FALSE);
+          return;
+        }
+    }
+
+  meta_prop_get_range_async (display, fetch->window->xwindow,
+                             display->atom__NET_WM_ICON, XA_CARDINAL,
+                             fetch->next_header, 2,
+                             header_cb, fetch);
+}
+
+/**
+ * Starts reading _NET_WM_ICON in the background if it needs rereading,
+ * fetching only the sizes closest to ideal_size and ideal_mini_size.
+ * func is called with the new icons once they are in, or with NULL
+ * icons if the property is unusable, in which case the caller should
+ * fall back to meta_read_icons(). If the property changes before the
+ * fetch is done, func is not called at all; the change queues another
+ * update.
+ *
+ * \return  Whether a fetch was started.
+ */
+gboolean
+meta_icon_cache_fetch_net_wm_icon (MetaIconCache     *icon_cache,
+                                   MetaWindow        *window,
+                                   int                ideal_size,
+                                   int                ideal_mini_size,
+                                   MetaIconFetchFunc  func)
+{
+  IconFetch *fetch;
+
+  if (icon_cache->origin > USING_NET_WM_ICON ||
+      !icon_cache->net_wm_icon_dirty)
+    return FALSE;
+
+  icon_cache->net_wm_icon_dirty = FALSE;
+
+  fetch = g_new0 (IconFetch, 1);
+  fetch->window = g_object_ref (window);
+  fetch->serial = icon_cache->net_wm_icon_serial;
+  fetch->ideal_size = ideal_size;
+  fetch->ideal_mini_size = ideal_mini_size;
+  fetch->func = func;
+  fetch->sizes = g_array_new (FALSE, FALSE, sizeof (IconSize));
+
+  request_next_header (fetch);
+
+  return TRUE;
+}
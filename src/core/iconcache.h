@@ -46,14 +46,29 @@ struct _MetaIconCache
   /* TRUE if these props have changed */
   guint wm_hints_dirty : 1;
   guint net_wm_icon_dirty : 1;
+  /* Bumped on every _NET_WM_ICON change */
+  guint net_wm_icon_serial;
 };
 
+/* Called with the icons read by meta_icon_cache_fetch_net_wm_icon() */
+typedef void (* MetaIconFetchFunc) (MetaWindow *window,
+                                    GdkPixbuf  *icon,
+                                    GdkPixbuf  *mini_icon);
+
 void           meta_icon_cache_init                 (MetaIconCache *icon_cache);
 void           meta_icon_cache_free                 (MetaIconCache *icon_cache);
 void           meta_icon_cache_property_changed     (MetaIconCache *icon_cache,
                                                      MetaWindow    *window,
                                                      Atom           atom);
 
+gboolean meta_icon_cache_fetch_net_wm_icon (MetaIconCache     *icon_cache,
+                                            MetaWindow        *window,
+                                            int                ideal_size,
+                                            int                ideal_mini_size,
+                                            MetaIconFetchFunc  func);
+
+void     meta_icon_cache_shutdown_workers  (void);
+
 gboolean meta_read_icons         (MetaScreen     *screen,
                                   Window          xwindow,
                                   MetaIconCache  *icon_cache,
@@ -0,0 +1,152 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity key binding lookup */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "keybinding-index.h"
+
+#include <stdlib.h>
+
+typedef struct
+{
+  guint32 key;
+  int     binding;
+} IndexedBinding;
+
+typedef struct
+{
+  int start;
+  int count;
+} BindingRun;
+
+struct _MetaKeyBindingIndex
+{
+  /* Binding numbers, grouped by key, in table order within a group */
+  int        *bindings;
+
+  BindingRun *runs;
+
+  /* key -> BindingRun */
+  GHashTable *table;
+};
+
+static int
+compare_indexed_bindings (const void *a,
+                          const void *b)
+{
+  const IndexedBinding *binding_a = a;
+  const IndexedBinding *binding_b = b;
+
+  if (binding_a->key != binding_b->key)
+    return binding_a->key < binding_b->key ? -1 : 1;
+
+  /* Earlier bindings take precedence, so keep them first */
+  return binding_a->binding - binding_b->binding;
+}
+
+/**
+ * Builds an index over a binding table; keys[i] is the
+ * META_KEY_BINDING_INDEX_KEY() of binding i.
+ */
+MetaKeyBindingIndex *
+meta_key_binding_index_new (const guint32 *keys,
+                            int            n_keys)
+{
+  MetaKeyBindingIndex *index;
+  IndexedBinding *sorted;
+  int n_sorted;
+  int n_runs;
+  int i;
+
+  index = g_new0 (MetaKeyBindingIndex, 1);
+  index->table = g_hash_table_new (NULL, NULL);
+
+  sorted = g_new (IndexedBinding, MAX (n_keys, 1));
+  n_sorted = 0;
+
+  for (i = 0; i < n_keys; i++)
+    {
+      if (keys[i] == META_KEY_BINDING_INDEX_NONE)
+        continue;
+
+      sorted[n_sorted].key = keys[i];
+      sorted[n_sorted].binding = i;
+      n_sorted += 1;
+    }
+
+  qsort (sorted, n_sorted, sizeof (IndexedBinding), compare_indexed_bindings);
+
+  index->bindings = g_new (int, MAX (n_sorted, 1));
+  index->runs = g_new (BindingRun, MAX (n_sorted, 1));
+  n_runs = 0;
+
+  for (i = 0; i < n_sorted; i++)
+    {
+      index->bindings[i] = sorted[i].binding;
+
+      if (i == 0 || sorted[i].key != sorted[i - 1].key)
+        {
+          BindingRun *run;
+
+          run = &index->runs[n_runs++];
+          run->start = i;
+          run->count = 0;
+
+          g_hash_table_insert (index->table,
+                               GUINT_TO_POINTER (sorted[i].key), run);
+        }
+
+      index->runs[n_runs - 1].count += 1;
+    }
+
+  g_free (sorted);
+
+  return index;
+}
+
+void
+meta_key_binding_index_free (MetaKeyBindingIndex *index)
+{
+  g_hash_table_destroy (index->table);
+  g_free (index->runs);
+  g_free (index->bindings);
+  g_free (index);
+}
+
+/**
+ * Returns the numbers of the bindings with the given key, in the order
+ * they appear in the table, or NULL if there are none.
+ */
+const int *
+meta_key_binding_index_lookup (MetaKeyBindingIndex *index,
+                               guint32              key,
+                               int                 *n_matches)
+{
+  BindingRun *run;
+
+  run = g_hash_table_lookup (index->table, GUINT_TO_POINTER (key));
+  if (run == NULL)
+    {
+      *n_matches = 0;
+      return NULL;
+    }
+
+  *n_matches = run->count;
+
+  return index->bindings + run->start;
+}
@@ -0,0 +1,51 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file keybinding-index.h  Lookup of key bindings by key press
+ *
+ * A key press matches a binding when its keycode and its modifier
+ * state, with the ignored modifiers such as NumLock cleared, are those
+ * of the binding. Rather than trying every binding for every key
+ * press, the bindings are grouped by that (keycode, mask) pair, so
+ * dispatch only looks at the few bindings that can match.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_KEYBINDING_INDEX_H
+#define META_KEYBINDING_INDEX_H
+
+#include <glib.h>
+
+typedef struct _MetaKeyBindingIndex MetaKeyBindingIndex;
+
+/* Only the core modifiers (state & 0xff) take part in matching, so a
+ * binding needing any other bit can never match and isn't indexed.
+ */
+#define META_KEY_BINDING_INDEX_NONE G_MAXUINT32
+#define META_KEY_BINDING_INDEX_KEY(keycode, mask)                \
+  (((mask) & ~0xffu) != 0 ? META_KEY_BINDING_INDEX_NONE :        \
+   ((guint32) (keycode) << 8) | (guint32) (mask))
+
+MetaKeyBindingIndex *meta_key_binding_index_new    (const guint32       *keys,
+                                                    int                  n_keys);
+void                 meta_key_binding_index_free   (MetaKeyBindingIndex *index);
+
+const int           *meta_key_binding_index_lookup (MetaKeyBindingIndex *index,
+                                                    guint32              key,
+                                                    int                 *n_matches);
+
+#endif
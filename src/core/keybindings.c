@@ -98,6 +98,11 @@ static gboolean process_workspace_switch_grab (MetaDisplay *display,
                                                KeySym       keysym);
 
 static void regrab_key_bindings         (MetaDisplay *display);
+static void update_key_grabs            (MetaDisplay *display);
+static void update_grabs                (MetaDisplay *display,
+                                         Window       xwindow,
+                                         GHashTable  *old_grabs,
+                                         GHashTable  *new_grabs);
 
 static GHashTable *key_handlers;
 
@@ -143,6 +148,22 @@ keysym_to_string (KeySym keysym)
   return name;
 }
 
+/* The unshifted keysym on a keycode, from the cached keymap, so that
+ * messages can name keys without asking the server
+ */
+static KeySym
+keycode_to_keysym (MetaDisplay  *display,
+                   unsigned int  keycode)
+{
+  if (display->keymap == NULL ||
+      keycode < (unsigned int) display->min_keycode ||
+      keycode > (unsigned int) display->max_keycode)
+    return NoSymbol;
+
+  return display->keymap[(keycode - display->min_keycode) *
+                         display->keysyms_per_keycode];
+}
+
 static void
 reload_modmap (MetaDisplay *display)
 {
@@ -299,6 +320,30 @@ reload_keycodes (MetaDisplay *display)
     }
 }
 
+static void
+index_key_bindings (MetaDisplay *display)
+{
+  guint32 *keys;
+  int i;
+
+  if (display->key_binding_index)
+    meta_key_binding_index_free (display->key_binding_index);
+
+  keys = g_new (guint32, MAX (display->n_key_bindings, 1));
+
+  for (i = 0; i < display->n_key_bindings; i++)
+    {
+      MetaKeyBinding *binding = &display->key_bindings[i];
+
+      keys[i] = META_KEY_BINDING_INDEX_KEY (binding->keycode, binding->mask);
+    }
+
+  display->key_binding_index = meta_key_binding_index_new (keys,
+                                                           display->n_key_bindings);
+
+  g_free (keys);
+}
+
 static void
 reload_modifiers (MetaDisplay *display)
 {
@@ -329,6 +374,9 @@ reload_modifiers (MetaDisplay *display)
           ++i;
         }
     }
+
+  /* The masks are final now */
+  index_key_bindings (display);
 }
 
 static int
@@ -453,16 +501,46 @@ rebuild_key_binding_table (MetaDisplay *display)
   g_list_free (prefs);
 }
 
+/* Whether the window's grabs are where meta_window_grab_keys() would put
+ * them, so that they only need to be brought up to date
+ */
+static gboolean
+window_grabs_are_current (MetaWindow *window)
+{
+  return window->keys_grabbed &&
+         window->type != META_WINDOW_DOCK &&
+         !window->override_redirect &&
+         window->grab_on_frame == (window->frame != NULL);
+}
+
 static void
 regrab_key_bindings (MetaDisplay *display)
 {
+  GHashTable *old_root_grabs;
+  GHashTable *old_window_grabs;
+  MetaScreen *screen;
   GSList *tmp;
   GSList *windows;
 
+  screen = display->screen;
+
+  old_root_grabs = display->root_key_grabs;
+  old_window_grabs = display->window_key_grabs;
+  update_key_grabs (display);
+
   meta_error_trap_push (display); /* for efficiency push outer trap */
 
-  meta_screen_ungrab_keys (display->screen);
-  meta_screen_grab_keys (display->screen);
+  /* Only touch what actually changed; a keymap change rarely moves more
+   * than a few keys, but regrabbing everything costs every binding
+   * times every combination of ignored modifiers, for every window.
+   */
+  if (all_bindings_disabled)
+    meta_screen_ungrab_keys (screen);
+  else if (screen->keys_grabbed)
+    update_grabs (display, screen->xroot,
+                  old_root_grabs, display->root_key_grabs);
+  else
+    meta_screen_grab_keys (screen);
 
   windows = meta_display_list_windows (display, META_LIST_DEFAULT);
   tmp = windows;
@@ -470,8 +548,21 @@ regrab_key_bindings (MetaDisplay *display)
     {
       MetaWindow *w = tmp->data;
 
-      meta_window_ungrab_keys (w);
-      meta_window_grab_keys (w);
+      if (all_bindings_disabled)
+        {
+          meta_window_ungrab_keys (w);
+        }
+      else if (window_grabs_are_current (w))
+        {
+          update_grabs (display,
+                        w->frame ? w->frame->xwindow : w->xwindow,
+                        old_window_grabs, display->window_key_grabs);
+        }
+      else
+        {
+          meta_window_ungrab_keys (w);
+          meta_window_grab_keys (w);
+        }
 
       tmp = tmp->next;
     }
@@ -479,6 +570,9 @@ regrab_key_bindings (MetaDisplay *display)
   meta_error_trap_pop (display);
 
   g_slist_free (windows);
+
+  g_hash_table_destroy (old_root_grabs);
+  g_hash_table_destroy (old_window_grabs);
 }
 
 static gboolean
@@ -614,36 +708,37 @@ meta_display_shutdown_keys (MetaDisplay *display)
   if (display->modmap)
     XFreeModifiermap (display->modmap);
   g_free (display->key_bindings);
+
+  if (display->key_binding_index)
+    meta_key_binding_index_free (display->key_binding_index);
+
+  g_clear_pointer (&display->root_key_grabs, g_hash_table_destroy);
+  g_clear_pointer (&display->window_key_grabs, g_hash_table_destroy);
 }
 
-/* Grab/ungrab, ignoring all annoying modifiers like NumLock etc. */
+/* Passive grabs are kept in sets of KEY_GRAB() values */
+#define KEY_GRAB(keycode, modmask) \
+  GUINT_TO_POINTER (((keycode) << 16) | ((modmask) & 0xffff))
+#define KEY_GRAB_KEYCODE(key_grab) (GPOINTER_TO_UINT (key_grab) >> 16)
+#define KEY_GRAB_MODMASK(key_grab) (GPOINTER_TO_UINT (key_grab) & 0xffff)
+
+/* Adds keycode/modmask, together with all combinations of ignored
+ * modifiers like NumLock etc. X provides no better way to do this.
+ */
 static void
-meta_change_keygrab (MetaDisplay *display,
-                     Window       xwindow,
-                     gboolean     grab,
-                     int          keysym,
-                     unsigned int keycode,
-                     int          modmask)
+add_key_grab (MetaDisplay  *display,
+              GHashTable   *grabs,
+              GHashTable   *covered,
+              unsigned int  keycode,
+              unsigned int  modmask)
 {
   unsigned int ignored_mask;
 
-  /* Grab keycode/modmask, together with
-   * all combinations of ignored modifiers.
-   * X provides no better way to do this.
-   */
-
-  meta_topic (META_DEBUG_KEYBINDINGS,
-              "%s keybinding %s keycode %d mask 0x%x on 0x%lx\n",
-              grab ? "Grabbing" : "Ungrabbing",
-              keysym_to_string (keysym), keycode,
-              modmask, xwindow);
-
-  /* efficiency, avoid so many XSync() */
-  meta_error_trap_push (display);
-
   ignored_mask = 0;
   while (ignored_mask <= display->ignored_modifier_mask)
     {
+      gpointer key_grab;
+
       if (ignored_mask & ~(display->ignored_modifier_mask))
         {
           /* Not a combination of ignored modifiers
@@ -653,90 +748,152 @@ meta_change_keygrab (MetaDisplay *display,
           continue;
         }
 
-      if (meta_is_debugging ())
-        meta_error_trap_push (display);
+      key_grab = KEY_GRAB (keycode, modmask | ignored_mask);
 
-      if (grab)
-        XGrabKey (display->xdisplay, keycode,
-                  modmask | ignored_mask,
-                  xwindow,
-                  True,
-                  GrabModeAsync, GrabModeSync);
-      else
-        XUngrabKey (display->xdisplay, keycode,
-                    modmask | ignored_mask,
-                    xwindow);
+      if (covered == NULL || !g_hash_table_contains (covered, key_grab))
+        g_hash_table_add (grabs, key_grab);
 
-      if (meta_is_debugging ())
-        {
-          int result;
+      ++ignored_mask;
+    }
+}
 
-          result = meta_error_trap_pop_with_return (display);
+static GHashTable *
+compute_key_grabs (MetaDisplay *display,
+                   gboolean     binding_per_window,
+                   GHashTable  *covered)
+{
+  MetaKeyBinding *bindings;
+  GHashTable *grabs;
+  int i;
 
-          if (grab && result != Success)
-            {
-              if (result == BadAccess)
-                {
-                  g_warning ("Some other program is already using the key %s "
-                             "with modifiers %x as a binding",
-                             keysym_to_string (keysym), modmask | ignored_mask);
-                }
-              else
-                meta_topic (META_DEBUG_KEYBINDINGS,
-                            "Failed to grab key %s with modifiers %x\n",
-                            keysym_to_string (keysym), modmask | ignored_mask);
-            }
-        }
+  bindings = display->key_bindings;
+  grabs = g_hash_table_new (NULL, NULL);
 
-      ++ignored_mask;
+  for (i = 0; i < display->n_key_bindings; i++)
+    {
+      if (!!binding_per_window ==
+          !!(bindings[i].handler->flags & META_KEY_BINDING_PER_WINDOW) &&
+          bindings[i].keycode != 0 &&
+          bindings[i].devirtualized != FALSE)
+        {
+          add_key_grab (display, grabs, covered,
+                        bindings[i].keycode,
+                        bindings[i].mask);
+        }
     }
 
-  meta_error_trap_pop (display);
+  return grabs;
 }
 
+/* Works out what should be grabbed on the root window and on each client
+ * window. A key press is offered to the passive grabs of the outermost
+ * window first, so a window grab that the root window also has could
+ * never fire, and is left out.
+ */
 static void
-meta_grab_key (MetaDisplay *display,
-               Window       xwindow,
-               int          keysym,
-               unsigned int keycode,
-               int          modmask)
+update_key_grabs (MetaDisplay *display)
 {
-  meta_change_keygrab (display, xwindow, TRUE, keysym, keycode, modmask);
+  display->root_key_grabs = compute_key_grabs (display, FALSE, NULL);
+  display->window_key_grabs = compute_key_grabs (display, TRUE,
+                                                 display->root_key_grabs);
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "%u key grabs on the root window, %u on each window\n",
+              g_hash_table_size (display->root_key_grabs),
+              g_hash_table_size (display->window_key_grabs));
 }
 
 static void
-grab_keys (MetaKeyBinding *bindings,
-           int             n_bindings,
-           MetaDisplay    *display,
-           Window          xwindow,
-           gboolean        binding_per_window)
+change_keygrab (MetaDisplay *display,
+                Window       xwindow,
+                gboolean     grab,
+                gpointer     key_grab)
 {
-  int i;
+  unsigned int keycode;
+  unsigned int modmask;
 
-  g_assert (n_bindings == 0 || bindings != NULL);
+  keycode = KEY_GRAB_KEYCODE (key_grab);
+  modmask = KEY_GRAB_MODMASK (key_grab);
 
-  meta_error_trap_push (display);
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "%s key %s keycode %d mask 0x%x on 0x%lx\n",
+              grab ? "Grabbing" : "Ungrabbing",
+              keysym_to_string (keycode_to_keysym (display, keycode)),
+              keycode, modmask, xwindow);
 
-  i = 0;
-  while (i < n_bindings)
+  if (meta_is_debugging ())
+    meta_error_trap_push (display);
+
+  if (grab)
+    XGrabKey (display->xdisplay, keycode,
+              modmask,
+              xwindow,
+              True,
+              GrabModeAsync, GrabModeSync);
+  else
+    XUngrabKey (display->xdisplay, keycode,
+                modmask,
+                xwindow);
+
+  if (meta_is_debugging ())
     {
-      if (!!binding_per_window ==
-          !!(bindings[i].handler->flags & META_KEY_BINDING_PER_WINDOW) &&
-          bindings[i].keycode != 0 &&
-          bindings[i].devirtualized != FALSE)
+      int result;
+
+      result = meta_error_trap_pop_with_return (display);
+
+      if (grab && result != Success)
         {
-          meta_grab_key (display, xwindow,
-                         bindings[i].keysym,
-                         bindings[i].keycode,
-                         bindings[i].mask);
+          if (result == BadAccess)
+            {
+              g_warning ("Some other program is already using the key %s "
+                         "with modifiers %x as a binding",
+                         keysym_to_string (keycode_to_keysym (display, keycode)),
+                         modmask);
+            }
+          else
+            meta_topic (META_DEBUG_KEYBINDINGS,
+                        "Failed to grab key %s with modifiers %x\n",
+                        keysym_to_string (keycode_to_keysym (display, keycode)),
+                        modmask);
         }
+    }
+}
 
-      ++i;
+/* Grabs or ungrabs everything in grabs that isn't also in except */
+static void
+change_keygrabs (MetaDisplay *display,
+                 Window       xwindow,
+                 gboolean     grab,
+                 GHashTable  *grabs,
+                 GHashTable  *except)
+{
+  GHashTableIter iter;
+  gpointer key_grab;
+
+  /* efficiency, avoid so many XSync() */
+  meta_error_trap_push (display);
+
+  g_hash_table_iter_init (&iter, grabs);
+  while (g_hash_table_iter_next (&iter, &key_grab, NULL))
+    {
+      if (except == NULL || !g_hash_table_contains (except, key_grab))
+        change_keygrab (display, xwindow, grab, key_grab);
     }
 
   meta_error_trap_pop (display);
 }
 
+/* Turns the grabs on xwindow from old_grabs into new_grabs */
+static void
+update_grabs (MetaDisplay *display,
+              Window       xwindow,
+              GHashTable  *old_grabs,
+              GHashTable  *new_grabs)
+{
+  change_keygrabs (display, xwindow, FALSE, old_grabs, new_grabs);
+  change_keygrabs (display, xwindow, TRUE, new_grabs, old_grabs);
+}
+
 static void
 ungrab_all_keys (MetaDisplay *display,
                  Window       xwindow)
@@ -772,10 +929,8 @@ meta_screen_grab_keys (MetaScreen *screen)
   if (all_bindings_disabled)
     return;
 
-  grab_keys (screen->display->key_bindings,
-             screen->display->n_key_bindings,
-             screen->display, screen->xroot,
-             FALSE);
+  change_keygrabs (screen->display, screen->xroot, TRUE,
+                   screen->display->root_key_grabs, NULL);
 
   screen->keys_grabbed = TRUE;
 }
@@ -819,11 +974,9 @@ meta_window_grab_keys (MetaWindow  *window)
         return; /* already all good */
     }
 
-  grab_keys (window->display->key_bindings,
-             window->display->n_key_bindings,
-             window->display,
-             window->frame ? window->frame->xwindow : window->xwindow,
-             TRUE);
+  change_keygrabs (window->display,
+                   window->frame ? window->frame->xwindow : window->xwindow,
+                   TRUE, window->display->window_key_grabs, NULL);
 
   window->keys_grabbed = TRUE;
   window->grab_on_frame = window->frame != NULL;
@@ -1173,25 +1326,29 @@ process_event (MetaKeyBinding       *bindings,
                KeySym                keysym,
                gboolean              on_window)
 {
-  int i;
+  const int *matches;
+  int n_matches;
+  int j;
 
   /* we used to have release-based bindings but no longer. */
-  if (event->type == KeyRelease)
+  if (event->type != KeyPress)
     return FALSE;
 
-  /*
-   * TODO: This would be better done with a hash table;
-   * it doesn't suit to use O(n) for such a common operation.
-   */
-  for (i=0; i<n_bindings; i++)
+  /* Only the bindings for this keycode and modifier state can match */
+  matches = meta_key_binding_index_lookup (display->key_binding_index,
+                                           META_KEY_BINDING_INDEX_KEY (event->xkey.keycode,
+                                                                       event->xkey.state & 0xff &
+                                                                       ~(display->ignored_modifier_mask)),
+                                           &n_matches);
+
+  for (j = 0; j < n_matches; j++)
     {
+      int i = matches[j];
       const MetaKeyHandler *handler = bindings[i].handler;
 
-      if ((!on_window && handler->flags & META_KEY_BINDING_PER_WINDOW) ||
-          event->type != KeyPress ||
-          bindings[i].keycode != event->xkey.keycode ||
-          ((event->xkey.state & 0xff & ~(display->ignored_modifier_mask)) !=
-           bindings[i].mask))
+      g_assert (i < n_bindings);
+
+      if (!on_window && handler->flags & META_KEY_BINDING_PER_WINDOW)
         continue;
 
       /*
@@ -3882,6 +4039,9 @@ meta_display_init_keys (MetaDisplay *display)
   display->meta_mask = 0;
   display->key_bindings = NULL;
   display->n_key_bindings = 0;
+  display->key_binding_index = NULL;
+  display->root_key_grabs = NULL;
+  display->window_key_grabs = NULL;
 
   XDisplayKeycodes (display->xdisplay,
                     &display->min_keycode,
@@ -3903,6 +4063,7 @@ meta_display_init_keys (MetaDisplay *display)
 
   reload_keycodes (display);
   reload_modifiers (display);
+  update_key_grabs (display);
 
   /* Keys are actually grabbed in meta_screen_grab_keys() */
 
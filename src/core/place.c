@@ -25,6 +25,8 @@
 #include <config.h>
 
 #include "place.h"
+#include "free-space.h"
+#include "rect-index.h"
 #include "workspace.h"
 #include "prefs.h"
 #include <gdk/gdk.h>
@@ -374,6 +376,45 @@ avoid_being_obscured_as_second_modal_dialog (MetaWindow *window,
     }
 }
 
+/* Whether a new window shouldn't be placed over other */
+static gboolean
+window_should_be_avoided (MetaWindow *other)
+{
+  switch (other->type)
+    {
+    case META_WINDOW_DOCK:
+    case META_WINDOW_SPLASHSCREEN:
+    case META_WINDOW_DESKTOP:
+    case META_WINDOW_DIALOG:
+    case META_WINDOW_MODAL_DIALOG:
+    case META_WINDOW_DROPDOWN_MENU:
+    case META_WINDOW_POPUP_MENU:
+    case META_WINDOW_TOOLTIP:
+    case META_WINDOW_NOTIFICATION:
+    case META_WINDOW_COMBO:
+    case META_WINDOW_DND:
+    case META_WINDOW_OVERRIDE_OTHER:
+      return FALSE;
+
+    case META_WINDOW_NORMAL:
+    case META_WINDOW_UTILITY:
+    case META_WINDOW_TOOLBAR:
+    case META_WINDOW_MENU:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/* Below this many windows, scan them all for each position tried
+ * rather than building a MetaRectIndex first. The value has not been
+ * tuned; it is set high so that the index is only built when there
+ * are clearly too many windows to scan. testrectindex can be used to
+ * measure where the two cross over.
+ */
+#define MIN_WINDOWS_TO_INDEX 256
+
 static gboolean
 rectangle_overlaps_some_window (MetaRectangle *rect,
                                 GList         *windows)
@@ -387,34 +428,12 @@ rectangle_overlaps_some_window (MetaRectangle *rect,
       MetaWindow *other = tmp->data;
       MetaRectangle other_rect;
 
-      switch (other->type)
+      if (window_should_be_avoided (other))
         {
-        case META_WINDOW_DOCK:
-        case META_WINDOW_SPLASHSCREEN:
-        case META_WINDOW_DESKTOP:
-        case META_WINDOW_DIALOG:
-        case META_WINDOW_MODAL_DIALOG:
-        case META_WINDOW_DROPDOWN_MENU:
-        case META_WINDOW_POPUP_MENU:
-        case META_WINDOW_TOOLTIP:
-        case META_WINDOW_NOTIFICATION:
-        case META_WINDOW_COMBO:
-        case META_WINDOW_DND:
-        case META_WINDOW_OVERRIDE_OTHER:
-          break;
-
-        case META_WINDOW_NORMAL:
-        case META_WINDOW_UTILITY:
-        case META_WINDOW_TOOLBAR:
-        case META_WINDOW_MENU:
           meta_window_get_outer_rect (other, &other_rect);
 
           if (meta_rectangle_intersect (rect, &other_rect, &dest))
             return TRUE;
-          break;
-
-        default:
-          break;
         }
 
       tmp = tmp->next;
@@ -423,6 +442,93 @@ rectangle_overlaps_some_window (MetaRectangle *rect,
   return FALSE;
 }
 
+/* Indexes the windows that a new window shouldn't be placed over, or
+ * returns NULL if there are too few for the index to pay off.
+ */
+static MetaRectIndex *
+index_windows_to_avoid (MetaScreen *screen,
+                        GList      *windows)
+{
+  MetaRectIndex *index;
+  GList *tmp;
+
+  if (g_list_length (windows) < MIN_WINDOWS_TO_INDEX)
+    return NULL;
+
+  index = meta_rect_index_new (&screen->rect);
+
+  tmp = windows;
+  while (tmp != NULL)
+    {
+      MetaWindow *other = tmp->data;
+      MetaRectangle other_rect;
+
+      if (window_should_be_avoided (other))
+        {
+          meta_window_get_outer_rect (other, &other_rect);
+          meta_rect_index_add (index, &other_rect);
+        }
+
+      tmp = tmp->next;
+    }
+
+  return index;
+}
+
+static gboolean
+overlaps_windows_to_avoid (MetaRectIndex *index,
+                           GList         *windows,
+                           MetaRectangle *rect)
+{
+  if (index != NULL)
+    return meta_rect_index_overlaps (index, rect);
+  else
+    return rectangle_overlaps_some_window (rect, windows);
+}
+
+/* Finds where in work_area a rect of the given size overlaps the
+ * windows to avoid the least, preferring higher and then more to the
+ * left among equally good positions.
+ */
+static void
+find_least_overlap (GList               *windows,
+                    const MetaRectangle *work_area,
+                    int                  width,
+                    int                  height,
+                    int                 *new_x,
+                    int                 *new_y)
+{
+  MetaFreeSpace *space;
+  GList *tmp;
+  int overlap;
+
+  space = meta_free_space_new (work_area);
+
+  tmp = windows;
+  while (tmp != NULL)
+    {
+      MetaWindow *other = tmp->data;
+      MetaRectangle other_rect;
+
+      if (window_should_be_avoided (other))
+        {
+          meta_window_get_outer_rect (other, &other_rect);
+          meta_free_space_add_window (space, &other_rect);
+        }
+
+      tmp = tmp->next;
+    }
+
+  overlap = meta_free_space_find_position (space, width, height,
+                                           new_x, new_y);
+
+  meta_topic (META_DEBUG_PLACEMENT,
+              "Least overlap of a %dx%d window is %d pixels, at %d,%d\n",
+              width, height, overlap, *new_x, *new_y);
+
+  meta_free_space_free (space);
+}
+
 static gint
 leftmost_cmp (gconstpointer a, gconstpointer b)
 {
@@ -527,11 +633,17 @@ find_first_fit (MetaWindow *window,
   GList *below_sorted;
   GList *right_sorted;
   GList *tmp;
+  MetaRectIndex *windows_to_avoid;
   MetaRectangle rect;
   MetaRectangle work_area;
 
   retval = FALSE;
 
+  /* Every position tried is checked against all the windows, through
+   * an index if there are many of them
+   */
+  windows_to_avoid = index_windows_to_avoid (window->screen, windows);
+
   /* Below each window */
   below_sorted = g_list_copy (windows);
   below_sorted = g_list_sort (below_sorted, leftmost_cmp);
@@ -566,7 +678,7 @@ find_first_fit (MetaWindow *window,
     center_tile_rect_in_area (&rect, &work_area);
 
     if (meta_rectangle_contains_rect (&work_area, &rect) &&
-        !rectangle_overlaps_some_window (&rect, windows))
+        !overlaps_windows_to_avoid (windows_to_avoid, windows, &rect))
       {
         *new_x = rect.x;
         *new_y = rect.y;
@@ -594,7 +706,7 @@ find_first_fit (MetaWindow *window,
         rect.y = outer_rect.y + outer_rect.height;
 
         if (meta_rectangle_contains_rect (&work_area, &rect) &&
-            !rectangle_overlaps_some_window (&rect, below_sorted))
+            !overlaps_windows_to_avoid (windows_to_avoid, windows, &rect))
           {
             *new_x = rect.x;
             *new_y = rect.y;
@@ -625,7 +737,7 @@ find_first_fit (MetaWindow *window,
         rect.y = outer_rect.y;
 
         if (meta_rectangle_contains_rect (&work_area, &rect) &&
-            !rectangle_overlaps_some_window (&rect, right_sorted))
+            !overlaps_windows_to_avoid (windows_to_avoid, windows, &rect))
           {
             *new_x = rect.x;
             *new_y = rect.y;
@@ -645,6 +757,8 @@ find_first_fit (MetaWindow *window,
 
  out:
 
+  if (windows_to_avoid)
+    meta_rect_index_free (windows_to_avoid);
   g_list_free (below_sorted);
   g_list_free (right_sorted);
   return retval;
@@ -728,6 +842,11 @@ find_preferred_position (MetaWindow *window,
             *new_y += work_area.y;
             break;
 
+          case META_PLACEMENT_MODE_MIN_OVERLAP:
+            find_least_overlap (windows, &work_area, rect.width, rect.height,
+                                new_x, new_y);
+            break;
+
           case META_PLACEMENT_MODE_SMART:
           case META_PLACEMENT_MODE_CASCADE:
             g_assert_not_reached ();
@@ -0,0 +1,188 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity rectangle overlap index */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "rect-index.h"
+
+/* The grid has at most this many cells each way, none of them smaller
+ * than MIN_CELL_SIZE
+ */
+#define MAX_CELLS_PER_SIDE 16
+#define MIN_CELL_SIZE 64
+
+struct _MetaRectIndex
+{
+  MetaRectangle  area;
+  int            cell_width;
+  int            cell_height;
+  int            n_columns;
+  int            n_rows;
+
+  /* MetaRectangle */
+  GArray        *rects;
+
+  /* For each cell, row by row, the indices into rects of the rectangles
+   * reaching into it, or NULL if there are none. Rectangles outside of
+   * area are in the cells along its border.
+   */
+  GArray       **cells;
+};
+
+MetaRectIndex *
+meta_rect_index_new (const MetaRectangle *area)
+{
+  MetaRectIndex *index;
+
+  index = g_new0 (MetaRectIndex, 1);
+  index->area = *area;
+
+  index->cell_width = MAX (MIN_CELL_SIZE,
+                           (area->width + MAX_CELLS_PER_SIDE - 1) /
+                           MAX_CELLS_PER_SIDE);
+  index->cell_height = MAX (MIN_CELL_SIZE,
+                            (area->height + MAX_CELLS_PER_SIDE - 1) /
+                            MAX_CELLS_PER_SIDE);
+  index->n_columns = MAX (1, (area->width + index->cell_width - 1) /
+                             index->cell_width);
+  index->n_rows = MAX (1, (area->height + index->cell_height - 1) /
+                          index->cell_height);
+
+  index->rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  index->cells = g_new0 (GArray *, index->n_columns * index->n_rows);
+
+  return index;
+}
+
+void
+meta_rect_index_free (MetaRectIndex *index)
+{
+  int i;
+
+  for (i = 0; i < index->n_columns * index->n_rows; i++)
+    {
+      if (index->cells[i] != NULL)
+        g_array_free (index->cells[i], TRUE);
+    }
+
+  g_free (index->cells);
+  g_array_free (index->rects, TRUE);
+  g_free (index);
+}
+
+static int
+get_cell (int offset,
+          int cell_size,
+          int n_cells)
+{
+  if (offset < 0)
+    return 0;
+
+  return MIN (offset / cell_size, n_cells - 1);
+}
+
+/* Gets the range of cells, inclusive, that rect reaches into */
+static void
+get_cells (MetaRectIndex       *index,
+           const MetaRectangle *rect,
+           int                 *first_column,
+           int                 *first_row,
+           int                 *last_column,
+           int                 *last_row)
+{
+  *first_column = get_cell (rect->x - index->area.x,
+                            index->cell_width, index->n_columns);
+  *last_column = get_cell (rect->x + rect->width - 1 - index->area.x,
+                           index->cell_width, index->n_columns);
+  *first_row = get_cell (rect->y - index->area.y,
+                         index->cell_height, index->n_rows);
+  *last_row = get_cell (rect->y + rect->height - 1 - index->area.y,
+                        index->cell_height, index->n_rows);
+}
+
+void
+meta_rect_index_add (MetaRectIndex       *index,
+                     const MetaRectangle *rect)
+{
+  int first_column, first_row, last_column, last_row;
+  int rect_index;
+  int column, row;
+
+  /* Nothing can overlap an empty rectangle */
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  rect_index = index->rects->len;
+  g_array_append_val (index->rects, *rect);
+
+  get_cells (index, rect, &first_column, &first_row, &last_column, &last_row);
+
+  for (row = first_row; row <= last_row; row++)
+    {
+      for (column = first_column; column <= last_column; column++)
+        {
+          GArray **cell = &index->cells[row * index->n_columns + column];
+
+          if (*cell == NULL)
+            *cell = g_array_new (FALSE, FALSE, sizeof (int));
+
+          g_array_append_val (*cell, rect_index);
+        }
+    }
+}
+
+gboolean
+meta_rect_index_overlaps (MetaRectIndex       *index,
+                          const MetaRectangle *rect)
+{
+  int first_column, first_row, last_column, last_row;
+  int column, row;
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return FALSE;
+
+  get_cells (index, rect, &first_column, &first_row, &last_column, &last_row);
+
+  /* A rectangle reaching into several of the cells is looked at once
+   * for each; that's cheaper than keeping track of which were seen.
+   */
+  for (row = first_row; row <= last_row; row++)
+    {
+      for (column = first_column; column <= last_column; column++)
+        {
+          GArray *cell = index->cells[row * index->n_columns + column];
+          guint i;
+
+          if (cell == NULL)
+            continue;
+
+          for (i = 0; i < cell->len; i++)
+            {
+              const MetaRectangle *other;
+
+              other = &g_array_index (index->rects, MetaRectangle,
+                                      g_array_index (cell, int, i));
+
+              if (meta_rectangle_overlap (rect, other))
+                return TRUE;
+            }
+        }
+    }
+
+  return FALSE;
+}
@@ -0,0 +1,49 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file rect-index.h  Finding rectangles that overlap a given one
+ *
+ * Placing a window tries a position next to each other window, and
+ * each of those positions has to be checked against all the windows
+ * again. To keep that from growing with the square of the number of
+ * windows, the rectangles to check against are sorted into a grid of
+ * cells over the screen, so a check only looks at the rectangles in
+ * the cells it covers.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_RECT_INDEX_H
+#define META_RECT_INDEX_H
+
+#include "boxes.h"
+
+typedef struct _MetaRectIndex MetaRectIndex;
+
+/* Rectangles may be anywhere, but the index works best for those within
+ * area.
+ */
+MetaRectIndex *meta_rect_index_new      (const MetaRectangle *area);
+void           meta_rect_index_free     (MetaRectIndex       *index);
+
+void           meta_rect_index_add      (MetaRectIndex       *index,
+                                         const MetaRectangle *rect);
+
+/* Whether rect has any area in common with a rectangle in the index */
+gboolean       meta_rect_index_overlaps (MetaRectIndex       *index,
+                                         const MetaRectangle *rect);
+
+#endif
@@ -0,0 +1,294 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity X server round-trip accounting */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "round-trips.h"
+#include "util.h"
+
+/* Nesting deeper than this is not expected (a focus inside a workspace
+ * switch inside a grab is about as deep as it gets); anything deeper is
+ * attributed to the innermost op we still have room for.
+ */
+#define MAX_OP_DEPTH 16
+
+typedef struct
+{
+  const char *site;
+  guint       count;
+  gint64      total_time;
+  gint64      max_time;
+} SiteStats;
+
+typedef struct
+{
+  guint       n_ops;
+  guint       count;
+  gint64      total_time;
+
+  /* const char *site -> SiteStats */
+  GHashTable *sites;
+} OpStats;
+
+typedef struct
+{
+  MetaRoundTripOp op;
+  guint           count;
+  gint64          total_time;
+} OpFrame;
+
+static OpStats op_stats[META_ROUND_TRIP_OP_LAST];
+static OpFrame op_stack[MAX_OP_DEPTH];
+static int op_depth = 0;
+
+static const char *
+op_to_string (MetaRoundTripOp op)
+{
+  switch (op)
+    {
+    case META_ROUND_TRIP_OP_OTHER:
+      return "other";
+    case META_ROUND_TRIP_OP_MAP:
+      return "map";
+    case META_ROUND_TRIP_OP_FOCUS:
+      return "focus";
+    case META_ROUND_TRIP_OP_WORKSPACE_SWITCH:
+      return "workspace-switch";
+    case META_ROUND_TRIP_OP_GRAB:
+      return "grab";
+    case META_ROUND_TRIP_OP_LAST:
+    default:
+      break;
+    }
+
+  return "(unknown)";
+}
+
+static OpFrame *
+current_frame (void)
+{
+  if (op_depth == 0)
+    return NULL;
+
+  return &op_stack[MIN (op_depth, MAX_OP_DEPTH) - 1];
+}
+
+/**
+ * Starts timing a call that is about to block on the X server.
+ *
+ * \return  A timestamp to hand to meta_round_trip_end(), or 0 if
+ *          round-trip accounting is disabled.
+ */
+gint64
+meta_round_trip_begin (void)
+{
+  if (!meta_check_debug_flags (META_DEBUG_ROUND_TRIPS))
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+/**
+ * Records a completed round-trip against the call site and the current
+ * operation.
+ *
+ * \param site        Name of the call site; must be a static string such
+ *                    as G_STRFUNC, since it is kept as a hash key.
+ * \param start_time  The value returned by meta_round_trip_begin().
+ */
+void
+meta_round_trip_end (const char *site,
+                     gint64      start_time)
+{
+  MetaRoundTripOp op;
+  OpFrame *frame;
+  OpStats *stats;
+  SiteStats *site_stats;
+  gint64 elapsed;
+
+  if (start_time == 0)
+    return;
+
+  elapsed = g_get_monotonic_time () - start_time;
+
+  frame = current_frame ();
+  op = frame != NULL ? frame->op : META_ROUND_TRIP_OP_OTHER;
+
+  if (frame != NULL)
+    {
+      frame->count += 1;
+      frame->total_time += elapsed;
+    }
+
+  stats = &op_stats[op];
+  if (stats->sites == NULL)
+    stats->sites = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          NULL, g_free);
+
+  site_stats = g_hash_table_lookup (stats->sites, site);
+  if (site_stats == NULL)
+    {
+      site_stats = g_new0 (SiteStats, 1);
+      site_stats->site = site;
+
+      g_hash_table_insert (stats->sites, (gpointer) site, site_stats);
+    }
+
+  site_stats->count += 1;
+  site_stats->total_time += elapsed;
+  site_stats->max_time = MAX (site_stats->max_time, elapsed);
+
+  stats->count += 1;
+  stats->total_time += elapsed;
+
+  meta_topic (META_DEBUG_ROUND_TRIPS,
+              "Round-trip in %s during %s took %" G_GINT64_FORMAT " us\n",
+              site, op_to_string (op), elapsed);
+}
+
+/**
+ * Marks the start of a high-level operation; round-trips recorded until
+ * the matching meta_round_trip_pop_op() are attributed to it.
+ *
+ * The op stack is maintained even while accounting is disabled so that
+ * toggling debugging at runtime can't leave it unbalanced.
+ */
+void
+meta_round_trip_push_op (MetaRoundTripOp op)
+{
+  OpFrame *frame;
+
+  g_return_if_fail (op < META_ROUND_TRIP_OP_LAST);
+
+  op_depth += 1;
+
+  if (op_depth > MAX_OP_DEPTH)
+    return;
+
+  frame = &op_stack[op_depth - 1];
+  frame->op = op;
+  frame->count = 0;
+  frame->total_time = 0;
+}
+
+void
+meta_round_trip_pop_op (void)
+{
+  OpFrame *frame;
+
+  g_return_if_fail (op_depth > 0);
+
+  if (op_depth <= MAX_OP_DEPTH)
+    {
+      frame = &op_stack[op_depth - 1];
+
+      if (meta_check_debug_flags (META_DEBUG_ROUND_TRIPS))
+        {
+          op_stats[frame->op].n_ops += 1;
+
+          if (frame->count > 0)
+            meta_topic (META_DEBUG_ROUND_TRIPS,
+                        "%s needed %u round-trips, blocked for %.3f ms\n",
+                        op_to_string (frame->op), frame->count,
+                        frame->total_time / 1000.0);
+        }
+    }
+
+  op_depth -= 1;
+}
+
+static gint
+compare_site_stats (gconstpointer a,
+                    gconstpointer b)
+{
+  const SiteStats *site_a = a;
+  const SiteStats *site_b = b;
+
+  /* Most expensive first */
+  if (site_a->total_time > site_b->total_time)
+    return -1;
+  else if (site_a->total_time < site_b->total_time)
+    return 1;
+
+  return 0;
+}
+
+/**
+ * Logs the accumulated round-trip counts, grouped by operation and
+ * sorted by the total time each call site spent blocked.
+ */
+void
+meta_round_trip_dump_stats (void)
+{
+  int i;
+
+  if (!meta_check_debug_flags (META_DEBUG_ROUND_TRIPS))
+    return;
+
+  meta_topic (META_DEBUG_ROUND_TRIPS, "Round-trip summary:\n");
+
+  for (i = 0; i < META_ROUND_TRIP_OP_LAST; i++)
+    {
+      OpStats *stats;
+      GList *sites;
+      GList *l;
+
+      stats = &op_stats[i];
+      if (stats->count == 0)
+        continue;
+
+      meta_topic (META_DEBUG_ROUND_TRIPS,
+                  "  %s: %u round-trips over %u operations, %.3f ms blocked\n",
+                  op_to_string (i), stats->count, stats->n_ops,
+                  stats->total_time / 1000.0);
+
+      sites = g_hash_table_get_values (stats->sites);
+      sites = g_list_sort (sites, compare_site_stats);
+
+      for (l = sites; l != NULL; l = l->next)
+        {
+          SiteStats *site_stats;
+
+          site_stats = l->data;
+
+          meta_topic (META_DEBUG_ROUND_TRIPS,
+                      "    %-48s %6u calls %10.3f ms total %8.3f ms avg %8.3f ms max\n",
+                      site_stats->site, site_stats->count,
+                      site_stats->total_time / 1000.0,
+                      site_stats->total_time / 1000.0 / site_stats->count,
+                      site_stats->max_time / 1000.0);
+        }
+
+      g_list_free (sites);
+    }
+}
+
+void
+meta_round_trip_free_stats (void)
+{
+  int i;
+
+  for (i = 0; i < META_ROUND_TRIP_OP_LAST; i++)
+    {
+      g_clear_pointer (&op_stats[i].sites, g_hash_table_destroy);
+
+      op_stats[i].n_ops = 0;
+      op_stats[i].count = 0;
+      op_stats[i].total_time = 0;
+    }
+}
@@ -0,0 +1,58 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file round-trips.h Accounting of synchronous X server round-trips
+ *
+ * Every place where we block waiting for the X server costs us a full
+ * round-trip, which is cheap on a local display but can easily be several
+ * milliseconds over a forwarded or otherwise remote connection. To decide
+ * which of them are worth eliminating, the blocking call sites wrap
+ * themselves in meta_round_trip_begin() / meta_round_trip_end() and the
+ * time spent is summed per call site and per high-level operation (map,
+ * focus, workspace switch, grab).
+ *
+ * The accounting is only active when META_DEBUG contains "round-trips".
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_ROUND_TRIPS_H
+#define META_ROUND_TRIPS_H
+
+#include <glib.h>
+
+typedef enum
+{
+  META_ROUND_TRIP_OP_OTHER,
+  META_ROUND_TRIP_OP_MAP,
+  META_ROUND_TRIP_OP_FOCUS,
+  META_ROUND_TRIP_OP_WORKSPACE_SWITCH,
+  META_ROUND_TRIP_OP_GRAB,
+
+  META_ROUND_TRIP_OP_LAST
+} MetaRoundTripOp;
+
+gint64 meta_round_trip_begin       (void);
+void   meta_round_trip_end         (const char      *site,
+                                    gint64           start_time);
+
+void   meta_round_trip_push_op     (MetaRoundTripOp  op);
+void   meta_round_trip_pop_op      (void);
+
+void   meta_round_trip_dump_stats  (void);
+void   meta_round_trip_free_stats  (void);
+
+#endif
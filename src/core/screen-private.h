@@ -36,6 +36,7 @@
 #include <X11/Xutil.h>
 #include "stack-tracker.h"
 #include "ui.h"
+#include "work-areas.h"
 
 typedef struct _MetaMonitorInfo MetaMonitorInfo;
 
@@ -43,6 +44,7 @@ struct _MetaMonitorInfo
 {
   int number;
   MetaRectangle rect;
+  double refresh_rate; /* in Hz */
 };
 
 typedef void (* MetaScreenWindowFunc) (MetaScreen *screen, MetaWindow *window,
@@ -89,6 +91,11 @@ struct _MetaScreen
 
   GList *workspaces;
 
+  /* Every window on the screen, override redirect ones included,
+   * newest first; the links are the windows' screen_link.
+   */
+  GList *windows;
+
   MetaStack *stack;
   MetaStackTracker *stack_tracker;
 
@@ -103,6 +110,9 @@ struct _MetaScreen
   MetaMonitorInfo *monitor_infos;
   int n_monitor_infos;
 
+  /* Work areas for the struts of each workspace */
+  MetaWorkAreaCache *work_area_cache;
+
   /* Cache the current monitor */
   int last_monitor_index;
 
@@ -29,7 +29,9 @@
 #include "screen-private.h"
 #include "util.h"
 #include "errors.h"
+#include "round-trips.h"
 #include "window-private.h"
+#include "window-props.h"
 #include "frame-private.h"
 #include "prefs.h"
 #include "workspace.h"
@@ -42,6 +44,10 @@
 #include <X11/extensions/Xinerama.h>
 #endif
 
+#ifdef HAVE_RANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+
 #include <X11/Xatom.h>
 #include <locale.h>
 #include <string.h>
@@ -169,6 +175,97 @@ meta_startup_sequence_free (MetaStartupSequence *self)
   g_free (self);
 }
 
+/* Used for monitors whose refresh rate RandR can't tell us */
+#define DEFAULT_REFRESH_RATE 60.0
+
+#ifdef HAVE_RANDR
+static double
+get_mode_refresh_rate (const XRRModeInfo *mode)
+{
+  double rate;
+
+  if (mode->hTotal == 0 || mode->vTotal == 0)
+    return 0.0;
+
+  rate = (double) mode->dotClock / ((double) mode->hTotal * mode->vTotal);
+
+  if (mode->modeFlags & RR_DoubleScan)
+    rate /= 2.0;
+  if (mode->modeFlags & RR_Interlace)
+    rate *= 2.0;
+
+  return rate;
+}
+
+/* Sets the refresh rate of every monitor that a CRTC shows exactly;
+ * a monitor mirrored on several CRTCs gets the fastest of them.
+ */
+static void
+update_refresh_rates (MetaScreen *screen)
+{
+  Display *xdisplay;
+  XRRScreenResources *resources;
+  int event_base, error_base;
+  int major, minor;
+  int i;
+
+  xdisplay = screen->display->xdisplay;
+
+  if (!XRRQueryExtension (xdisplay, &event_base, &error_base) ||
+      !XRRQueryVersion (xdisplay, &major, &minor) ||
+      (major == 1 && minor < 3))
+    {
+      meta_topic (META_DEBUG_XINERAMA,
+                  "No RandR 1.3, assuming monitors refresh at %g Hz\n",
+                  DEFAULT_REFRESH_RATE);
+      return;
+    }
+
+  meta_error_trap_push (screen->display);
+
+  resources = XRRGetScreenResourcesCurrent (xdisplay, screen->xroot);
+
+  for (i = 0; resources != NULL && i < resources->ncrtc; i++)
+    {
+      XRRCrtcInfo *crtc;
+      double rate;
+      int j;
+
+      crtc = XRRGetCrtcInfo (xdisplay, resources, resources->crtcs[i]);
+      if (crtc == NULL)
+        continue;
+
+      rate = 0.0;
+      for (j = 0; crtc->mode != None && j < resources->nmode; j++)
+        {
+          if (resources->modes[j].id == crtc->mode)
+            {
+              rate = get_mode_refresh_rate (&resources->modes[j]);
+              break;
+            }
+        }
+
+      for (j = 0; j < screen->n_monitor_infos; j++)
+        {
+          MetaMonitorInfo *info = &screen->monitor_infos[j];
+
+          if (info->rect.x == crtc->x &&
+              info->rect.y == crtc->y &&
+              info->rect.width == (int) crtc->width &&
+              info->rect.height == (int) crtc->height)
+            info->refresh_rate = MAX (info->refresh_rate, rate);
+        }
+
+      XRRFreeCrtcInfo (crtc);
+    }
+
+  if (resources != NULL)
+    XRRFreeScreenResources (resources);
+
+  meta_error_trap_pop (screen->display);
+}
+#endif /* HAVE_RANDR */
+
 static void
 reload_monitor_infos (MetaScreen *screen)
 {
@@ -285,6 +382,28 @@ reload_monitor_infos (MetaScreen *screen)
 
   g_assert (screen->n_monitor_infos > 0);
   g_assert (screen->monitor_infos != NULL);
+
+  {
+    int i;
+
+    for (i = 0; i < screen->n_monitor_infos; i++)
+      screen->monitor_infos[i].refresh_rate = 0.0;
+
+#ifdef HAVE_RANDR
+    update_refresh_rates (screen);
+#endif
+
+    for (i = 0; i < screen->n_monitor_infos; i++)
+      {
+        if (screen->monitor_infos[i].refresh_rate <= 0.0)
+          screen->monitor_infos[i].refresh_rate = DEFAULT_REFRESH_RATE;
+
+        meta_topic (META_DEBUG_XINERAMA,
+                    "Monitor %d refreshes at %g Hz\n",
+                    screen->monitor_infos[i].number,
+                    screen->monitor_infos[i].refresh_rate);
+      }
+  }
 }
 
 MetaScreen*
@@ -454,6 +573,8 @@ meta_screen_new (MetaDisplay *display,
 
   screen->active_workspace = NULL;
   screen->workspaces = NULL;
+  screen->windows = NULL;
+  screen->work_area_cache = meta_work_area_cache_new ();
   screen->rows_of_workspaces = 1;
   screen->columns_of_workspaces = -1;
   screen->vertical_workspaces = FALSE;
@@ -593,6 +714,8 @@ meta_screen_free (MetaScreen *screen,
   if (screen->work_area_idle != 0)
     g_source_remove (screen->work_area_idle);
 
+  meta_work_area_cache_free (screen->work_area_cache);
+
   if (screen->monitor_infos)
     g_free (screen->monitor_infos);
 
@@ -612,6 +735,7 @@ meta_screen_manage_all_windows (MetaScreen *screen)
   Window *windows;
   int n_windows;
   Window *xwindows;
+  MetaWindowPrefetch **prefetches;
   int i;
 
   meta_stack_freeze (screen->stack);
@@ -620,12 +744,37 @@ meta_screen_manage_all_windows (MetaScreen *screen)
   /* Copy the stack as it will be modified as part of the loop */
   xwindows = g_memdup2 (windows, sizeof (Window) * n_windows);
 
+  meta_round_trip_push_op (META_ROUND_TRIP_OP_MAP);
+
+  /* Keep the properties from changing between fetching them and
+   * selecting for PropertyNotify in meta_window_new()
+   */
+  meta_display_grab (screen->display);
+
+  /* Send the property requests for every window before waiting for any
+   * of them, so they cost one round-trip rather than one per window.
+   * Windows may be destroyed before the server gets to them.
+   */
+  prefetches = g_new (MetaWindowPrefetch *, n_windows);
+  meta_error_trap_push (screen->display);
   for (i = 0; i < n_windows; i++)
     {
-      meta_window_new (screen->display, xwindows[i], TRUE,
-                       META_EFFECT_TYPE_NONE);
+      prefetches[i] = meta_window_prefetch_initial_properties (screen->display,
+                                                               xwindows[i]);
     }
+  meta_error_trap_pop (screen->display);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      meta_window_new_prefetched (screen->display, xwindows[i], TRUE,
+                                  META_EFFECT_TYPE_NONE, prefetches[i]);
+    }
+
+  meta_display_ungrab (screen->display);
+
+  meta_round_trip_pop_op ();
 
+  g_free (prefetches);
   g_free (xwindows);
 
   meta_stack_thaw (screen->stack);
@@ -724,64 +873,27 @@ get_screen_name (MetaDisplay *display,
   return scr;
 }
 
-static gint
-ptrcmp (gconstpointer a, gconstpointer b)
-{
-  if (a < b)
-    return -1;
-  else if (a > b)
-    return 1;
-  else
-    return 0;
-}
-
-static void
-listify_func (gpointer key, gpointer value, gpointer data)
-{
-  GSList **listp;
-
-  listp = data;
-
-  *listp = g_slist_prepend (*listp, value);
-}
-
 void
 meta_screen_foreach_window (MetaScreen *screen,
                             MetaScreenWindowFunc func,
                             gpointer data)
 {
-  GSList *winlist;
-  GSList *tmp;
-
-  /* If we end up doing this often, just keeping a list
-   * of windows might be sensible.
-   */
-
-  winlist = NULL;
-  g_hash_table_foreach (screen->display->window_ids,
-                        listify_func,
-                        &winlist);
-
-  winlist = g_slist_sort (winlist, ptrcmp);
+  GList *tmp;
 
-  tmp = winlist;
+  tmp = screen->windows;
   while (tmp != NULL)
     {
-      /* If the next node doesn't contain this window
-       * a second time, delete the window.
-       */
-      if (tmp->next == NULL ||
-          (tmp->next && tmp->next->data != tmp->data))
-        {
-          MetaWindow *window = tmp->data;
+      MetaWindow *window = tmp->data;
+      GList *next;
 
-          if (window->screen == screen && !window->override_redirect)
-            (* func) (screen, window, data);
-        }
+      /* func may unmanage the window, taking its link with it */
+      next = tmp->next;
 
-      tmp = tmp->next;
+      if (!window->override_redirect)
+        (* func) (screen, window, data);
+
+      tmp = next;
     }
-  g_slist_free (winlist);
 }
 
 static void
@@ -1577,10 +1689,12 @@ meta_screen_get_current_monitor (MetaScreen *screen)
       unsigned int mask_return;
       int i;
       MetaRectangle pointer_position;
+      gint64 start_time;
 
       screen->display->monitor_cache_invalidated = FALSE;
 
       pointer_position.width = pointer_position.height = 1;
+      start_time = meta_round_trip_begin ();
       XQueryPointer (screen->display->xdisplay,
                      screen->xroot,
                      &root_return,
@@ -1590,6 +1704,7 @@ meta_screen_get_current_monitor (MetaScreen *screen)
                      &win_x_return,
                      &win_y_return,
                      &mask_return);
+      meta_round_trip_end (G_STRFUNC, start_time);
 
       screen->last_monitor_index = 0;
       for (i = 0; i < screen->n_monitor_infos; i++)
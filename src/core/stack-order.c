@@ -0,0 +1,431 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity incremental stack sorting */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "stack-order.h"
+
+static gint
+compare_items (gconstpointer a,
+               gconstpointer b,
+               gpointer      user_data)
+{
+  GCompareFunc compare_func = user_data;
+
+  return (* compare_func) (*(gconstpointer *) a, *(gconstpointer *) b);
+}
+
+/**
+ * Sorts items by compare_func, given that the items for which moved_func
+ * returns FALSE are already in order among themselves. Returns the number
+ * of items that had moved.
+ */
+int
+meta_stack_order_resort (GPtrArray               *items,
+                         MetaStackOrderMovedFunc  moved_func,
+                         GCompareFunc             compare_func)
+{
+  GPtrArray *moved;
+  int n_items;
+  int n_kept;
+  int n_moved;
+  int i, j, k;
+
+  n_items = items->len;
+  moved = g_ptr_array_new ();
+
+  /* Take the moved items out, closing up the gaps they leave */
+  n_kept = 0;
+  for (i = 0; i < n_items; i++)
+    {
+      gpointer item = g_ptr_array_index (items, i);
+
+      if ((* moved_func) (item))
+        g_ptr_array_add (moved, item);
+      else
+        items->pdata[n_kept++] = item;
+    }
+
+  n_moved = moved->len;
+
+  if (n_moved == 0)
+    {
+      g_ptr_array_free (moved, TRUE);
+      return 0;
+    }
+
+  g_ptr_array_sort_with_data (moved, compare_items, compare_func);
+
+  /* Merge from the end, so that nothing is overwritten before it has
+   * been placed
+   */
+  i = n_kept - 1;
+  j = n_moved - 1;
+  k = n_items - 1;
+
+  while (j >= 0)
+    {
+      if (i >= 0 &&
+          (* compare_func) (items->pdata[i], moved->pdata[j]) > 0)
+        items->pdata[k--] = items->pdata[i--];
+      else
+        items->pdata[k--] = moved->pdata[j--];
+    }
+
+  g_ptr_array_free (moved, TRUE);
+
+  return n_moved;
+}
+
+/**
+ * Finds a longest increasing subsequence of order, that is, the most
+ * items that can keep their places when they are put in increasing
+ * order. Sets kept[i] for the items in it, and returns their number.
+ */
+int
+meta_stack_order_find_kept (const int *order,
+                            int        n_items,
+                            gboolean  *kept)
+{
+  int *tails;
+  int *prev;
+  int n_tails;
+  int i;
+
+  /* tails[k] is the item ending the increasing run of length k + 1 with
+   * the lowest last value found so far; prev[] links each item to the
+   * one before it in its run.
+   */
+  tails = g_new (int, MAX (n_items, 1));
+  prev = g_new (int, MAX (n_items, 1));
+  n_tails = 0;
+
+  for (i = 0; i < n_items; i++)
+    {
+      int low, high;
+
+      low = 0;
+      high = n_tails;
+      while (low < high)
+        {
+          int mid = (low + high) / 2;
+
+          if (order[tails[mid]] < order[i])
+            low = mid + 1;
+          else
+            high = mid;
+        }
+
+      prev[i] = low > 0 ? tails[low - 1] : -1;
+      tails[low] = i;
+
+      if (low == n_tails)
+        n_tails += 1;
+    }
+
+  for (i = 0; i < n_items; i++)
+    kept[i] = FALSE;
+
+  for (i = n_tails > 0 ? tails[n_tails - 1] : -1; i >= 0; i = prev[i])
+    kept[i] = TRUE;
+
+  g_free (prev);
+  g_free (tails);
+
+  return n_tails;
+}
+
+typedef struct
+{
+  gpointer above;
+  gpointer below;
+  int      above_position;
+
+  /* The next constraint with the same below window, or -1 */
+  int      next;
+
+  /* Constraints whose below window is our above window, in edges */
+  int      first_edge;
+  int      n_edges;
+
+  /* The generation in which the constraint was applied, used to detect
+   * cycles
+   */
+  guint    applied;
+
+  /* Has a previous node in the graph, so isn't a place to start */
+  gboolean has_prev;
+} StackConstraint;
+
+typedef struct
+{
+  int   first;
+  guint generation;
+} ConstraintList;
+
+struct _MetaStackConstraints
+{
+  /* StackConstraint; everything is an index into this */
+  GArray *constraints;
+
+  /* ConstraintList per stack position of the below window; a list is
+   * empty unless it is from the current generation.
+   */
+  GArray *by_below;
+
+  GArray *edges;
+  GArray *heads;
+  GArray *pending;
+
+  guint   generation;
+};
+
+MetaStackConstraints *
+meta_stack_constraints_new (void)
+{
+  MetaStackConstraints *constraints;
+
+  constraints = g_new0 (MetaStackConstraints, 1);
+  constraints->constraints = g_array_new (FALSE, FALSE, sizeof (StackConstraint));
+  constraints->by_below = g_array_new (FALSE, TRUE, sizeof (ConstraintList));
+  constraints->edges = g_array_new (FALSE, FALSE, sizeof (int));
+  constraints->heads = g_array_new (FALSE, FALSE, sizeof (int));
+  constraints->pending = g_array_new (FALSE, FALSE, sizeof (int));
+
+  return constraints;
+}
+
+void
+meta_stack_constraints_free (MetaStackConstraints *constraints)
+{
+  g_array_free (constraints->constraints, TRUE);
+  g_array_free (constraints->by_below, TRUE);
+  g_array_free (constraints->edges, TRUE);
+  g_array_free (constraints->heads, TRUE);
+  g_array_free (constraints->pending, TRUE);
+  g_free (constraints);
+}
+
+/**
+ * Starts a new set of constraints between windows at stack positions
+ * 0 to n_positions - 1, dropping the previous set.
+ */
+void
+meta_stack_constraints_begin (MetaStackConstraints *constraints,
+                              int                   n_positions)
+{
+  constraints->generation += 1;
+
+  /* After wrapping around, old lists could look current again */
+  if (constraints->generation == 0)
+    {
+      g_array_set_size (constraints->by_below, 0);
+      constraints->generation = 1;
+    }
+
+  if ((int) constraints->by_below->len < n_positions)
+    g_array_set_size (constraints->by_below, n_positions);
+
+  g_array_set_size (constraints->constraints, 0);
+  g_array_set_size (constraints->edges, 0);
+}
+
+static ConstraintList *
+get_list (MetaStackConstraints *constraints,
+          int                   position)
+{
+  ConstraintList *list;
+
+  list = &g_array_index (constraints->by_below, ConstraintList, position);
+
+  if (list->generation != constraints->generation)
+    {
+      list->first = -1;
+      list->generation = constraints->generation;
+    }
+
+  return list;
+}
+
+/**
+ * Adds the constraint that above must be above below; the positions are
+ * their stack positions as of meta_stack_constraints_begin(). Adding the
+ * same constraint again does nothing.
+ */
+void
+meta_stack_constraints_add (MetaStackConstraints *constraints,
+                            gpointer              above,
+                            int                   above_position,
+                            gpointer              below,
+                            int                   below_position)
+{
+  ConstraintList *list;
+  StackConstraint *all;
+  StackConstraint c;
+  int i;
+
+  list = get_list (constraints, below_position);
+
+  /* check if constraint is a duplicate */
+  all = (StackConstraint *) constraints->constraints->data;
+  for (i = list->first; i >= 0; i = all[i].next)
+    {
+      if (all[i].above == above)
+        return;
+    }
+
+  c.above = above;
+  c.below = below;
+  c.above_position = above_position;
+  c.next = list->first;
+  c.first_edge = 0;
+  c.n_edges = 0;
+  c.applied = 0;
+  c.has_prev = FALSE;
+
+  list->first = constraints->constraints->len;
+  g_array_append_val (constraints->constraints, c);
+}
+
+/* If we have "A below B" and "B below C" then AB -> BC, so BC is one of
+ * the edges of AB.
+ */
+static void
+graph_constraints (MetaStackConstraints *constraints)
+{
+  StackConstraint *all;
+  int n_positions;
+  int i;
+
+  all = (StackConstraint *) constraints->constraints->data;
+  n_positions = constraints->by_below->len;
+
+  for (i = 0; i < n_positions; i++)
+    {
+      int c;
+
+      for (c = get_list (constraints, i)->first; c >= 0; c = all[c].next)
+        {
+          int *edges;
+          int n;
+          int j;
+
+          all[c].first_edge = constraints->edges->len;
+
+          for (n = get_list (constraints, all[c].above_position)->first;
+               n >= 0;
+               n = all[n].next)
+            {
+              g_array_append_val (constraints->edges, n);
+              all[n].has_prev = TRUE;
+            }
+
+          all[c].n_edges = constraints->edges->len - all[c].first_edge;
+
+          /* Edges are followed last found first */
+          edges = &g_array_index (constraints->edges, int, all[c].first_edge);
+          for (j = 0; j < all[c].n_edges / 2; j++)
+            {
+              int tmp = edges[j];
+
+              edges[j] = edges[all[c].n_edges - 1 - j];
+              edges[all[c].n_edges - 1 - j] = tmp;
+            }
+        }
+    }
+}
+
+/* Applies c and then everything reachable from it, depth first */
+static void
+traverse_constraint (MetaStackConstraints    *constraints,
+                     int                      c,
+                     MetaStackConstraintFunc  func,
+                     gpointer                 user_data)
+{
+  StackConstraint *all;
+  const int *edges;
+
+  all = (StackConstraint *) constraints->constraints->data;
+  edges = (const int *) constraints->edges->data;
+
+  g_array_set_size (constraints->pending, 0);
+  g_array_append_val (constraints->pending, c);
+
+  while (constraints->pending->len > 0)
+    {
+      int j;
+
+      c = g_array_index (constraints->pending, int,
+                         constraints->pending->len - 1);
+      g_array_set_size (constraints->pending, constraints->pending->len - 1);
+
+      if (all[c].applied == constraints->generation)
+        continue;
+
+      (* func) (all[c].above, all[c].below, user_data);
+      all[c].applied = constraints->generation;
+
+      /* Pushed in reverse, so that the first edge is followed first */
+      for (j = all[c].n_edges - 1; j >= 0; j--)
+        g_array_append_val (constraints->pending, edges[all[c].first_edge + j]);
+    }
+}
+
+/**
+ * Calls func for every constraint, in an order such that applying a
+ * constraint never undoes one applied before it. The graph may have
+ * cycles, in which case a constraint on the cycle may end up broken.
+ * Returns the number of constraints.
+ */
+int
+meta_stack_constraints_apply (MetaStackConstraints    *constraints,
+                              MetaStackConstraintFunc  func,
+                              gpointer                 user_data)
+{
+  StackConstraint *all;
+  GArray *heads;
+  int n_positions;
+  int i;
+
+  graph_constraints (constraints);
+
+  all = (StackConstraint *) constraints->constraints->data;
+  n_positions = constraints->by_below->len;
+
+  /* Find all heads of ordered constraint chains */
+  heads = constraints->heads;
+  g_array_set_size (heads, 0);
+
+  for (i = 0; i < n_positions; i++)
+    {
+      int c;
+
+      for (c = get_list (constraints, i)->first; c >= 0; c = all[c].next)
+        {
+          if (!all[c].has_prev)
+            g_array_append_val (heads, c);
+        }
+    }
+
+  /* Last found first, and traverse the chains applying constraints */
+  for (i = (int) heads->len - 1; i >= 0; i--)
+    traverse_constraint (constraints, g_array_index (heads, int, i),
+                         func, user_data);
+
+  return constraints->constraints->len;
+}
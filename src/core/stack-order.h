@@ -0,0 +1,75 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file stack-order.h  Keeping the stack sorted as windows move
+ *
+ * Raising, lowering or relayering a window changes where that one window
+ * belongs in the stack, but leaves every other window in the same order
+ * relative to the rest. So rather than sorting the whole stack again, the
+ * windows that moved are taken out, sorted among themselves and merged
+ * back in, which costs one pass over the stack plus a sort of the few
+ * windows that moved.
+ *
+ * The same idea saves requests when the X server's stack is brought
+ * into a new order: as many windows as are already in the right order
+ * relative to each other can stay where they are, and only the others
+ * need to be restacked.
+ *
+ * Transient windows are kept above their parents by a graph of stacking
+ * constraints that is rebuilt whenever the stack changes; its storage is
+ * kept from one rebuild to the next.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_STACK_ORDER_H
+#define META_STACK_ORDER_H
+
+#include <glib.h>
+
+/* Whether item has moved since the items were last sorted */
+typedef gboolean (* MetaStackOrderMovedFunc) (gconstpointer item);
+
+int meta_stack_order_resort    (GPtrArray               *items,
+                                MetaStackOrderMovedFunc  moved_func,
+                                GCompareFunc             compare_func);
+
+int meta_stack_order_find_kept (const int               *order,
+                                int                      n_items,
+                                gboolean                *kept);
+
+typedef struct _MetaStackConstraints MetaStackConstraints;
+
+/* Puts above above below, given that it must be */
+typedef void (* MetaStackConstraintFunc) (gpointer above,
+                                          gpointer below,
+                                          gpointer user_data);
+
+MetaStackConstraints *meta_stack_constraints_new   (void);
+void                  meta_stack_constraints_free  (MetaStackConstraints    *constraints);
+
+void                  meta_stack_constraints_begin (MetaStackConstraints    *constraints,
+                                                    int                      n_positions);
+void                  meta_stack_constraints_add   (MetaStackConstraints    *constraints,
+                                                    gpointer                 above,
+                                                    int                      above_position,
+                                                    gpointer                 below,
+                                                    int                      below_position);
+int                   meta_stack_constraints_apply (MetaStackConstraints    *constraints,
+                                                    MetaStackConstraintFunc  func,
+                                                    gpointer                 user_data);
+
+#endif
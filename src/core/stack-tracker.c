@@ -25,6 +25,7 @@
 #include "frame-private.h"
 #include "meta-compositor.h"
 #include "screen-private.h"
+#include "stack-order.h"
 #include "stack-tracker.h"
 #include "util.h"
 
@@ -55,15 +56,27 @@
  * no longer pending b) if necessary, drop the predicted stacking
  * order to recompute it at the next opportunity.
  *
+ * Each stack is an array together with a hash table from window to
+ * position in the array, so that finding a window doesn't mean searching
+ * the stack; override-redirect windows such as menus and tooltips come
+ * and go often enough for that to matter.
+ *
  * Possible optimizations:
- *  Keep the stacks as an array + reverse-mapping hash table to avoid
- *    linear lookups.
- *  Keep the stacks as a GList + reverse-mapping hash table to avoid
- *    linear lookups and to make restacking constant-time.
+ *  Keep the stacks as a GList + reverse-mapping hash table to make
+ *    restacking constant-time.
  */
 
 typedef union _MetaStackOp MetaStackOp;
 
+/* The children of the root window, bottom to top */
+typedef struct
+{
+  GArray     *windows;
+
+  /* Window -> position in windows, plus one */
+  GHashTable *positions;
+} WindowStack;
+
 typedef enum {
   STACK_OP_ADD,
   STACK_OP_REMOVE,
@@ -131,7 +144,7 @@ struct _MetaStackTracker
 
   /* A stack without any unverified operations applied.
    */
-  GArray *verified_stack;
+  WindowStack *verified_stack;
 
   /* This is a queue of requests we've made to change the stacking order,
    * where we haven't yet gotten a reply back from the server.
@@ -142,12 +155,15 @@ struct _MetaStackTracker
    * on the unverified_predictions we've made subsequent to
    * verified_stack.
    */
-  GArray *predicted_stack;
+  WindowStack *predicted_stack;
 
   /* Idle function used to sync the compositor's view of the window
    * stack up with our best guess before a frame is drawn.
    */
   guint sync_stack_idle;
+
+  /* Number of XConfigureWindow() calls we have made to restack windows */
+  guint n_restack_requests;
 };
 
 static void
@@ -188,14 +204,15 @@ meta_stack_op_dump (MetaStackOp *op,
 }
 
 static void
-stack_dump (GArray *stack)
+stack_dump (WindowStack *stack)
 {
   guint i;
 
   meta_push_no_msg_prefix ();
-  for (i = 0; i < stack->len; i++)
+  for (i = 0; i < stack->windows->len; i++)
     {
-      meta_topic (META_DEBUG_STACK, " %#lx", g_array_index (stack, Window, i));
+      meta_topic (META_DEBUG_STACK, " %#lx",
+                  g_array_index (stack->windows, Window, i));
     }
   meta_topic (META_DEBUG_STACK, "\n");
   meta_pop_no_msg_prefix ();
@@ -232,30 +249,75 @@ meta_stack_op_free (MetaStackOp *op)
   g_free (op);
 }
 
-static int
-find_window (GArray *window_stack,
-             Window  window)
+static WindowStack *
+window_stack_new (const Window *windows,
+                  guint         n_windows)
 {
+  WindowStack *stack;
   guint i;
 
-  for (i = 0; i < window_stack->len; i++)
-    {
-      if (g_array_index (window_stack, Window, i) == window)
-        return i;
-    }
+  stack = g_new (WindowStack, 1);
+  stack->windows = g_array_sized_new (FALSE, FALSE, sizeof (Window), n_windows);
+  stack->positions = g_hash_table_new (NULL, NULL);
+
+  g_array_append_vals (stack->windows, windows, n_windows);
+
+  for (i = 0; i < n_windows; i++)
+    g_hash_table_insert (stack->positions,
+                         GUINT_TO_POINTER (windows[i]),
+                         GUINT_TO_POINTER (i + 1));
+
+  return stack;
+}
+
+static void
+window_stack_free (WindowStack *stack)
+{
+  g_array_free (stack->windows, TRUE);
+  g_hash_table_destroy (stack->positions);
+  g_free (stack);
+}
+
+static WindowStack *
+copy_stack (WindowStack *stack)
+{
+  return window_stack_new ((Window *) stack->windows->data,
+                           stack->windows->len);
+}
+
+static int
+find_window (WindowStack *stack,
+             Window       window)
+{
+  gpointer position;
+
+  position = g_hash_table_lookup (stack->positions, GUINT_TO_POINTER (window));
 
-  return -1;
+  return GPOINTER_TO_INT (position) - 1;
+}
+
+/* Brings the positions of the windows from first to last up to date */
+static void
+update_positions (WindowStack *stack,
+                  int          first,
+                  int          last)
+{
+  int i;
+
+  for (i = first; i <= last; i++)
+    g_hash_table_insert (stack->positions,
+                         GUINT_TO_POINTER (g_array_index (stack->windows, Window, i)),
+                         GUINT_TO_POINTER (i + 1));
 }
 
 /* Returns TRUE if stack was changed */
 static gboolean
-move_window_above (GArray     *stack,
-                   Window      window,
-                   int         old_pos,
-                   int         above_pos,
-                   ApplyFlags  apply_flags)
+move_window_above (WindowStack *stack,
+                   Window       window,
+                   int          old_pos,
+                   int          above_pos,
+                   ApplyFlags   apply_flags)
 {
-  int i;
   gboolean can_restack_this_window = (apply_flags & NO_RESTACK_X_WINDOWS) == 0;
 
   if (old_pos < above_pos)
@@ -264,17 +326,16 @@ move_window_above (GArray     *stack,
         {
         }
 
-      for (i = old_pos; i < above_pos; i++)
-        {
-          if (!can_restack_this_window)
-            break;
-
-          g_array_index (stack, Window, i) = g_array_index (stack, Window, i + 1);
-        }
+      if (!can_restack_this_window)
+        return FALSE;
 
-      g_array_index (stack, Window, i) = window;
+      memmove (&g_array_index (stack->windows, Window, old_pos),
+               &g_array_index (stack->windows, Window, old_pos + 1),
+               sizeof (Window) * (above_pos - old_pos));
+      g_array_index (stack->windows, Window, above_pos) = window;
+      update_positions (stack, old_pos, above_pos);
 
-      return i != old_pos;
+      return TRUE;
     }
   else if (old_pos > above_pos + 1)
     {
@@ -282,17 +343,16 @@ move_window_above (GArray     *stack,
         {
         }
 
-      for (i = old_pos; i > above_pos + 1; i--)
-        {
-          if (!can_restack_this_window)
-            break;
-
-          g_array_index (stack, Window, i) = g_array_index (stack, Window, i - 1);
-        }
+      if (!can_restack_this_window)
+        return FALSE;
 
-      g_array_index (stack, Window, i) = window;
+      memmove (&g_array_index (stack->windows, Window, above_pos + 2),
+               &g_array_index (stack->windows, Window, above_pos + 1),
+               sizeof (Window) * (old_pos - above_pos - 1));
+      g_array_index (stack->windows, Window, above_pos + 1) = window;
+      update_positions (stack, above_pos + 1, old_pos);
 
-      return i != old_pos;
+      return TRUE;
     }
   else
     return FALSE;
@@ -301,7 +361,7 @@ move_window_above (GArray     *stack,
 /* Returns TRUE if stack was changed */
 static gboolean
 meta_stack_op_apply (MetaStackOp *op,
-                     GArray      *stack,
+                     WindowStack *stack,
                      ApplyFlags   apply_flags)
 {
   switch (op->any.type)
@@ -323,7 +383,10 @@ meta_stack_op_apply (MetaStackOp *op,
             return FALSE;
           }
 
-        g_array_append_val (stack, op->add.window);
+        g_array_append_val (stack->windows, op->add.window);
+        g_hash_table_insert (stack->positions,
+                             GUINT_TO_POINTER (op->add.window),
+                             GUINT_TO_POINTER (stack->windows->len));
         return TRUE;
       }
       break;
@@ -344,7 +407,10 @@ meta_stack_op_apply (MetaStackOp *op,
             return FALSE;
           }
 
-        g_array_remove_index (stack, old_pos);
+        g_array_remove_index (stack->windows, old_pos);
+        g_hash_table_remove (stack->positions,
+                             GUINT_TO_POINTER (op->remove.window));
+        update_positions (stack, old_pos, (int) stack->windows->len - 1);
         return TRUE;
       }
       break;
@@ -407,7 +473,7 @@ meta_stack_op_apply (MetaStackOp *op,
           }
         else
           {
-            above_pos = stack->len - 1;
+            above_pos = stack->windows->len - 1;
           }
 
         return move_window_above (stack, op->lower_below.window, old_pos,
@@ -422,18 +488,6 @@ meta_stack_op_apply (MetaStackOp *op,
   return FALSE;
 }
 
-static GArray *
-copy_stack (GArray *stack)
-{
-  GArray *copy = g_array_sized_new (FALSE, FALSE, sizeof (Window), stack->len);
-
-  g_array_set_size (copy, stack->len);
-
-  memcpy (copy->data, stack->data, sizeof (Window) * stack->len);
-
-  return copy;
-}
-
 static void
 query_xserver_stack (MetaStackTracker *tracker)
 {
@@ -441,7 +495,6 @@ query_xserver_stack (MetaStackTracker *tracker)
   Window ignored1, ignored2;
   Window *children;
   guint n_children;
-  guint i;
 
   tracker->xserver_serial = XNextRequest (screen->display->xdisplay);
 
@@ -449,11 +502,7 @@ query_xserver_stack (MetaStackTracker *tracker)
               screen->xroot,
               &ignored1, &ignored2, &children, &n_children);
 
-  tracker->verified_stack = g_array_sized_new (FALSE, FALSE, sizeof (Window), n_children);
-  g_array_set_size (tracker->verified_stack, n_children);
-
-  for (i = 0; i < n_children; i++)
-    g_array_index (tracker->verified_stack, Window, i) = children[i];
+  tracker->verified_stack = window_stack_new (children, n_children);
 
   XFree (children);
 }
@@ -478,12 +527,15 @@ meta_stack_tracker_new (MetaScreen *screen)
 void
 meta_stack_tracker_free (MetaStackTracker *tracker)
 {
+  meta_verbose ("Stack tracker: %u restack requests made\n",
+                tracker->n_restack_requests);
+
   if (tracker->sync_stack_idle)
     g_source_remove (tracker->sync_stack_idle);
 
-  g_array_free (tracker->verified_stack, TRUE);
+  window_stack_free (tracker->verified_stack);
   if (tracker->predicted_stack)
-    g_array_free (tracker->predicted_stack, TRUE);
+    window_stack_free (tracker->predicted_stack);
 
   g_queue_free_full (tracker->unverified_predictions, (GDestroyNotify) meta_stack_op_free);
   tracker->unverified_predictions = NULL;
@@ -628,7 +680,7 @@ stack_tracker_event_received (MetaStackTracker *tracker,
     {
       if (tracker->predicted_stack)
         {
-          g_array_free (tracker->predicted_stack, TRUE);
+          window_stack_free (tracker->predicted_stack);
           tracker->predicted_stack = NULL;
         }
 
@@ -726,7 +778,7 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
                               Window          **windows,
                               int              *n_windows)
 {
-  GArray *stack;
+  WindowStack *stack;
 
   if (tracker->unverified_predictions->length == 0)
     {
@@ -750,9 +802,9 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
     }
 
   if (windows)
-    *windows = (Window *)stack->data;
+    *windows = (Window *)stack->windows->data;
   if (n_windows)
-    *n_windows = stack->len;
+    *n_windows = stack->windows->len;
 }
 
 /**
@@ -862,6 +914,7 @@ meta_stack_tracker_lower_below (MetaStackTracker *tracker,
 
   serial = XNextRequest (display->xdisplay);
   XConfigureWindow (display->xdisplay, window, changes_mask, &changes);
+  tracker->n_restack_requests += 1;
 
   meta_error_trap_pop (tracker->screen->display);
 
@@ -888,6 +941,7 @@ meta_stack_tracker_raise_above (MetaStackTracker *tracker,
 
   serial = XNextRequest (display->xdisplay);
   XConfigureWindow (display->xdisplay, window, changes_mask, &changes);
+  tracker->n_restack_requests += 1;
 
   meta_error_trap_pop (tracker->screen->display);
 
@@ -941,8 +995,16 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
   MetaDisplay *display;
   Window *windows;
   int n_windows;
+  Window top_window;
+  GHashTable *new_positions;
+  int *order;
+  int n_order;
+  gboolean *kept;
+  gboolean *kept_position;
+  guint old_n_requests;
   int old_pos;
   int new_pos;
+  int i;
 
   if (n_managed == 0)
     return;
@@ -956,7 +1018,6 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
    * the top of the X stack; we instead move it above all managed windows (or
    * above the guard window if there are no non-hidden managed windows.)
    */
-  old_pos = n_windows - 1;
   for (old_pos = n_windows - 1; old_pos >= 0; old_pos--)
     {
       MetaWindow *old_window;
@@ -969,55 +1030,71 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
 
   g_assert (old_pos >= 0);
 
-  new_pos = n_managed - 1;
-  if (managed[new_pos] != windows[old_pos])
+  top_window = windows[old_pos];
+
+  /* Find the order the managed windows are in now; whatever windows are
+   * already in the right order relative to each other stay where they
+   * are, and every other window is restacked next to one of those.
+   * After a large change such as a workspace switch, that is far fewer
+   * requests than restacking each window that doesn't match its
+   * neighbour.
+   */
+  new_positions = g_hash_table_new (NULL, NULL);
+  for (new_pos = 0; new_pos < n_managed; new_pos++)
+    g_hash_table_insert (new_positions,
+                         GUINT_TO_POINTER (managed[new_pos]),
+                         GINT_TO_POINTER (new_pos + 1));
+
+  order = g_new (int, n_managed);
+  n_order = 0;
+  for (old_pos = 0; old_pos < n_windows; old_pos++)
     {
-      /* Move the first managed window in the new stack above
-       * all managed windows
-       */
-      meta_stack_tracker_raise_above (tracker, managed[new_pos], windows[old_pos]);
-      meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
-      /* Moving managed[new_pos] above windows[old_pos], moves
-       * the window at old_pos down by one
-       */
+      new_pos = GPOINTER_TO_INT (g_hash_table_lookup (new_positions,
+                                                      GUINT_TO_POINTER (windows[old_pos])));
+      if (new_pos > 0 && n_order < n_managed)
+        order[n_order++] = new_pos - 1;
     }
 
-  old_pos--;
-  new_pos--;
+  g_hash_table_destroy (new_positions);
+
+  kept = g_new (gboolean, MAX (n_order, 1));
+  meta_stack_order_find_kept (order, n_order, kept);
 
-  while (old_pos >= 0 && new_pos >= 0)
+  /* Windows that aren't in the X stack yet are never kept */
+  kept_position = g_new0 (gboolean, n_managed);
+  for (i = 0; i < n_order; i++)
+    kept_position[order[i]] = kept[i];
+
+  old_n_requests = tracker->n_restack_requests;
+
+  /* Going from the top down, the window above each moved window is
+   * already where it should be
+   */
+  for (new_pos = n_managed - 1; new_pos >= 0; new_pos--)
     {
-      MetaWindow *old_window;
+      if (kept_position[new_pos])
+        continue;
 
-      if (windows[old_pos] == managed[new_pos])
+      if (new_pos == n_managed - 1)
         {
-          old_pos--;
-          new_pos--;
-          continue;
+          if (managed[new_pos] != top_window)
+            meta_stack_tracker_raise_above (tracker, managed[new_pos], top_window);
         }
-
-      old_window = meta_display_lookup_x_window (display, windows[old_pos]);
-      if (!old_window || old_window->override_redirect || old_window->unmanaging)
+      else
         {
-          old_pos--;
-          continue;
+          meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos + 1]);
         }
-
-      meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos + 1]);
-      meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
-      /* Moving managed[new_pos] above windows[old_pos] moves the window
-       * at old_pos down by one, we'll examine it again to see if it
-       * matches the next new window
-       */
-      old_pos--;
-      new_pos--;
     }
 
-  while (new_pos > 0)
-    {
-      meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos - 1]);
-      new_pos--;
-    }
+  meta_topic (META_DEBUG_STACK,
+              "Restacked %d managed windows with %u requests, "
+              "%u restack requests in total\n",
+              n_managed, tracker->n_restack_requests - old_n_requests,
+              tracker->n_restack_requests);
+
+  g_free (kept_position);
+  g_free (kept);
+  g_free (order);
 }
 
 void
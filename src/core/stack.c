@@ -30,6 +30,7 @@
 #include "errors.h"
 #include "frame-private.h"
 #include "group.h"
+#include "stack-order.h"
 #include "prefs.h"
 #include "workspace.h"
 
@@ -49,6 +50,11 @@
 
 #define WINDOW_IN_STACK(w) (w->stack_position >= 0)
 
+/* A window with no stack_index has moved since the stack was last sorted,
+ * or has only just been added, and stack_do_resort() will place it.
+ */
+#define WINDOW_MOVED(w) (w->stack_index < 0)
+
 static void stack_sync_to_xserver (MetaStack *stack);
 static void meta_window_set_stack_position_no_sync (MetaWindow *window,
                                                     int         position);
@@ -70,7 +76,9 @@ meta_stack_new (MetaScreen *screen)
   stack->screen = screen;
   stack->xwindows = g_array_new (FALSE, FALSE, sizeof (Window));
 
-  stack->sorted = NULL;
+  stack->sorted = g_ptr_array_new ();
+  stack->positions = g_ptr_array_new ();
+  stack->constraints = meta_stack_constraints_new ();
   stack->added = NULL;
   stack->removed = NULL;
 
@@ -90,7 +98,9 @@ meta_stack_free (MetaStack *stack)
 {
   g_array_free (stack->xwindows, TRUE);
 
-  g_list_free (stack->sorted);
+  g_ptr_array_free (stack->sorted, TRUE);
+  g_ptr_array_free (stack->positions, TRUE);
+  meta_stack_constraints_free (stack->constraints);
   g_list_free (stack->added);
   g_list_free (stack->removed);
 
@@ -111,7 +121,9 @@ meta_stack_add (MetaStack  *stack,
   stack->added = g_list_prepend (stack->added, window);
 
   window->stack_position = stack->n_positions;
+  window->stack_index = -1;
   stack->n_positions += 1;
+  g_ptr_array_add (stack->positions, window);
   meta_topic (META_DEBUG_STACK,
               "Window %s has stack_position initialized to %d\n",
               window->desc, window->stack_position);
@@ -135,11 +147,14 @@ meta_stack_remove (MetaStack  *stack,
   meta_window_set_stack_position_no_sync (window,
                                           stack->n_positions - 1);
   window->stack_position = -1;
+  window->stack_index = -1;
   stack->n_positions -= 1;
+  g_ptr_array_set_size (stack->positions, stack->n_positions);
 
   /* We don't know if it's been moved from "added" to "stack" yet */
   stack->added = g_list_remove (stack->added, window);
-  stack->sorted = g_list_remove (stack->sorted, window);
+  if (g_ptr_array_remove (stack->sorted, window))
+    stack->need_resort = TRUE; /* to renumber the windows after it */
 
   /* Remember the window ID to remove it from the stack array.
    * The macro is safe to use: Window is guaranteed to be 32 bits, and
@@ -177,16 +192,16 @@ void
 meta_stack_raise (MetaStack  *stack,
                   MetaWindow *window)
 {
-  GList *l;
+  guint i;
   int max_stack_position = window->stack_position;
   MetaWorkspace *workspace;
 
   stack_ensure_sorted (stack);
 
   workspace = meta_window_get_workspace (window);
-  for (l = stack->sorted; l; l = l->next)
+  for (i = 0; i < stack->sorted->len; i++)
     {
-      MetaWindow *w = (MetaWindow *) l->data;
+      MetaWindow *w = g_ptr_array_index (stack->sorted, i);
       if (meta_window_located_on_workspace (w, workspace) &&
           w->stack_position > max_stack_position)
         max_stack_position = w->stack_position;
@@ -204,16 +219,16 @@ void
 meta_stack_lower (MetaStack  *stack,
                   MetaWindow *window)
 {
-  GList *l;
+  guint i;
   int min_stack_position = window->stack_position;
   MetaWorkspace *workspace;
 
   stack_ensure_sorted (stack);
 
   workspace = meta_window_get_workspace (window);
-  for (l = stack->sorted; l; l = l->next)
+  for (i = 0; i < stack->sorted->len; i++)
     {
-      MetaWindow *w = (MetaWindow *) l->data;
+      MetaWindow *w = g_ptr_array_index (stack->sorted, i);
       if (meta_window_located_on_workspace (w, workspace) &&
           w->stack_position < min_stack_position)
         min_stack_position = w->stack_position;
@@ -403,11 +418,11 @@ compute_layer (MetaWindow *window)
  * so the lower stack position is later in the list
  */
 static int
-compare_window_position (void *a,
-                         void *b)
+compare_window_position (gconstpointer a,
+                         gconstpointer b)
 {
-  MetaWindow *window_a = a;
-  MetaWindow *window_b = b;
+  const MetaWindow *window_a = a;
+  const MetaWindow *window_b = b;
 
   /* Go by layer, then stack_position */
   if (window_a->layer < window_b->layer)
@@ -457,88 +472,35 @@ compare_window_position (void *a,
  * that they appear, we will apply them correctly. Note that the
  * graph MAY have cycles, so we have to guard against that.
  *
+ * The graph itself is kept in stack->constraints; see stack-order.c.
  */
 
-typedef struct Constraint Constraint;
-
-struct Constraint
-{
-  MetaWindow *above;
-  MetaWindow *below;
-
-  /* used to keep the constraint in the
-   * list of constraints for window "below"
-   */
-  Constraint *next;
-
-  /* used to create the graph. */
-  GSList *next_nodes;
-
-  /* constraint has been applied, used
-   * to detect cycles.
-   */
-  unsigned int applied : 1;
-
-  /* constraint has a previous node in the graph,
-   * used to find places to start in the graph.
-   * (I think this also has the side effect
-   * of preventing cycles, since cycles will
-   * have no starting point - so maybe
-   * the "applied" flag isn't needed.)
-   */
-  unsigned int has_prev : 1;
-};
-
-/* We index the array of constraints by window
- * stack positions, just because the stack
- * positions are a convenient index.
- */
 static void
-add_constraint (Constraint **constraints,
-                MetaWindow  *above,
-                MetaWindow  *below)
+add_constraint (MetaStackConstraints *constraints,
+                MetaWindow           *above,
+                MetaWindow           *below)
 {
-  Constraint *c;
-
   g_assert (above->screen == below->screen);
 
-  /* check if constraint is a duplicate */
-  c = constraints[below->stack_position];
-  while (c != NULL)
-    {
-      if (c->above == above)
-        return;
-      c = c->next;
-    }
-
-  /* if not, add the constraint */
-  c = g_new (Constraint, 1);
-  c->above = above;
-  c->below = below;
-  c->next = constraints[below->stack_position];
-  c->next_nodes = NULL;
-  c->applied = FALSE;
-  c->has_prev = FALSE;
-
-  constraints[below->stack_position] = c;
+  meta_stack_constraints_add (constraints,
+                              above, above->stack_position,
+                              below, below->stack_position);
 }
 
 static void
-create_constraints (Constraint **constraints,
-                    GList       *windows)
+create_constraints (MetaStackConstraints *constraints,
+                    GPtrArray            *windows)
 {
-  GList *tmp;
+  guint i;
 
-  tmp = windows;
-  while (tmp != NULL)
+  for (i = 0; i < windows->len; i++)
     {
-      MetaWindow *w = tmp->data;
+      MetaWindow *w = g_ptr_array_index (windows, i);
 
       if (!WINDOW_IN_STACK (w))
         {
           meta_topic (META_DEBUG_STACK, "Window %s not in the stack, not constraining it\n",
                       w->desc);
-          tmp = tmp->next;
           continue;
         }
 
@@ -606,85 +568,17 @@ create_constraints (Constraint **constraints,
               add_constraint (constraints, w, parent);
             }
         }
-
-      tmp = tmp->next;
     }
 }
 
 static void
-graph_constraints (Constraint **constraints,
-                   int          n_constraints)
+ensure_above (gpointer data_above,
+              gpointer data_below,
+              gpointer user_data)
 {
-  int i;
+  MetaWindow *above = data_above;
+  MetaWindow *below = data_below;
 
-  i = 0;
-  while (i < n_constraints)
-    {
-      Constraint *c;
-
-      /* If we have "A below B" and "B below C" then AB -> BC so we
-       * add BC to next_nodes in AB.
-       */
-
-      c = constraints[i];
-      while (c != NULL)
-        {
-          Constraint *n;
-
-          g_assert (c->below->stack_position == i);
-
-          /* Constraints where ->above is below are our
-           * next_nodes and we are their previous
-           */
-          n = constraints[c->above->stack_position];
-          while (n != NULL)
-            {
-              c->next_nodes = g_slist_prepend (c->next_nodes,
-                                               n);
-              /* c is a previous node of n */
-              n->has_prev = TRUE;
-
-              n = n->next;
-            }
-
-          c = c->next;
-        }
-
-      ++i;
-    }
-}
-
-static void
-free_constraints (Constraint **constraints,
-                  int          n_constraints)
-{
-  int i;
-
-  i = 0;
-  while (i < n_constraints)
-    {
-      Constraint *c;
-
-      c = constraints[i];
-      while (c != NULL)
-        {
-          Constraint *next = c->next;
-
-          g_slist_free (c->next_nodes);
-
-          g_free (c);
-
-          c = next;
-        }
-
-      ++i;
-    }
-}
-
-static void
-ensure_above (MetaWindow *above,
-              MetaWindow *below)
-{
   if (WINDOW_HAS_TRANSIENT_TYPE(above) &&
       above->layer < below->layer)
     {
@@ -692,6 +586,8 @@ ensure_above (MetaWindow *above,
                   "Promoting window %s from layer %u to %u due to contraint\n",
                   above->desc, above->layer, below->layer);
       above->layer = below->layer;
+      above->stack_index = -1;
+      above->screen->stack->need_resort = TRUE;
     }
 
   if (above->stack_position < below->stack_position)
@@ -705,67 +601,6 @@ ensure_above (MetaWindow *above,
               below->desc, below->stack_position);
 }
 
-static void
-traverse_constraint (Constraint *c)
-{
-  GSList *tmp;
-
-  if (c->applied)
-    return;
-
-  ensure_above (c->above, c->below);
-  c->applied = TRUE;
-
-  tmp = c->next_nodes;
-  while (tmp != NULL)
-    {
-      traverse_constraint (tmp->data);
-
-      tmp = tmp->next;
-    }
-}
-
-static void
-apply_constraints (Constraint **constraints,
-                   int          n_constraints)
-{
-  GSList *heads;
-  GSList *tmp;
-  int i;
-
-  /* List all heads in an ordered constraint chain */
-  heads = NULL;
-  i = 0;
-  while (i < n_constraints)
-    {
-      Constraint *c;
-
-      c = constraints[i];
-      while (c != NULL)
-        {
-          if (!c->has_prev)
-            heads = g_slist_prepend (heads, c);
-
-          c = c->next;
-        }
-
-      ++i;
-    }
-
-  /* Now traverse the chain and apply constraints */
-  tmp = heads;
-  while (tmp != NULL)
-    {
-      Constraint *c = tmp->data;
-
-      traverse_constraint (c);
-
-      tmp = tmp->next;
-    }
-
-  g_slist_free (heads);
-}
-
 /**
  * Go through "deleted" and take the matching windows
  * out of "windows".
@@ -850,14 +685,14 @@ stack_do_window_additions (MetaStack *stack)
 
           end[i] = w->xwindow;
 
-          /* add to the main list */
-          stack->sorted = g_list_prepend (stack->sorted, w);
+          /* add to the main list; stack_do_resort() puts it in place */
+          g_ptr_array_add (stack->sorted, w);
 
           ++i;
           tmp = tmp->next;
         }
 
-      stack->need_resort = TRUE; /* may not be needed as we add to top */
+      stack->need_resort = TRUE;
       stack->need_constrain = TRUE;
       stack->need_relayer = TRUE;
     }
@@ -872,7 +707,7 @@ stack_do_window_additions (MetaStack *stack)
 static void
 stack_do_relayer (MetaStack *stack)
 {
-  GList *tmp;
+  guint i;
 
   if (!stack->need_relayer)
       return;
@@ -880,14 +715,12 @@ stack_do_relayer (MetaStack *stack)
   meta_topic (META_DEBUG_STACK,
               "Recomputing layers\n");
 
-  tmp = stack->sorted;
-
-  while (tmp != NULL)
+  for (i = 0; i < stack->sorted->len; i++)
     {
       MetaWindow *w;
       MetaStackLayer old_layer;
 
-      w = tmp->data;
+      w = g_ptr_array_index (stack->sorted, i);
       old_layer = w->layer;
 
       compute_layer (w);
@@ -898,6 +731,7 @@ stack_do_relayer (MetaStack *stack)
                       "Window %s moved from layer %u to %u\n",
                       w->desc, old_layer, w->layer);
 
+          w->stack_index = -1;
           stack->need_resort = TRUE;
           stack->need_constrain = TRUE;
           /* don't need to constrain as constraining
@@ -905,8 +739,6 @@ stack_do_relayer (MetaStack *stack)
            * not layer
            */
         }
-
-      tmp = tmp->next;
     }
 
   stack->need_relayer = FALSE;
@@ -919,45 +751,61 @@ stack_do_relayer (MetaStack *stack)
 static void
 stack_do_constrain (MetaStack *stack)
 {
-  Constraint **constraints;
-
-  /* It'd be nice if this were all faster, probably */
+  int n_constraints;
 
   if (!stack->need_constrain)
     return;
 
-  meta_topic (META_DEBUG_STACK,
-              "Reapplying constraints\n");
+  meta_stack_constraints_begin (stack->constraints, stack->n_positions);
 
-  constraints = g_new0 (Constraint*,
-                        stack->n_positions);
+  create_constraints (stack->constraints, stack->sorted);
 
-  create_constraints (constraints, stack->sorted);
+  n_constraints = meta_stack_constraints_apply (stack->constraints,
+                                                ensure_above, NULL);
 
-  graph_constraints (constraints, stack->n_positions);
+  meta_topic (META_DEBUG_STACK,
+              "Reapplied %d constraints\n", n_constraints);
 
-  apply_constraints (constraints, stack->n_positions);
+  stack->need_constrain = FALSE;
+}
 
-  free_constraints (constraints, stack->n_positions);
-  g_free (constraints);
+static gboolean
+window_moved (gconstpointer item)
+{
+  const MetaWindow *window = item;
 
-  stack->need_constrain = FALSE;
+  return WINDOW_MOVED (window);
 }
 
 /**
  * Sort stack->sorted with layers having priority over stack_position.
+ *
+ * Only the windows that moved are put back in place; everything else
+ * keeps its order, since changing one window's layer or stack_position
+ * never changes how the other windows compare to each other.
  */
 static void
 stack_do_resort (MetaStack *stack)
 {
+  int n_moved;
+  guint i;
+
   if (!stack->need_resort)
     return;
 
+  n_moved = meta_stack_order_resort (stack->sorted, window_moved,
+                                     compare_window_position);
+
   meta_topic (META_DEBUG_STACK,
-              "Sorting stack list\n");
+              "Sorted %d moved windows into the stack of %u\n",
+              n_moved, stack->sorted->len);
 
-  stack->sorted = g_list_sort (stack->sorted,
-                               (GCompareFunc) compare_window_position);
+  for (i = 0; i < stack->sorted->len; i++)
+    {
+      MetaWindow *w = g_ptr_array_index (stack->sorted, i);
+
+      w->stack_index = i;
+    }
 
   stack->need_resort = FALSE;
 }
@@ -997,7 +845,7 @@ stack_sync_to_xserver (MetaStack *stack)
 {
   GArray *stacked;
   GArray *root_children_stacked;
-  GList *tmp;
+  int i;
 
   /* Bail out if frozen */
   if (stack->freeze_count > 0)
@@ -1014,11 +862,11 @@ stack_sync_to_xserver (MetaStack *stack)
   meta_topic (META_DEBUG_STACK, "Top to bottom: ");
   meta_push_no_msg_prefix ();
 
-  for (tmp = g_list_last (stack->sorted); tmp != NULL; tmp = tmp->prev)
+  for (i = (int) stack->sorted->len - 1; i >= 0; i--)
     {
       MetaWindow *w;
 
-      w = tmp->data;
+      w = g_ptr_array_index (stack->sorted, i);
 
       if (w->unmanaging)
         continue;
@@ -1067,13 +915,37 @@ stack_sync_to_xserver (MetaStack *stack)
   g_array_free (root_children_stacked, TRUE);
 }
 
+/* Only valid once the stack is sorted */
+static gboolean
+stack_contains (MetaStack  *stack,
+                MetaWindow *window)
+{
+  return window->stack_index >= 0 &&
+         window->stack_index < (int) stack->sorted->len &&
+         g_ptr_array_index (stack->sorted, window->stack_index) == window;
+}
+
+/* A copy of stack->sorted, top window first */
+static GList*
+stack_copy_sorted (MetaStack *stack)
+{
+  GList *list;
+  int i;
+
+  list = NULL;
+  for (i = (int) stack->sorted->len - 1; i >= 0; i--)
+    list = g_list_prepend (list, g_ptr_array_index (stack->sorted, i));
+
+  return list;
+}
+
 MetaWindow*
 meta_stack_get_top (MetaStack *stack)
 {
   stack_ensure_sorted (stack);
 
-  if (stack->sorted)
-    return stack->sorted->data;
+  if (stack->sorted->len > 0)
+    return g_ptr_array_index (stack->sorted, 0);
   else
     return NULL;
 }
@@ -1081,13 +953,10 @@ meta_stack_get_top (MetaStack *stack)
 MetaWindow*
 meta_stack_get_bottom (MetaStack  *stack)
 {
-  GList *link;
-
   stack_ensure_sorted (stack);
 
-  link = g_list_last (stack->sorted);
-  if (link != NULL)
-    return link->data;
+  if (stack->sorted->len > 0)
+    return g_ptr_array_index (stack->sorted, stack->sorted->len - 1);
   else
     return NULL;
 }
@@ -1097,18 +966,16 @@ meta_stack_get_above (MetaStack      *stack,
                       MetaWindow     *window,
                       gboolean        only_within_layer)
 {
-  GList *link;
   MetaWindow *above;
 
   stack_ensure_sorted (stack);
 
-  link = g_list_find (stack->sorted, window);
-  if (link == NULL)
+  if (!stack_contains (stack, window))
     return NULL;
-  if (link->prev == NULL)
+  if (window->stack_index == 0)
     return NULL;
 
-  above = link->prev->data;
+  above = g_ptr_array_index (stack->sorted, window->stack_index - 1);
 
   if (only_within_layer &&
       above->layer != window->layer)
@@ -1122,19 +989,16 @@ meta_stack_get_below (MetaStack      *stack,
                       MetaWindow     *window,
                       gboolean        only_within_layer)
 {
-  GList *link;
   MetaWindow *below;
 
   stack_ensure_sorted (stack);
 
-  link = g_list_find (stack->sorted, window);
-
-  if (link == NULL)
+  if (!stack_contains (stack, window))
     return NULL;
-  if (link->next == NULL)
+  if (window->stack_index + 1 == (int) stack->sorted->len)
     return NULL;
 
-  below = link->next->data;
+  below = g_ptr_array_index (stack->sorted, window->stack_index + 1);
 
   if (only_within_layer &&
       below->layer != window->layer)
@@ -1222,7 +1086,7 @@ get_default_focus_window (MetaStack     *stack,
 
   stack_ensure_sorted (stack);
 
-  tmp = g_list_copy (stack->sorted);
+  tmp = stack_copy_sorted (stack);
   tmp = g_list_sort (tmp, compare_default_focus_window_func);
 
   for (l = tmp; l != NULL; l = l->next)
@@ -1303,15 +1167,13 @@ meta_stack_list_windows (MetaStack     *stack,
                          MetaWorkspace *workspace)
 {
   GList *workspace_windows = NULL;
-  GList *link;
+  guint i;
 
   stack_ensure_sorted (stack); /* do adds/removes */
 
-  link = stack->sorted;
-
-  while (link)
+  for (i = 0; i < stack->sorted->len; i++)
     {
-      MetaWindow *window = link->data;
+      MetaWindow *window = g_ptr_array_index (stack->sorted, i);
 
       if (window &&
           (workspace == NULL || meta_window_located_on_workspace (window, workspace)))
@@ -1319,8 +1181,6 @@ meta_stack_list_windows (MetaStack     *stack,
           workspace_windows = g_list_prepend (workspace_windows,
                                               window);
         }
-
-      link = link->next;
     }
 
   return workspace_windows;
@@ -1349,31 +1209,18 @@ meta_stack_windows_cmp  (MetaStack  *stack,
     return 0; /* not reached */
 }
 
-static int
-compare_just_window_stack_position (void *a,
-                                    void *b)
-{
-  MetaWindow *window_a = a;
-  MetaWindow *window_b = b;
-
-  if (window_a->stack_position < window_b->stack_position)
-    return -1; /* move window_a earlier in list */
-  else if (window_a->stack_position > window_b->stack_position)
-    return 1;
-  else
-    return 0; /* not reached */
-}
-
 GList*
 meta_stack_get_positions (MetaStack *stack)
 {
   GList *tmp;
+  int i;
 
   /* Make sure to handle any adds or removes */
   stack_ensure_sorted (stack);
 
-  tmp = g_list_copy (stack->sorted);
-  tmp = g_list_sort (tmp, (GCompareFunc) compare_just_window_stack_position);
+  tmp = NULL;
+  for (i = stack->n_positions - 1; i >= 0; i--)
+    tmp = g_list_prepend (tmp, g_ptr_array_index (stack->positions, i));
 
   return tmp;
 }
@@ -1421,20 +1268,23 @@ meta_stack_set_positions (MetaStack *stack,
 {
   int i;
   GList *tmp;
+  GList *sorted;
+  gboolean same_windows;
 
   /* Make sure any adds or removes aren't in limbo -- is this needed? */
   stack_ensure_sorted (stack);
 
-  if (!lists_contain_same_windows (windows, stack->sorted))
+  sorted = stack_copy_sorted (stack);
+  same_windows = lists_contain_same_windows (windows, sorted);
+  g_list_free (sorted);
+
+  if (!same_windows)
     {
       g_warning ("This list of windows has somehow changed; not resetting "
                  "positions of the windows.");
       return;
     }
 
-  g_list_free (stack->sorted);
-  stack->sorted = g_list_copy (windows);
-
   stack->need_resort = TRUE;
   stack->need_constrain = TRUE;
 
@@ -1443,7 +1293,10 @@ meta_stack_set_positions (MetaStack *stack,
   while (tmp != NULL)
     {
       MetaWindow *w = tmp->data;
-      w->stack_position = i++;
+      w->stack_position = i;
+      w->stack_index = -1;
+      g_ptr_array_index (stack->positions, i) = w;
+      i++;
       tmp = tmp->next;
     }
 
@@ -1457,8 +1310,9 @@ void
 meta_window_set_stack_position_no_sync (MetaWindow *window,
                                         int         position)
 {
-  int low, high, delta;
-  GList *tmp;
+  MetaStack *stack;
+  MetaWindow **positions;
+  int i;
 
   g_return_if_fail (window->screen->stack != NULL);
   g_return_if_fail (window->stack_position >= 0);
@@ -1472,35 +1326,35 @@ meta_window_set_stack_position_no_sync (MetaWindow *window,
       return;
     }
 
-  window->screen->stack->need_resort = TRUE;
-  window->screen->stack->need_constrain = TRUE;
+  stack = window->screen->stack;
+  stack->need_resort = TRUE;
+  stack->need_constrain = TRUE;
+
+  /* Shift the windows between the old and new position by one towards
+   * the old position; their order among themselves is unchanged.
+   */
+  positions = (MetaWindow **) stack->positions->pdata;
 
   if (position < window->stack_position)
     {
-      low = position;
-      high = window->stack_position - 1;
-      delta = 1;
+      for (i = window->stack_position; i > position; i--)
+        {
+          positions[i] = positions[i - 1];
+          positions[i]->stack_position = i;
+        }
     }
   else
     {
-      low = window->stack_position + 1;
-      high = position;
-      delta = -1;
-    }
-
-  tmp = window->screen->stack->sorted;
-  while (tmp != NULL)
-    {
-      MetaWindow *w = tmp->data;
-
-      if (w->stack_position >= low &&
-          w->stack_position <= high)
-        w->stack_position += delta;
-
-      tmp = tmp->next;
+      for (i = window->stack_position; i < position; i++)
+        {
+          positions[i] = positions[i + 1];
+          positions[i]->stack_position = i;
+        }
     }
 
+  positions[position] = window;
   window->stack_position = position;
+  window->stack_index = -1;
 
   meta_topic (META_DEBUG_STACK,
               "Window %s had stack_position set to %d\n",
@@ -40,6 +40,7 @@
 #define META_STACK_H
 
 #include "screen-private.h"
+#include "stack-order.h"
 
 /**
  * Layers a window can be in.
@@ -75,8 +76,22 @@ struct _MetaStack
    */
   GArray *xwindows;
 
-  /** The MetaWindows of the windows we manage, sorted in order. */
-  GList *sorted;
+  /**
+   * The MetaWindows of the windows we manage, sorted in order, top window
+   * first. Each window's stack_index is its index here.
+   */
+  GPtrArray *sorted;
+
+  /**
+   * The same windows, and those in "added", indexed by stack_position.
+   */
+  GPtrArray *positions;
+
+  /**
+   * The transiency constraints between the windows, rebuilt in the
+   * same storage each time they are reapplied.
+   */
+  MetaStackConstraints *constraints;
 
   /**
    * MetaWindows waiting to be added to the "sorted" and "windows" list, after
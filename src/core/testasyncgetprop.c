@@ -239,6 +239,9 @@ try_get_reply (Display           *xdisplay,
 
 static void run_speed_comparison (Display *xdisplay,
                                   Window   window);
+static void run_stress_test      (Display *xdisplay,
+                                  Window   window,
+                                  int      n_requests);
 
 int
 main (int argc, char **argv)
@@ -252,6 +255,31 @@ main (int argc, char **argv)
   char *end;
   Atom *props;
   struct timeval current_time;
+  int n_stress;
+
+  /* --stress [N] issues N requests (default 100000) with thousands in
+   * flight at a time and only reports the throughput
+   */
+  n_stress = 0;
+  if (argc > 1 && strcmp (argv[1], "--stress") == 0)
+    {
+      n_stress = 100000;
+      argv += 1;
+      argc -= 1;
+
+      if (argc > 2)
+        {
+          n_stress = atoi (argv[1]);
+          argv += 1;
+          argc -= 1;
+        }
+
+      if (n_stress <= 0)
+        {
+          fprintf (stderr, "number of requests must be positive\n");
+          return 1;
+        }
+    }
 
   if (argc < 2)
     {
@@ -281,6 +309,12 @@ main (int argc, char **argv)
 
   XSetErrorHandler (x_error_handler);
 
+  if (n_stress > 0)
+    {
+      run_stress_test (xdisplay, window, n_stress);
+      return 0;
+    }
+
   n_props = 0;
   props = XListProperties (xdisplay, window, &n_props);
   if (n_props == 0 || props == NULL)
@@ -494,3 +528,119 @@ run_speed_comparison (Display *xdisplay,
   printf ("Sync time:  %gms\n",
           ELAPSED (start, end));
 }
+
+/* Keeps this many requests in flight, sending more as replies come in,
+ * so that the pending ring fills up, wraps around and grows
+ */
+#define STRESS_IN_FLIGHT 5000
+
+static void
+run_stress_test (Display *xdisplay,
+                 Window   window,
+                 int      n_requests)
+{
+  struct timeval start, end;
+  unsigned long in_order;
+  unsigned long out_of_order;
+  double elapsed;
+  Atom *props;
+  int n_props;
+  int n_sent;
+  int n_left;
+
+  /* Cycle through properties that exist, so that we time replies
+   * rather than BadAtom errors
+   */
+  n_props = 0;
+  props = XListProperties (xdisplay, window, &n_props);
+  if (n_props == 0 || props == NULL)
+    {
+      fprintf (stderr, "Window has no properties\n");
+      exit (1);
+    }
+
+  printf ("Stress test with %d property requests, up to %d in flight\n",
+          n_requests, STRESS_IN_FLIGHT);
+
+  gettimeofday (&start, NULL);
+
+  n_sent = 0;
+  n_left = n_requests;
+
+  while (n_left > 0)
+    {
+      int connection;
+      fd_set set;
+      XEvent xevent;
+      AgGetPropertyTask *task;
+
+      while (n_sent < n_requests &&
+             n_sent - (n_requests - n_left) < STRESS_IN_FLIGHT)
+        {
+          if (ag_task_create (xdisplay,
+                              window, props[n_sent % n_props],
+                              0, 0xffffffff,
+                              False,
+                              AnyPropertyType) == NULL)
+            {
+              fprintf (stderr, "Failed to send request\n");
+              exit (1);
+            }
+
+          ++n_sent;
+        }
+
+      XFlush (xdisplay);
+
+      /* Mop up event queue */
+      while (XPending (xdisplay) > 0)
+        XNextEvent (xdisplay, &xevent);
+
+      while ((task = ag_get_next_completed_task (xdisplay)))
+        {
+          Atom actual_type;
+          int actual_format;
+          unsigned long n_items;
+          unsigned long bytes_after;
+          unsigned char *data;
+
+          assert (ag_task_have_reply (task));
+
+          data = NULL;
+          ag_task_get_reply_and_free (task,
+                                      &actual_type,
+                                      &actual_format,
+                                      &n_items,
+                                      &bytes_after,
+                                      &data);
+
+          if (data)
+            XFree (data);
+
+          n_left -= 1;
+        }
+
+      if (n_left == 0)
+        break;
+
+      /* Wake up if we may have a reply */
+      connection = ConnectionNumber (xdisplay);
+
+      FD_ZERO (&set);
+      FD_SET (connection, &set);
+
+      select (connection + 1, &set, NULL, NULL, NULL);
+    }
+
+  gettimeofday (&end, NULL);
+
+  XFree (props);
+
+  elapsed = ELAPSED (start, end);
+  ag_get_reply_stats (&in_order, &out_of_order);
+
+  printf ("Time: %gms, %.0f requests/s\n",
+          elapsed, n_requests / (elapsed / 1000.0));
+  printf ("Replies in order: %lu, out of order: %lu\n",
+          in_order, out_of_order);
+}
@@ -23,10 +23,12 @@
 #include <glib.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <X11/Xutil.h> /* Just for the definition of the various gravities */
 #include <time.h>      /* To initialize random seed */
 
 #define NUM_RANDOM_RUNS 10000
+#define NUM_BENCHMARK_RUNS 200
 
 static GRand *grand = NULL;
 
@@ -1407,11 +1409,480 @@ test_find_closest_point_to_line (void)
   printf ("%s passed.\n", G_STRFUNC);
 }
 
+/* What meta_rectangle_get_minimal_spanning_set_for_region() used to do,
+ * with every rectangle in its own allocation and the merge done on a
+ * linked list
+ */
+static GList*
+reference_merge_spanning_rects (GList *region)
+{
+  GList* compare;
+  compare = region;
+
+  if (region == NULL)
+    {
+      g_warning ("Region to merge was empty!  Either you have a some "
+                 "pathological STRUT list or there's a bug somewhere!");
+
+      return NULL;
+    }
+
+  while (compare && compare->next)
+    {
+      MetaRectangle *a = compare->data;
+      GList *other = compare->next;
+
+      g_assert (a->width > 0 && a->height > 0);
+
+      while (other)
+        {
+          MetaRectangle *b = other->data;
+          GList *delete_me = NULL;
+
+          g_assert (b->width > 0 && b->height > 0);
+
+          /* If a contains b, just remove b */
+          if (meta_rectangle_contains_rect (a, b))
+            {
+              delete_me = other;
+            }
+          /* If b contains a, just remove a */
+          else if (meta_rectangle_contains_rect (b, a))
+            {
+              delete_me = compare;
+            }
+          /* If a and b might be mergeable horizontally */
+          else if (a->y == b->y && a->height == b->height)
+            {
+              /* If a and b overlap */
+              if (meta_rectangle_overlap (a, b))
+                {
+                  int new_x = MIN (a->x, b->x);
+                  a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
+                  a->x = new_x;
+                  delete_me = other;
+                }
+              /* If a and b are adjacent */
+              else if (a->x + a->width == b->x || a->x == b->x + b->width)
+                {
+                  int new_x = MIN (a->x, b->x);
+                  a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
+                  a->x = new_x;
+                  delete_me = other;
+                }
+            }
+          /* If a and b might be mergeable vertically */
+          else if (a->x == b->x && a->width == b->width)
+            {
+              /* If a and b overlap */
+              if (meta_rectangle_overlap (a, b))
+                {
+                  int new_y = MIN (a->y, b->y);
+                  a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
+                  a->y = new_y;
+                  delete_me = other;
+                }
+              /* If a and b are adjacent */
+              else if (a->y + a->height == b->y || a->y == b->y + b->height)
+                {
+                  int new_y = MIN (a->y, b->y);
+                  a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
+                  a->y = new_y;
+                  delete_me = other;
+                }
+            }
+
+          other = other->next;
+
+          /* Delete any rectangle in the list that is no longer wanted */
+          if (delete_me != NULL)
+            {
+              /* Deleting the rect we compare others to is a little tricker */
+              if (compare == delete_me)
+                {
+                  compare = compare->next;
+                  other = compare->next;
+                  a = compare->data;
+                }
+
+              /* Okay, we can free it now */
+              g_free (delete_me->data);
+              region = g_list_delete_link (region, delete_me);
+            }
+
+        }
+
+      compare = compare->next;
+    }
+
+  return region;
+}
+
+static gint
+reference_compare_rect_areas (gconstpointer a, gconstpointer b)
+{
+  const MetaRectangle *a_rect = (gconstpointer) a;
+  const MetaRectangle *b_rect = (gconstpointer) b;
+
+  int a_area = meta_rectangle_area (a_rect);
+  int b_area = meta_rectangle_area (b_rect);
+
+  return b_area - a_area; /* positive ret value denotes b > a, ... */
+}
+
+static GList*
+reference_get_minimal_spanning_set (const MetaRectangle *basic_rect,
+                                    const GSList        *all_struts,
+                                    gboolean             skip_middle_struts)
+{
+  GList         *ret;
+  GList         *tmp_list;
+  const GSList  *strut_iter;
+  MetaRectangle *temp_rect;
+
+  /* The algorithm is basically as follows:
+   *   Initialize rectangle_set to basic_rect
+   *   Foreach strut:
+   *     Foreach rectangle in rectangle_set:
+   *       - Split the rectangle into new rectangles that don't overlap the
+   *         strut (but which are as big as possible otherwise)
+   *       - Remove the old (pre-split) rectangle from the rectangle_set,
+   *         and replace it with the new rectangles generated from the
+   *         splitting
+   */
+
+  temp_rect = g_new (MetaRectangle, 1);
+  *temp_rect = *basic_rect;
+  ret = g_list_prepend (NULL, temp_rect);
+
+  strut_iter = all_struts;
+  for (strut_iter = all_struts; strut_iter; strut_iter = strut_iter->next)
+    {
+      GList *rect_iter;
+      MetaStrut *strut = (MetaStrut *) strut_iter->data;
+      MetaRectangle *strut_rect = &strut->rect;
+
+      if (skip_middle_struts && strut->edge == META_EDGE_MONITOR)
+        {
+          if ((strut->side == META_SIDE_LEFT &&
+               strut_rect->x != basic_rect->x) ||
+              (strut->side == META_SIDE_RIGHT &&
+               strut_rect->x + strut_rect->width != basic_rect->width) ||
+              (strut->side == META_SIDE_TOP &&
+               strut_rect->y != basic_rect->y) ||
+              (strut->side == META_SIDE_BOTTOM &&
+               strut_rect->y + strut_rect->height != basic_rect->height))
+            {
+              continue;
+            }
+        }
+
+      tmp_list = ret;
+      ret = NULL;
+      rect_iter = tmp_list;
+      while (rect_iter)
+        {
+          MetaRectangle *rect = (MetaRectangle*) rect_iter->data;
+          if (!meta_rectangle_overlap (rect, strut_rect))
+            ret = g_list_prepend (ret, rect);
+          else
+            {
+              /* If there is area in rect left of strut */
+              if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
+                {
+                  temp_rect = g_new (MetaRectangle, 1);
+                  *temp_rect = *rect;
+                  temp_rect->width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
+                  ret = g_list_prepend (ret, temp_rect);
+                }
+              /* If there is area in rect right of strut */
+              if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
+                {
+                  int new_x;
+                  temp_rect = g_new (MetaRectangle, 1);
+                  *temp_rect = *rect;
+                  new_x = BOX_RIGHT (*strut_rect);
+                  temp_rect->width = BOX_RIGHT(*rect) - new_x;
+                  temp_rect->x = new_x;
+                  ret = g_list_prepend (ret, temp_rect);
+                }
+              /* If there is area in rect above strut */
+              if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
+                {
+                  temp_rect = g_new (MetaRectangle, 1);
+                  *temp_rect = *rect;
+                  temp_rect->height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
+                  ret = g_list_prepend (ret, temp_rect);
+                }
+              /* If there is area in rect below strut */
+              if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
+                {
+                  int new_y;
+                  temp_rect = g_new (MetaRectangle, 1);
+                  *temp_rect = *rect;
+                  new_y = BOX_BOTTOM (*strut_rect);
+                  temp_rect->height = BOX_BOTTOM (*rect) - new_y;
+                  temp_rect->y = new_y;
+                  ret = g_list_prepend (ret, temp_rect);
+                }
+              g_free (rect);
+            }
+          rect_iter = rect_iter->next;
+        }
+      g_list_free (tmp_list);
+    }
+
+  /* Sort by maximal area, just because I feel like it... */
+  ret = g_list_sort (ret, reference_compare_rect_areas);
+
+  /* Merge rectangles if possible so that the list really is minimal */
+  ret = reference_merge_spanning_rects (ret);
+
+  return ret;
+}
+
+
+static void
+test_spanning_set_matches_old (void)
+{
+  const MetaSide sides[] = {
+    META_SIDE_LEFT, META_SIDE_RIGHT, META_SIDE_TOP, META_SIDE_BOTTOM
+  };
+  MetaRectangle screen_rect;
+  int i;
+
+  screen_rect = meta_rect (0, 0, 1600, 1200);
+
+  for (i = 0; i < NUM_RANDOM_RUNS / 10; i++)
+    {
+      GSList *struts;
+      GList *region;
+      GList *old_region;
+      int n_struts;
+      int j;
+
+      /* Narrow struts along the edges and in the middle, so that they
+       * never cover the whole screen
+       */
+      struts = NULL;
+      n_struts = g_rand_int_range (grand, 0, 12);
+      for (j = 0; j < n_struts; j++)
+        {
+          MetaStrut *strut;
+
+          strut = new_meta_strut (g_rand_int_range (grand, 0, 1500),
+                                  g_rand_int_range (grand, 0, 1100),
+                                  g_rand_int_range (grand, 1, 100),
+                                  g_rand_int_range (grand, 1, 100),
+                                  sides[g_rand_int_range (grand, 0, 4)]);
+          if (g_rand_int_range (grand, 0, 2))
+            strut->edge = META_EDGE_MONITOR;
+
+          struts = g_slist_prepend (struts, strut);
+        }
+
+      for (j = 0; j < 2; j++)
+        {
+          region = meta_rectangle_get_minimal_spanning_set_for_region (&screen_rect,
+                                                                       struts,
+                                                                       j);
+          old_region = reference_get_minimal_spanning_set (&screen_rect,
+                                                           struts,
+                                                           j);
+
+          verify_lists_are_equal (region, old_region);
+
+          g_list_free_full (region, g_free);
+          g_list_free_full (old_region, g_free);
+        }
+
+      free_strut_list (struts);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+run_benchmark (int n_monitors,
+               int n_struts_per_monitor)
+{
+  MetaRectangle screen_rect;
+  GList *monitors;
+  GSList *struts;
+  gint64 start_time;
+  double region_time;
+  double old_region_time;
+  double edges_time;
+  double monitor_edges_time;
+  int n_rects;
+  int i, j;
+
+  /* Monitors side by side, of alternating heights so that there are
+   * dead areas below the shorter ones; each one has a panel at the top
+   * and bottom, and the remaining struts are docks along its sides.
+   */
+  screen_rect = meta_rect (0, 0, n_monitors * 1920, 1200);
+  monitors = NULL;
+  struts = NULL;
+  for (i = 0; i < n_monitors; i++)
+    {
+      int x = i * 1920;
+      int height = i % 2 ? 1080 : 1200;
+
+      monitors = g_list_append (monitors, new_meta_rect (x, 0, 1920, height));
+
+      for (j = 0; j < n_struts_per_monitor; j++)
+        {
+          int offset = (j / 4) * 30;
+
+          switch (j % 4)
+            {
+            case 0:
+              struts = g_slist_prepend (struts,
+                new_meta_strut (x, offset, 1920, 30, META_DIRECTION_TOP));
+              break;
+            case 1:
+              struts = g_slist_prepend (struts,
+                new_meta_strut (x, height - offset - 30, 1920, 30,
+                                META_DIRECTION_BOTTOM));
+              break;
+            case 2:
+              struts = g_slist_prepend (struts,
+                new_meta_strut (x + offset, 200, 60, 600, META_DIRECTION_LEFT));
+              break;
+            case 3:
+              struts = g_slist_prepend (struts,
+                new_meta_strut (x + 1920 - offset - 60, 300, 60, 500,
+                                META_DIRECTION_RIGHT));
+              break;
+            }
+        }
+    }
+
+  n_rects = 0;
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+    {
+      GList *region;
+
+      region = meta_rectangle_get_minimal_spanning_set_for_region (&screen_rect,
+                                                                   struts,
+                                                                   FALSE);
+      n_rects = g_list_length (region);
+      g_list_free_full (region, g_free);
+    }
+  region_time = (g_get_monotonic_time () - start_time) / (double) NUM_BENCHMARK_RUNS;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+    {
+      GList *region;
+
+      region = reference_get_minimal_spanning_set (&screen_rect, struts, FALSE);
+      g_list_free_full (region, g_free);
+    }
+  old_region_time = (g_get_monotonic_time () - start_time) / (double) NUM_BENCHMARK_RUNS;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+    g_list_free_full (meta_rectangle_find_onscreen_edges (&screen_rect, struts),
+                      g_free);
+  edges_time = (g_get_monotonic_time () - start_time) / (double) NUM_BENCHMARK_RUNS;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_BENCHMARK_RUNS; i++)
+    g_list_free_full (meta_rectangle_find_nonintersected_monitor_edges (&screen_rect,
+                                                                        monitors,
+                                                                        struts),
+                      g_free);
+  monitor_edges_time = (g_get_monotonic_time () - start_time) / (double) NUM_BENCHMARK_RUNS;
+
+  printf ("%d monitors, %3d struts: spanning set of %4d in %9.1f us"
+          " (old code %9.1f us), edges in %7.1f us, monitor edges in %7.1f us\n",
+          n_monitors, n_monitors * n_struts_per_monitor, n_rects,
+          region_time, old_region_time, edges_time, monitor_edges_time);
+
+  g_list_free_full (monitors, g_free);
+  free_strut_list (struts);
+}
+
+/* Finds the edges of n_windows random windows that aren't covered by the
+ * windows stacked above them, the way edge resistance does at the start
+ * of a grab
+ */
+static void
+run_window_edges_benchmark (int n_windows)
+{
+  MetaRectangle *windows;
+  gint64 start_time;
+  double edges_time;
+  int n_edges;
+  int i, run;
+
+  windows = g_new (MetaRectangle, n_windows);
+  for (i = 0; i < n_windows; i++)
+    windows[i] = meta_rect (g_rand_int_range (grand, 0, 1600),
+                            g_rand_int_range (grand, 0, 1000),
+                            g_rand_int_range (grand, 100, 800),
+                            g_rand_int_range (grand, 100, 600));
+
+  n_edges = 0;
+  start_time = g_get_monotonic_time ();
+  for (run = 0; run < NUM_BENCHMARK_RUNS; run++)
+    {
+      GSList *above;
+
+      n_edges = 0;
+      above = NULL;
+      for (i = 0; i < n_windows; i++)
+        {
+          GList *edges;
+
+          edges = NULL;
+          edges = g_list_prepend (edges,
+            new_screen_edge (windows[i].x, windows[i].y,
+                             0, windows[i].height, META_SIDE_RIGHT));
+          edges = g_list_prepend (edges,
+            new_screen_edge (BOX_RIGHT (windows[i]), windows[i].y,
+                             0, windows[i].height, META_SIDE_LEFT));
+          edges = g_list_prepend (edges,
+            new_screen_edge (windows[i].x, windows[i].y,
+                             windows[i].width, 0, META_SIDE_BOTTOM));
+          edges = g_list_prepend (edges,
+            new_screen_edge (windows[i].x, BOX_BOTTOM (windows[i]),
+                             windows[i].width, 0, META_SIDE_TOP));
+
+          edges = meta_rectangle_remove_intersections_with_boxes_from_edges (edges,
+                                                                             above);
+          n_edges += g_list_length (edges);
+          g_list_free_full (edges, g_free);
+
+          above = g_slist_prepend (above, &windows[i]);
+        }
+
+      g_slist_free (above);
+    }
+  edges_time = (g_get_monotonic_time () - start_time) / (double) NUM_BENCHMARK_RUNS;
+
+  printf ("%4d windows: %5d uncovered window edges in %9.1f us\n",
+          n_windows, n_edges, edges_time);
+
+  g_free (windows);
+}
+
 int
 main (int argc, char **argv)
 {
+  gboolean benchmark;
+
   grand = g_rand_new ();
 
+  /* --benchmark times the region and edge functions on multi-monitor
+   * layouts with growing numbers of struts, and finding window edges
+   * among growing numbers of windows
+   */
+  benchmark = argc > 1 && strcmp (argv[1], "--benchmark") == 0;
+
   test_area ();
   test_intersect ();
   test_equal ();
@@ -1432,9 +1903,24 @@ main (int argc, char **argv)
   /* And now the misfit functions that don't quite fit in anywhere else... */
   test_gravity_resize ();
   test_find_closest_point_to_line ();
+  test_spanning_set_matches_old ();
+
+  printf ("All tests passed.\n");
+
+  if (benchmark)
+    {
+      run_benchmark (4, 2);
+      run_benchmark (4, 8);
+      run_benchmark (6, 4);
+      run_benchmark (8, 8);
+
+      run_window_edges_benchmark (25);
+      run_window_edges_benchmark (50);
+      run_window_edges_benchmark (100);
+      run_window_edges_benchmark (200);
+    }
 
   g_rand_free (grand);
 
-  printf ("All tests passed.\n");
   return 0;
 }
@@ -0,0 +1,454 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity window edge cache testing program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "edge-cache.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>      /* To initialize random seed */
+
+#define NUM_RANDOM_RUNS 30
+#define NUM_RANDOM_ROUNDS 100
+#define NUM_BENCHMARK_WINDOWS 400
+#define NUM_BENCHMARK_GRABS 1000
+
+static GRand *grand = NULL;
+
+/* What edge-resistance.c takes from a MetaWindow, plus whether it is
+ * showing at all
+ */
+typedef struct
+{
+  MetaRectangle rect;
+  gboolean      is_dock;
+  gboolean      showing;
+} TestWindow;
+
+typedef struct
+{
+  TestWindow    *windows;
+  /* Bottom to top */
+  TestWindow   **stack;
+  int            n_windows;
+  MetaRectangle  screen_rect;
+} TestScreen;
+
+static MetaRectangle
+random_rect (const MetaRectangle *screen_rect)
+{
+  return meta_rect (g_rand_int_range (grand, -100, screen_rect->width),
+                    g_rand_int_range (grand, -50, screen_rect->height),
+                    g_rand_int_range (grand, 50, 850),
+                    g_rand_int_range (grand, 50, 650));
+}
+
+static TestScreen *
+screen_new (int n_windows)
+{
+  TestScreen *screen;
+  int i;
+
+  screen = g_new0 (TestScreen, 1);
+  screen->n_windows = n_windows;
+  screen->windows = g_new0 (TestWindow, n_windows);
+  screen->stack = g_new0 (TestWindow *, n_windows);
+  screen->screen_rect = meta_rect (0, 0, 1920, 1080);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      TestWindow *window = &screen->windows[i];
+
+      window->rect = random_rect (&screen->screen_rect);
+      window->is_dock = g_rand_int_range (grand, 0, 10) == 0;
+      window->showing = g_rand_int_range (grand, 0, 5) != 0;
+      screen->stack[i] = window;
+    }
+
+  return screen;
+}
+
+static void
+screen_free (TestScreen *screen)
+{
+  g_free (screen->stack);
+  g_free (screen->windows);
+  g_free (screen);
+}
+
+/* Moves a window to position in the stack */
+static void
+restack (TestScreen *screen,
+         TestWindow *window,
+         int         position)
+{
+  int i;
+
+  for (i = 0; screen->stack[i] != window; i++)
+    ;
+
+  if (position < i)
+    memmove (&screen->stack[position + 1], &screen->stack[position],
+             (i - position) * sizeof (TestWindow *));
+  else
+    memmove (&screen->stack[i], &screen->stack[i + 1],
+             (position - i) * sizeof (TestWindow *));
+
+  screen->stack[position] = window;
+}
+
+/* The kinds of things that happen to windows between two grabs */
+static void
+random_changes (TestScreen *screen)
+{
+  int n_changes;
+  int i;
+
+  n_changes = g_rand_int_range (grand, 0, 4);
+
+  for (i = 0; i < n_changes; i++)
+    {
+      TestWindow *window;
+
+      window = &screen->windows[g_rand_int_range (grand, 0, screen->n_windows)];
+
+      switch (g_rand_int_range (grand, 0, 6))
+        {
+        case 0:
+          window->rect.x += g_rand_int_range (grand, -100, 100);
+          break;
+        case 1:
+          window->rect = random_rect (&screen->screen_rect);
+          break;
+        case 2:
+          window->showing = !window->showing;
+          break;
+        case 3:
+          restack (screen, window, screen->n_windows - 1);
+          break;
+        case 4:
+          restack (screen, window,
+                   g_rand_int_range (grand, 0, screen->n_windows));
+          break;
+        case 5:
+          window->is_dock = !window->is_dock;
+          break;
+        }
+    }
+
+  /* Snap a window exactly against another now and then */
+  if (g_rand_int_range (grand, 0, 3) == 0)
+    {
+      TestWindow *a, *b;
+
+      a = &screen->windows[g_rand_int_range (grand, 0, screen->n_windows)];
+      b = &screen->windows[g_rand_int_range (grand, 0, screen->n_windows)];
+      a->rect.x = b->rect.x + b->rect.width;
+    }
+
+  if (g_rand_int_range (grand, 0, 200) == 0)
+    screen->screen_rect.width = 1920 + g_rand_int_range (grand, 0, 2) * 1280;
+}
+
+/* The windows whose edges matter, bottom to top, leaving out grabbed */
+static GArray *
+relevant_windows (TestScreen *screen,
+                  TestWindow *grabbed)
+{
+  GArray *windows;
+  int i;
+
+  windows = g_array_new (FALSE, FALSE, sizeof (MetaEdgeCacheWindow));
+
+  for (i = 0; i < screen->n_windows; i++)
+    {
+      TestWindow *window = screen->stack[i];
+      MetaEdgeCacheWindow cache_window;
+
+      if (!window->showing || window == grabbed)
+        continue;
+
+      cache_window.id = window;
+      cache_window.rect = window->rect;
+      cache_window.is_dock = window->is_dock;
+      g_array_append_val (windows, cache_window);
+    }
+
+  return windows;
+}
+
+static int
+update (MetaEdgeCache *cache,
+        TestScreen    *screen,
+        GArray        *windows)
+{
+  return meta_edge_cache_update (cache, &screen->screen_rect,
+                                 (MetaEdgeCacheWindow *) windows->data,
+                                 windows->len);
+}
+
+static void
+assert_edges_sorted (const GArray *edges)
+{
+  guint i;
+
+  for (i = 1; i < edges->len; i++)
+    g_assert (meta_edge_cache_compare_edges (&g_array_index (edges, MetaEdge*, i - 1),
+                                             &g_array_index (edges, MetaEdge*, i)) <= 0);
+}
+
+static void
+assert_edges_equal (const GArray *edges,
+                    const GArray *expected)
+{
+  guint i;
+
+  g_assert (edges->len == expected->len);
+
+  for (i = 0; i < edges->len; i++)
+    {
+      const MetaEdge *edge = g_array_index (edges, MetaEdge*, i);
+      const MetaEdge *expected_edge = g_array_index (expected, MetaEdge*, i);
+
+      g_assert (meta_rectangle_equal (&edge->rect, &expected_edge->rect));
+      g_assert (edge->side_type == expected_edge->side_type);
+      g_assert (edge->edge_type == expected_edge->edge_type);
+    }
+}
+
+static int
+count_non_docks (GArray *windows)
+{
+  int n_non_docks;
+  guint i;
+
+  n_non_docks = 0;
+  for (i = 0; i < windows->len; i++)
+    if (!g_array_index (windows, MetaEdgeCacheWindow, i).is_dock)
+      n_non_docks++;
+
+  return n_non_docks;
+}
+
+static void
+test_update_matches_fresh_cache (void)
+{
+  int n_reused;
+  int n_windows;
+  int run;
+
+  n_reused = 0;
+  n_windows = 0;
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      TestScreen *screen;
+      MetaEdgeCache *cache;
+      int round;
+
+      screen = screen_new (g_rand_int_range (grand, 1, 60));
+      cache = meta_edge_cache_new ();
+
+      for (round = 0; round < NUM_RANDOM_ROUNDS; round++)
+        {
+          MetaEdgeCache *fresh_cache;
+          TestWindow *grabbed;
+          GArray *windows;
+
+          random_changes (screen);
+
+          /* Sometimes the same window as last time, mostly another */
+          grabbed = &screen->windows[g_rand_int_range (grand, 0, screen->n_windows)];
+
+          windows = relevant_windows (screen, grabbed);
+
+          n_reused += update (cache, screen, windows);
+          n_windows += count_non_docks (windows);
+
+          /* The edges kept from before must be just those found from
+           * scratch
+           */
+          fresh_cache = meta_edge_cache_new ();
+          g_assert (update (fresh_cache, screen, windows) == 0);
+
+          assert_edges_sorted (meta_edge_cache_get_vertical_edges (cache));
+          assert_edges_sorted (meta_edge_cache_get_horizontal_edges (cache));
+          assert_edges_equal (meta_edge_cache_get_vertical_edges (cache),
+                              meta_edge_cache_get_vertical_edges (fresh_cache));
+          assert_edges_equal (meta_edge_cache_get_horizontal_edges (cache),
+                              meta_edge_cache_get_horizontal_edges (fresh_cache));
+
+          meta_edge_cache_free (fresh_cache);
+          g_array_free (windows, TRUE);
+
+          /* The grabbed window moves */
+          if (g_rand_boolean (grand))
+            grabbed->rect.y += g_rand_int_range (grand, -150, 150);
+        }
+
+      meta_edge_cache_free (cache);
+      screen_free (screen);
+    }
+
+  /* Most windows are far from the few that change */
+  g_assert (n_reused > n_windows / 2);
+
+  printf ("%s passed (kept the edges of %d of %d windows).\n",
+          G_STRFUNC, n_reused, n_windows);
+}
+
+static void
+test_reuse (void)
+{
+  TestScreen *screen;
+  MetaEdgeCache *cache;
+  GArray *windows;
+  TestWindow *window;
+  int n_non_docks;
+  int i;
+
+  /* Small windows in a grid, none touching another */
+  screen = screen_new (30);
+  for (i = 0; i < screen->n_windows; i++)
+    {
+      screen->windows[i].rect = meta_rect ((i % 6) * 100, (i / 6) * 100,
+                                           50, 50);
+      screen->windows[i].is_dock = FALSE;
+      screen->windows[i].showing = TRUE;
+    }
+  cache = meta_edge_cache_new ();
+
+  windows = relevant_windows (screen, NULL);
+  n_non_docks = count_non_docks (windows);
+
+  /* Nothing to keep the first time, and everything the second */
+  g_assert (update (cache, screen, windows) == 0);
+  g_assert (update (cache, screen, windows) == n_non_docks);
+  g_array_free (windows, TRUE);
+
+  /* A window far away from all the others changes nothing for them */
+  window = screen->stack[0];
+  window->rect = meta_rect (1800, 1000, 10, 10);
+  windows = relevant_windows (screen, NULL);
+  update (cache, screen, windows);
+  g_array_free (windows, TRUE);
+
+  window->rect = meta_rect (1700, 900, 10, 10);
+  windows = relevant_windows (screen, NULL);
+  g_assert (update (cache, screen, windows) == screen->n_windows - 1);
+  g_array_free (windows, TRUE);
+
+  /* Nothing is kept when the screen changes size */
+  screen->screen_rect.width += 100;
+  windows = relevant_windows (screen, NULL);
+  g_assert (update (cache, screen, windows) == 0);
+  g_array_free (windows, TRUE);
+
+  meta_edge_cache_free (cache);
+  screen_free (screen);
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+run_benchmark (void)
+{
+  TestScreen *screen;
+  MetaEdgeCache *cache;
+  gint64 start;
+  double update_time;
+  double fresh_time;
+  int grab;
+  int i;
+
+  screen = screen_new (NUM_BENCHMARK_WINDOWS);
+  for (i = 0; i < screen->n_windows; i++)
+    {
+      screen->windows[i].is_dock = FALSE;
+      screen->windows[i].showing = TRUE;
+    }
+
+  /* The same grabs, each after moving one window, first updating one
+   * cache and then finding and sorting all the edges every time, as
+   * before the edges were kept
+   */
+  update_time = 0.0;
+  fresh_time = 0.0;
+  cache = meta_edge_cache_new ();
+
+  for (grab = 0; grab < NUM_BENCHMARK_GRABS; grab++)
+    {
+      MetaEdgeCache *fresh_cache;
+      TestWindow *grabbed;
+      GArray *windows;
+
+      grabbed = &screen->windows[grab % screen->n_windows];
+      windows = relevant_windows (screen, grabbed);
+
+      start = g_get_monotonic_time ();
+      update (cache, screen, windows);
+      update_time += g_get_monotonic_time () - start;
+
+      start = g_get_monotonic_time ();
+      fresh_cache = meta_edge_cache_new ();
+      update (fresh_cache, screen, windows);
+      meta_edge_cache_free (fresh_cache);
+      fresh_time += g_get_monotonic_time () - start;
+
+      g_array_free (windows, TRUE);
+
+      grabbed->rect.x += g_rand_int_range (grand, -100, 100);
+    }
+
+  meta_edge_cache_free (cache);
+  screen_free (screen);
+
+  printf ("Edges of %d windows at the start of a grab: %.1f us kept "
+          "(%.1f us found again)\n",
+          NUM_BENCHMARK_WINDOWS,
+          update_time / NUM_BENCHMARK_GRABS,
+          fresh_time / NUM_BENCHMARK_GRABS);
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean benchmark;
+  int i;
+
+  benchmark = FALSE;
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "--benchmark") == 0)
+        benchmark = TRUE;
+    }
+
+  /* Must initialize random seed prior to creating the windows */
+  grand = g_rand_new_with_seed (time (NULL));
+
+  test_update_matches_fresh_cache ();
+  test_reuse ();
+
+  if (benchmark)
+    run_benchmark ();
+
+  g_rand_free (grand);
+
+  return 0;
+}
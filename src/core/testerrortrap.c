@@ -0,0 +1,211 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Checks that error traps see the errors of the requests inside them */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Run it on any display, e.g.
+ *
+ *   Xvfb :9 & DISPLAY=:9 ./testerrortrap
+ *
+ * Each test makes requests on a window that has been destroyed, which
+ * the server answers with BadWindow, and checks that the trap around
+ * them reports it, while traps around requests that succeed report
+ * Success.
+ */
+
+#include <config.h>
+
+#include <gdk/gdk.h>
+#include <gdk/gdkx.h>
+#include <stdio.h>
+
+#include "display-private.h"
+#include "errors.h"
+
+/* errors.c has the event loop retire traps popped asynchronously once
+ * the server is done with them; here the tests do it after an XSync.
+ */
+void
+meta_display_queue_reply_sentinel (MetaDisplay *display)
+{
+}
+
+static Window
+create_window (MetaDisplay *display)
+{
+  return XCreateSimpleWindow (display->xdisplay,
+                              DefaultRootWindow (display->xdisplay),
+                              0, 0, 10, 10, 0, 0, 0);
+}
+
+static Window
+create_destroyed_window (MetaDisplay *display)
+{
+  Window xwindow;
+
+  xwindow = create_window (display);
+  XDestroyWindow (display->xdisplay, xwindow);
+
+  return xwindow;
+}
+
+static void
+store_error_code (MetaDisplay *display,
+                  int          error_code,
+                  gpointer     user_data)
+{
+  int *result = user_data;
+
+  *result = error_code;
+}
+
+static void
+test_pop_with_return (MetaDisplay *display)
+{
+  Window good;
+  Window bad;
+
+  good = create_window (display);
+  bad = create_destroyed_window (display);
+
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, bad);
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, BadWindow);
+
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, good);
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, Success);
+
+  /* The error has already arrived by the time of the pop */
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, bad);
+  XSync (display->xdisplay, False);
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, BadWindow);
+
+  XDestroyWindow (display->xdisplay, good);
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* Errors in place of a reply take a different way through Xlib */
+static void
+test_reply_error (MetaDisplay *display)
+{
+  XWindowAttributes attrs;
+  Window bad;
+
+  bad = create_destroyed_window (display);
+
+  meta_error_trap_push (display);
+  g_assert (!XGetWindowAttributes (display->xdisplay, bad, &attrs));
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, BadWindow);
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+test_nested (MetaDisplay *display)
+{
+  Window good;
+  Window bad;
+
+  good = create_window (display);
+  bad = create_destroyed_window (display);
+
+  /* An error inside the inner trap is only reported by the inner one */
+  meta_error_trap_push (display);
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, bad);
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, BadWindow);
+  XMapWindow (display->xdisplay, good);
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, Success);
+
+  /* One after the inner trap is reported by the outer one */
+  meta_error_trap_push (display);
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, good);
+  meta_error_trap_pop (display);
+  XMapWindow (display->xdisplay, bad);
+  g_assert_cmpint (meta_error_trap_pop_with_return (display), ==, BadWindow);
+
+  XDestroyWindow (display->xdisplay, good);
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+test_pop_async (MetaDisplay *display)
+{
+  Window good;
+  Window bad;
+  int bad_result;
+  int good_result;
+
+  good = create_window (display);
+  bad = create_destroyed_window (display);
+
+  bad_result = -1;
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, bad);
+  meta_error_trap_pop_async (display, store_error_code, &bad_result);
+
+  good_result = -1;
+  meta_error_trap_push (display);
+  XMapWindow (display->xdisplay, good);
+  meta_error_trap_pop_async (display, store_error_code, &good_result);
+
+  XSync (display->xdisplay, False);
+  meta_error_trap_process_pending (display);
+
+  g_assert_cmpint (bad_result, ==, BadWindow);
+  g_assert_cmpint (good_result, ==, Success);
+
+  XDestroyWindow (display->xdisplay, good);
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+int
+main (int argc, char **argv)
+{
+  MetaDisplay *display;
+
+  gdk_set_allowed_backends ("x11");
+
+  if (!gdk_init_check (&argc, &argv))
+    {
+      fprintf (stderr, "Could not open display\n");
+      return 1;
+    }
+
+  display = g_new0 (MetaDisplay, 1);
+  display->xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+
+  meta_error_trap_init (display);
+
+  test_pop_with_return (display);
+  test_reply_error (display);
+  test_nested (display);
+  test_pop_async (display);
+
+  meta_error_trap_shutdown (display);
+  g_free (display);
+
+  printf ("All tests passed.\n");
+
+  return 0;
+}
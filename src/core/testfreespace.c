@@ -0,0 +1,469 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity free space tracking testing program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "free-space.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>      /* To initialize random seed */
+
+#define NUM_RANDOM_RUNS 200
+
+static GRand *grand = NULL;
+
+/* Mostly within a 1600x1200 area, but some sticking out of it */
+static void
+get_random_window (MetaRectangle *rect)
+{
+  rect->x = g_rand_int_range (grand, -200, 1600);
+  rect->y = g_rand_int_range (grand, -200, 1200);
+  rect->width = g_rand_int_range (grand, 1, 700);
+  rect->height = g_rand_int_range (grand, 1, 500);
+}
+
+static gboolean
+overlaps_some_window (const MetaRectangle *rect,
+                      const MetaRectangle *windows,
+                      int                  n_windows)
+{
+  int i;
+
+  for (i = 0; i < n_windows; i++)
+    {
+      if (meta_rectangle_overlap (rect, &windows[i]))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static int
+get_overlap_area (const MetaRectangle *rect,
+                  const MetaRectangle *windows,
+                  int                  n_windows)
+{
+  int total;
+  int i;
+
+  total = 0;
+  for (i = 0; i < n_windows; i++)
+    {
+      MetaRectangle overlap;
+
+      if (meta_rectangle_intersect (&windows[i], rect, &overlap))
+        total += meta_rectangle_area (&overlap);
+    }
+
+  return total;
+}
+
+/* Whether rect is free, inside area, and can't grow by a pixel on any
+ * side without running into a window or out of the area
+ */
+static gboolean
+is_maximal_free_rect (const MetaRectangle *rect,
+                      const MetaRectangle *area,
+                      const MetaRectangle *windows,
+                      int                  n_windows)
+{
+  int side;
+
+  if (!meta_rectangle_contains_rect (area, rect) ||
+      overlaps_some_window (rect, windows, n_windows))
+    return FALSE;
+
+  for (side = 0; side < 4; side++)
+    {
+      MetaRectangle grown = *rect;
+
+      switch (side)
+        {
+        case 0:
+          grown.x -= 1;
+          grown.width += 1;
+          break;
+        case 1:
+          grown.width += 1;
+          break;
+        case 2:
+          grown.y -= 1;
+          grown.height += 1;
+          break;
+        case 3:
+          grown.height += 1;
+          break;
+        }
+
+      if (meta_rectangle_contains_rect (area, &grown) &&
+          !overlaps_some_window (&grown, windows, n_windows))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+test_free_rects (void)
+{
+  MetaRectangle area;
+  int run;
+
+  area = meta_rect (0, 0, 1600, 1200);
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      MetaFreeSpace *space;
+      MetaRectangle *windows;
+      const MetaRectangle *free_rects;
+      int n_windows;
+      int n_free_rects;
+      int i, j;
+
+      n_windows = g_rand_int_range (grand, 0, 30);
+      windows = g_new (MetaRectangle, MAX (n_windows, 1));
+      space = meta_free_space_new (&area);
+
+      for (i = 0; i < n_windows; i++)
+        {
+          get_random_window (&windows[i]);
+          meta_free_space_add_window (space, &windows[i]);
+        }
+
+      free_rects = meta_free_space_get_rects (space, &n_free_rects);
+
+      for (i = 0; i < n_free_rects; i++)
+        {
+          g_assert (is_maximal_free_rect (&free_rects[i], &area,
+                                          windows, n_windows));
+
+          for (j = 0; j < n_free_rects; j++)
+            g_assert (j == i ||
+                      !meta_rectangle_contains_rect (&free_rects[j],
+                                                     &free_rects[i]));
+        }
+
+      /* Every free pixel is in a free rectangle */
+      for (i = 0; i < 1000; i++)
+        {
+          MetaRectangle pixel;
+          gboolean found;
+
+          pixel = meta_rect (g_rand_int_range (grand, 0, 1600),
+                             g_rand_int_range (grand, 0, 1200), 1, 1);
+
+          if (overlaps_some_window (&pixel, windows, n_windows))
+            continue;
+
+          found = FALSE;
+          for (j = 0; j < n_free_rects && !found; j++)
+            found = meta_rectangle_contains_rect (&free_rects[j], &pixel);
+          g_assert (found);
+        }
+
+      meta_free_space_free (space);
+      g_free (windows);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* Whether a width x height window can go somewhere in area without
+ * overlapping any window; if it can, it can also be slid up and left
+ * until it touches a window or the edge of the area.
+ */
+static gboolean
+fits_without_overlap (const MetaRectangle *area,
+                      const MetaRectangle *windows,
+                      int                  n_windows,
+                      int                  width,
+                      int                  height)
+{
+  int i, j;
+
+  for (i = -1; i < n_windows; i++)
+    {
+      for (j = -1; j < n_windows; j++)
+        {
+          MetaRectangle rect;
+
+          rect.x = i < 0 ? area->x : BOX_RIGHT (windows[i]);
+          rect.y = j < 0 ? area->y : BOX_BOTTOM (windows[j]);
+          rect.width = width;
+          rect.height = height;
+
+          if (meta_rectangle_contains_rect (area, &rect) &&
+              !overlaps_some_window (&rect, windows, n_windows))
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static void
+test_find_position (void)
+{
+  MetaRectangle area;
+  int run;
+
+  area = meta_rect (100, 50, 1600, 1200);
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      MetaFreeSpace *space;
+      MetaRectangle *windows;
+      MetaRectangle rect;
+      int n_windows;
+      int overlap;
+      int i;
+
+      n_windows = g_rand_int_range (grand, 0, 30);
+      windows = g_new (MetaRectangle, MAX (n_windows, 1));
+      space = meta_free_space_new (&area);
+
+      for (i = 0; i < n_windows; i++)
+        {
+          get_random_window (&windows[i]);
+          windows[i].x += area.x;
+          windows[i].y += area.y;
+          meta_free_space_add_window (space, &windows[i]);
+        }
+
+      for (i = 0; i < 20; i++)
+        {
+          rect.width = g_rand_int_range (grand, 1, 1700);
+          rect.height = g_rand_int_range (grand, 1, 1300);
+
+          overlap = meta_free_space_find_position (space,
+                                                   rect.width, rect.height,
+                                                   &rect.x, &rect.y);
+
+          if (rect.width > area.width || rect.height > area.height)
+            {
+              g_assert (overlap == -1);
+              continue;
+            }
+
+          g_assert (meta_rectangle_contains_rect (&area, &rect));
+          g_assert (overlap == get_overlap_area (&rect, windows, n_windows));
+          g_assert ((overlap == 0) ==
+                    fits_without_overlap (&area, windows, n_windows,
+                                          rect.width, rect.height));
+        }
+
+      meta_free_space_free (space);
+      g_free (windows);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* Opens n_windows windows of a few sizes one after the other on a
+ * 1920x1080 monitor, each at its place of least overlap
+ */
+static void
+run_benchmark (int n_windows)
+{
+  MetaRectangle area;
+  MetaRectangle *windows;
+  gint64 start_time;
+  double place_time;
+  int n_overlapping;
+  int i;
+
+  area = meta_rect (0, 0, 1920, 1080);
+  windows = g_new (MetaRectangle, n_windows);
+  n_overlapping = 0;
+
+  start_time = g_get_monotonic_time ();
+
+  for (i = 0; i < n_windows; i++)
+    {
+      MetaFreeSpace *space;
+      int j;
+
+      /* Placement starts from the windows as they are */
+      space = meta_free_space_new (&area);
+      for (j = 0; j < i; j++)
+        meta_free_space_add_window (space, &windows[j]);
+
+      windows[i].width = 320 + 160 * (i % 3);
+      windows[i].height = 240 + 120 * (i % 2);
+      if (meta_free_space_find_position (space,
+                                         windows[i].width, windows[i].height,
+                                         &windows[i].x, &windows[i].y) > 0)
+        n_overlapping++;
+
+      meta_free_space_free (space);
+    }
+
+  place_time = (g_get_monotonic_time () - start_time) / (double) n_windows;
+
+  printf ("%4d windows: %8.1f us per window, %4d had to overlap others\n",
+          n_windows, place_time, n_overlapping);
+
+  g_free (windows);
+}
+
+/* What meta_free_space_find_position() does when the window has to
+ * overlap others, scoring every corner of every free rectangle in full
+ */
+static int
+reference_find_position (MetaFreeSpace       *space,
+                         const MetaRectangle *area,
+                         const MetaRectangle *windows,
+                         int                  n_windows,
+                         MetaRectangle       *best)
+{
+  const MetaRectangle *free_rects;
+  int n_free_rects;
+  int best_overlap;
+  int i, corner;
+
+  free_rects = meta_free_space_get_rects (space, &n_free_rects);
+
+  best->x = area->x;
+  best->y = area->y;
+  best_overlap = get_overlap_area (best, windows, n_windows);
+
+  for (i = 0; i < n_free_rects; i++)
+    {
+      for (corner = 0; corner < 4; corner++)
+        {
+          MetaRectangle rect;
+          int overlap;
+
+          rect.x = corner & 1 ? BOX_RIGHT (free_rects[i]) - best->width : free_rects[i].x;
+          rect.y = corner & 2 ? BOX_BOTTOM (free_rects[i]) - best->height : free_rects[i].y;
+          rect.width = best->width;
+          rect.height = best->height;
+
+          rect.x = CLAMP (rect.x, area->x, BOX_RIGHT (*area) - rect.width);
+          rect.y = CLAMP (rect.y, area->y, BOX_BOTTOM (*area) - rect.height);
+
+          overlap = get_overlap_area (&rect, windows, n_windows);
+          if (overlap < best_overlap ||
+              (overlap == best_overlap &&
+               (rect.y < best->y || (rect.y == best->y && rect.x < best->x))))
+            {
+              *best = rect;
+              best_overlap = overlap;
+            }
+        }
+    }
+
+  return best_overlap;
+}
+
+/* Places a big window among n_windows small ones scattered over a
+ * 1920x1080 monitor, which leaves many free rectangles and nowhere to
+ * put it without overlapping
+ */
+static void
+run_scattered_benchmark (int n_windows)
+{
+  MetaRectangle area;
+  MetaRectangle *windows;
+  MetaFreeSpace *space;
+  MetaRectangle rect;
+  MetaRectangle reference_rect;
+  gint64 start_time;
+  double find_time;
+  double reference_time;
+  int n_free_rects;
+  int overlap;
+  int reference_overlap;
+  int n_runs;
+  int i;
+
+  area = meta_rect (0, 0, 1920, 1080);
+  windows = g_new (MetaRectangle, n_windows);
+  space = meta_free_space_new (&area);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      windows[i] = meta_rect (g_rand_int_range (grand, 0, 1920 - 160),
+                              g_rand_int_range (grand, 0, 1080 - 120),
+                              160, 120);
+      meta_free_space_add_window (space, &windows[i]);
+    }
+
+  meta_free_space_get_rects (space, &n_free_rects);
+
+  n_runs = 20;
+  rect = meta_rect (0, 0, 960, 720);
+  reference_rect = rect;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    overlap = meta_free_space_find_position (space, rect.width, rect.height,
+                                             &rect.x, &rect.y);
+  find_time = (g_get_monotonic_time () - start_time) / (double) n_runs;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    reference_overlap = reference_find_position (space, &area,
+                                                 windows, n_windows,
+                                                 &reference_rect);
+  reference_time = (g_get_monotonic_time () - start_time) / (double) n_runs;
+
+  g_assert (overlap == get_overlap_area (&rect, windows, n_windows));
+  g_assert (overlap == reference_overlap);
+  g_assert (meta_rectangle_equal (&rect, &reference_rect));
+
+  printf ("%4d windows, %5d free rectangles: %8.1f us, overlap %7d "
+          "(scoring in full %8.1f us)\n",
+          n_windows, n_free_rects, find_time, overlap,
+          reference_time);
+
+  meta_free_space_free (space);
+  g_free (windows);
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean benchmark;
+
+  grand = g_rand_new_with_seed (time (NULL));
+
+  /* --benchmark times placing growing numbers of windows */
+  benchmark = argc > 1 && strcmp (argv[1], "--benchmark") == 0;
+
+  test_free_rects ();
+  test_find_position ();
+
+  printf ("All tests passed.\n");
+
+  if (benchmark)
+    {
+      int n_windows;
+
+      for (n_windows = 10; n_windows <= 160; n_windows *= 2)
+        run_benchmark (n_windows);
+
+      for (n_windows = 10; n_windows <= 160; n_windows *= 2)
+        run_scattered_benchmark (n_windows);
+    }
+
+  g_rand_free (grand);
+
+  return 0;
+}
@@ -0,0 +1,432 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity icon pixel pipeline testing program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "icon-pixels.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>      /* To initialize random seed */
+
+#define NUM_RANDOM_RUNS 1000
+
+static GRand *grand = NULL;
+
+static gulong *
+random_argb (gsize n_pixels)
+{
+  gulong *argb;
+  gsize i;
+
+  argb = g_new (gulong, n_pixels);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      argb[i] = g_rand_int (grand);
+
+      /* Plenty of icons are mostly fully transparent or opaque */
+      if (g_rand_int_range (grand, 0, 4) == 0)
+        argb[i] &= 0x00ffffff;
+      else if (g_rand_int_range (grand, 0, 4) == 0)
+        argb[i] |= 0xff000000;
+    }
+
+  return argb;
+}
+
+/* What iconcache.c used to do */
+static void
+reference_from_argb (const gulong *argb,
+                     guchar       *rgba,
+                     gsize         n_pixels)
+{
+  gsize i;
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      guint argb_pixel;
+      guint rgba_pixel;
+
+      argb_pixel = argb[i];
+      rgba_pixel = (argb_pixel << 8) | (argb_pixel >> 24);
+
+      rgba[i * 4] = rgba_pixel >> 24;
+      rgba[i * 4 + 1] = (rgba_pixel >> 16) & 0xff;
+      rgba[i * 4 + 2] = (rgba_pixel >> 8) & 0xff;
+      rgba[i * 4 + 3] = rgba_pixel & 0xff;
+    }
+}
+
+static void
+test_from_argb (void)
+{
+  int i;
+
+  for (i = 0; i < NUM_RANDOM_RUNS; i++)
+    {
+      gsize n_pixels;
+      gulong *argb;
+      guchar *expected;
+      guchar *result;
+
+      n_pixels = g_rand_int_range (grand, 1, 300);
+      argb = random_argb (n_pixels);
+      expected = g_new (guchar, n_pixels * 4);
+      result = g_new (guchar, n_pixels * 4);
+
+      reference_from_argb (argb, expected, n_pixels);
+      meta_icon_pixels_from_argb (argb, result, n_pixels);
+
+      g_assert (memcmp (expected, result, n_pixels * 4) == 0);
+
+      g_free (argb);
+      g_free (expected);
+      g_free (result);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+test_premultiply (void)
+{
+  int i;
+
+  for (i = 0; i < NUM_RANDOM_RUNS; i++)
+    {
+      gsize n_pixels;
+      gulong *argb;
+      guchar *original;
+      guchar *rgba;
+      gsize j;
+
+      n_pixels = g_rand_int_range (grand, 1, 300);
+      argb = random_argb (n_pixels);
+      original = g_new (guchar, n_pixels * 4);
+      rgba = g_new (guchar, n_pixels * 4);
+
+      meta_icon_pixels_from_argb (argb, original, n_pixels);
+      memcpy (rgba, original, n_pixels * 4);
+
+      meta_icon_pixels_premultiply (rgba, n_pixels);
+
+      for (j = 0; j < n_pixels * 4; j++)
+        {
+          int a = original[j | 3];
+
+          if ((j & 3) == 3)
+            g_assert (rgba[j] == a);
+          else
+            g_assert (rgba[j] == (original[j] * a + 127) / 255);
+        }
+
+      meta_icon_pixels_unpremultiply (rgba, n_pixels);
+
+      /* Going back loses precision, but never more than 255 / alpha */
+      for (j = 0; j < n_pixels * 4; j++)
+        {
+          int a = original[j | 3];
+
+          if (a == 0)
+            g_assert ((j & 3) == 3 || rgba[j] == 0);
+          else
+            g_assert (ABS (rgba[j] - original[j]) <= (255 + a - 1) / a);
+        }
+
+      g_free (argb);
+      g_free (original);
+      g_free (rgba);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+test_mask_helpers (void)
+{
+  int i;
+
+  for (i = 0; i < NUM_RANDOM_RUNS; i++)
+    {
+      gsize n_pixels;
+      gulong *argb;
+      guchar *src;
+      guchar *dest;
+      guchar *original;
+      gsize j;
+
+      n_pixels = g_rand_int_range (grand, 1, 300);
+      argb = random_argb (n_pixels);
+      src = g_new (guchar, n_pixels * 4);
+      meta_icon_pixels_from_argb (argb, src, n_pixels);
+      g_free (argb);
+
+      argb = random_argb (n_pixels);
+      dest = g_new (guchar, n_pixels * 4);
+      original = g_new (guchar, n_pixels * 4);
+      meta_icon_pixels_from_argb (argb, dest, n_pixels);
+      memcpy (original, dest, n_pixels * 4);
+      g_free (argb);
+
+      meta_icon_pixels_copy_alpha (src, dest, n_pixels);
+
+      for (j = 0; j < n_pixels * 4; j++)
+        g_assert (dest[j] == ((j & 3) == 3 ? src[j] : original[j]));
+
+      memcpy (dest, original, n_pixels * 4);
+      meta_icon_pixels_bitmap_to_mono (dest, n_pixels);
+
+      for (j = 0; j < n_pixels * 4; j++)
+        {
+          if ((j & 3) == 3)
+            g_assert (dest[j] == 0xff);
+          else
+            g_assert (dest[j] == (original[j | 3] == 0 ? 0xff : 0x00));
+        }
+
+      g_free (src);
+      g_free (dest);
+      g_free (original);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* Straightforward area average in floating point */
+static void
+reference_downscale (const guchar *src,
+                     int           src_width,
+                     int           src_height,
+                     guchar       *dest,
+                     int           dest_width,
+                     int           dest_height)
+{
+  double scale_x = (double) src_width / dest_width;
+  double scale_y = (double) src_height / dest_height;
+  int x, y, c;
+
+  for (y = 0; y < dest_height; y++)
+    for (x = 0; x < dest_width; x++)
+      for (c = 0; c < 4; c++)
+        {
+          double sum = 0.0;
+          int sx, sy;
+
+          for (sy = 0; sy < src_height; sy++)
+            {
+              double cover_y;
+
+              cover_y = MIN (sy + 1, (y + 1) * scale_y) - MAX (sy, y * scale_y);
+              if (cover_y <= 0.0)
+                continue;
+
+              for (sx = 0; sx < src_width; sx++)
+                {
+                  double cover_x;
+
+                  cover_x = MIN (sx + 1, (x + 1) * scale_x) - MAX (sx, x * scale_x);
+                  if (cover_x <= 0.0)
+                    continue;
+
+                  sum += src[(sy * src_width + sx) * 4 + c] * cover_x * cover_y;
+                }
+            }
+
+          dest[(y * dest_width + x) * 4 + c] = sum / (scale_x * scale_y) + 0.5;
+        }
+}
+
+static void
+test_downscale (void)
+{
+  int i;
+
+  for (i = 0; i < NUM_RANDOM_RUNS / 10; i++)
+    {
+      int src_width, src_height;
+      int dest_width, dest_height;
+      gulong *argb;
+      guchar *src;
+      guchar *expected;
+      guchar *result;
+      int j;
+
+      src_width = g_rand_int_range (grand, 1, 100);
+      src_height = g_rand_int_range (grand, 1, 100);
+      dest_width = g_rand_int_range (grand, 1, src_width + 1);
+      dest_height = g_rand_int_range (grand, 1, src_height + 1);
+
+      argb = random_argb (src_width * src_height);
+      src = g_new (guchar, src_width * src_height * 4);
+      meta_icon_pixels_from_argb (argb, src, src_width * src_height);
+      meta_icon_pixels_premultiply (src, src_width * src_height);
+      g_free (argb);
+
+      expected = g_new (guchar, dest_width * dest_height * 4);
+      result = g_new (guchar, dest_width * dest_height * 4);
+
+      reference_downscale (src, src_width, src_height,
+                           expected, dest_width, dest_height);
+      meta_icon_pixels_downscale (src, src_width, src_height, src_width * 4,
+                                  result, dest_width, dest_height,
+                                  dest_width * 4);
+
+      for (j = 0; j < dest_width * dest_height * 4; j++)
+        g_assert (ABS (expected[j] - result[j]) <= 1);
+
+      g_free (result);
+
+      /* Scaling to the same size must be lossless */
+      result = g_new (guchar, src_width * src_height * 4);
+      meta_icon_pixels_downscale (src, src_width, src_height, src_width * 4,
+                                  result, src_width, src_height,
+                                  src_width * 4);
+
+      g_assert (memcmp (src, result, src_width * src_height * 4) == 0);
+
+      g_free (expected);
+      g_free (src);
+      g_free (result);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static double
+time_ms (gint64 start_time,
+         int    n_runs)
+{
+  return (g_get_monotonic_time () - start_time) / 1000.0 / n_runs;
+}
+
+/* Typical _NET_WM_ICON contents: a 256x256 image scaled to the frame and
+ * tab-list sizes.
+ */
+static void
+run_benchmark (int n_runs)
+{
+  const int size = 256;
+  const int n_pixels = size * size;
+  gulong *argb;
+  guchar *rgba;
+  guchar *scaled;
+  gint64 start_time;
+  int i;
+
+  argb = random_argb (n_pixels);
+  rgba = g_new (guchar, n_pixels * 4);
+  scaled = g_new (guchar, 48 * 48 * 4);
+
+  /* Build with CFLAGS=-U__SSE2__ (or -U__ARM_NEON) to compare against
+   * the plain C loops
+   */
+#if defined (__SSE2__)
+  printf ("Timing %d runs over %dx%d pixels, SSE2\n", n_runs, size, size);
+#elif defined (__ARM_NEON) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+  printf ("Timing %d runs over %dx%d pixels, NEON\n", n_runs, size, size);
+#else
+  printf ("Timing %d runs over %dx%d pixels, plain C\n", n_runs, size, size);
+#endif
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    reference_from_argb (argb, rgba, n_pixels);
+  printf ("  byte-wise ARGB conversion: %8.4f ms\n", time_ms (start_time, n_runs));
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    meta_icon_pixels_from_argb (argb, rgba, n_pixels);
+  printf ("  ARGB conversion:           %8.4f ms\n", time_ms (start_time, n_runs));
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    meta_icon_pixels_premultiply (rgba, n_pixels);
+  printf ("  premultiply:               %8.4f ms\n", time_ms (start_time, n_runs));
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    meta_icon_pixels_copy_alpha (rgba, rgba, n_pixels);
+  printf ("  copy alpha:                %8.4f ms\n", time_ms (start_time, n_runs));
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    meta_icon_pixels_downscale (rgba, size, size, size * 4,
+                                scaled, 48, 48, 48 * 4);
+  printf ("  downscale to 48x48:        %8.4f ms\n", time_ms (start_time, n_runs));
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    meta_icon_pixels_downscale (rgba, size, size, size * 4,
+                                scaled, 16, 16, 16 * 4);
+  printf ("  downscale to 16x16:        %8.4f ms\n", time_ms (start_time, n_runs));
+
+  /* Everything iconcache.c does to a _NET_WM_ICON */
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < n_runs; i++)
+    {
+      meta_icon_pixels_from_argb (argb, rgba, n_pixels);
+      meta_icon_pixels_premultiply (rgba, n_pixels);
+      meta_icon_pixels_downscale (rgba, size, size, size * 4,
+                                  scaled, 48, 48, 48 * 4);
+      meta_icon_pixels_downscale (rgba, size, size, size * 4,
+                                  scaled, 16, 16, 16 * 4);
+    }
+  printf ("  full pipeline:             %8.4f ms\n", time_ms (start_time, n_runs));
+
+  g_free (argb);
+  g_free (rgba);
+  g_free (scaled);
+}
+
+int
+main (int argc, char **argv)
+{
+  int n_runs;
+
+  grand = g_rand_new_with_seed (time (NULL));
+
+  /* --benchmark [N] times each step over N runs (default 1000) */
+  n_runs = 0;
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    {
+      n_runs = 1000;
+      if (argc > 2)
+        n_runs = atoi (argv[2]);
+
+      if (n_runs <= 0)
+        {
+          fprintf (stderr, "number of runs must be positive\n");
+          return 1;
+        }
+    }
+
+  test_from_argb ();
+  test_premultiply ();
+  test_mask_helpers ();
+  test_downscale ();
+
+  printf ("All tests passed.\n");
+
+  if (n_runs > 0)
+    run_benchmark (n_runs);
+
+  g_rand_free (grand);
+
+  return 0;
+}
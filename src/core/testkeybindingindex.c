@@ -0,0 +1,248 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity key binding index testing program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "keybinding-index.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>      /* To initialize random seed */
+
+#define NUM_RANDOM_RUNS 100
+#define NUM_KEY_PRESSES 100000
+
+static GRand *grand = NULL;
+
+typedef struct
+{
+  guint keycode;
+  guint mask;
+} Binding;
+
+/* Bindings are on the usual keycodes (8 to 255) with a mix of the core
+ * modifiers; a few need a bit outside of them and can never match.
+ */
+static Binding *
+random_bindings (int n_bindings)
+{
+  Binding *bindings;
+  int i;
+
+  bindings = g_new (Binding, n_bindings);
+
+  for (i = 0; i < n_bindings; i++)
+    {
+      bindings[i].keycode = g_rand_int_range (grand, 8, 256);
+      bindings[i].mask = g_rand_int_range (grand, 0, 0x100);
+
+      if (g_rand_int_range (grand, 0, 50) == 0)
+        bindings[i].mask |= 0x2000;
+    }
+
+  return bindings;
+}
+
+static MetaKeyBindingIndex *
+index_bindings (const Binding *bindings,
+                int            n_bindings)
+{
+  MetaKeyBindingIndex *index;
+  guint32 *keys;
+  int i;
+
+  keys = g_new (guint32, MAX (n_bindings, 1));
+
+  for (i = 0; i < n_bindings; i++)
+    keys[i] = META_KEY_BINDING_INDEX_KEY (bindings[i].keycode,
+                                          bindings[i].mask);
+
+  index = meta_key_binding_index_new (keys, n_bindings);
+
+  g_free (keys);
+
+  return index;
+}
+
+/* What process_event() used to do */
+static int
+linear_lookup (const Binding *bindings,
+               int            n_bindings,
+               int            start,
+               guint          keycode,
+               guint          state)
+{
+  int i;
+
+  for (i = start; i < n_bindings; i++)
+    {
+      if (bindings[i].keycode == keycode && bindings[i].mask == (state & 0xff))
+        return i;
+    }
+
+  return -1;
+}
+
+static void
+test_matches (void)
+{
+  int run;
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      MetaKeyBindingIndex *index;
+      Binding *bindings;
+      int n_bindings;
+      int i;
+
+      n_bindings = g_rand_int_range (grand, 0, 2000);
+      bindings = random_bindings (n_bindings);
+      index = index_bindings (bindings, n_bindings);
+
+      for (i = 0; i < 1000; i++)
+        {
+          const int *matches;
+          int n_matches;
+          guint keycode;
+          guint state;
+          int expected;
+          int j;
+
+          /* Half of the presses are on bound keys */
+          if (n_bindings > 0 && g_rand_boolean (grand))
+            {
+              Binding *binding;
+
+              binding = &bindings[g_rand_int_range (grand, 0, n_bindings)];
+              keycode = binding->keycode;
+              state = binding->mask & 0xff;
+            }
+          else
+            {
+              keycode = g_rand_int_range (grand, 8, 256);
+              state = g_rand_int_range (grand, 0, 0x100);
+            }
+
+          matches = meta_key_binding_index_lookup (index,
+                                                   META_KEY_BINDING_INDEX_KEY (keycode, state),
+                                                   &n_matches);
+
+          /* Every binding the linear scan finds, in the same order */
+          expected = linear_lookup (bindings, n_bindings, 0, keycode, state);
+          for (j = 0; j < n_matches; j++)
+            {
+              g_assert (matches[j] == expected);
+              expected = linear_lookup (bindings, n_bindings, expected + 1,
+                                        keycode, state);
+            }
+          g_assert (expected == -1);
+        }
+
+      meta_key_binding_index_free (index);
+      g_free (bindings);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+static void
+run_benchmark (int n_bindings)
+{
+  MetaKeyBindingIndex *index;
+  Binding *bindings;
+  guint *presses;
+  gint64 start_time;
+  double linear_time;
+  double index_time;
+  int n_found;
+  int i;
+
+  bindings = random_bindings (n_bindings);
+
+  presses = g_new (guint, NUM_KEY_PRESSES * 2);
+  for (i = 0; i < NUM_KEY_PRESSES; i++)
+    {
+      presses[i * 2] = g_rand_int_range (grand, 8, 256);
+      presses[i * 2 + 1] = g_rand_int_range (grand, 0, 0x100);
+    }
+
+  start_time = g_get_monotonic_time ();
+  index = index_bindings (bindings, n_bindings);
+  printf ("%5d bindings: indexed in %.3f ms,", n_bindings,
+          (g_get_monotonic_time () - start_time) / 1000.0);
+
+  n_found = 0;
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_KEY_PRESSES; i++)
+    {
+      if (linear_lookup (bindings, n_bindings, 0,
+                         presses[i * 2], presses[i * 2 + 1]) >= 0)
+        n_found += 1;
+    }
+  linear_time = (g_get_monotonic_time () - start_time) * 1000.0 / NUM_KEY_PRESSES;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_KEY_PRESSES; i++)
+    {
+      int n_matches;
+
+      meta_key_binding_index_lookup (index,
+                                     META_KEY_BINDING_INDEX_KEY (presses[i * 2],
+                                                                 presses[i * 2 + 1]),
+                                     &n_matches);
+      if (n_matches > 0)
+        n_found -= 1;
+    }
+  index_time = (g_get_monotonic_time () - start_time) * 1000.0 / NUM_KEY_PRESSES;
+
+  g_assert (n_found == 0);
+
+  printf (" %8.1f ns per press scanning, %6.1f ns indexed\n",
+          linear_time, index_time);
+
+  meta_key_binding_index_free (index);
+  g_free (presses);
+  g_free (bindings);
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean benchmark;
+
+  grand = g_rand_new_with_seed (time (NULL));
+
+  /* --benchmark times dispatch for growing numbers of bindings */
+  benchmark = argc > 1 && strcmp (argv[1], "--benchmark") == 0;
+
+  test_matches ();
+
+  printf ("All tests passed.\n");
+
+  if (benchmark)
+    {
+      int n_bindings;
+
+      for (n_bindings = 50; n_bindings <= 5000; n_bindings *= 10)
+        run_benchmark (n_bindings);
+    }
+
+  g_rand_free (grand);
+
+  return 0;
+}
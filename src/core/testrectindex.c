@@ -0,0 +1,236 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity rectangle overlap index testing program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rect-index.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>      /* To initialize random seed */
+
+#define NUM_RANDOM_RUNS 100
+
+static GRand *grand = NULL;
+
+/* Mostly on a 1600x1200 screen, but some off its edges or empty */
+static void
+get_random_rect (MetaRectangle *rect)
+{
+  rect->x = g_rand_int_range (grand, -400, 1800);
+  rect->y = g_rand_int_range (grand, -300, 1400);
+  rect->width = g_rand_int_range (grand, 0, 600);
+  rect->height = g_rand_int_range (grand, 0, 500);
+}
+
+/* What find_first_fit() used to do */
+static gboolean
+linear_overlaps (const MetaRectangle *rects,
+                 int                  n_rects,
+                 const MetaRectangle *rect)
+{
+  MetaRectangle dest;
+  int i;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      if (meta_rectangle_intersect (rect, &rects[i], &dest))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+test_overlaps (void)
+{
+  MetaRectangle screen_rect;
+  int run;
+
+  screen_rect = meta_rect (0, 0, 1600, 1200);
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      MetaRectIndex *index;
+      MetaRectangle *rects;
+      int n_rects;
+      int i;
+
+      n_rects = g_rand_int_range (grand, 0, 100);
+      rects = g_new (MetaRectangle, MAX (n_rects, 1));
+      index = meta_rect_index_new (&screen_rect);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          get_random_rect (&rects[i]);
+          meta_rect_index_add (index, &rects[i]);
+        }
+
+      for (i = 0; i < 1000; i++)
+        {
+          MetaRectangle rect;
+
+          get_random_rect (&rect);
+          g_assert (meta_rect_index_overlaps (index, &rect) ==
+                    linear_overlaps (rects, n_rects, &rect));
+        }
+
+      /* Touching isn't overlapping */
+      for (i = 0; i < n_rects; i++)
+        {
+          MetaRectangle rect = rects[i];
+
+          if (rect.width <= 0 || rect.height <= 0)
+            continue;
+
+          g_assert (meta_rect_index_overlaps (index, &rect));
+
+          rect.x += rect.width;
+          g_assert (meta_rect_index_overlaps (index, &rect) ==
+                    linear_overlaps (rects, n_rects, &rect));
+        }
+
+      meta_rect_index_free (index);
+      g_free (rects);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* Places windows the way find_first_fit() does, next to the windows
+ * already there, until n_windows have been placed; the screen is made
+ * big enough for them to fit without overlapping. As in place.c, the
+ * index is built again for each window placed. Returns the number of
+ * positions tried.
+ */
+static int
+place_windows (int      n_windows,
+               gboolean use_index)
+{
+  MetaRectangle screen_rect;
+  MetaRectangle *placed;
+  MetaRectIndex *index;
+  int columns;
+  int n_tries;
+  int i;
+
+  columns = 1;
+  while (columns * columns < n_windows)
+    columns++;
+
+  screen_rect = meta_rect (0, 0, columns * 200, columns * 150);
+  placed = g_new (MetaRectangle, n_windows);
+
+  n_tries = 0;
+  for (i = 0; i < n_windows; i++)
+    {
+      MetaRectangle rect;
+      gboolean found;
+      int j;
+
+      rect = meta_rect (0, 0, 200, 150);
+      found = FALSE;
+
+      index = NULL;
+      if (use_index)
+        {
+          index = meta_rect_index_new (&screen_rect);
+          for (j = 0; j < i; j++)
+            meta_rect_index_add (index, &placed[j]);
+        }
+
+      for (j = -1; j < 2 * i && !found; j++)
+        {
+          if (j >= 0)
+            {
+              const MetaRectangle *other = &placed[j / 2];
+
+              rect.x = other->x + (j % 2 ? other->width : 0);
+              rect.y = other->y + (j % 2 ? 0 : other->height);
+            }
+
+          n_tries++;
+
+          if (!meta_rectangle_contains_rect (&screen_rect, &rect))
+            continue;
+
+          if (use_index)
+            found = !meta_rect_index_overlaps (index, &rect);
+          else
+            found = !linear_overlaps (placed, i, &rect);
+        }
+
+      g_assert (found);
+
+      placed[i] = rect;
+
+      if (index)
+        meta_rect_index_free (index);
+    }
+
+  g_free (placed);
+
+  return n_tries;
+}
+
+static void
+run_benchmark (int n_windows)
+{
+  gint64 start_time;
+  double linear_time;
+  double index_time;
+  int n_tries;
+
+  start_time = g_get_monotonic_time ();
+  n_tries = place_windows (n_windows, FALSE);
+  linear_time = (g_get_monotonic_time () - start_time) / 1000.0;
+
+  start_time = g_get_monotonic_time ();
+  g_assert (place_windows (n_windows, TRUE) == n_tries);
+  index_time = (g_get_monotonic_time () - start_time) / 1000.0;
+
+  printf ("%5d windows, %8d positions tried: %9.3f ms scanning, %8.3f ms indexed\n",
+          n_windows, n_tries, linear_time, index_time);
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean benchmark;
+
+  grand = g_rand_new_with_seed (time (NULL));
+
+  /* --benchmark times placing growing numbers of windows */
+  benchmark = argc > 1 && strcmp (argv[1], "--benchmark") == 0;
+
+  test_overlaps ();
+
+  printf ("All tests passed.\n");
+
+  if (benchmark)
+    {
+      int n_windows;
+
+      for (n_windows = 50; n_windows <= 800; n_windows *= 2)
+        run_benchmark (n_windows);
+    }
+
+  g_rand_free (grand);
+
+  return 0;
+}
@@ -0,0 +1,753 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity incremental stack sorting testing program */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stack-order.h"
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>      /* To initialize random seed */
+
+#define NUM_RANDOM_RUNS 100
+#define NUM_BENCHMARK_WINDOWS 1000
+#define NUM_BENCHMARK_RAISES 10000
+#define NUM_BENCHMARK_PASSES 100
+
+static GRand *grand = NULL;
+
+/* Just what the stack looks at in a MetaWindow */
+typedef struct
+{
+  int      layer;
+  int      stack_position;
+  gboolean moved;
+} TestWindow;
+
+typedef struct
+{
+  TestWindow  *windows;
+  TestWindow **by_position;
+  int          n_windows;
+  GPtrArray   *sorted;
+} TestStack;
+
+/* Top to bottom, as compare_window_position() in stack.c */
+static int
+compare_window_position (gconstpointer a,
+                         gconstpointer b)
+{
+  const TestWindow *window_a = a;
+  const TestWindow *window_b = b;
+
+  if (window_a->layer != window_b->layer)
+    return window_a->layer < window_b->layer ? 1 : -1;
+  else if (window_a->stack_position != window_b->stack_position)
+    return window_a->stack_position < window_b->stack_position ? 1 : -1;
+  else
+    return 0;
+}
+
+static gboolean
+window_moved (gconstpointer item)
+{
+  const TestWindow *window = item;
+
+  return window->moved;
+}
+
+static gint
+compare_indirect (gconstpointer a,
+                  gconstpointer b)
+{
+  return compare_window_position (*(gconstpointer *) a, *(gconstpointer *) b);
+}
+
+static TestStack *
+stack_new (int n_windows)
+{
+  TestStack *stack;
+  int i;
+
+  stack = g_new0 (TestStack, 1);
+  stack->n_windows = n_windows;
+  stack->windows = g_new0 (TestWindow, MAX (n_windows, 1));
+  stack->by_position = g_new0 (TestWindow *, MAX (n_windows, 1));
+  stack->sorted = g_ptr_array_new ();
+
+  for (i = 0; i < n_windows; i++)
+    {
+      TestWindow *window = &stack->windows[i];
+
+      window->layer = g_rand_int_range (grand, 0, 8);
+      window->stack_position = i;
+      window->moved = TRUE;
+
+      stack->by_position[i] = window;
+      g_ptr_array_add (stack->sorted, window);
+    }
+
+  return stack;
+}
+
+static void
+stack_free (TestStack *stack)
+{
+  g_ptr_array_free (stack->sorted, TRUE);
+  g_free (stack->by_position);
+  g_free (stack->windows);
+  g_free (stack);
+}
+
+/* As meta_window_set_stack_position_no_sync() */
+static void
+set_stack_position (TestStack  *stack,
+                    TestWindow *window,
+                    int         position)
+{
+  int i;
+
+  if (position < window->stack_position)
+    {
+      for (i = window->stack_position; i > position; i--)
+        {
+          stack->by_position[i] = stack->by_position[i - 1];
+          stack->by_position[i]->stack_position = i;
+        }
+    }
+  else
+    {
+      for (i = window->stack_position; i < position; i++)
+        {
+          stack->by_position[i] = stack->by_position[i + 1];
+          stack->by_position[i]->stack_position = i;
+        }
+    }
+
+  stack->by_position[position] = window;
+  window->stack_position = position;
+  window->moved = TRUE;
+}
+
+static void
+resort (TestStack *stack)
+{
+  int i;
+
+  meta_stack_order_resort (stack->sorted, window_moved,
+                           compare_window_position);
+
+  for (i = 0; i < stack->n_windows; i++)
+    stack->windows[i].moved = FALSE;
+}
+
+static void
+random_changes (TestStack *stack)
+{
+  int n_changes;
+  int i;
+
+  n_changes = g_rand_int_range (grand, 0, 10);
+
+  for (i = 0; i < n_changes; i++)
+    {
+      TestWindow *window;
+
+      window = &stack->windows[g_rand_int_range (grand, 0, stack->n_windows)];
+
+      switch (g_rand_int_range (grand, 0, 4))
+        {
+        case 0:
+          set_stack_position (stack, window, stack->n_windows - 1);
+          break;
+        case 1:
+          set_stack_position (stack, window, 0);
+          break;
+        case 2:
+          set_stack_position (stack, window,
+                              g_rand_int_range (grand, 0, stack->n_windows));
+          break;
+        case 3:
+          window->layer = g_rand_int_range (grand, 0, 8);
+          window->moved = TRUE;
+          break;
+        }
+    }
+}
+
+static void
+test_resort (void)
+{
+  int run;
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      TestStack *stack;
+      GPtrArray *expected;
+      int round;
+      int i;
+
+      stack = stack_new (g_rand_int_range (grand, 1, 300));
+      resort (stack);
+
+      for (round = 0; round < 50; round++)
+        {
+          random_changes (stack);
+          resort (stack);
+
+          /* The same order as sorting everything from scratch */
+          expected = g_ptr_array_new ();
+          for (i = 0; i < stack->n_windows; i++)
+            g_ptr_array_add (expected, &stack->windows[i]);
+          g_ptr_array_sort (expected, compare_indirect);
+
+          g_assert (stack->sorted->len == expected->len);
+          for (i = 0; i < stack->n_windows; i++)
+            g_assert (g_ptr_array_index (stack->sorted, i) ==
+                      g_ptr_array_index (expected, i));
+
+          g_ptr_array_free (expected, TRUE);
+        }
+
+      stack_free (stack);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* The length of the longest increasing subsequence, the slow way */
+static int
+longest_increasing_length (const int *order,
+                           int        n_items)
+{
+  int *lengths;
+  int longest;
+  int i, j;
+
+  lengths = g_new (int, MAX (n_items, 1));
+  longest = 0;
+
+  for (i = 0; i < n_items; i++)
+    {
+      lengths[i] = 1;
+
+      for (j = 0; j < i; j++)
+        if (order[j] < order[i] && lengths[j] + 1 > lengths[i])
+          lengths[i] = lengths[j] + 1;
+
+      longest = MAX (longest, lengths[i]);
+    }
+
+  g_free (lengths);
+
+  return longest;
+}
+
+static void
+test_find_kept (void)
+{
+  int run;
+
+  for (run = 0; run < NUM_RANDOM_RUNS * 10; run++)
+    {
+      int *order;
+      gboolean *kept;
+      int n_items;
+      int n_kept;
+      int n_marked;
+      int last;
+      int i;
+
+      /* A stack with a few windows moved about, as after a restack */
+      n_items = g_rand_int_range (grand, 0, 200);
+      order = g_new (int, MAX (n_items, 1));
+      kept = g_new (gboolean, MAX (n_items, 1));
+
+      for (i = 0; i < n_items; i++)
+        order[i] = i;
+
+      for (i = g_rand_int_range (grand, 0, 20); i > 0 && n_items > 1; i--)
+        {
+          int a = g_rand_int_range (grand, 0, n_items);
+          int b = g_rand_int_range (grand, 0, n_items);
+          int tmp = order[a];
+
+          order[a] = order[b];
+          order[b] = tmp;
+        }
+
+      n_kept = meta_stack_order_find_kept (order, n_items, kept);
+
+      g_assert (n_kept == longest_increasing_length (order, n_items));
+
+      /* The kept items are in order, and there are n_kept of them */
+      n_marked = 0;
+      last = -1;
+      for (i = 0; i < n_items; i++)
+        {
+          if (!kept[i])
+            continue;
+
+          g_assert (order[i] > last);
+          last = order[i];
+          n_marked += 1;
+        }
+      g_assert (n_marked == n_kept);
+
+      g_free (kept);
+      g_free (order);
+    }
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+typedef struct
+{
+  int above;
+  int below;
+} ConstraintPair;
+
+/* A forest of transient windows, mostly in long chains, with some
+ * windows transient for a whole group of others. Some pairs are given
+ * more than once, as walking both groups and transients can do.
+ */
+static GArray *
+random_transient_forest (int n_windows)
+{
+  GArray *pairs;
+  int i;
+
+  pairs = g_array_new (FALSE, FALSE, sizeof (ConstraintPair));
+
+  for (i = 1; i < n_windows; i++)
+    {
+      ConstraintPair pair;
+      int n_parents;
+
+      switch (g_rand_int_range (grand, 0, 10))
+        {
+        case 0:
+        case 1:
+          n_parents = 0;
+          break;
+        case 2:
+          n_parents = g_rand_int_range (grand, 2, 6);
+          break;
+        default:
+          n_parents = 1;
+          break;
+        }
+
+      pair.above = i;
+
+      if (n_parents == 1 && g_rand_boolean (grand))
+        {
+          pair.below = i - 1;
+          g_array_append_val (pairs, pair);
+          if (g_rand_int_range (grand, 0, 10) == 0)
+            g_array_append_val (pairs, pair);
+          continue;
+        }
+
+      while (n_parents-- > 0)
+        {
+          pair.below = g_rand_int_range (grand, 0, i);
+          g_array_append_val (pairs, pair);
+        }
+    }
+
+  return pairs;
+}
+
+static void
+ensure_above (gpointer data_above,
+              gpointer data_below,
+              gpointer user_data)
+{
+  TestStack *stack = user_data;
+  TestWindow *above = data_above;
+  TestWindow *below = data_below;
+
+  if (above->stack_position < below->stack_position)
+    set_stack_position (stack, above, below->stack_position);
+}
+
+/* What stack_do_constrain() used to do */
+typedef struct OldConstraint OldConstraint;
+
+struct OldConstraint
+{
+  TestWindow    *above;
+  TestWindow    *below;
+  OldConstraint *next;
+  GSList        *next_nodes;
+  unsigned int   applied : 1;
+  unsigned int   has_prev : 1;
+};
+
+static void
+old_traverse_constraint (OldConstraint *c,
+                         TestStack     *stack)
+{
+  GSList *tmp;
+
+  if (c->applied)
+    return;
+
+  ensure_above (c->above, c->below, stack);
+  c->applied = TRUE;
+
+  for (tmp = c->next_nodes; tmp != NULL; tmp = tmp->next)
+    old_traverse_constraint (tmp->data, stack);
+}
+
+static void
+old_constrain (TestStack *stack,
+               GArray    *pairs)
+{
+  OldConstraint **constraints;
+  GSList *heads;
+  GSList *tmp;
+  guint i;
+  int j;
+
+  constraints = g_new0 (OldConstraint *, stack->n_windows);
+
+  for (i = 0; i < pairs->len; i++)
+    {
+      ConstraintPair *pair = &g_array_index (pairs, ConstraintPair, i);
+      TestWindow *above = &stack->windows[pair->above];
+      TestWindow *below = &stack->windows[pair->below];
+      OldConstraint *c;
+
+      /* check if constraint is a duplicate */
+      c = constraints[below->stack_position];
+      while (c != NULL)
+        {
+          if (c->above == above)
+            break;
+          c = c->next;
+        }
+
+      if (c != NULL)
+        continue;
+
+      c = g_new (OldConstraint, 1);
+      c->above = above;
+      c->below = below;
+      c->next = constraints[c->below->stack_position];
+      c->next_nodes = NULL;
+      c->applied = FALSE;
+      c->has_prev = FALSE;
+
+      constraints[c->below->stack_position] = c;
+    }
+
+  for (j = 0; j < stack->n_windows; j++)
+    {
+      OldConstraint *c;
+
+      for (c = constraints[j]; c != NULL; c = c->next)
+        {
+          OldConstraint *n;
+
+          for (n = constraints[c->above->stack_position]; n != NULL; n = n->next)
+            {
+              c->next_nodes = g_slist_prepend (c->next_nodes, n);
+              n->has_prev = TRUE;
+            }
+        }
+    }
+
+  heads = NULL;
+  for (j = 0; j < stack->n_windows; j++)
+    {
+      OldConstraint *c;
+
+      for (c = constraints[j]; c != NULL; c = c->next)
+        if (!c->has_prev)
+          heads = g_slist_prepend (heads, c);
+    }
+
+  for (tmp = heads; tmp != NULL; tmp = tmp->next)
+    old_traverse_constraint (tmp->data, stack);
+
+  g_slist_free (heads);
+
+  for (j = 0; j < stack->n_windows; j++)
+    {
+      OldConstraint *c = constraints[j];
+
+      while (c != NULL)
+        {
+          OldConstraint *next = c->next;
+
+          g_slist_free (c->next_nodes);
+          g_free (c);
+
+          c = next;
+        }
+    }
+
+  g_free (constraints);
+}
+
+static void
+constrain (TestStack            *stack,
+           GArray               *pairs,
+           MetaStackConstraints *constraints)
+{
+  guint i;
+
+  meta_stack_constraints_begin (constraints, stack->n_windows);
+
+  for (i = 0; i < pairs->len; i++)
+    {
+      ConstraintPair *pair = &g_array_index (pairs, ConstraintPair, i);
+      TestWindow *above = &stack->windows[pair->above];
+      TestWindow *below = &stack->windows[pair->below];
+
+      meta_stack_constraints_add (constraints,
+                                  above, above->stack_position,
+                                  below, below->stack_position);
+    }
+
+  meta_stack_constraints_apply (constraints, ensure_above, stack);
+}
+
+/* Puts the windows back at the positions in order */
+static void
+reset_positions (TestStack *stack,
+                 const int *positions)
+{
+  int i;
+
+  for (i = 0; i < stack->n_windows; i++)
+    {
+      stack->windows[i].stack_position = positions[i];
+      stack->by_position[positions[i]] = &stack->windows[i];
+    }
+}
+
+static int *
+random_positions (int n_windows)
+{
+  int *positions;
+  int i;
+
+  positions = g_new (int, n_windows);
+
+  for (i = 0; i < n_windows; i++)
+    positions[i] = i;
+
+  for (i = n_windows - 1; i > 0; i--)
+    {
+      int j = g_rand_int_range (grand, 0, i + 1);
+      int tmp = positions[i];
+
+      positions[i] = positions[j];
+      positions[j] = tmp;
+    }
+
+  return positions;
+}
+
+static void
+test_constraints (void)
+{
+  MetaStackConstraints *constraints;
+  int run;
+
+  constraints = meta_stack_constraints_new ();
+
+  for (run = 0; run < NUM_RANDOM_RUNS; run++)
+    {
+      TestStack *stack;
+      GArray *pairs;
+      int *positions;
+      int *expected;
+      int n_windows;
+      int i;
+
+      n_windows = g_rand_int_range (grand, 1, 300);
+      stack = stack_new (n_windows);
+      pairs = random_transient_forest (n_windows);
+      positions = random_positions (n_windows);
+      expected = g_new (int, n_windows);
+
+      reset_positions (stack, positions);
+      old_constrain (stack, pairs);
+      for (i = 0; i < n_windows; i++)
+        expected[i] = stack->windows[i].stack_position;
+
+      /* The same constraints in the same order, so the same result */
+      reset_positions (stack, positions);
+      constrain (stack, pairs, constraints);
+      for (i = 0; i < n_windows; i++)
+        g_assert (stack->windows[i].stack_position == expected[i]);
+
+      g_free (expected);
+      g_free (positions);
+      g_array_free (pairs, TRUE);
+      stack_free (stack);
+    }
+
+  meta_stack_constraints_free (constraints);
+
+  printf ("%s passed.\n", G_STRFUNC);
+}
+
+/* Raising a window at a time, as when clicking through windows */
+static void
+run_benchmark (void)
+{
+  TestStack *stack;
+  GList *list;
+  GList *l;
+  int *raised;
+  gint64 start_time;
+  double list_time;
+  double array_time;
+  int i;
+
+  stack = stack_new (NUM_BENCHMARK_WINDOWS);
+  resort (stack);
+
+  raised = g_new (int, NUM_BENCHMARK_RAISES);
+  for (i = 0; i < NUM_BENCHMARK_RAISES; i++)
+    raised[i] = g_rand_int_range (grand, 0, NUM_BENCHMARK_WINDOWS);
+
+  /* What stack_do_resort() used to do */
+  list = NULL;
+  for (i = stack->n_windows - 1; i >= 0; i--)
+    list = g_list_prepend (list, g_ptr_array_index (stack->sorted, i));
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_BENCHMARK_RAISES; i++)
+    {
+      set_stack_position (stack, &stack->windows[raised[i]],
+                          stack->n_windows - 1);
+      list = g_list_sort (list, compare_window_position);
+    }
+  list_time = (g_get_monotonic_time () - start_time) /
+    (double) NUM_BENCHMARK_RAISES;
+
+  /* Carry on from the order the list ended up in */
+  g_ptr_array_set_size (stack->sorted, 0);
+  for (l = list; l != NULL; l = l->next)
+    g_ptr_array_add (stack->sorted, l->data);
+
+  for (i = 0; i < stack->n_windows; i++)
+    stack->windows[i].moved = FALSE;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < NUM_BENCHMARK_RAISES; i++)
+    {
+      set_stack_position (stack, &stack->windows[raised[i]],
+                          stack->n_windows - 1);
+      resort (stack);
+    }
+  array_time = (g_get_monotonic_time () - start_time) /
+    (double) NUM_BENCHMARK_RAISES;
+
+  printf ("%d windows: %.2f us per raise sorting the list, "
+          "%.2f us re-sorting the array\n",
+          NUM_BENCHMARK_WINDOWS, list_time, array_time);
+
+  g_list_free (list);
+  g_free (raised);
+  stack_free (stack);
+}
+
+static void
+run_constraints_benchmark (int n_windows)
+{
+  MetaStackConstraints *constraints;
+  TestStack *stack;
+  GArray *pairs;
+  int *positions;
+  gint64 start_time;
+  double old_time;
+  double new_time;
+  int pass;
+
+  stack = stack_new (n_windows);
+  pairs = random_transient_forest (n_windows);
+  positions = random_positions (n_windows);
+  constraints = meta_stack_constraints_new ();
+
+  start_time = g_get_monotonic_time ();
+  for (pass = 0; pass < NUM_BENCHMARK_PASSES; pass++)
+    {
+      reset_positions (stack, positions);
+      old_constrain (stack, pairs);
+    }
+  old_time = (g_get_monotonic_time () - start_time) /
+    (double) NUM_BENCHMARK_PASSES;
+
+  start_time = g_get_monotonic_time ();
+  for (pass = 0; pass < NUM_BENCHMARK_PASSES; pass++)
+    {
+      reset_positions (stack, positions);
+      constrain (stack, pairs, constraints);
+    }
+  new_time = (g_get_monotonic_time () - start_time) /
+    (double) NUM_BENCHMARK_PASSES;
+
+  printf ("%5d transient windows, %5u constraints: %8.1f us per pass "
+          "allocating, %8.1f us reusing storage\n",
+          n_windows, pairs->len, old_time, new_time);
+
+  meta_stack_constraints_free (constraints);
+  g_free (positions);
+  g_array_free (pairs, TRUE);
+  stack_free (stack);
+}
+
+int
+main (int argc, char **argv)
+{
+  gboolean benchmark;
+
+  grand = g_rand_new_with_seed (time (NULL));
+
+  /* --benchmark times raising windows in a stack of 1000, and
+   * reapplying constraints in growing forests of transient windows
+   */
+  benchmark = argc > 1 && strcmp (argv[1], "--benchmark") == 0;
+
+  test_resort ();
+  test_find_kept ();
+  test_constraints ();
+
+  printf ("All tests passed.\n");
+
+  if (benchmark)
+    {
+      int n_windows;
+
+      run_benchmark ();
+
+      for (n_windows = 100; n_windows <= 10000; n_windows *= 10)
+        run_constraints_benchmark (n_windows);
+    }
+
+  g_rand_free (grand);
+
+  return 0;
+}
@@ -0,0 +1,361 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Times workspace switches against a running window manager */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Run it on a display with the window manager already up, e.g.
+ *
+ *   Xvfb :9 & DISPLAY=:9 metacity & DISPLAY=:9 ./testworkspaceswitch 100
+ *
+ * It puts N windows on each of the first two workspaces and switches
+ * between them, timing each switch from the request until every window
+ * has been mapped or unmapped. Meanwhile a second connection keeps
+ * making round trips, the way any other client would, and reports the
+ * longest it had to wait: while the window manager grabs the server,
+ * that is how long everything else on the display is frozen.
+ */
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define DEFAULT_N_WINDOWS 50
+#define DEFAULT_N_SWITCHES 20
+
+/* Give up on the window manager after this long */
+#define TIMEOUT_MS 10000.0
+
+static Atom atom_net_current_desktop;
+static Atom atom_net_number_of_desktops;
+static Atom atom_net_wm_desktop;
+static Atom atom_wm_state;
+
+static double
+now_ms (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static long
+get_cardinal (Display *xdisplay,
+              Window   xwindow,
+              Atom     atom)
+{
+  Atom type;
+  int format;
+  unsigned long n_items;
+  unsigned long bytes_after;
+  unsigned char *data;
+  long result;
+
+  data = NULL;
+  result = -1;
+
+  if (XGetWindowProperty (xdisplay, xwindow, atom,
+                          0, 1, False, XA_CARDINAL,
+                          &type, &format, &n_items, &bytes_after,
+                          &data) == Success &&
+      type == XA_CARDINAL && format == 32 && n_items == 1)
+    result = ((long *) data)[0];
+
+  if (data)
+    XFree (data);
+
+  return result;
+}
+
+static int
+find_window (Window *windows,
+             int     n_windows,
+             Window  xwindow)
+{
+  int i;
+
+  for (i = 0; i < n_windows; i++)
+    {
+      if (windows[i] == xwindow)
+        return i;
+    }
+
+  return -1;
+}
+
+/* Times one round trip on the probe connection */
+static double
+probe_round_trip (Display *probe)
+{
+  double start;
+
+  start = now_ms ();
+  XSync (probe, False);
+
+  return now_ms () - start;
+}
+
+static void
+wait_for_events (Display *xdisplay,
+                 int      timeout_ms)
+{
+  struct pollfd fd;
+
+  if (XPending (xdisplay) > 0)
+    return;
+
+  fd.fd = ConnectionNumber (xdisplay);
+  fd.events = POLLIN;
+
+  poll (&fd, 1, timeout_ms);
+}
+
+static void
+send_switch (Display *xdisplay,
+             long     workspace)
+{
+  XEvent xev;
+
+  memset (&xev, 0, sizeof (xev));
+  xev.xclient.type = ClientMessage;
+  xev.xclient.send_event = True;
+  xev.xclient.window = DefaultRootWindow (xdisplay);
+  xev.xclient.message_type = atom_net_current_desktop;
+  xev.xclient.format = 32;
+  xev.xclient.data.l[0] = workspace;
+  xev.xclient.data.l[1] = CurrentTime;
+
+  XSendEvent (xdisplay, DefaultRootWindow (xdisplay), False,
+              SubstructureRedirectMask | SubstructureNotifyMask,
+              &xev);
+  XFlush (xdisplay);
+}
+
+int
+main (int argc, char **argv)
+{
+  Display *xdisplay;
+  Display *probe;
+  Window *windows;
+  Bool *managed;
+  int n_windows;
+  int n_switches;
+  int n_managed;
+  long workspace;
+  double start;
+  double total_time;
+  double max_time;
+  double max_stall;
+  int i;
+
+  n_windows = DEFAULT_N_WINDOWS;
+  if (argc > 1)
+    n_windows = atoi (argv[1]);
+
+  n_switches = DEFAULT_N_SWITCHES;
+  if (argc > 2)
+    n_switches = atoi (argv[2]);
+
+  if (n_windows <= 0 || n_switches <= 0)
+    {
+      fprintf (stderr, "usage: %s [WINDOWS_PER_WORKSPACE [SWITCHES]]\n",
+               argv[0]);
+      return 1;
+    }
+
+  xdisplay = XOpenDisplay (NULL);
+  probe = XOpenDisplay (NULL);
+  if (xdisplay == NULL || probe == NULL)
+    {
+      fprintf (stderr, "Could not open display\n");
+      return 1;
+    }
+
+  atom_net_current_desktop = XInternAtom (xdisplay, "_NET_CURRENT_DESKTOP", False);
+  atom_net_number_of_desktops = XInternAtom (xdisplay, "_NET_NUMBER_OF_DESKTOPS", False);
+  atom_net_wm_desktop = XInternAtom (xdisplay, "_NET_WM_DESKTOP", False);
+  atom_wm_state = XInternAtom (xdisplay, "WM_STATE", False);
+
+  if (get_cardinal (xdisplay, DefaultRootWindow (xdisplay),
+                    atom_net_number_of_desktops) < 2)
+    {
+      fprintf (stderr, "Need a window manager with at least two workspaces\n");
+      return 1;
+    }
+
+  /* Even windows go on the first workspace, odd ones on the second */
+  windows = calloc (n_windows * 2, sizeof (Window));
+  managed = calloc (n_windows * 2, sizeof (Bool));
+
+  for (i = 0; i < n_windows * 2; i++)
+    {
+      long desktop;
+
+      windows[i] = XCreateSimpleWindow (xdisplay, DefaultRootWindow (xdisplay),
+                                        (i * 7) % 400, (i * 11) % 300,
+                                        200, 150, 0, 0,
+                                        WhitePixel (xdisplay,
+                                                    DefaultScreen (xdisplay)));
+
+      XSelectInput (xdisplay, windows[i],
+                    StructureNotifyMask | PropertyChangeMask);
+
+      desktop = i % 2;
+      XChangeProperty (xdisplay, windows[i], atom_net_wm_desktop,
+                       XA_CARDINAL, 32, PropModeReplace,
+                       (unsigned char *) &desktop, 1);
+
+      XMapWindow (xdisplay, windows[i]);
+    }
+
+  /* The window manager sets WM_STATE on every window it manages,
+   * whichever workspace it is on
+   */
+  n_managed = 0;
+  start = now_ms ();
+  while (n_managed < n_windows * 2)
+    {
+      XEvent xevent;
+
+      if (now_ms () - start > TIMEOUT_MS)
+        {
+          fprintf (stderr, "Only %d of %d windows were managed\n",
+                   n_managed, n_windows * 2);
+          return 1;
+        }
+
+      wait_for_events (xdisplay, 100);
+
+      while (XPending (xdisplay) > 0)
+        {
+          XNextEvent (xdisplay, &xevent);
+
+          if (xevent.type == PropertyNotify &&
+              xevent.xproperty.atom == atom_wm_state &&
+              xevent.xproperty.state == PropertyNewValue)
+            {
+              int index;
+
+              index = find_window (windows, n_windows * 2,
+                                   xevent.xproperty.window);
+              if (index >= 0 && !managed[index])
+                {
+                  managed[index] = True;
+                  n_managed += 1;
+                }
+            }
+        }
+    }
+
+  /* Start out on the first workspace */
+  send_switch (xdisplay, 0);
+  XSync (xdisplay, True);
+  usleep (500 * 1000);
+  XSync (xdisplay, True);
+
+  printf ("Switching %d times between two workspaces with %d windows each\n",
+          n_switches, n_windows);
+
+  total_time = 0.0;
+  max_time = 0.0;
+  max_stall = 0.0;
+  workspace = 0;
+
+  for (i = 0; i < n_switches; i++)
+    {
+      int n_mapped;
+      int n_unmapped;
+      double end;
+      double elapsed;
+
+      workspace = 1 - workspace;
+      n_mapped = 0;
+      n_unmapped = 0;
+
+      start = now_ms ();
+      end = start;
+      send_switch (xdisplay, workspace);
+
+      while (n_mapped < n_windows || n_unmapped < n_windows)
+        {
+          double stall;
+
+          if (now_ms () - start > TIMEOUT_MS)
+            {
+              fprintf (stderr, "Switch %d timed out: %d mapped, %d unmapped\n",
+                       i, n_mapped, n_unmapped);
+              return 1;
+            }
+
+          stall = probe_round_trip (probe);
+          if (stall > max_stall)
+            max_stall = stall;
+
+          wait_for_events (xdisplay, 1);
+
+          while (XPending (xdisplay) > 0)
+            {
+              XEvent xevent;
+              int index;
+
+              XNextEvent (xdisplay, &xevent);
+
+              if (xevent.type == MapNotify)
+                {
+                  index = find_window (windows, n_windows * 2,
+                                       xevent.xmap.window);
+                  if (index >= 0 && index % 2 == workspace)
+                    n_mapped += 1;
+                }
+              else if (xevent.type == UnmapNotify)
+                {
+                  index = find_window (windows, n_windows * 2,
+                                       xevent.xunmap.window);
+                  if (index >= 0 && index % 2 != workspace)
+                    n_unmapped += 1;
+                }
+              else
+                continue;
+
+              end = now_ms ();
+            }
+        }
+
+      elapsed = end - start;
+      total_time += elapsed;
+      if (elapsed > max_time)
+        max_time = elapsed;
+    }
+
+  printf ("Switch time: %.2f ms on average, %.2f ms at most\n",
+          total_time / n_switches, max_time);
+  printf ("Longest round trip for another client: %.2f ms\n", max_stall);
+
+  XCloseDisplay (probe);
+  XCloseDisplay (xdisplay);
+  free (windows);
+  free (managed);
+
+  return 0;
+}
@@ -57,7 +57,8 @@ static const GDebugKey debug_keys[] = {
   { "edge-resistance", META_DEBUG_EDGE_RESISTANCE },
   { "verbose", META_DEBUG_VERBOSE },
   { "vulkan", META_DEBUG_VULKAN },
-  { "damage-region", META_DEBUG_DAMAGE_REGION }
+  { "damage-region", META_DEBUG_DAMAGE_REGION },
+  { "round-trips", META_DEBUG_ROUND_TRIPS }
 };
 
 static guint debug_flags = 0;
@@ -278,6 +279,8 @@ topic_name (MetaDebugFlags topic)
       return "VULKAN";
     case META_DEBUG_DAMAGE_REGION:
       return "DAMAGE_REGION";
+    case META_DEBUG_ROUND_TRIPS:
+      return "ROUND_TRIPS";
     default:
       break;
     }
@@ -101,6 +101,12 @@ struct _MetaWindow
   MetaWorkspace *workspace;
   Window xwindow;
 
+  /* Our links in screen->windows and workspace->windows, so that we
+   * can be added and removed without searching; data is the window.
+   */
+  GList screen_link;
+  GList workspace_link;
+
   /* may be NULL! not all windows get decorated */
   MetaFrame *frame;
   guint check_decorated_id;
@@ -363,8 +369,16 @@ struct _MetaWindow
 
   /* XSync update counter */
   XSyncCounter sync_request_counter;
-  guint sync_request_serial;
+  /* the counter is the extended one of _NET_WM_FRAME_DRAWN */
+  gboolean extended_sync_request_counter;
+  /* the value we last asked the client for, and the one it last set */
+  guint64 sync_request_serial;
+  guint64 sync_request_counter_value;
+  /* whether the alarm has told us sync_request_counter_value yet */
+  gboolean sync_request_counter_value_known;
   gint64 sync_request_time;
+  /* running average of how long, in us, the client takes to sync */
+  gint64 sync_request_latency;
   /* alarm monitoring client's _NET_WM_SYNC_REQUEST_COUNTER */
   XSyncAlarm sync_request_alarm;
 
@@ -424,6 +438,7 @@ struct _MetaWindow
   /* Managed by stack.c */
   MetaStackLayer layer;
   int stack_position; /* see comment in stack.h */
+  int stack_index;    /* index in the sorted stack, -1 if it needs placing */
 
   /* Current dialog open for this window */
   int dialog_pid;
@@ -458,10 +473,20 @@ struct _MetaWindow
 #define META_WINDOW_ALLOWS_HORIZONTAL_RESIZE(w) (META_WINDOW_ALLOWS_RESIZE_EXCEPT_HINTS (w) && (w)->size_hints.min_width < (w)->size_hints.max_width)
 #define META_WINDOW_ALLOWS_VERTICAL_RESIZE(w)   (META_WINDOW_ALLOWS_RESIZE_EXCEPT_HINTS (w) && (w)->size_hints.min_height < (w)->size_hints.max_height)
 
+/* Initial property values requested ahead of meta_window_new(), see
+ * window-props.h
+ */
+typedef struct _MetaWindowPrefetch MetaWindowPrefetch;
+
 MetaWindow* meta_window_new                (MetaDisplay    *display,
                                             Window          xwindow,
                                             gboolean        must_be_viewable,
                                             MetaEffectType  effect);
+MetaWindow* meta_window_new_prefetched     (MetaDisplay        *display,
+                                            Window              xwindow,
+                                            gboolean            must_be_viewable,
+                                            MetaEffectType      effect,
+                                            MetaWindowPrefetch *prefetch);
 void        meta_window_unmanage           (MetaWindow  *window,
                                             guint32      timestamp);
 void        meta_window_calc_showing       (MetaWindow  *window);
@@ -609,6 +634,9 @@ void     meta_window_shove_titlebar_onscreen (MetaWindow *window);
 void meta_window_update_sync_request_counter (MetaWindow *window,
                                               guint64     new_counter_value);
 
+void meta_window_set_updates_frozen_for_resize (MetaWindow *window,
+                                                gboolean    updates_frozen);
+
 void meta_window_handle_mouse_grab_op_event (MetaWindow *window,
                                              XEvent     *event);
 
@@ -40,6 +40,8 @@
 #include "window-props.h"
 #include "errors.h"
 #include "xprops.h"
+#include "async-getprop.h"
+#include "round-trips.h"
 #include "frame-private.h"
 #include "group.h"
 #include <X11/Xatom.h>
@@ -91,6 +93,33 @@ static void reload_prop_value          (MetaWindow          *window,
 static MetaWindowPropHooks* find_hooks (MetaDisplay *display,
                                         Atom         property);
 
+typedef struct
+{
+  MetaWindow          *window;
+  MetaWindowPropHooks *hooks;
+  MetaPropValue        value;
+} PropertyReload;
+
+static void
+property_reload_cb (MetaDisplay   *display,
+                    MetaPropValue *values,
+                    int            n_values,
+                    gpointer       user_data)
+{
+  PropertyReload *reload;
+
+  reload = user_data;
+
+  /* Nothing to update if the window went away in the meantime */
+  if (!reload->window->unmanaging)
+    reload_prop_value (reload->window, reload->hooks, values, FALSE);
+
+  meta_prop_free_values (values, n_values);
+
+  g_object_unref (reload->window);
+  g_free (reload);
+}
+
 void
 meta_window_reload_property_from_xwindow (MetaWindow *window,
                                           Window      xwindow,
@@ -107,6 +136,26 @@ meta_window_reload_property_from_xwindow (MetaWindow *window,
   if ((hooks->flags & INIT_ONLY) && !initial)
     return;
 
+  /* Changes notified after the window was set up don't need to be
+   * dealt with right away; run the hook once the reply comes in rather
+   * than blocking the processing of every PropertyNotify on it.
+   */
+  if (!initial)
+    {
+      PropertyReload *reload;
+
+      reload = g_new0 (PropertyReload, 1);
+      reload->window = g_object_ref (window);
+      reload->hooks = hooks;
+
+      init_prop_value (window, hooks, &reload->value);
+
+      meta_prop_get_values_async (window->display, xwindow,
+                                  &reload->value, 1,
+                                  property_reload_cb, reload);
+      return;
+    }
+
   init_prop_value (window, hooks, &value);
 
   meta_prop_get_values (window->display, xwindow,
@@ -129,29 +178,152 @@ meta_window_reload_property (MetaWindow *window,
                                             initial);
 }
 
-void
-meta_window_load_initial_properties (MetaWindow *window)
+struct _MetaWindowPrefetch
+{
+  MetaDisplay     *display;
+
+  /* NULL once the reply has been collected */
+  AgGetAttributesTask *attrs_task;
+
+  MetaPropValue   *values;
+  int              n_values;
+
+  /* NULL once the replies have been collected */
+  MetaPropRequest *request;
+};
+
+MetaWindowPrefetch*
+meta_window_prefetch_initial_properties (MetaDisplay *display,
+                                         Window       xwindow)
 {
+  MetaWindowPrefetch *prefetch;
   int i, j;
-  MetaPropValue *values;
-  int n_properties = 0;
 
-  values = g_new0 (MetaPropValue, window->display->n_prop_hooks);
+  prefetch = g_new0 (MetaWindowPrefetch, 1);
+  prefetch->display = display;
+
+  /* Sent first, since window_new() wants it before the properties */
+  prefetch->attrs_task = ag_attributes_task_create (display->xdisplay,
+                                                    xwindow);
 
+  prefetch->values = g_new0 (MetaPropValue, display->n_prop_hooks);
+
+  /* We can't tell override-redirect windows apart yet, so ask for
+   * everything; reload_prop_value() skips what they don't use.
+   */
   j = 0;
-  for (i = 0; i < window->display->n_prop_hooks; i++)
+  for (i = 0; i < display->n_prop_hooks; i++)
     {
-      MetaWindowPropHooks *hooks = &window->display->prop_hooks_table[i];
+      MetaWindowPropHooks *hooks = &display->prop_hooks_table[i];
       if (hooks->flags & LOAD_INIT)
         {
-          init_prop_value (window, hooks, &values[j]);
+          if (hooks->type == META_PROP_VALUE_INVALID)
+            {
+              prefetch->values[j].type = META_PROP_VALUE_INVALID;
+              prefetch->values[j].atom = None;
+            }
+          else
+            {
+              prefetch->values[j].type = hooks->type;
+              prefetch->values[j].atom = hooks->property;
+            }
           ++j;
         }
     }
-  n_properties = j;
+  prefetch->n_values = j;
+
+  prefetch->request = meta_prop_request_values (display, xwindow,
+                                                prefetch->values,
+                                                prefetch->n_values);
+
+  return prefetch;
+}
+
+gboolean
+meta_window_prefetch_get_attributes (MetaWindowPrefetch *prefetch,
+                                     XWindowAttributes  *attrs)
+{
+  Status status;
+
+  if (prefetch->attrs_task == NULL)
+    return FALSE;
+
+  if (!ag_attributes_task_have_reply (prefetch->attrs_task))
+    {
+      gint64 start_time;
+
+      meta_topic (META_DEBUG_SYNC, "Syncing to get window attributes in %s\n",
+                  G_STRFUNC);
+      start_time = meta_round_trip_begin ();
+      XSync (prefetch->display->xdisplay, False);
+      meta_round_trip_end (G_STRFUNC, start_time);
+
+      /* Failed requests leave the task unanswered */
+      ag_fail_unanswered_tasks (prefetch->display->xdisplay);
+    }
+
+  status = ag_attributes_task_get_reply_and_free (prefetch->attrs_task,
+                                                  attrs);
+  prefetch->attrs_task = NULL;
+
+  return status == Success;
+}
+
+void
+meta_window_prefetch_free (MetaWindowPrefetch *prefetch)
+{
+  if (prefetch->attrs_task != NULL)
+    {
+      XWindowAttributes attrs;
+
+      meta_window_prefetch_get_attributes (prefetch, &attrs);
+    }
+
+  /* The tasks can only be freed once their replies are in */
+  if (prefetch->request != NULL)
+    meta_prop_finish_request (prefetch->request);
+
+  meta_prop_free_values (prefetch->values, prefetch->n_values);
+
+  g_free (prefetch->values);
+  g_free (prefetch);
+}
+
+void
+meta_window_load_initial_properties (MetaWindow         *window,
+                                     MetaWindowPrefetch *prefetch)
+{
+  int i, j;
+  MetaPropValue *values;
+  int n_properties = 0;
+
+  if (prefetch != NULL)
+    {
+      values = prefetch->values;
+      n_properties = prefetch->n_values;
+
+      meta_prop_finish_request (prefetch->request);
+      prefetch->request = NULL;
+    }
+  else
+    {
+      values = g_new0 (MetaPropValue, window->display->n_prop_hooks);
 
-  meta_prop_get_values (window->display, window->xwindow,
-                        values, n_properties);
+      j = 0;
+      for (i = 0; i < window->display->n_prop_hooks; i++)
+        {
+          MetaWindowPropHooks *hooks = &window->display->prop_hooks_table[i];
+          if (hooks->flags & LOAD_INIT)
+            {
+              init_prop_value (window, hooks, &values[j]);
+              ++j;
+            }
+        }
+      n_properties = j;
+
+      meta_prop_get_values (window->display, window->xwindow,
+                            values, n_properties);
+    }
 
   j = 0;
   for (i = 0; i < window->display->n_prop_hooks; i++)
@@ -169,6 +341,10 @@ meta_window_load_initial_properties (MetaWindow *window)
         }
     }
 
+  /* Prefetched values are freed along with the prefetch */
+  if (prefetch != NULL)
+    return;
+
   meta_prop_free_values (values, n_properties);
 
   g_free (values);
@@ -1049,13 +1225,35 @@ reload_update_counter (MetaWindow    *window,
 {
   if (value->type != META_PROP_VALUE_INVALID)
     {
-      XSyncCounter counter = value->v.xcounter;
+      int n_counters = value->v.xcounter_list.n_counters;
 
       meta_window_destroy_sync_request_alarm (window);
 
-      window->sync_request_counter = counter;
-      meta_verbose ("Window has _NET_WM_SYNC_REQUEST_COUNTER 0x%lx\n",
+      window->sync_request_counter = None;
+      window->extended_sync_request_counter = FALSE;
+
+      if (n_counters == 0)
+        {
+          meta_verbose ("_NET_WM_SYNC_REQUEST_COUNTER on %s is empty\n",
+                        window->desc);
+          return;
+        }
+
+      /* A second counter is the extended one, which the client also
+       * uses to tell us when it starts and finishes drawing a frame
+       */
+      window->extended_sync_request_counter = n_counters > 1;
+      window->sync_request_counter =
+        value->v.xcounter_list.counters[n_counters > 1 ? 1 : 0];
+
+      meta_verbose ("Window has %s_NET_WM_SYNC_REQUEST_COUNTER 0x%lx\n",
+                    window->extended_sync_request_counter ? "extended " : "",
                     window->sync_request_counter);
+
+      /* Frames are drawn all the time, not only while resizing */
+      if (window->extended_sync_request_counter &&
+          META_DISPLAY_HAS_XSYNC (window->display))
+        meta_window_create_sync_request_alarm (window);
     }
 }
 
@@ -1802,7 +2000,7 @@ meta_display_init_window_prop_hooks (MetaDisplay *display)
     },
     {
       display->atom__NET_WM_SYNC_REQUEST_COUNTER,
-      META_PROP_VALUE_SYNC_COUNTER,
+      META_PROP_VALUE_SYNC_COUNTER_LIST,
       reload_update_counter,
       LOAD_INIT | INCLUDE_OR
     },
@@ -52,9 +52,48 @@ void meta_window_reload_property_from_xwindow (MetaWindow *window,
  * window from the server, and deals with them appropriately.
  * Does not return them to the caller (they've been dealt with!)
  *
- * \param window The window.
+ * \param window    The window.
+ * \param prefetch  Values requested earlier with
+ *                  meta_window_prefetch_initial_properties(), or NULL
+ *                  to request them now.
  */
-void meta_window_load_initial_properties (MetaWindow *window);
+void meta_window_load_initial_properties (MetaWindow         *window,
+                                          MetaWindowPrefetch *prefetch);
+
+/**
+ * Sends the requests for the standard properties of a window that is
+ * about to be managed, without waiting for the replies. Used to fetch
+ * the properties of many windows in a single round-trip.
+ *
+ * \param display  The display.
+ * \param xwindow  The X handle for the window.
+ * \return         The pending values, to be handed to
+ *                 meta_window_new_prefetched().
+ */
+MetaWindowPrefetch* meta_window_prefetch_initial_properties (MetaDisplay *display,
+                                                             Window       xwindow);
+
+/**
+ * Collects the window attributes requested along with the prefetched
+ * properties, waiting for the reply if necessary. Can only be called
+ * once per prefetch.
+ *
+ * \param prefetch  The values returned by
+ *                  meta_window_prefetch_initial_properties().
+ * \param attrs     Filled in with the attributes.
+ * \return          FALSE if the attributes couldn't be fetched, as
+ *                  XGetWindowAttributes() would.
+ */
+gboolean meta_window_prefetch_get_attributes (MetaWindowPrefetch *prefetch,
+                                              XWindowAttributes  *attrs);
+
+/**
+ * Frees prefetched values, waiting for their replies if necessary.
+ *
+ * \param prefetch  The values returned by
+ *                  meta_window_prefetch_initial_properties().
+ */
+void meta_window_prefetch_free (MetaWindowPrefetch *prefetch);
 
 /**
  * Initialises the hooks used for the reload_propert* functions
@@ -29,6 +29,7 @@
 #include "util.h"
 #include "frame-private.h"
 #include "errors.h"
+#include "round-trips.h"
 #include "workspace.h"
 #include "stack.h"
 #include "keybindings.h"
@@ -276,11 +277,12 @@ meta_window_should_attach_to_parent (MetaWindow *window)
   return FALSE;
 }
 
-MetaWindow*
-meta_window_new (MetaDisplay    *display,
-                 Window          xwindow,
-                 gboolean        must_be_viewable,
-                 MetaEffectType  effect)
+static MetaWindow*
+window_new (MetaDisplay        *display,
+            Window              xwindow,
+            gboolean            must_be_viewable,
+            MetaEffectType      effect,
+            MetaWindowPrefetch *prefetch)
 {
   XWindowAttributes attrs;
   MetaWindow *window;
@@ -288,6 +290,8 @@ meta_window_new (MetaDisplay    *display,
   gulong existing_wm_state;
   gulong event_mask;
   MetaMoveResizeFlags flags;
+  gint64 start_time;
+  Status status;
 
   meta_verbose ("Attempting to manage 0x%lx\n", xwindow);
 
@@ -295,7 +299,21 @@ meta_window_new (MetaDisplay    *display,
                                    * creation, to reduce XSync() calls
                                    */
 
-  if (!XGetWindowAttributes (display->xdisplay,xwindow, &attrs))
+  if (prefetch != NULL)
+    {
+      /* Requested along with the properties, so at most one
+       * round-trip for all the windows being prefetched
+       */
+      status = meta_window_prefetch_get_attributes (prefetch, &attrs);
+    }
+  else
+    {
+      start_time = meta_round_trip_begin ();
+      status = XGetWindowAttributes (display->xdisplay, xwindow, &attrs);
+      meta_round_trip_end (G_STRFUNC, start_time);
+    }
+
+  if (!status)
     {
       meta_verbose ("Failed to get attributes for window 0x%lx\n", xwindow);
       meta_error_trap_pop (display);
@@ -417,8 +435,12 @@ meta_window_new (MetaDisplay    *display,
   window->workspace = NULL;
 
   window->sync_request_counter = None;
+  window->extended_sync_request_counter = FALSE;
   window->sync_request_serial = 0;
+  window->sync_request_counter_value = 0;
+  window->sync_request_counter_value_known = FALSE;
   window->sync_request_time = 0;
+  window->sync_request_latency = 0;
   window->sync_request_alarm = None;
 
   window->screen = display->screen;
@@ -584,6 +606,7 @@ meta_window_new (MetaDisplay    *display,
 
   window->layer = META_LAYER_LAST; /* invalid value */
   window->stack_position = -1;
+  window->stack_index = -1;
   window->initial_workspace = 0; /* not used */
   window->initial_timestamp = 0; /* not used */
 
@@ -599,6 +622,10 @@ meta_window_new (MetaDisplay    *display,
 
   meta_display_register_x_window (display, &window->xwindow, window);
 
+  window->screen_link.data = window;
+  window->screen->windows = g_list_concat (&window->screen_link,
+                                           window->screen->windows);
+
   meta_window_update_shape_region (window);
 
   /* assign the window to its group, or create a new group if needed
@@ -607,13 +634,23 @@ meta_window_new (MetaDisplay    *display,
   window->xgroup_leader = None;
   meta_window_compute_group (window);
 
-  meta_window_load_initial_properties (window);
+  meta_window_load_initial_properties (window, prefetch);
 
   if (!window->override_redirect)
     update_sm_hints (window); /* must come after transient_for */
 
+  /* Show the default icon until the real one has been read and scaled,
+   * which idle_update_icon() does without blocking us
+   */
   if (!window->override_redirect)
-    meta_window_update_icon_now (window);
+    {
+      window->icon = meta_ui_get_default_window_icon (window->screen->ui,
+                                                      META_ICON_SIZE);
+      window->mini_icon = meta_ui_get_default_mini_icon (window->screen->ui,
+                                                         META_MINI_ICON_SIZE);
+
+      meta_window_queue (window, META_QUEUE_UPDATE_ICON);
+    }
 
   if (window->initially_iconic)
     {
@@ -871,6 +908,36 @@ meta_window_new (MetaDisplay    *display,
   return window;
 }
 
+MetaWindow*
+meta_window_new (MetaDisplay    *display,
+                 Window          xwindow,
+                 gboolean        must_be_viewable,
+                 MetaEffectType  effect)
+{
+  return window_new (display, xwindow, must_be_viewable, effect, NULL);
+}
+
+/**
+ * Like meta_window_new(), using initial properties requested earlier
+ * with meta_window_prefetch_initial_properties(). Takes ownership of
+ * prefetch, which is freed whether or not the window gets managed.
+ */
+MetaWindow*
+meta_window_new_prefetched (MetaDisplay        *display,
+                            Window              xwindow,
+                            gboolean            must_be_viewable,
+                            MetaEffectType      effect,
+                            MetaWindowPrefetch *prefetch)
+{
+  MetaWindow *window;
+
+  window = window_new (display, xwindow, must_be_viewable, effect, prefetch);
+
+  meta_window_prefetch_free (prefetch);
+
+  return window;
+}
+
 /* This function should only be called from the end of meta_window_new () */
 static void
 meta_window_apply_session_info (MetaWindow *window,
@@ -1226,6 +1293,9 @@ meta_window_unmanage (MetaWindow *window,
 
   meta_display_unregister_x_window (window->display, window->xwindow);
 
+  window->screen->windows = g_list_remove_link (window->screen->windows,
+                                                &window->screen_link);
+
   meta_error_trap_push (window->display);
 
   /* Put back anything we messed up */
@@ -1611,7 +1681,6 @@ idle_calc_showing (gpointer data)
   GSList *should_hide;
   GSList *unplaced;
   GSList *displays;
-  MetaWindow *first_window;
   guint queue_index = GPOINTER_TO_INT (data);
 
   meta_topic (META_DEBUG_WINDOW_STATE,
@@ -1662,9 +1731,13 @@ idle_calc_showing (gpointer data)
   should_show = g_slist_sort (should_show, stackcmp);
   should_show = g_slist_reverse (should_show);
 
-  first_window = copy->data;
-
-  meta_display_grab (first_window->display);
+  /* The maps, unmaps and WM_STATE changes below don't wait for replies,
+   * so they all go out in one batch when the main loop next flushes. We
+   * used to grab the server around them, which froze every other client
+   * for as long as a workspace switch took, just so that nobody could
+   * see the windows change one at a time; the server handles the whole
+   * batch in one go anyway.
+   */
 
   tmp = unplaced;
   while (tmp != NULL)
@@ -1738,8 +1811,6 @@ idle_calc_showing (gpointer data)
         }
     }
 
-  meta_display_ungrab (first_window->display);
-
   g_slist_free (copy);
 
   g_slist_free (unplaced);
@@ -2167,12 +2238,6 @@ meta_window_show (MetaWindow *window)
   gboolean needs_stacking_adjustment;
   gboolean will_be_covered;
   MetaWindow *focus_window;
-  guint32     timestamp;
-
-  /* FIXME: It really sucks to put timestamp pinging here; it'd
-   * probably make more sense in implement_showing().
-   */
-  timestamp = meta_display_get_current_time_roundtrip (window->display);
 
   meta_topic (META_DEBUG_WINDOW_STATE,
               "Showing window %s, shaded: %d iconic: %d placed: %d\n",
@@ -2375,6 +2440,15 @@ meta_window_show (MetaWindow *window)
       window->showing_for_first_time = FALSE;
       if (takes_focus_on_map)
         {
+          guint32 timestamp;
+
+          /* FIXME: It really sucks to put timestamp pinging here; it'd
+           * probably make more sense in implement_showing(). At least
+           * only windows taking focus pay for the round trip, rather
+           * than every window mapped by a workspace switch.
+           */
+          timestamp = meta_display_get_current_time_roundtrip (window->display);
+
           meta_window_focus (window, timestamp);
         }
       else
@@ -3365,6 +3439,30 @@ adjust_for_gravity (MetaWindow        *window,
     }
 }
 
+static void
+sync_request_alarm_result_cb (MetaDisplay *display,
+                              int          error_code,
+                              gpointer     user_data)
+{
+  XSyncAlarm alarm;
+  MetaWindow *window;
+
+  if (error_code == Success)
+    return;
+
+  alarm = GPOINTER_TO_UINT (user_data);
+
+  /* The window may have gone away in the meantime */
+  window = meta_display_lookup_sync_alarm (display, alarm);
+  if (window == NULL || window->sync_request_alarm != alarm)
+    return;
+
+  meta_display_unregister_sync_alarm (display, alarm);
+
+  window->sync_request_alarm = None;
+  window->sync_request_counter = None;
+}
+
 void
 meta_window_create_sync_request_alarm (MetaWindow *window)
 {
@@ -3377,13 +3475,24 @@ meta_window_create_sync_request_alarm (MetaWindow *window)
 
   meta_error_trap_push (window->display);
 
-  /* Set the counter to 0, so we know that the application's
-   * responses to the client messages will always trigger
-   * a PositiveTransition
+  /* The client counts its frames on the extended counter, so that one
+   * is left alone; the alarm below is relative to wherever it is, and
+   * tells us the value the first time it changes. There is no need to
+   * ask the server for it now, with every such window being mapped.
    */
-  XSyncIntToValue (&init, 0);
-  XSyncSetCounter (window->display->xdisplay,
-                   window->sync_request_counter, init);
+  if (!window->extended_sync_request_counter)
+    {
+      /* Set the counter to 0, so we know that the application's
+       * responses to the client messages will always trigger
+       * a PositiveTransition
+       */
+      XSyncIntToValue (&init, 0);
+      XSyncSetCounter (window->display->xdisplay,
+                       window->sync_request_counter, init);
+      window->sync_request_counter_value = 0;
+      window->sync_request_counter_value_known = TRUE;
+    }
+
   window->sync_request_serial = 0;
 
   values.trigger.counter = window->sync_request_counter;
@@ -3409,22 +3518,24 @@ meta_window_create_sync_request_alarm (MetaWindow *window)
                                                  XSyncCAEvents,
                                                  &values);
 
-  if (meta_error_trap_pop_with_return (window->display) == Success)
-    {
-      meta_display_register_sync_alarm (window->display,
-                                        &window->sync_request_alarm,
-                                        window);
-    }
-  else
-    {
-      window->sync_request_alarm = None;
-      window->sync_request_counter = None;
-    }
+  /* Assume the alarm could be created rather than waiting for the
+   * server to tell us; this happens for every window that supports
+   * _NET_WM_SYNC_REQUEST, usually while it is being mapped.
+   */
+  meta_display_register_sync_alarm (window->display,
+                                    &window->sync_request_alarm,
+                                    window);
+
+  meta_error_trap_pop_async (window->display,
+                             sync_request_alarm_result_cb,
+                             GUINT_TO_POINTER (window->sync_request_alarm));
 }
 
 void
 meta_window_destroy_sync_request_alarm (MetaWindow *window)
 {
+  gboolean was_frozen;
+
   if (window->sync_request_alarm != None)
     {
       /* Has to be unregistered _before_ clearing the structure field */
@@ -3433,6 +3544,18 @@ meta_window_destroy_sync_request_alarm (MetaWindow *window)
       XSyncDestroyAlarm (window->display->xdisplay, window->sync_request_alarm);
       window->sync_request_alarm = None;
     }
+
+  /* Nothing tells us about the counter any more, so don't leave the
+   * window frozen in the middle of a frame
+   */
+  was_frozen = meta_window_updates_are_frozen (window);
+
+  window->sync_request_counter_value = 0;
+  window->sync_request_counter_value_known = FALSE;
+
+  if (meta_window_updates_are_frozen (window) != was_frozen)
+    meta_compositor_set_updates_frozen (window->display->compositor, window,
+                                        !was_frozen);
 }
 
 static void
@@ -3441,9 +3564,62 @@ send_sync_request (MetaWindow *window)
   XSyncValue value;
   XClientMessageEvent ev;
 
-  window->sync_request_serial++;
+  if (window->extended_sync_request_counter &&
+      !window->sync_request_counter_value_known)
+    {
+      XSyncValue current;
+      gint64 start_time;
+      gboolean was_frozen;
+      Bool queried;
 
-  XSyncIntToValue (&value, window->sync_request_serial);
+      /* The client hasn't drawn a frame since we started watching, so
+       * the value the requests count from has to be asked for once
+       */
+      meta_topic (META_DEBUG_SYNC,
+                  "Querying the extended sync counter of %s\n",
+                  window->desc);
+
+      start_time = meta_round_trip_begin ();
+      queried = XSyncQueryCounter (window->display->xdisplay,
+                                   window->sync_request_counter, &current);
+      meta_round_trip_end (G_STRFUNC, start_time);
+
+      /* Otherwise go on from the last value we asked for below */
+      if (queried)
+        {
+          was_frozen = meta_window_updates_are_frozen (window);
+
+          window->sync_request_counter_value =
+            XSyncValueLow32 (current) + ((guint64) XSyncValueHigh32 (current) << 32);
+          window->sync_request_counter_value_known = TRUE;
+
+          if (meta_window_updates_are_frozen (window) != was_frozen)
+            meta_compositor_set_updates_frozen (window->display->compositor, window,
+                                                !was_frozen);
+        }
+    }
+
+  if (window->extended_sync_request_counter)
+    {
+      /* The client counts up by its frames too, so ask for an even
+       * value, which ends a frame, well ahead of where it is; 240 is
+       * what the EWMH suggests: a second at 60 frames of 4 each. The
+       * value must also be past anything asked for before, in case
+       * the counter could not be read.
+       */
+      window->sync_request_serial = MAX (window->sync_request_counter_value,
+                                         window->sync_request_serial) + 240;
+      if (window->sync_request_serial % 2 == 1)
+        window->sync_request_serial++;
+    }
+  else
+    {
+      window->sync_request_serial++;
+    }
+
+  XSyncIntsToValue (&value,
+                    window->sync_request_serial & G_GUINT64_CONSTANT (0xffffffff),
+                    window->sync_request_serial >> 32);
 
   ev.type = ClientMessage;
   ev.window = window->xwindow;
@@ -3458,6 +3634,7 @@ send_sync_request (MetaWindow *window)
   ev.data.l[1] = meta_display_get_current_time (window->display);
   ev.data.l[2] = XSyncValueLow32 (value);
   ev.data.l[3] = XSyncValueHigh32 (value);
+  ev.data.l[4] = window->extended_sync_request_counter;
 
   /* We don't need to trap errors here as we are already
    * inside an error_trap_push()/pop() pair.
@@ -3483,10 +3660,15 @@ send_sync_request (MetaWindow *window)
 gboolean
 meta_window_updates_are_frozen (MetaWindow *window)
 {
+  /* An odd value means the client is in the middle of a frame */
+  if (window->extended_sync_request_counter &&
+      window->sync_request_counter_value % 2 == 1)
+    return TRUE;
+
   return window->updates_frozen_for_resize;
 }
 
-static void
+void
 meta_window_set_updates_frozen_for_resize (MetaWindow *window,
                                            gboolean    updates_frozen)
 {
@@ -4431,6 +4613,8 @@ meta_window_focus (MetaWindow  *window,
       return;
     }
 
+  meta_round_trip_push_op (META_ROUND_TRIP_OP_FOCUS);
+
   modal_transient = get_modal_transient (window);
   if (modal_transient != NULL &&
       !modal_transient->unmanaging)
@@ -4452,6 +4636,7 @@ meta_window_focus (MetaWindow  *window,
       meta_topic (META_DEBUG_FOCUS,
                   "Window %s is not showing, not focusing after all\n",
                   window->desc);
+      meta_round_trip_pop_op ();
       return;
     }
 
@@ -4521,6 +4706,8 @@ meta_window_focus (MetaWindow  *window,
 
   if (window->wm_state_demands_attention)
     meta_window_unset_demands_attention(window);
+
+  meta_round_trip_pop_op ();
 }
 
 static void
@@ -6219,6 +6406,30 @@ meta_window_update_icon_now (MetaWindow *window)
   g_assert (window->mini_icon);
 }
 
+static void
+net_wm_icon_fetched (MetaWindow *window,
+                     GdkPixbuf  *icon,
+                     GdkPixbuf  *mini_icon)
+{
+  if (icon == NULL)
+    {
+      /* Fall back to WM_HINTS or the default icon */
+      meta_window_update_icon_now (window);
+      return;
+    }
+
+  if (window->icon)
+    g_object_unref (G_OBJECT (window->icon));
+
+  if (window->mini_icon)
+    g_object_unref (G_OBJECT (window->mini_icon));
+
+  window->icon = icon;
+  window->mini_icon = mini_icon;
+
+  redraw_icon (window);
+}
+
 static gboolean
 idle_update_icon (gpointer data)
 {
@@ -6246,7 +6457,17 @@ idle_update_icon (gpointer data)
 
       window = tmp->data;
 
-      meta_window_update_icon_now (window);
+      /* We already have an icon to show meanwhile, so don't block on
+       * reading what may be a huge _NET_WM_ICON
+       */
+      if (window->override_redirect ||
+          !meta_icon_cache_fetch_net_wm_icon (&window->icon_cache,
+                                              window,
+                                              META_ICON_SIZE,
+                                              META_MINI_ICON_SIZE,
+                                              net_wm_icon_fetched))
+        meta_window_update_icon_now (window);
+
       window->is_in_queues &= ~META_QUEUE_UPDATE_ICON;
 
       tmp = tmp->next;
@@ -7436,6 +7657,61 @@ meta_window_titlebar_is_onscreen (MetaWindow *window)
   return is_onscreen;
 }
 
+/* How long, in ms, a client that has been asked to sync is waited for
+ * before resizing it without waiting any more
+ */
+#define MIN_SYNC_REQUEST_BUDGET 200.0
+#define MAX_SYNC_REQUEST_BUDGET 1000.0
+
+/* Clients that usually answer sync requests quickly are given up on
+ * sooner than those known to be slow, or not known at all
+ */
+static gdouble
+get_sync_request_budget (MetaWindow *window)
+{
+  if (window->sync_request_latency == 0)
+    return MAX_SYNC_REQUEST_BUDGET;
+
+  return CLAMP (window->sync_request_latency / 1000.0 * 10,
+                MIN_SYNC_REQUEST_BUDGET, MAX_SYNC_REQUEST_BUDGET);
+}
+
+/* Resizing more than once per refresh of the monitor the window is on
+ * only makes the client do work that is never shown
+ */
+static gboolean
+check_frame_interval (MetaWindow *window,
+                      gint64      current_time,
+                      gdouble    *remaining)
+{
+  const MetaMonitorInfo *monitor;
+  gdouble ms_between_resizes;
+  gdouble elapsed;
+
+  monitor = meta_screen_get_monitor_for_window (window->screen, window);
+  ms_between_resizes = 1000.0 / monitor->refresh_rate;
+
+  elapsed = (current_time - window->display->grab_last_moveresize_time) / 1000.0;
+
+  if (elapsed >= 0.0 && elapsed < ms_between_resizes)
+    {
+      meta_topic (META_DEBUG_RESIZING,
+                  "Delaying move/resize as only %g of %g ms elapsed\n",
+                  elapsed, ms_between_resizes);
+
+      if (remaining)
+        *remaining = (ms_between_resizes - elapsed);
+
+      return FALSE;
+    }
+
+  meta_topic (META_DEBUG_RESIZING,
+              " Checked moveresize freq, allowing move/resize now (%g of %g ms elapsed)\n",
+              elapsed, ms_between_resizes);
+
+  return TRUE;
+}
+
 static gboolean
 check_moveresize_frequency (MetaWindow *window,
                             gdouble    *remaining)
@@ -7450,59 +7726,46 @@ check_moveresize_frequency (MetaWindow *window,
     {
       if (window->sync_request_time != 0)
         {
+          gdouble budget;
+
           elapsed = (current_time - window->sync_request_time) / 1000.0;
+          budget = get_sync_request_budget (window);
 
-          if (elapsed < 1000.0)
+          if (elapsed < budget)
             {
               /* We want to be sure that the timeout happens at
                * a time where elapsed will definitely be
-               * greater than 1000, so we can disable sync
+               * greater than the budget, so we can disable sync
                */
               if (remaining)
-                *remaining = 1000.0 - elapsed + 100;
+                *remaining = budget - elapsed + 1;
 
               return FALSE;
             }
           else
             {
-              /* We have now waited for more than a second for the
-               * application to respond to the sync request
+              /* We have now waited longer than the application usually
+               * takes to respond to the sync request
                */
+              meta_topic (META_DEBUG_RESIZING,
+                          "Giving up on sync request after %g ms\n",
+                          elapsed);
+
               window->disable_sync = TRUE;
               return TRUE;
             }
         }
       else
         {
-          /* No outstanding sync requests. Go ahead and resize
+          /* No outstanding sync requests. Go ahead and resize, but
+           * not faster than the monitor can show it
            */
-          return TRUE;
+          return check_frame_interval (window, current_time, remaining);
         }
     }
   else
     {
-      const double max_resizes_per_second = 25.0;
-      const double ms_between_resizes = 1000.0 / max_resizes_per_second;
-
-      elapsed = (current_time - window->display->grab_last_moveresize_time) / 1000.0;
-
-      if (elapsed >= 0.0 && elapsed < ms_between_resizes)
-        {
-          meta_topic (META_DEBUG_RESIZING,
-                      "Delaying move/resize as only %g of %g ms elapsed\n",
-                      elapsed, ms_between_resizes);
-
-          if (remaining)
-            *remaining = (ms_between_resizes - elapsed);
-
-          return FALSE;
-        }
-
-      meta_topic (META_DEBUG_RESIZING,
-                  " Checked moveresize freq, allowing move/resize now (%g of %g seconds elapsed)\n",
-                  elapsed / 1000.0, 1.0 / max_resizes_per_second);
-
-      return TRUE;
+      return check_frame_interval (window, current_time, remaining);
     }
 }
 
@@ -8033,6 +8296,40 @@ void
 meta_window_update_sync_request_counter (MetaWindow *window,
                                          guint64     new_counter_value)
 {
+  if (window->extended_sync_request_counter)
+    {
+      gboolean was_frozen;
+
+      was_frozen = meta_window_updates_are_frozen (window);
+      window->sync_request_counter_value = new_counter_value;
+      window->sync_request_counter_value_known = TRUE;
+
+      if (meta_window_updates_are_frozen (window) != was_frozen)
+        meta_compositor_set_updates_frozen (window->display->compositor, window,
+                                            !was_frozen);
+
+      /* An even value means the client has finished a frame */
+      if (new_counter_value % 2 == 0)
+        meta_compositor_queue_frame_drawn (window->display->compositor, window,
+                                           new_counter_value);
+
+      /* The client changes the counter for every frame it draws, but
+       * only reaching the value we asked for answers our sync request
+       */
+      if (window->sync_request_time == 0 ||
+          new_counter_value < window->sync_request_serial)
+        return;
+    }
+  else
+    {
+      window->sync_request_counter_value = new_counter_value;
+    }
+
+  /* The client has drawn the size we asked for, whether or not the
+   * resize is still going on
+   */
+  meta_window_set_updates_frozen_for_resize (window, FALSE);
+
   if (window->display->grab_op != META_GRAB_OP_NONE &&
       window == window->display->grab_window &&
       meta_grab_op_is_mouse (window->display->grab_op))
@@ -8047,6 +8344,25 @@ meta_window_update_sync_request_counter (MetaWindow *window,
        * busy with a pagefault or a long computation).
        */
       window->disable_sync = FALSE;
+
+      if (window->sync_request_time != 0)
+        {
+          gint64 latency;
+
+          /* Keep a running average of how long the client takes */
+          latency = g_get_real_time () - window->sync_request_time;
+          if (window->sync_request_latency == 0)
+            window->sync_request_latency = latency;
+          else
+            window->sync_request_latency =
+              (3 * window->sync_request_latency + latency) / 4;
+
+          meta_topic (META_DEBUG_RESIZING,
+                      "Sync request took %" G_GINT64_FORMAT " us, "
+                      "%" G_GINT64_FORMAT " us on average\n",
+                      latency, window->sync_request_latency);
+        }
+
       window->sync_request_time = 0;
 
       /* This means we are ready for another configure. */
@@ -8068,12 +8384,15 @@ meta_window_update_sync_request_counter (MetaWindow *window,
         case META_GRAB_OP_KEYBOARD_RESIZING_NE:
         case META_GRAB_OP_KEYBOARD_RESIZING_SW:
         case META_GRAB_OP_KEYBOARD_RESIZING_NW:
-          /* no pointer round trip here, to keep in sync */
+          /* no pointer round trip here, to keep in sync; a client that
+           * answers quickly still isn't resized more often than the
+           * monitor refreshes
+           */
           update_resize (window,
                          window->display->grab_last_user_action_was_snap,
                          window->display->grab_latest_motion_x,
                          window->display->grab_latest_motion_y,
-                         TRUE);
+                         FALSE);
           break;
 
         case META_GRAB_OP_NONE:
@@ -8821,8 +9140,9 @@ void
 meta_window_set_demands_attention (MetaWindow *window)
 {
   MetaRectangle candidate_rect, other_rect;
-  GList *stack = window->screen->stack->sorted;
+  GPtrArray *stack = window->screen->stack->sorted;
   MetaWindow *other_window;
+  guint i;
   gboolean obscured = FALSE;
 
   MetaWorkspace *workspace = window->screen->active_workspace;
@@ -8841,10 +9161,12 @@ meta_window_set_demands_attention (MetaWindow *window)
 
       /* The stack is sorted with the top windows first. */
 
-      while (stack != NULL && stack->data != window)
+      for (i = 0; i < stack->len; i++)
         {
-          other_window = stack->data;
-          stack = stack->next;
+          other_window = g_ptr_array_index (stack, i);
+
+          if (other_window == window)
+            break;
 
           if (other_window->on_all_workspaces ||
               window->on_all_workspaces ||
@@ -0,0 +1,424 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Metacity shared work areas */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "work-areas.h"
+
+#include <string.h>
+
+/* How many work areas nobody uses any more we keep around, in case
+ * their struts come back
+ */
+#define MAX_UNUSED_WORK_AREAS 16
+
+#define MIN_SANE_AREA 100
+
+struct _MetaWorkAreaCache
+{
+  /* MetaWorkArea -> itself */
+  GHashTable *work_areas;
+
+  /* Work areas with no references, least recently used first */
+  GQueue     *unused;
+};
+
+static guint
+hash_rect (guint                hash,
+           const MetaRectangle *rect)
+{
+  hash = hash * 31 + rect->x;
+  hash = hash * 31 + rect->y;
+  hash = hash * 31 + rect->width;
+  hash = hash * 31 + rect->height;
+
+  return hash;
+}
+
+static gint
+compare_struts (gconstpointer a,
+                gconstpointer b)
+{
+  const MetaStrut *strut_a = a;
+  const MetaStrut *strut_b = b;
+
+  if (strut_a->rect.x != strut_b->rect.x)
+    return strut_a->rect.x < strut_b->rect.x ? -1 : 1;
+  if (strut_a->rect.y != strut_b->rect.y)
+    return strut_a->rect.y < strut_b->rect.y ? -1 : 1;
+  if (strut_a->rect.width != strut_b->rect.width)
+    return strut_a->rect.width < strut_b->rect.width ? -1 : 1;
+  if (strut_a->rect.height != strut_b->rect.height)
+    return strut_a->rect.height < strut_b->rect.height ? -1 : 1;
+  if (strut_a->side != strut_b->side)
+    return strut_a->side < strut_b->side ? -1 : 1;
+  if (strut_a->edge != strut_b->edge)
+    return strut_a->edge < strut_b->edge ? -1 : 1;
+
+  return 0;
+}
+
+static guint
+work_area_hash (gconstpointer key)
+{
+  const MetaWorkArea *area = key;
+
+  return area->hash;
+}
+
+static gboolean
+work_area_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const MetaWorkArea *area_a = a;
+  const MetaWorkArea *area_b = b;
+  const GSList *strut_a;
+  const GSList *strut_b;
+
+  if (area_a->hash != area_b->hash ||
+      area_a->whole_screen != area_b->whole_screen ||
+      !meta_rectangle_equal (&area_a->basic_rect, &area_b->basic_rect) ||
+      area_a->n_monitor_rects != area_b->n_monitor_rects)
+    return FALSE;
+
+  if (area_a->n_monitor_rects > 0 &&
+      memcmp (area_a->monitor_rects, area_b->monitor_rects,
+              area_a->n_monitor_rects * sizeof (MetaRectangle)) != 0)
+    return FALSE;
+
+  strut_a = area_a->struts;
+  strut_b = area_b->struts;
+  while (strut_a != NULL && strut_b != NULL)
+    {
+      if (compare_struts (strut_a->data, strut_b->data) != 0)
+        return FALSE;
+
+      strut_a = strut_a->next;
+      strut_b = strut_b->next;
+    }
+
+  return strut_a == NULL && strut_b == NULL;
+}
+
+/* Fills in everything a lookup compares; the struts are borrowed */
+static void
+init_key (MetaWorkArea        *key,
+          gboolean             whole_screen,
+          const MetaRectangle *basic_rect,
+          const MetaRectangle *monitor_rects,
+          int                  n_monitor_rects,
+          GSList              *struts)
+{
+  const GSList *tmp;
+  guint hash;
+  int i;
+
+  memset (key, 0, sizeof (MetaWorkArea));
+
+  key->whole_screen = whole_screen;
+  key->basic_rect = *basic_rect;
+  key->monitor_rects = (MetaRectangle *) monitor_rects;
+  key->n_monitor_rects = n_monitor_rects;
+  key->struts = g_slist_sort (struts, compare_struts);
+
+  hash = whole_screen ? 1 : 0;
+  hash = hash_rect (hash, basic_rect);
+
+  for (i = 0; i < n_monitor_rects; i++)
+    hash = hash_rect (hash, &monitor_rects[i]);
+
+  for (tmp = key->struts; tmp != NULL; tmp = tmp->next)
+    {
+      const MetaStrut *strut = tmp->data;
+
+      hash = hash_rect (hash, &strut->rect);
+      hash = hash * 31 + strut->side;
+      hash = hash * 31 + strut->edge;
+    }
+
+  key->hash = hash;
+}
+
+static void
+free_work_area (gpointer data)
+{
+  MetaWorkArea *area = data;
+
+  g_slist_free_full (area->struts, g_free);
+  g_list_free_full (area->region, g_free);
+  g_list_free_full (area->screen_edges, g_free);
+  g_list_free_full (area->monitor_edges, g_free);
+  g_free (area->monitor_rects);
+  g_free (area);
+}
+
+/* Takes over the key, copying what it borrowed */
+static MetaWorkArea *
+new_work_area (const MetaWorkArea *key)
+{
+  MetaWorkArea *area;
+  GSList *struts;
+  const GSList *tmp;
+
+  area = g_new (MetaWorkArea, 1);
+  *area = *key;
+
+  struts = NULL;
+  for (tmp = key->struts; tmp != NULL; tmp = tmp->next)
+    struts = g_slist_prepend (struts, g_memdup2 (tmp->data, sizeof (MetaStrut)));
+  area->struts = g_slist_reverse (struts);
+
+  if (key->n_monitor_rects > 0)
+    area->monitor_rects = g_memdup2 (key->monitor_rects,
+                                     key->n_monitor_rects * sizeof (MetaRectangle));
+
+  area->ref_count = 1;
+
+  return area;
+}
+
+static void
+compute_screen (MetaWorkArea *area)
+{
+  MetaRectangle work_area;
+  GList *monitor_rects;
+  int i;
+
+  area->region =
+    meta_rectangle_get_minimal_spanning_set_for_region (&area->basic_rect,
+                                                        area->struts,
+                                                        TRUE);
+
+  work_area = area->basic_rect;
+  if (area->region == NULL)
+    work_area = meta_rect (0, 0, -1, -1);
+  else
+    meta_rectangle_clip_to_region (area->region,
+                                   FIXED_DIRECTION_NONE,
+                                   &work_area);
+
+  /* Lots of paranoia checks, forcing the work area to be sane */
+  if (work_area.width < MIN_SANE_AREA)
+    {
+      g_warning ("struts occupy an unusually large percentage of the screen; "
+                 "available remaining width = %d < %d",
+                 work_area.width, MIN_SANE_AREA);
+
+      if (work_area.width < 1)
+        {
+          work_area.x = (area->basic_rect.width - MIN_SANE_AREA)/2;
+          work_area.width = MIN_SANE_AREA;
+        }
+      else
+        {
+          int amount = (MIN_SANE_AREA - work_area.width)/2;
+          work_area.x     -=   amount;
+          work_area.width += 2*amount;
+        }
+    }
+  if (work_area.height < MIN_SANE_AREA)
+    {
+      g_warning ("struts occupy an unusually large percentage of the screen; "
+                 "available remaining height = %d < %d",
+                  work_area.height, MIN_SANE_AREA);
+
+      if (work_area.height < 1)
+        {
+          work_area.y = (area->basic_rect.height - MIN_SANE_AREA)/2;
+          work_area.height = MIN_SANE_AREA;
+        }
+      else
+        {
+          int amount = (MIN_SANE_AREA - work_area.height)/2;
+          work_area.y      -=   amount;
+          work_area.height += 2*amount;
+        }
+    }
+  area->work_area = work_area;
+
+  /* Make sure the region is nonempty */
+  if (area->region == NULL)
+    area->region = g_list_prepend (NULL, g_memdup2 (&work_area,
+                                                    sizeof (MetaRectangle)));
+
+  area->screen_edges =
+    meta_rectangle_find_onscreen_edges (&area->basic_rect, area->struts);
+
+  monitor_rects = NULL;
+  for (i = 0; i < area->n_monitor_rects; i++)
+    monitor_rects = g_list_prepend (monitor_rects, &area->monitor_rects[i]);
+
+  area->monitor_edges =
+    meta_rectangle_find_nonintersected_monitor_edges (&area->basic_rect,
+                                                      monitor_rects,
+                                                      area->struts);
+
+  g_list_free (monitor_rects);
+}
+
+static void
+compute_monitor (MetaWorkArea *area)
+{
+  MetaRectangle work_area;
+
+  area->region =
+    meta_rectangle_get_minimal_spanning_set_for_region (&area->basic_rect,
+                                                        area->struts,
+                                                        FALSE);
+
+  work_area = area->basic_rect;
+  if (area->region == NULL)
+    /* FIXME: constraints.c untested with this, but it might be nice for
+     * a screen reader or magnifier.
+     */
+    work_area = meta_rect (work_area.x, work_area.y, -1, -1);
+  else
+    meta_rectangle_clip_to_region (area->region,
+                                   FIXED_DIRECTION_NONE,
+                                   &work_area);
+
+  area->work_area = work_area;
+}
+
+/* Looks the key up, computing and adding the work area if it is new */
+static MetaWorkArea *
+get_work_area (MetaWorkAreaCache  *cache,
+               MetaWorkArea       *key)
+{
+  MetaWorkArea *area;
+
+  area = g_hash_table_lookup (cache->work_areas, key);
+
+  if (area != NULL)
+    {
+      if (area->ref_count == 0)
+        g_queue_remove (cache->unused, area);
+
+      area->ref_count += 1;
+      return area;
+    }
+
+  area = new_work_area (key);
+
+  if (area->whole_screen)
+    compute_screen (area);
+  else
+    compute_monitor (area);
+
+  g_hash_table_add (cache->work_areas, area);
+
+  return area;
+}
+
+MetaWorkAreaCache *
+meta_work_area_cache_new (void)
+{
+  MetaWorkAreaCache *cache;
+
+  cache = g_new (MetaWorkAreaCache, 1);
+  cache->work_areas = g_hash_table_new_full (work_area_hash, work_area_equal,
+                                             free_work_area, NULL);
+  cache->unused = g_queue_new ();
+
+  return cache;
+}
+
+/**
+ * Frees the cache and every work area in it, whether or not it is still
+ * in use.
+ */
+void
+meta_work_area_cache_free (MetaWorkAreaCache *cache)
+{
+  g_queue_free (cache->unused);
+  g_hash_table_destroy (cache->work_areas);
+  g_free (cache);
+}
+
+/**
+ * Returns the work area of the whole screen with the given struts, which
+ * must be released with meta_work_area_cache_release().
+ */
+MetaWorkArea *
+meta_work_area_cache_get_screen (MetaWorkAreaCache   *cache,
+                                 const MetaRectangle *screen_rect,
+                                 const MetaRectangle *monitor_rects,
+                                 int                  n_monitor_rects,
+                                 const GSList        *struts)
+{
+  MetaWorkArea key;
+  MetaWorkArea *area;
+
+  init_key (&key, TRUE, screen_rect, monitor_rects, n_monitor_rects,
+            g_slist_copy ((GSList *) struts));
+
+  area = get_work_area (cache, &key);
+
+  g_slist_free (key.struts);
+
+  return area;
+}
+
+/**
+ * Returns the work area of one monitor with the given struts, which must
+ * be released with meta_work_area_cache_release(). Struts not overlapping
+ * the monitor make no difference to it, so they are left out.
+ */
+MetaWorkArea *
+meta_work_area_cache_get_monitor (MetaWorkAreaCache   *cache,
+                                  const MetaRectangle *monitor_rect,
+                                  const GSList        *struts)
+{
+  MetaWorkArea key;
+  MetaWorkArea *area;
+  GSList *overlapping;
+  const GSList *tmp;
+
+  overlapping = NULL;
+  for (tmp = struts; tmp != NULL; tmp = tmp->next)
+    {
+      const MetaStrut *strut = tmp->data;
+
+      if (meta_rectangle_overlap (&strut->rect, monitor_rect))
+        overlapping = g_slist_prepend (overlapping, (gpointer) strut);
+    }
+
+  init_key (&key, FALSE, monitor_rect, NULL, 0, overlapping);
+
+  area = get_work_area (cache, &key);
+
+  g_slist_free (key.struts);
+
+  return area;
+}
+
+void
+meta_work_area_cache_release (MetaWorkAreaCache *cache,
+                              MetaWorkArea      *area)
+{
+  g_return_if_fail (area->ref_count > 0);
+
+  area->ref_count -= 1;
+  if (area->ref_count > 0)
+    return;
+
+  g_queue_push_tail (cache->unused, area);
+
+  if (g_queue_get_length (cache->unused) > MAX_UNUSED_WORK_AREAS)
+    g_hash_table_remove (cache->work_areas, g_queue_pop_head (cache->unused));
+}
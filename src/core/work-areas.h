@@ -0,0 +1,82 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * \file work-areas.h  Work areas shared between workspaces
+ *
+ * The work areas, spanning sets and edges of a workspace depend on
+ * nothing but the screen and monitor geometry and the struts of the
+ * windows on the workspace. Most workspaces have the same struts, and
+ * a panel that hides and shows itself keeps switching between the same
+ * two sets of them, so each result is kept, keyed by the struts it was
+ * computed from, and handed to every workspace asking for it again.
+ *
+ * The work area of a single monitor is keyed only by the struts that
+ * overlap that monitor, so a strut changing on one monitor doesn't
+ * make the others compute theirs again.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_WORK_AREAS_H
+#define META_WORK_AREAS_H
+
+#include "boxes.h"
+
+typedef struct _MetaWorkAreaCache MetaWorkAreaCache;
+typedef struct _MetaWorkArea MetaWorkArea;
+
+struct _MetaWorkArea
+{
+  /* The struts it was computed from, sorted so that equal sets compare
+   * equal; these are our own copies.
+   */
+  GSList        *struts;
+
+  MetaRectangle  work_area;
+
+  /* The spanning set of the region usable by windows; never empty for
+   * the whole screen.
+   */
+  GList         *region;
+
+  /* Edges for edge resistance and snapping; only for the whole screen */
+  GList         *screen_edges;
+  GList         *monitor_edges;
+
+  /*< private >*/
+  int            ref_count;
+  guint          hash;
+  gboolean       whole_screen;
+  MetaRectangle  basic_rect;
+  MetaRectangle *monitor_rects;
+  int            n_monitor_rects;
+};
+
+MetaWorkAreaCache *meta_work_area_cache_new         (void);
+void               meta_work_area_cache_free        (MetaWorkAreaCache   *cache);
+
+MetaWorkArea      *meta_work_area_cache_get_screen  (MetaWorkAreaCache   *cache,
+                                                     const MetaRectangle *screen_rect,
+                                                     const MetaRectangle *monitor_rects,
+                                                     int                  n_monitor_rects,
+                                                     const GSList        *struts);
+MetaWorkArea      *meta_work_area_cache_get_monitor (MetaWorkAreaCache   *cache,
+                                                     const MetaRectangle *monitor_rect,
+                                                     const GSList        *struts);
+void               meta_work_area_cache_release     (MetaWorkAreaCache   *cache,
+                                                     MetaWorkArea        *area);
+
+#endif
@@ -24,6 +24,7 @@
 #include <config.h>
 #include "workspace.h"
 #include "errors.h"
+#include "round-trips.h"
 #include "prefs.h"
 #include <X11/Xatom.h>
 #include <string.h>
@@ -58,19 +59,20 @@ meta_workspace_new (MetaScreen *screen)
   workspace->screen = screen;
   workspace->screen->workspaces =
     g_list_append (workspace->screen->workspaces, workspace);
+
+  /* The work areas of windows on all workspaces now include this one */
+  meta_display_cleanup_constraint_context (screen->display);
+
   workspace->windows = NULL;
   workspace->mru_list = NULL;
   meta_screen_foreach_window (screen, maybe_add_to_list, &workspace->mru_list);
 
   workspace->work_areas_invalid = TRUE;
-  workspace->work_area_monitor = NULL;
-  workspace->work_area_screen.x = 0;
-  workspace->work_area_screen.y = 0;
-  workspace->work_area_screen.width = 0;
-  workspace->work_area_screen.height = 0;
+  workspace->screen_work_area = NULL;
+  workspace->monitor_work_areas = NULL;
+  workspace->n_monitor_work_areas = 0;
 
   workspace->screen_region = NULL;
-  workspace->monitor_region = NULL;
   workspace->screen_edges = NULL;
   workspace->monitor_edges = NULL;
   workspace->list_containing_self = g_list_prepend (NULL, workspace);
@@ -82,38 +84,47 @@ meta_workspace_new (MetaScreen *screen)
   return workspace;
 }
 
-static void
-free_this (gpointer candidate,
-           gpointer user_data)
-{
-  g_free (candidate);
-}
-
 /**
- * Frees the struts list of a workspace.
+ * Lets go of the work areas of a workspace, which may live on in the
+ * screen's cache.
  *
  * \param workspace  The workspace.
  */
 static void
-workspace_free_struts (MetaWorkspace *workspace)
+workspace_release_work_areas (MetaWorkspace *workspace)
 {
-  if (workspace->all_struts == NULL)
-    return;
+  MetaWorkAreaCache *cache;
+  int i;
+
+  cache = workspace->screen->work_area_cache;
+
+  if (workspace->screen_work_area != NULL)
+    meta_work_area_cache_release (cache, workspace->screen_work_area);
+
+  for (i = 0; i < workspace->n_monitor_work_areas; i++)
+    meta_work_area_cache_release (cache, workspace->monitor_work_areas[i]);
+
+  g_free (workspace->monitor_work_areas);
+
+  workspace->screen_work_area = NULL;
+  workspace->monitor_work_areas = NULL;
+  workspace->n_monitor_work_areas = 0;
 
-  g_slist_foreach (workspace->all_struts, free_this, NULL);
-  g_slist_free (workspace->all_struts);
   workspace->all_struts = NULL;
+  workspace->screen_region = NULL;
+  workspace->screen_edges = NULL;
+  workspace->monitor_edges = NULL;
 }
 
 void
 meta_workspace_free (MetaWorkspace *workspace)
 {
   GList *tmp;
-  MetaScreen *screen;
-  int i;
 
   g_return_if_fail (workspace != workspace->screen->active_workspace);
 
+  meta_display_cleanup_constraint_context (workspace->screen->display);
+
   /* Here we assume all the windows are already on another workspace
    * as well, so they won't be "orphaned"
    */
@@ -134,13 +145,9 @@ meta_workspace_free (MetaWorkspace *workspace)
 
   g_assert (workspace->windows == NULL);
 
-  screen = workspace->screen;
-
   workspace->screen->workspaces =
     g_list_remove (workspace->screen->workspaces, workspace);
 
-  g_free (workspace->work_area_monitor);
-
   g_list_free (workspace->mru_list);
   g_list_free (workspace->list_containing_self);
 
@@ -152,15 +159,7 @@ meta_workspace_free (MetaWorkspace *workspace)
    */
 
   if (!workspace->work_areas_invalid)
-    {
-      workspace_free_struts (workspace);
-      for (i = 0; i < screen->n_monitor_infos; i++)
-        g_list_free_full (workspace->monitor_region[i], g_free);
-      g_free (workspace->monitor_region);
-      g_list_free_full (workspace->screen_region, g_free);
-      g_list_free_full (workspace->screen_edges, g_free);
-      g_list_free_full (workspace->monitor_edges, g_free);
-    }
+    workspace_release_work_areas (workspace);
 
   g_free (workspace);
 
@@ -199,7 +198,9 @@ meta_workspace_add_window (MetaWorkspace *workspace,
       workspace->mru_list = g_list_prepend (workspace->mru_list, window);
     }
 
-  workspace->windows = g_list_prepend (workspace->windows, window);
+  window->workspace_link.data = window;
+  workspace->windows = g_list_concat (&window->workspace_link,
+                                      workspace->windows);
   window->workspace = workspace;
 
   meta_window_set_current_workspace_hint (window);
@@ -224,7 +225,8 @@ meta_workspace_remove_window (MetaWorkspace *workspace,
 {
   g_return_if_fail (window->workspace == workspace);
 
-  workspace->windows = g_list_remove (workspace->windows, window);
+  workspace->windows = g_list_remove_link (workspace->windows,
+                                           &window->workspace_link);
   window->workspace = NULL;
 
   /* If the window is on all workspaces, we don't want to remove it
@@ -292,6 +294,10 @@ meta_workspace_relocate_windows (MetaWorkspace *workspace,
   g_assert (workspace->windows == NULL);
 }
 
+/* Only windows of the workspaces being switched between can change, and
+ * of those only the ones that aren't already shown or hidden as they
+ * should be; everything else stays as it is.
+ */
 static void
 meta_workspace_queue_calc_showing (MetaWorkspace *workspace)
 {
@@ -300,7 +306,11 @@ meta_workspace_queue_calc_showing (MetaWorkspace *workspace)
   tmp = workspace->windows;
   while (tmp != NULL)
     {
-      meta_window_queue (tmp->data, META_QUEUE_CALC_SHOWING);
+      MetaWindow *window = tmp->data;
+
+      if (!window->placed ||
+          meta_window_should_be_showing (window) != window->visible_to_compositor)
+        meta_window_queue (window, META_QUEUE_CALC_SHOWING);
 
       tmp = tmp->next;
     }
@@ -389,10 +399,13 @@ meta_workspace_activate_with_focus (MetaWorkspace *workspace,
   if (workspace->screen->active_workspace == workspace)
     return;
 
+  meta_round_trip_push_op (META_ROUND_TRIP_OP_WORKSPACE_SWITCH);
+
   /* Free any cached pointers to the workspaces's edges from
    * a current resize or move operation
    */
   meta_display_cleanup_edges (workspace->screen->display);
+  meta_display_cleanup_constraint_context (workspace->screen->display);
 
   if (workspace->screen->active_workspace)
     workspace_switch_sound(workspace->screen->active_workspace, workspace);
@@ -412,7 +425,10 @@ meta_workspace_activate_with_focus (MetaWorkspace *workspace,
     meta_screen_update_showing_desktop_hint (workspace->screen);
 
   if (old == NULL)
-    return;
+    {
+      meta_round_trip_pop_op ();
+      return;
+    }
 
   move_window = NULL;
   if (workspace->screen->display->grab_op == META_GRAB_OP_MOVING ||
@@ -460,6 +476,8 @@ meta_workspace_activate_with_focus (MetaWorkspace *workspace,
       meta_topic (META_DEBUG_FOCUS, "Focusing default window on new workspace\n");
       meta_workspace_focus_default_window (workspace, NULL, timestamp);
     }
+
+  meta_round_trip_pop_op ();
 }
 
 void
@@ -488,28 +506,23 @@ meta_workspace_index (MetaWorkspace *workspace)
 GList*
 meta_workspace_list_windows (MetaWorkspace *workspace)
 {
-  GSList *display_windows;
-  GSList *tmp;
+  GList *tmp;
   GList *workspace_windows;
 
-  display_windows = meta_display_list_windows (workspace->screen->display,
-                                               META_LIST_DEFAULT);
-
   workspace_windows = NULL;
-  tmp = display_windows;
+  tmp = workspace->screen->windows;
   while (tmp != NULL)
     {
       MetaWindow *window = tmp->data;
 
-      if (meta_window_located_on_workspace (window, workspace))
+      if (!window->override_redirect &&
+          meta_window_located_on_workspace (window, workspace))
         workspace_windows = g_list_prepend (workspace_windows,
                                             window);
 
       tmp = tmp->next;
     }
 
-  g_slist_free (display_windows);
-
   return workspace_windows;
 }
 
@@ -544,7 +557,6 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
 {
   GList *tmp;
   GList *windows;
-  int i;
 
   if (workspace->work_areas_invalid)
     {
@@ -564,21 +576,10 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
   if (workspace == workspace->screen->active_workspace)
     meta_display_cleanup_edges (workspace->screen->display);
 
-  g_free (workspace->work_area_monitor);
-  workspace->work_area_monitor = NULL;
+  /* The window being moved or resized may be on this workspace */
+  meta_display_cleanup_constraint_context (workspace->screen->display);
 
-  workspace_free_struts (workspace);
-
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
-    g_list_free_full (workspace->monitor_region[i], g_free);
-  g_free (workspace->monitor_region);
-  g_list_free_full (workspace->screen_region, g_free);
-  g_list_free_full (workspace->screen_edges, g_free);
-  g_list_free_full (workspace->monitor_edges, g_free);
-  workspace->monitor_region = NULL;
-  workspace->screen_region = NULL;
-  workspace->screen_edges = NULL;
-  workspace->monitor_edges = NULL;
+  workspace_release_work_areas (workspace);
 
   workspace->work_areas_invalid = TRUE;
 
@@ -602,176 +603,88 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
 static void
 ensure_work_areas_validated (MetaWorkspace *workspace)
 {
+  MetaScreen    *screen;
   GList         *windows;
   GList         *tmp;
+  GSList        *struts;
+  MetaRectangle *monitor_rects;
   MetaRectangle  work_area;
   int            i;  /* C89 absolutely sucks... */
 
   if (!workspace->work_areas_invalid)
     return;
 
-  g_assert (workspace->all_struts == NULL);
-  g_assert (workspace->monitor_region == NULL);
-  g_assert (workspace->screen_region == NULL);
-  g_assert (workspace->screen_edges == NULL);
-  g_assert (workspace->monitor_edges == NULL);
+  g_assert (workspace->screen_work_area == NULL);
+  g_assert (workspace->monitor_work_areas == NULL);
+
+  screen = workspace->screen;
 
   /* STEP 1: Get the list of struts */
+  struts = NULL;
   windows = meta_workspace_list_windows (workspace);
   for (tmp = windows; tmp != NULL; tmp = tmp->next)
     {
       MetaWindow *win = tmp->data;
       GSList *s_iter;
 
-      for (s_iter = win->struts; s_iter != NULL; s_iter = s_iter->next) {
-        MetaStrut *cpy = g_new (MetaStrut, 1);
-        *cpy = *((MetaStrut *)s_iter->data);
-        workspace->all_struts = g_slist_prepend (workspace->all_struts,
-                                                 cpy);
-      }
+      for (s_iter = win->struts; s_iter != NULL; s_iter = s_iter->next)
+        struts = g_slist_prepend (struts, s_iter->data);
     }
   g_list_free (windows);
 
-  /* STEP 2: Get the maximal/spanning rects for the onscreen and
-   *         on-single-monitor regions
+  /* STEP 2: Get the spanning rects and work areas for the screen and for
+   *         each monitor. Other workspaces with the same struts, or this
+   *         one before they last changed, have probably worked them out
+   *         already; see work-areas.h.
    */
-  g_assert (workspace->monitor_region == NULL);
-  g_assert (workspace->screen_region == NULL);
+  monitor_rects = g_new (MetaRectangle, MAX (screen->n_monitor_infos, 1));
+  for (i = 0; i < screen->n_monitor_infos; i++)
+    monitor_rects[i] = screen->monitor_infos[i].rect;
 
-  workspace->monitor_region = g_new (GList*,
-                                     workspace->screen->n_monitor_infos);
+  workspace->screen_work_area =
+    meta_work_area_cache_get_screen (screen->work_area_cache,
+                                     &screen->rect,
+                                     monitor_rects,
+                                     screen->n_monitor_infos,
+                                     struts);
 
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
-    {
-      workspace->monitor_region[i] =
-        meta_rectangle_get_minimal_spanning_set_for_region (
-          &workspace->screen->monitor_infos[i].rect,
-          workspace->all_struts,
-          FALSE);
-    }
-  workspace->screen_region =
-    meta_rectangle_get_minimal_spanning_set_for_region (
-      &workspace->screen->rect,
-      workspace->all_struts,
-      TRUE);
-
-  /* STEP 3: Get the work areas (region-to-maximize-to) for the screen and
-   *         monitors.
-   */
-  work_area = workspace->screen->rect;  /* start with the screen */
-  if (workspace->screen_region == NULL)
-    work_area = meta_rect (0, 0, -1, -1);
-  else
-    meta_rectangle_clip_to_region (workspace->screen_region,
-                                   FIXED_DIRECTION_NONE,
-                                   &work_area);
-
-  /* Lots of paranoia checks, forcing work_area_screen to be sane */
-#define MIN_SANE_AREA 100
-  if (work_area.width < MIN_SANE_AREA)
-    {
-      g_warning ("struts occupy an unusually large percentage of the screen; "
-                 "available remaining width = %d < %d",
-                 work_area.width, MIN_SANE_AREA);
-
-      if (work_area.width < 1)
-        {
-          work_area.x = (workspace->screen->rect.width - MIN_SANE_AREA)/2;
-          work_area.width = MIN_SANE_AREA;
-        }
-      else
-        {
-          int amount = (MIN_SANE_AREA - work_area.width)/2;
-          work_area.x     -=   amount;
-          work_area.width += 2*amount;
-        }
-    }
-  if (work_area.height < MIN_SANE_AREA)
-    {
-      g_warning ("struts occupy an unusually large percentage of the screen; "
-                 "available remaining height = %d < %d",
-                  work_area.height, MIN_SANE_AREA);
+  g_free (monitor_rects);
 
-      if (work_area.height < 1)
-        {
-          work_area.y = (workspace->screen->rect.height - MIN_SANE_AREA)/2;
-          work_area.height = MIN_SANE_AREA;
-        }
-      else
-        {
-          int amount = (MIN_SANE_AREA - work_area.height)/2;
-          work_area.y      -=   amount;
-          work_area.height += 2*amount;
-        }
-    }
-  workspace->work_area_screen = work_area;
+  work_area = workspace->screen_work_area->work_area;
   meta_topic (META_DEBUG_WORKAREA,
               "Computed work area for workspace %d: %d,%d %d x %d\n",
               meta_workspace_index (workspace),
-              workspace->work_area_screen.x,
-              workspace->work_area_screen.y,
-              workspace->work_area_screen.width,
-              workspace->work_area_screen.height);
+              work_area.x, work_area.y, work_area.width, work_area.height);
 
-  /* Now find the work areas for each monitor */
-  g_free (workspace->work_area_monitor);
-  workspace->work_area_monitor = g_new (MetaRectangle,
-                                        workspace->screen->n_monitor_infos);
+  workspace->n_monitor_work_areas = screen->n_monitor_infos;
+  workspace->monitor_work_areas = g_new (MetaWorkArea *,
+                                         screen->n_monitor_infos);
 
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
+  for (i = 0; i < screen->n_monitor_infos; i++)
     {
-      work_area = workspace->screen->monitor_infos[i].rect;
-
-      if (workspace->monitor_region[i] == NULL)
-        /* FIXME: constraints.c untested with this, but it might be nice for
-         * a screen reader or magnifier.
-         */
-        work_area = meta_rect (work_area.x, work_area.y, -1, -1);
-      else
-        meta_rectangle_clip_to_region (workspace->monitor_region[i],
-                                       FIXED_DIRECTION_NONE,
-                                       &work_area);
-
-      workspace->work_area_monitor[i] = work_area;
+      workspace->monitor_work_areas[i] =
+        meta_work_area_cache_get_monitor (screen->work_area_cache,
+                                          &screen->monitor_infos[i].rect,
+                                          struts);
+
+      work_area = workspace->monitor_work_areas[i]->work_area;
       meta_topic (META_DEBUG_WORKAREA,
                   "Computed work area for workspace %d "
                   "monitor %d: %d,%d %d x %d\n",
                   meta_workspace_index (workspace),
                   i,
-                  workspace->work_area_monitor[i].x,
-                  workspace->work_area_monitor[i].y,
-                  workspace->work_area_monitor[i].width,
-                  workspace->work_area_monitor[i].height);
-    }
-
-  /* STEP 4: Make sure the screen_region is nonempty (separate from step 2
-   *         since it relies on step 3).
-   */
-  if (workspace->screen_region == NULL)
-    {
-      MetaRectangle *nonempty_region;
-      nonempty_region = g_new (MetaRectangle, 1);
-      *nonempty_region = workspace->work_area_screen;
-      workspace->screen_region = g_list_prepend (NULL, nonempty_region);
+                  work_area.x, work_area.y, work_area.width, work_area.height);
     }
 
-  /* STEP 5: Cache screen and monitor edges for edge resistance and snapping */
-  g_assert (workspace->screen_edges == NULL);
-  g_assert (workspace->monitor_edges == NULL);
-
-  workspace->screen_edges =
-    meta_rectangle_find_onscreen_edges (&workspace->screen->rect,
-                                        workspace->all_struts);
-  tmp = NULL;
-  for (i = 0; i < workspace->screen->n_monitor_infos; i++)
-    tmp = g_list_prepend (tmp, &workspace->screen->monitor_infos[i].rect);
+  g_slist_free (struts);
 
-  workspace->monitor_edges =
-    meta_rectangle_find_nonintersected_monitor_edges (&workspace->screen->rect,
-                                                      tmp,
-                                                      workspace->all_struts);
-
-  g_list_free (tmp);
+  /* STEP 3: Point the fields the rest of us look at directly into the
+   *         screen's work area.
+   */
+  workspace->all_struts = workspace->screen_work_area->struts;
+  workspace->screen_region = workspace->screen_work_area->region;
+  workspace->screen_edges = workspace->screen_work_area->screen_edges;
+  workspace->monitor_edges = workspace->screen_work_area->monitor_edges;
 
   /* We're all done, YAAY!  Record that everything has been validated. */
   workspace->work_areas_invalid = FALSE;
@@ -787,7 +700,7 @@ meta_workspace_get_work_area_for_monitor (MetaWorkspace *workspace,
   ensure_work_areas_validated (workspace);
   g_assert (which_monitor < workspace->screen->n_monitor_infos);
 
-  *area = workspace->work_area_monitor[which_monitor];
+  *area = workspace->monitor_work_areas[which_monitor]->work_area;
 }
 
 void
@@ -796,7 +709,7 @@ meta_workspace_get_work_area_all_monitors (MetaWorkspace *workspace,
 {
   ensure_work_areas_validated (workspace);
 
-  *area = workspace->work_area_screen;
+  *area = workspace->screen_work_area->work_area;
 }
 
 GList*
@@ -813,7 +726,7 @@ meta_workspace_get_onmonitor_region (MetaWorkspace *workspace,
 {
   ensure_work_areas_validated (workspace);
 
-  return workspace->monitor_region[which_monitor];
+  return workspace->monitor_work_areas[which_monitor]->region;
 }
 
 static const gchar *
@@ -32,6 +32,7 @@
 #define META_WORKSPACE_H
 
 #include "window-private.h"
+#include "work-areas.h"
 
 /* Negative to avoid conflicting with real workspace
  * numbers
@@ -48,6 +49,9 @@ struct _MetaWorkspace
 {
   MetaScreen *screen;
 
+  /* The windows whose workspace this is, but not the sticky ones living
+   * elsewhere; the links are the windows' workspace_link.
+   */
   GList *windows;
 
   /* The "MRU list", or "most recently used" list, is a list of
@@ -63,10 +67,13 @@ struct _MetaWorkspace
 
   GList  *list_containing_self;
 
-  MetaRectangle work_area_screen;
-  MetaRectangle *work_area_monitor;
+  /* Shared with the other workspaces that have the same struts */
+  MetaWorkArea  *screen_work_area;
+  MetaWorkArea **monitor_work_areas;
+  int            n_monitor_work_areas;
+
+  /* These belong to screen_work_area */
   GList  *screen_region;
-  GList  **monitor_region;
   GList  *screen_edges;
   GList  *monitor_edges;
   GSList *all_struts;
@@ -83,6 +83,7 @@ from The Open Group.
 #include "errors.h"
 #include "util.h"
 #include "async-getprop.h"
+#include "round-trips.h"
 #include "ui.h"
 #include "metacity-Xatomtype.h"
 #include <X11/Xatom.h>
@@ -185,6 +186,9 @@ get_property (MetaDisplay        *display,
               Atom                req_type,
               GetPropertyResults *results)
 {
+  gint64 start_time;
+  int status;
+
   results->display = display;
   results->xwindow = xwindow;
   results->xatom = xatom;
@@ -195,13 +199,15 @@ get_property (MetaDisplay        *display,
   results->format = 0;
 
   meta_error_trap_push (display);
-  if (XGetWindowProperty (display->xdisplay, xwindow, xatom,
-                          0, G_MAXLONG,
-                          False, req_type, &results->type, &results->format,
-                          &results->n_items,
-                          &results->bytes_after,
-                          &results->prop) != Success ||
-      results->type == None)
+  start_time = meta_round_trip_begin ();
+  status = XGetWindowProperty (display->xdisplay, xwindow, xatom,
+                               0, G_MAXLONG,
+                               False, req_type, &results->type,
+                               &results->format, &results->n_items,
+                               &results->bytes_after, &results->prop);
+  meta_round_trip_end (G_STRFUNC, start_time);
+
+  if (status != Success || results->type == None)
     {
       if (results->prop)
         XFree (results->prop);
@@ -881,21 +887,35 @@ latin1_to_utf8 (const char *text)
   return g_string_free (str, FALSE);
 }
 
-void
-meta_prop_get_values (MetaDisplay   *display,
-                      Window         xwindow,
-                      MetaPropValue *values,
-                      int            n_values)
+struct _MetaPropRequest
 {
-  int i;
+  MetaDisplay        *display;
+  Window              xwindow;
+
+  MetaPropValue      *values;
+  int                 n_values;
+
   AgGetPropertyTask **tasks;
+};
+
+/**
+ * Sends the GetProperty requests for values without waiting for the
+ * replies, so that requests for many windows can be in flight at once.
+ * The values array must stay around until meta_prop_finish_request().
+ */
+MetaPropRequest*
+meta_prop_request_values (MetaDisplay   *display,
+                          Window         xwindow,
+                          MetaPropValue *values,
+                          int            n_values)
+{
+  MetaPropRequest *request;
+  AgGetPropertyTask **tasks;
+  int i;
 
   meta_verbose ("Requesting %d properties of 0x%lx at once\n",
                 n_values, xwindow);
 
-  if (n_values == 0)
-    return;
-
   tasks = g_new0 (AgGetPropertyTask*, n_values);
 
   /* Start up tasks. The "values" array can have values
@@ -964,12 +984,70 @@ meta_prop_get_values (MetaDisplay   *display,
       ++i;
     }
 
-  /* Get replies for all our tasks */
-  meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
-              n_values, G_STRFUNC);
-  XSync (display->xdisplay, False);
+  request = g_new0 (MetaPropRequest, 1);
+  request->display = display;
+  request->xwindow = xwindow;
+  request->values = values;
+  request->n_values = n_values;
+  request->tasks = tasks;
+
+  return request;
+}
+
+static gboolean
+request_has_replies (MetaPropRequest *request)
+{
+  int i;
+
+  for (i = 0; i < request->n_values; i++)
+    {
+      if (request->tasks[i] != NULL && !ag_task_have_reply (request->tasks[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * Fills in the values of a request made with meta_prop_request_values()
+ * and frees the request. This only blocks if some of the replies haven't
+ * been read yet; when requests for several windows were made up front,
+ * the first one to finish waits for all of them.
+ */
+void
+meta_prop_finish_request (MetaPropRequest *request)
+{
+  MetaDisplay *display;
+  Window xwindow;
+  MetaPropValue *values;
+  int n_values;
+  AgGetPropertyTask **tasks;
+  int i;
+
+  display = request->display;
+  xwindow = request->xwindow;
+  values = request->values;
+  n_values = request->n_values;
+  tasks = request->tasks;
+
+  if (!request_has_replies (request))
+    {
+      gint64 start_time;
+
+      meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
+                  n_values, G_STRFUNC);
+      start_time = meta_round_trip_begin ();
+      XSync (display->xdisplay, False);
+      meta_round_trip_end (G_STRFUNC, start_time);
+
+      /* Failed requests leave their tasks unanswered */
+      ag_fail_unanswered_tasks (display->xdisplay);
+    }
 
-  /* Collect results, should arrive in order requested */
+  /* Collect results; take each reply from its own task rather than
+   * the head of the completed list, since other requests may have
+   * completed in between.
+   */
   i = 0;
   while (i < n_values)
     {
@@ -985,8 +1063,7 @@ meta_prop_get_values (MetaDisplay   *display,
           goto next;
         }
 
-      task = ag_get_next_completed_task (display->xdisplay);
-      g_assert (task != NULL);
+      task = tasks[i];
       g_assert (ag_task_have_reply (task));
 
       results.display = display;
@@ -1120,6 +1197,247 @@ meta_prop_get_values (MetaDisplay   *display,
     }
 
   g_free (tasks);
+  g_free (request);
+}
+
+/* An asynchronous request, either for parsed values or for a raw range
+ * of a single property
+ */
+typedef struct
+{
+  MetaPropRequest    *request;
+  MetaPropValuesFunc  values_func;
+
+  AgGetPropertyTask  *task;
+  MetaPropRangeFunc   range_func;
+
+  gpointer            user_data;
+} PendingRequest;
+
+static gboolean
+pending_has_replies (PendingRequest *pending)
+{
+  if (pending->request != NULL)
+    return request_has_replies (pending->request);
+
+  return ag_task_have_reply (pending->task);
+}
+
+static void
+finish_pending (MetaDisplay    *display,
+                PendingRequest *pending)
+{
+  if (pending->request != NULL)
+    {
+      MetaPropValue *values;
+      int n_values;
+
+      values = pending->request->values;
+      n_values = pending->request->n_values;
+
+      meta_prop_finish_request (pending->request);
+
+      (* pending->values_func) (display, values, n_values,
+                                pending->user_data);
+    }
+  else
+    {
+      Atom type;
+      int format;
+      gulong n_items;
+      gulong bytes_after;
+      guchar *data;
+      int result;
+
+      type = None;
+      format = 0;
+      n_items = 0;
+      bytes_after = 0;
+      data = NULL;
+
+      result = ag_task_get_reply_and_free (pending->task,
+                                           &type, &format,
+                                           &n_items, &bytes_after,
+                                           &data);
+
+      (* pending->range_func) (display, result, type, format,
+                               n_items, bytes_after, data,
+                               pending->user_data);
+    }
+
+  g_free (pending);
+}
+
+void
+meta_prop_get_values (MetaDisplay   *display,
+                      Window         xwindow,
+                      MetaPropValue *values,
+                      int            n_values)
+{
+  if (n_values == 0)
+    return;
+
+  meta_prop_finish_request (meta_prop_request_values (display, xwindow,
+                                                      values, n_values));
+}
+
+/**
+ * Like meta_prop_get_values(), but doesn't wait for the replies; func is
+ * called from the event loop once they have all been read, and is
+ * expected to free the values. Requests complete in the order they were
+ * made.
+ */
+void
+meta_prop_get_values_async (MetaDisplay        *display,
+                            Window              xwindow,
+                            MetaPropValue      *values,
+                            int                 n_values,
+                            MetaPropValuesFunc  func,
+                            gpointer            user_data)
+{
+  PendingRequest *pending;
+
+  if (display->closing)
+    {
+      meta_prop_get_values (display, xwindow, values, n_values);
+      func (display, values, n_values, user_data);
+      return;
+    }
+
+  /* Errors are reported by the values coming back invalid */
+  pending = g_new0 (PendingRequest, 1);
+  meta_error_trap_push (display);
+  pending->request = meta_prop_request_values (display, xwindow,
+                                               values, n_values);
+  meta_error_trap_pop (display);
+  pending->values_func = func;
+  pending->user_data = user_data;
+
+  g_queue_push_tail (display->pending_prop_requests, pending);
+
+  meta_display_queue_reply_sentinel (display);
+}
+
+/**
+ * Asynchronously reads length 32-bit units of a property, starting at
+ * offset (also in 32-bit units), for callers that want to pick apart
+ * large properties without transferring all of them. func gets the
+ * data, to be freed with XFree(), or a non-Success result on error;
+ * it is called in order with meta_prop_get_values_async() callbacks.
+ */
+void
+meta_prop_get_range_async (MetaDisplay       *display,
+                           Window             xwindow,
+                           Atom               xatom,
+                           Atom               req_type,
+                           long               offset,
+                           long               length,
+                           MetaPropRangeFunc  func,
+                           gpointer           user_data)
+{
+  PendingRequest *pending;
+  AgGetPropertyTask *task;
+
+  /* Errors are reported by the result passed to func */
+  task = NULL;
+  if (!display->closing)
+    {
+      meta_error_trap_push (display);
+      task = ag_task_create (display->xdisplay, xwindow, xatom,
+                             offset, length, False, req_type);
+      meta_error_trap_pop (display);
+    }
+
+  if (task == NULL)
+    {
+      Atom type;
+      int format;
+      gulong n_items;
+      gulong bytes_after;
+      guchar *data;
+      int result;
+      int err;
+
+      type = None;
+      format = 0;
+      n_items = 0;
+      bytes_after = 0;
+      data = NULL;
+
+      meta_error_trap_push (display);
+      result = XGetWindowProperty (display->xdisplay, xwindow, xatom,
+                                   offset, length, False, req_type,
+                                   &type, &format, &n_items,
+                                   &bytes_after, &data);
+      err = meta_error_trap_pop_with_return (display);
+
+      if (err != Success)
+        result = err;
+
+      func (display, result, type, format, n_items, bytes_after, data,
+            user_data);
+      return;
+    }
+
+  pending = g_new0 (PendingRequest, 1);
+  pending->task = task;
+  pending->range_func = func;
+  pending->user_data = user_data;
+
+  g_queue_push_tail (display->pending_prop_requests, pending);
+
+  meta_display_queue_reply_sentinel (display);
+}
+
+/**
+ * Runs the callbacks of the asynchronous requests whose replies have
+ * arrived. Called for every event we get.
+ */
+void
+meta_prop_process_pending (MetaDisplay *display)
+{
+  /* A request that failed is never answered as far as its task can
+   * tell; once a later reply or the sentinel has come in, it is known
+   * to have failed.
+   */
+  ag_fail_unanswered_tasks (display->xdisplay);
+
+  /* Replies come back in request order, so stop at the first request
+   * that is still waiting; this also keeps the callbacks in order.
+   */
+  while (!g_queue_is_empty (display->pending_prop_requests))
+    {
+      PendingRequest *pending;
+
+      pending = g_queue_peek_head (display->pending_prop_requests);
+
+      if (!pending_has_replies (pending))
+        break;
+
+      g_queue_pop_head (display->pending_prop_requests);
+
+      finish_pending (display, pending);
+    }
+}
+
+/**
+ * Waits for and completes every outstanding asynchronous request.
+ */
+void
+meta_prop_flush_pending (MetaDisplay *display)
+{
+  gint64 start_time;
+
+  meta_prop_process_pending (display);
+
+  if (g_queue_is_empty (display->pending_prop_requests))
+    return;
+
+  start_time = meta_round_trip_begin ();
+  XSync (display->xdisplay, False);
+  meta_round_trip_end (G_STRFUNC, start_time);
+
+  meta_prop_process_pending (display);
 }
 
 static void
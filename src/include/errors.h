@@ -22,10 +22,32 @@
 
 #include "display.h"
 
-void meta_error_trap_push            (MetaDisplay *display);
+/* Called once the server has processed every request made under an
+ * asynchronously popped trap; error_code is Success or the code of the
+ * first error any of those requests caused.
+ */
+typedef void (* MetaErrorTrapFunc) (MetaDisplay *display,
+                                    int          error_code,
+                                    gpointer     user_data);
+
+void meta_error_trap_init            (MetaDisplay       *display);
+void meta_error_trap_shutdown        (MetaDisplay       *display);
+
+void meta_error_trap_push            (MetaDisplay       *display);
+
+void meta_error_trap_pop             (MetaDisplay       *display);
+
+/* A round trip this needs is accounted to site, see round-trips.h */
+int  meta_error_trap_pop_with_return_full (MetaDisplay       *display,
+                                           const char        *site);
+
+#define meta_error_trap_pop_with_return(display) \
+  meta_error_trap_pop_with_return_full ((display), G_STRFUNC)
 
-void meta_error_trap_pop             (MetaDisplay *display);
+void meta_error_trap_pop_async       (MetaDisplay       *display,
+                                      MetaErrorTrapFunc  func,
+                                      gpointer           user_data);
 
-int  meta_error_trap_pop_with_return (MetaDisplay *display);
+void meta_error_trap_process_pending (MetaDisplay       *display);
 
 #endif
@@ -76,6 +76,10 @@ void             meta_compositor_set_updates_frozen           (MetaCompositor
                                                                MetaWindow         *window,
                                                                gboolean            updates_frozen);
 
+void             meta_compositor_queue_frame_drawn            (MetaCompositor     *compositor,
+                                                               MetaWindow         *window,
+                                                               guint64             counter_value);
+
 void             meta_compositor_process_event                (MetaCompositor     *compositor,
                                                                XEvent             *event,
                                                                MetaWindow         *window);
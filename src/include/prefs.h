@@ -73,7 +73,8 @@ typedef enum
   META_PLACEMENT_MODE_CASCADE,
   META_PLACEMENT_MODE_CENTER,
   META_PLACEMENT_MODE_ORIGIN,
-  META_PLACEMENT_MODE_RANDOM
+  META_PLACEMENT_MODE_RANDOM,
+  META_PLACEMENT_MODE_MIN_OVERLAP
 } MetaPlacementMode;
 
 typedef void (* MetaPrefsChangedFunc) (MetaPreference pref,
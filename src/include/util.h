@@ -52,7 +52,8 @@ typedef enum
   META_DEBUG_EDGE_RESISTANCE = 1 << 18,
   META_DEBUG_VERBOSE = 1 << 19,
   META_DEBUG_VULKAN = 1 << 20,
-  META_DEBUG_DAMAGE_REGION = 1 << 21
+  META_DEBUG_DAMAGE_REGION = 1 << 21,
+  META_DEBUG_ROUND_TRIPS = 1 << 22
 } MetaDebugFlags;
 
 void meta_init_debug (void);
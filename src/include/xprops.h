@@ -188,4 +188,49 @@ void meta_prop_get_values (MetaDisplay   *display,
 void meta_prop_free_values (MetaPropValue *values,
                             int            n_values);
 
+/* Same as meta_prop_get_values(), split in two so the replies can be
+ * waited for later (or not at all, if they have arrived meanwhile)
+ */
+typedef struct _MetaPropRequest MetaPropRequest;
+
+MetaPropRequest* meta_prop_request_values (MetaDisplay     *display,
+                                           Window           xwindow,
+                                           MetaPropValue   *values,
+                                           int              n_values);
+void             meta_prop_finish_request (MetaPropRequest *request);
+
+/* Called with the values of a meta_prop_get_values_async() request */
+typedef void (* MetaPropValuesFunc) (MetaDisplay   *display,
+                                     MetaPropValue *values,
+                                     int            n_values,
+                                     gpointer       user_data);
+
+void meta_prop_get_values_async (MetaDisplay        *display,
+                                 Window              xwindow,
+                                 MetaPropValue      *values,
+                                 int                 n_values,
+                                 MetaPropValuesFunc  func,
+                                 gpointer            user_data);
+/* Called with a raw range of a property, see meta_prop_get_range_async() */
+typedef void (* MetaPropRangeFunc) (MetaDisplay   *display,
+                                    int            result,
+                                    Atom           type,
+                                    int            format,
+                                    unsigned long  n_items,
+                                    unsigned long  bytes_after,
+                                    unsigned char *data,
+                                    gpointer       user_data);
+
+void meta_prop_get_range_async  (MetaDisplay        *display,
+                                 Window              xwindow,
+                                 Atom                xatom,
+                                 Atom                req_type,
+                                 long                offset,
+                                 long                length,
+                                 MetaPropRangeFunc   func,
+                                 gpointer            user_data);
+
+void meta_prop_process_pending  (MetaDisplay        *display);
+void meta_prop_flush_pending    (MetaDisplay        *display);
+
 #endif